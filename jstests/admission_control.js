@@ -0,0 +1,93 @@
+// test the read and write ticket pools used for admission control
+
+var admin = db.getSisterDB('admin');
+t = db.admission_control;
+t.drop();
+
+function status() {
+    return db.serverStatus().admissionControl;
+}
+
+function getTickets(name) {
+    var cmd = { getParameter: 1 };
+    cmd[name] = 1;
+    return admin.runCommand(cmd)[name];
+}
+
+function setTickets(name, n) {
+    var cmd = { setParameter: 1 };
+    cmd[name] = n;
+    return admin.runCommand(cmd);
+}
+
+[ 'read', 'write' ].forEach(function(pool) {
+    var s = status()[pool];
+    [ 'out', 'available', 'totalTickets', 'queued', 'totalQueued', 'queuedMicros' ].forEach(function(f) {
+        assert(s.hasOwnProperty(f), pool + ' is missing ' + f + ': ' + tojson(s));
+    });
+    assert.eq(s.totalTickets, getTickets(pool + 'Tickets'));
+    // serverStatus is exempt, so it does not hold a ticket of its own
+    assert.eq(0, s.out, pool);
+    assert.eq(s.totalTickets, s.available, pool);
+});
+
+var origRead = getTickets('readTickets');
+var origWrite = getTickets('writeTickets');
+
+// the pools can be resized at runtime
+assert.commandWorked(setTickets('readTickets', 5));
+assert.commandWorked(setTickets('writeTickets', 3));
+assert.eq(5, getTickets('readTickets'));
+assert.eq(3, getTickets('writeTickets'));
+assert.eq(5, status().read.totalTickets);
+assert.eq(3, status().write.totalTickets);
+
+assert.commandFailed(setTickets('readTickets', 0));
+assert.commandFailed(setTickets('writeTickets', -1));
+assert.eq(5, getTickets('readTickets'));
+assert.eq(3, getTickets('writeTickets'));
+
+// with a single ticket per pool, operations still go through, one at a time
+assert.commandWorked(setTickets('readTickets', 1));
+assert.commandWorked(setTickets('writeTickets', 1));
+for (var i = 0; i < 100; i++) {
+    t.insert({ _id: i, a: i });
+}
+t.update({ a: { $lt: 50 } }, { $inc: { a: 100 } }, false, true);
+t.remove({ _id: { $gte: 90 } });
+assert.eq(null, db.getLastError());
+assert.eq(90, t.find().itcount());
+assert.eq(50, t.count({ a: { $gte: 100 } }));
+
+// concurrent clients queue for the single write ticket instead of failing
+var threads = [];
+for (var i = 0; i < 4; i++) {
+    threads.push(startParallelShell('for (var j = 0; j < 200; j++) { db.admission_control.insert({ t: ' + i + ', j: j }); } db.getLastError();'));
+}
+threads.forEach(function(join) { join(); });
+assert.eq(800, t.count({ t: { $exists: true } }));
+assert.eq(0, status().write.queued);
+assert.eq(0, status().write.out);
+
+// commands that read, like aggregate, wait for a read ticket too
+var sleeper = startParallelShell('db.admission_control.findOne({ _id: 0, $where: function() { sleep(3000); return true; } });');
+assert.soon(function() {
+    return db.currentOp().inprog.some(function(op) {
+        return op.active && op.ns == t.getFullName() && op.query && op.query.$where;
+    });
+}, 'the sleeping query never started');
+assert.eq(1, status().read.out);
+var queuedBefore = status().read.totalQueued;
+var res = t.aggregate({ $match: { t: 0 } }, { $group: { _id: '$t', n: { $sum: 1 } } });
+assert.commandWorked(res);
+assert.eq(200, res.result[0].n);
+assert.lt(queuedBefore, status().read.totalQueued, 'aggregate did not wait for a read ticket');
+sleeper();
+assert.eq(0, status().read.queued);
+assert.eq(0, status().read.out);
+
+assert.commandWorked(setTickets('readTickets', origRead));
+assert.commandWorked(setTickets('writeTickets', origWrite));
+assert.eq(origRead, status().read.totalTickets);
+assert.eq(origWrite, status().write.totalTickets);
+t.drop();
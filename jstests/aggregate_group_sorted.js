@@ -0,0 +1,66 @@
+// $group streams its results when its input is sorted on the group key, either by a preceding
+// $sort or by a covered index scan, and gives the same groups as the hash based $group.
+
+var coll = db.aggregate_group_sorted;
+coll.drop();
+for (var i = 0; i < 300; i++) {
+    coll.insert({ a: i % 13, b: i });
+}
+// missing and null keys make one group
+coll.insert({ b: 1000 });
+coll.insert({ a: null, b: 1001 });
+coll.insert({ b: 1003 });
+coll.insert({ a: "str", b: 1004 });
+coll.insert({ a: 4.0, b: 1005 });
+
+function groupSpec() {
+    return { $group: { _id: "$a", n: { $sum: 1 }, total: { $sum: "$b" } } };
+}
+
+function explainGroup(pipeline) {
+    var res = db.runCommand({ aggregate: coll.getName(), pipeline: pipeline, explain: true });
+    assert.commandWorked(res);
+    var group = null;
+    res.serverPipeline.forEach(function(stage) {
+        if (stage.$group) {
+            group = stage.$group;
+        }
+    });
+    assert.neq(null, group, "no $group in " + tojson(res));
+    return group;
+}
+
+function sortedResults(pipeline) {
+    var res = coll.aggregate(pipeline);
+    assert.commandWorked(res);
+    // group output order is unspecified
+    return res.result.sort(function(l, r) { return tojson(l._id) < tojson(r._id) ? -1 : 1; });
+}
+
+var expected = sortedResults([ groupSpec() ]);
+assert.eq(15, expected.length, "groups");
+assert.eq(undefined, explainGroup([ groupSpec() ]).$streaming, "unsorted input");
+
+// a preceding $sort on the group key, in either direction, with other fields following
+[ { a: 1 }, { a: -1 }, { a: 1, b: -1 } ].forEach(function(sort) {
+    var pipeline = [ { $sort: sort }, groupSpec() ];
+    assert.eq(true, explainGroup(pipeline).$streaming, "sorted by " + tojson(sort));
+    assert.eq(expected, sortedResults(pipeline), "sorted by " + tojson(sort));
+});
+
+// sorted on something else
+assert.eq(undefined, explainGroup([ { $sort: { b: 1, a: 1 } }, groupSpec() ]).$streaming,
+          "sorted by b");
+
+// a covering index on the key gives sorted input without a $sort
+coll.ensureIndex({ a: 1, b: 1 });
+assert.eq(true, explainGroup([ groupSpec() ]).$streaming, "covering index");
+assert.eq(expected, sortedResults([ groupSpec() ]), "covering index");
+
+var matched = [ { $match: { a: { $gte: 5 } } }, groupSpec() ];
+assert.eq(true, explainGroup(matched).$streaming, "covering index with $match");
+assert.eq(8, sortedResults(matched).length, "covering index with $match");
+
+// an index that doesn't cover isn't worth the ordered scan
+var uncovered = [ { $group: { _id: "$a", b: { $max: "$b" }, c: { $first: "$c" } } } ];
+assert.eq(undefined, explainGroup(uncovered).$streaming, "not covered");
@@ -0,0 +1,46 @@
+// $group only streams on a $sort absorbed into an index cursor if the index isn't multikey: the
+// index orders documents by their smallest array element, not by the whole array $group groups by.
+
+var coll = db.aggregate_group_sorted_arrays;
+coll.drop();
+coll.insert({ _id: 0, a: [ 1, 5 ], b: 1 });
+coll.insert({ _id: 1, a: 1, b: 2 });
+coll.insert({ _id: 2, a: [ 1, 5 ], b: 3 });
+coll.insert({ _id: 3, a: 2, b: 4 });
+coll.insert({ _id: 4, a: [ 0, 7 ], b: 5 });
+coll.insert({ _id: 5, a: 1, b: 6 });
+
+var group = { $group: { _id: "$a", n: { $sum: 1 }, total: { $sum: "$b" } } };
+var pipeline = [ { $sort: { a: 1 } }, group ];
+
+function explainGroup(pipeline) {
+    var res = db.runCommand({ aggregate: coll.getName(), pipeline: pipeline, explain: true });
+    assert.commandWorked(res);
+    var found = null;
+    res.serverPipeline.forEach(function(stage) {
+        if (stage.$group) {
+            found = stage.$group;
+        }
+    });
+    assert.neq(null, found, "no $group in " + tojson(res));
+    return found;
+}
+
+function sortedResults(pipeline) {
+    var res = coll.aggregate(pipeline);
+    assert.commandWorked(res);
+    return res.result.sort(function(l, r) { return tojson(l._id) < tojson(r._id) ? -1 : 1; });
+}
+
+var expected = sortedResults([ group ]);
+assert.eq(4, expected.length, tojson(expected));
+
+// an in memory $sort compares whole arrays, so streaming is fine
+assert.eq(true, explainGroup(pipeline).$streaming, "in memory sort");
+assert.eq(expected, sortedResults(pipeline), "in memory sort");
+
+// with the $sort done by a multikey index, [1,5] comes before and after 1
+coll.ensureIndex({ a: 1 });
+assert.eq(undefined, explainGroup(pipeline).$streaming, "multikey index");
+assert.eq(expected, sortedResults(pipeline), "multikey index");
+assert.eq(expected, sortedResults([ { $sort: { a: -1 } }, group ]), "multikey index descending");
@@ -0,0 +1,87 @@
+// Check that the analyze command saves index statistics, and that the query optimizer uses them
+// to leave out plans that would scan many more keys than others.
+
+t = db.jstests_analyze;
+t.drop();
+
+t.ensureIndex( {a:1} );
+t.ensureIndex( {b:1} );
+for( i = 0; i < 5000; ++i ) {
+    t.insert( {a:i, b:i % 2} );
+}
+db.getLastError();
+
+function clearQueryCache() {
+    t.ensureIndex( {c:1} );
+    t.dropIndex( {c:1} );
+}
+
+function nPlans( query ) {
+    return t.find( query ).explain( true ).allPlans.length;
+}
+
+assert.commandFailed( db.runCommand( {analyze:"jstests_analyze_missing"} ) );
+assert.commandFailed( db.runCommand( {analyze:"jstests_analyze", index:"nosuchindex"} ) );
+assert.commandFailed( db.runCommand( {analyze:"jstests_analyze", buckets:0} ) );
+
+res = db.runCommand( {analyze:"jstests_analyze", buckets:20} );
+assert.commandWorked( res );
+assert.eq( 3, res.indexes.length );
+
+stats = db.system.indexStats.findOne( {_id:t.getFullName() + ".$b_1"} );
+assert( stats, "no statistics saved for b_1" );
+assert.eq( {b:1}, stats.key );
+assert.eq( 5000, stats.numKeys );
+assert.lte( stats.distinct, 100, "b has two values" );
+assert.eq( 0, stats.bounds[ 0 ].b );
+assert.eq( 1, stats.bounds[ stats.bounds.length - 1 ].b );
+
+stats = db.system.indexStats.findOne( {_id:t.getFullName() + ".$a_1"} );
+assert.lt( 10, stats.bounds.length );
+assert.gt( stats.distinct, 1000, "a is unique" );
+assert.eq( 0, stats.bounds[ 0 ].a );
+assert.eq( 4999, stats.bounds[ stats.bounds.length - 1 ].a );
+
+// Now the scan of half of b_1 is left out.
+pruned = db.serverStatus().metrics.queryOptimizer.prunedPlans;
+clearQueryCache();
+explain = t.find( {a:5, b:1} ).explain( true );
+assert.eq( 1, explain.allPlans.length );
+assert.eq( "IndexCursor a_1", explain.cursor );
+assert.eq( 1, explain.n );
+assert.lt( pruned, db.serverStatus().metrics.queryOptimizer.prunedPlans );
+
+// Ranges are estimated from the histogram.
+clearQueryCache();
+assert.eq( 1, nPlans( {a:{$gte:100, $lt:110}, b:{$gte:0}} ) );
+
+// A plan that provides the sort order is still raced.
+clearQueryCache();
+assert.eq( 2, t.find( {a:{$lt:10}, b:1} ).sort( {b:1} ).explain( true ).allPlans.length );
+
+// Analyzing one index leaves the others' statistics alone.
+assert.commandWorked( db.runCommand( {analyze:"jstests_analyze", index:"a_1"} ) );
+assert.eq( 3, db.system.indexStats.count( {ns:t.getFullName()} ) );
+
+// Pruning can be turned off, then both indexes are raced.
+assert.commandWorked( db.adminCommand( {setParameter:1, queryOptimizerPruneFactor:0} ) );
+clearQueryCache();
+assert.eq( 2, nPlans( {a:5, b:1} ) );
+assert.commandWorked( db.adminCommand( {setParameter:1, queryOptimizerPruneFactor:10} ) );
+
+// A compound index with a common first value isn't estimated as scanning every key having it.
+t.ensureIndex( {b:1, a:1} );
+assert.commandWorked( db.runCommand( {analyze:"jstests_analyze", index:"b_1_a_1", buckets:20} ) );
+clearQueryCache();
+assert.eq( 2, nPlans( {a:5, b:1} ) );
+
+// Dropping an index drops its statistics, an index made again starts with none.
+t.dropIndex( {b:1, a:1} );
+assert.eq( null, db.system.indexStats.findOne( {_id:t.getFullName() + ".$b_1_a_1"} ) );
+t.ensureIndex( {b:1, a:1} );
+clearQueryCache();
+assert.eq( 2, nPlans( {a:5, b:1} ) );
+
+t.drop();
+assert.eq( 0, db.system.indexStats.count( {ns:t.getFullName()} ) );
+
@@ -0,0 +1,61 @@
+// benchRun latency percentiles, transaction blocks, write concern and throughput windows
+
+t = db.bench_test4;
+t.drop();
+t.insert( { _id : 1 , x : 0 } );
+db.getLastError();
+
+ops = [
+    { op : "beginTransaction" , isolation : "serializable" } ,
+    { op : "update" , ns : t.getFullName() , query : { _id : 1 } , update : { $inc : { x : 1 } } } ,
+    { op : "insert" , ns : t.getFullName() , doc : { y : 1 } , writeConcern : { w : 1 } } ,
+    { op : "commitTransaction" }
+];
+
+seconds = 1;
+
+benchArgs = { ops : ops , parallel : 2 , seconds : seconds , host : db.getMongo().host ,
+              db : db.getName() , throughputWindowSeconds : 0.25 };
+
+if (jsTest.options().auth) {
+    benchArgs['db'] = 'admin';
+    benchArgs['username'] = jsTest.options().adminUser;
+    benchArgs['password'] = jsTest.options().adminPassword;
+}
+res = benchRun( benchArgs );
+printjson( res );
+
+assert( res.latency.update , "no update latencies" );
+assert( res.latency.insert , "no insert latencies" );
+assert( res.latency.transaction , "no transaction latencies" );
+var u = res.latency.update;
+assert.lte( u.p50Micros , u.p95Micros , "A1" );
+assert.lte( u.p95Micros , u.p99Micros , "A2" );
+assert.lte( u.p99Micros , u.p999Micros , "A3" );
+assert.lte( u.p999Micros , u.maxMicros , "A4" );
+assert.gt( res.transactions , 0 , "B1" );
+
+// each committed transaction did one update and one insert
+var committed = res.latency.transaction.count;
+assert.eq( committed , t.findOne( { _id : 1 } ).x , "C1" );
+assert.eq( committed , t.count( { y : 1 } ) , "C2" );
+
+assert.gte( res.throughput.length , 3 , "D1" );
+
+// a failing statement rolls back the rest of its transaction
+t.drop();
+t.insert( { _id : 1 , x : 0 } );
+db.getLastError();
+benchArgs['ops'] = [
+    { op : "beginTransaction" } ,
+    { op : "update" , ns : t.getFullName() , query : { _id : 1 } , update : { $inc : { x : 1 } } } ,
+    { op : "insert" , ns : t.getFullName() , doc : { _id : 1 } , safe : true , throwGLE : true ,
+      handleError : true , hideErrors : true } ,
+    { op : "commitTransaction" }
+];
+benchArgs['parallel'] = 1;
+benchArgs['hideErrors'] = true;
+res = benchRun( benchArgs );
+printjson( res );
+assert.gt( res.transactionsRolledBack , 0 , "E1" );
+assert.eq( 0 , t.findOne( { _id : 1 } ).x , "E2" );
@@ -0,0 +1,62 @@
+// Test partitioned capped collections, which trim by dropping whole partitions.
+
+var t = db.capped_partitioned;
+t.drop();
+
+// capped partitioned collections need a size or max, and cannot define a primary key
+assert.commandFailed(db.runCommand({create: t.getName(), capped: true, partitioned: true}));
+assert.commandFailed(db.runCommand({create: t.getName(), capped: true, partitioned: true, size: 100000,
+                                    primaryKey: {a: 1, _id: 1}}));
+assert.commandFailed(db.runCommand({create: t.getName(), capped: true, partitioned: true, size: 100000,
+                                    cappedPartitions: 1}));
+
+assert.commandWorked(db.runCommand({create: t.getName(), capped: true, partitioned: true,
+                                    max: 100, size: 10000000, cappedPartitions: 4}));
+var stats = t.stats();
+assert(stats.capped, "stats should say capped");
+assert(stats.partitioned, "stats should say partitioned");
+assert.eq(4, stats.cappedPartitions);
+
+// 25 documents fill a partition. Once one is full a new partition gets added, and
+// the oldest partitions are dropped so that only 4 remain.
+for (var batch = 1; batch <= 8; batch++) {
+    for (var i = (batch - 1) * 25; i < batch * 25; i++) {
+        t.insert({_id: i, a: i});
+        assert.eq(null, db.getLastError());
+    }
+    assert.soon(function() {
+        return db.runCommand({getPartitionInfo: t.getName()}).numPartitions == Math.min(batch + 1, 4);
+    }, "partitions were never rotated after batch " + batch, 30 * 1000);
+}
+
+// what is left is the most recent 3 full partitions, in insertion order
+var docs = t.find().sort({$natural: 1}).toArray();
+assert.eq(75, docs.length);
+for (var i = 0; i < docs.length; i++) {
+    assert.eq(125 + i, docs[i].a);
+}
+assert.eq(199, t.find().sort({$natural: -1}).limit(1).next().a);
+
+// removes are not allowed, updates may not grow the document
+t.remove({_id: 199});
+assert.neq(null, db.getLastError());
+t.update({_id: 199}, {$set: {a: 'a much longer string than the number'}});
+assert.neq(null, db.getLastError());
+t.update({_id: 199}, {$set: {a: -1}});
+assert.eq(null, db.getLastError());
+assert.eq(-1, t.findOne({_id: 199}).a);
+
+// tailable cursors work, and see new inserts
+var c = t.find().addOption(DBQuery.Option.tailable);
+var n = 0;
+while (c.hasNext()) {
+    c.next();
+    n++;
+}
+assert.eq(docs.length, n);
+t.insert({_id: 200, a: 200});
+assert.eq(null, db.getLastError());
+assert(c.hasNext(), "tailable cursor should see the new document");
+assert.eq(200, c.next().a);
+
+t.drop();
@@ -0,0 +1,61 @@
+// Aggregation pipelines whose dependencies all live in one secondary index are answered from
+// the index keys, without fetching documents.
+
+var coll = db.getCollection("covered_aggregate");
+coll.drop();
+for (var i = 0; i < 100; i++) {
+    coll.insert({ a: i % 10, b: i, c: "x" + i });
+}
+coll.ensureIndex({ a: 1 });
+coll.ensureIndex({ a: 1, b: 1 });
+coll.ensureIndex({ c: 1 }, { sparse: true });
+
+function serverPipeline(pipeline) {
+    var res = db.runCommand({ aggregate: coll.getName(), pipeline: pipeline, explain: true });
+    assert.commandWorked(res);
+    return res.serverPipeline[0];
+}
+
+function results(pipeline) {
+    var res = coll.aggregate(pipeline);
+    assert.commandWorked(res);
+    return res.result;
+}
+
+// $group by an indexed field with $sum: 1 uses the narrowest covering index
+var groupByA = [ { $group: { _id: "$a", n: { $sum: 1 } } }, { $sort: { _id: 1 } } ];
+var explain = serverPipeline(groupByA);
+assert.eq(true, explain.indexOnly, "group by a - indexOnly");
+assert.eq("IndexCursor a_1", explain.cursor.cursor, "group by a - cursor");
+assert.eq(0, explain.cursor.nscannedObjects, "group by a - nscannedObjects");
+var res = results(groupByA);
+assert.eq(10, res.length, "group by a - groups");
+res.forEach(function(g, i) { assert.eq({ _id: i, n: 10 }, g, "group by a"); });
+
+// with an initial $match on indexed fields
+var matchGroup = [ { $match: { a: { $gte: 5 } } },
+                   { $group: { _id: "$a", total: { $sum: "$b" } } },
+                   { $sort: { _id: 1 } } ];
+explain = serverPipeline(matchGroup);
+assert.eq(true, explain.indexOnly, "match and group - indexOnly");
+res = results(matchGroup);
+assert.eq(5, res.length, "match and group - groups");
+assert.eq({ _id: 5, total: 5 * 10 + 450 }, res[0], "match and group");
+
+// a field outside every index needs the documents
+var groupByBC = [ { $group: { _id: "$b", c: { $first: "$c" }, a: { $first: "$a" } } } ];
+explain = serverPipeline(groupByBC);
+assert.eq(false, explain.indexOnly, "uncovered - indexOnly");
+assert.eq(100, results(groupByBC).length, "uncovered");
+
+// a sparse index would miss documents, so it is never used to cover
+coll.insert({ a: 0, b: 1000 });
+var groupByC = [ { $group: { _id: "$c", n: { $sum: 1 } } } ];
+explain = serverPipeline(groupByC);
+assert.eq(false, explain.indexOnly, "sparse - indexOnly");
+assert.eq(101, results(groupByC).length, "sparse");
+
+// multikey indexes can't cover
+coll.insert({ a: [ 1, 2 ], b: 2000 });
+explain = serverPipeline(groupByA);
+assert.eq(false, explain.indexOnly, "multikey - indexOnly");
@@ -0,0 +1,43 @@
+// Test that getLastError with j/fsync waits on the shared log flusher, and that
+// concurrent waiters can share flushes.
+
+var t = db.gle_log_flush;
+t.drop();
+
+var metrics = function() {
+    return db.serverStatus().metrics.logFlusher;
+};
+
+var before = metrics();
+t.insert({ a: 1 });
+var res = db.runCommand({ getlasterror: 1, j: true });
+assert.commandWorked(res);
+assert.eq(null, res.err);
+res = db.runCommand({ getlasterror: 1, fsync: true });
+assert.commandWorked(res);
+var after = metrics();
+assert.lte(before.flushes + 2, after.flushes);
+assert.lte(before.waiters + 2, after.waiters);
+assert.lte(before.flushMicros, after.flushMicros);
+
+// Every waiter gets its own turn, but never needs more than one flush.
+before = metrics();
+var nShells = 4;
+var perShell = 200;
+var shells = [];
+for (var n = 0; n < nShells; n++) {
+    shells.push(startParallelShell(
+        'for (var i = 0; i < ' + perShell + '; i++) {' +
+        '    db.gle_log_flush.insert({ s: ' + n + ', i: i });' +
+        '    var r = db.runCommand({ getlasterror: 1, j: true });' +
+        '    assert.commandWorked(r); assert.eq(null, r.err);' +
+        '}'));
+}
+shells.forEach(function(s) { s(); });
+after = metrics();
+assert.eq(nShells * perShell + 1, t.count());
+assert.lte(before.waiters + nShells * perShell, after.waiters);
+assert.lte(after.flushes - before.flushes, after.waiters - before.waiters);
+print('log flushes: ' + (after.flushes - before.flushes) + ' for ' + (after.waiters - before.waiters) + ' waiters');
+
+t.drop();
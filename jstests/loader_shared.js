@@ -0,0 +1,86 @@
+// Test that several connections can insert into one shared bulk load.
+
+var filename;
+if (TestData.testDir !== undefined) {
+    load(TestData.testDir + "/_loader_helpers.js");
+} else {
+    load('jstests/_loader_helpers.js');
+}
+
+var beginSharedLoad = function(ns, indexes, options) {
+    var res = db.runCommand({ 'beginLoad' : 1, 'ns' : ns, 'indexes' : indexes, 'options' : options, 'shared' : true });
+    assert.commandWorked(res);
+    assert(res.loadToken);
+    return res.loadToken;
+};
+
+var testJoinRequiresToken = function() {
+    t = db.loadershared;
+    t.drop();
+    begin();
+    beginLoad('loadershared', [ ], { });
+    // The load was not shared, so nobody can join it.
+    s = startParallelShell('assert.commandFailed(db.runCommand({ joinLoad: 1, ns: "loadershared", token: new ObjectId() }));'); s();
+    commitLoad();
+    commit();
+
+    t.drop();
+    begin();
+    var token = beginSharedLoad('loadershared', [ ], { });
+    s = startParallelShell('assert.commandFailed(db.runCommand({ joinLoad: 1, ns: "loadershared", token: new ObjectId() }));' +
+                           'db.loadershared.insert({ _id: 0 }); assert(db.getLastError());'); s();
+    // The owner of the load cannot join it.
+    assert.commandFailed(db.runCommand({ joinLoad: 1, ns: 'loadershared', token: token }));
+    commitLoad();
+    commit();
+    assert.eq(0, t.count());
+}();
+
+var testParallelInserts = function() {
+    t = db.loadershared;
+    t.drop();
+    begin();
+    var token = beginSharedLoad('loadershared', [ { key: { a: 1 }, ns: db.getName() + '.loadershared', name: 'a_1' } ], { });
+
+    // Enough data per joiner to fill more than one intake batch.
+    var nShells = 3;
+    var perShell = 10000;
+    var shells = [];
+    for (var n = 0; n < nShells; n++) {
+        shells.push(startParallelShell(
+            'assert.commandWorked(db.runCommand({ joinLoad: 1, ns: "loadershared", token: ' + tojson(token) + ' }));' +
+            'var pad = new Array(200).join("x");' +
+            'for (var i = ' + (n * perShell) + '; i < ' + ((n + 1) * perShell) + '; i++) {' +
+            '    db.loadershared.insert({ _id: i, a: i % 10, pad: pad });' +
+            '}' +
+            'assert(!db.getLastError());'));
+    }
+    // The owner can insert as well.
+    for (i = nShells * perShell; i < nShells * perShell + 100; i++) {
+        t.insert({ _id: i, a: i % 10 });
+    }
+    shells.forEach(function(s) { s(); });
+
+    commitLoad();
+    commit();
+    assert.eq(nShells * perShell + 100, t.count());
+    assert.eq((nShells * perShell + 100) / 10, t.count({ a: 3 }));
+    assert.eq(nShells * perShell + 100, t.find().hint({ a: 1 }).itcount());
+
+    // Once the load is over the collection is open to everyone.
+    s = startParallelShell('db.loadershared.insert({ _id: -1 }); assert(!db.getLastError());'); s();
+    assert.eq(nShells * perShell + 101, t.count());
+}();
+
+var testDuplicateAcrossJoinersFails = function() {
+    t = db.loadershared;
+    t.drop();
+    begin();
+    var token = beginSharedLoad('loadershared', [ ], { });
+    s = startParallelShell('assert.commandWorked(db.runCommand({ joinLoad: 1, ns: "loadershared", token: ' + tojson(token) + ' }));' +
+                           'db.loadershared.insert({ _id: 1 }); assert(!db.getLastError());'); s();
+    t.insert({ _id: 1 });
+    commitLoadShouldFail();
+    rollback();
+    assert.eq(0, t.count());
+}();
@@ -6,7 +6,7 @@ t = db.part_coll_simple;
 t.drop();
 
 // verify that we cannot create a partitioned collection
-// with a custom PK or with a capped collection
+// with a custom PK or as a capped collection without a size
 assert.commandFailed(db.runCommand({ create: 'part_coll_simple', partitioned:1, capped:1}));
 assert.commandFailed(db.runCommand({ create: 'part_coll_simple', partitioned:1, capped:1, primaryKey: { a: 1, _id: 1 } }));
 
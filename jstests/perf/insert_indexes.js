@@ -0,0 +1,56 @@
+// Insert throughput into a collection with 10 secondary indexes, for documents that
+// take the single key path for every index and for documents whose arrays need the
+// general multikey path.
+
+t = db.perf.insert_indexes;
+
+var N = 100000;
+var batch = 1000;
+
+function doc(i, multikey) {
+    var d = { _id: i };
+    for (var f = 0; f < 10; f++) {
+        d['f' + f] = (i * (f + 7)) % 1000;
+    }
+    d.s = 'str' + (i % 5000);
+    d.sub = { x: i % 100, y: 'y' + (i % 17) };
+    if (multikey) {
+        d.f9 = [ i % 10, i % 11 ];
+    }
+    return d;
+}
+
+function run(multikey) {
+    t.drop();
+    for (var f = 0; f < 8; f++) {
+        var key = {};
+        key['f' + f] = 1;
+        if (f % 2 == 1) {
+            key.s = -1;
+        }
+        t.ensureIndex(key);
+    }
+    t.ensureIndex({ 'sub.x': 1, 'sub.y': 1 });
+    t.ensureIndex({ f9: 1 });
+    assert.eq(11, t.getIndexes().length);
+
+    var ms = Date.timeFunc(function() {
+        for (var i = 0; i < N; i += batch) {
+            var docs = [];
+            for (var j = i; j < i + batch; j++) {
+                docs.push(doc(j, multikey));
+            }
+            t.insert(docs);
+        }
+        db.getLastError();
+    });
+    assert.eq(N, t.count());
+    print((multikey ? 'multikey' : 'single key') + ': ' + N + ' inserts in ' + ms + 'ms, ' +
+          Math.round(N * 1000 / ms) + ' inserts/s');
+}
+
+for (var i = 0; i < 3; i++) {
+    run(false);
+    run(true);
+}
+t.drop();
@@ -0,0 +1,55 @@
+// test the profile command's sampleRate, and that queued profile entries show up in
+// system.profile as soon as it is read
+
+// special db so that it can be run in parallel tests
+var stddb = db;
+var db = db.getSisterDB("profile_sample");
+
+t = db.profile_sample;
+
+function inserts() {
+    return db.system.profile.find( { op : "insert" , ns : t.getFullName() } ).count();
+}
+
+try {
+    db.setProfilingLevel(0);
+    db.system.profile.drop();
+    t.drop();
+
+    var res = db.runCommand( { profile : -1 } );
+    assert.eq( 1 , res.sampleRate , tojson( res ) );
+
+    assert.commandFailed( db.runCommand( { profile : 2 , sampleRate : 1.5 } ) );
+    assert.commandFailed( db.runCommand( { profile : 2 , sampleRate : -1 } ) );
+    assert.eq( 1 , db.runCommand( { profile : -1 } ).sampleRate );
+
+    // everything is recorded, and visible right away
+    db.setProfilingLevel(2);
+    for ( var i = 0; i < 100; i++ ) {
+        t.insert( { i : i } );
+    }
+    assert.eq( 100 , inserts() , "full rate" );
+
+    // half of the operations, give or take those of other tests running in parallel
+    assert.commandWorked( db.runCommand( { profile : 2 , sampleRate : 0.5 } ) );
+    assert.eq( 0.5 , db.runCommand( { profile : -1 } ).sampleRate );
+    for ( var i = 0; i < 200; i++ ) {
+        t.insert( { i : i } );
+    }
+    var n = inserts() - 100;
+    assert.lte( 50 , n , "half rate" );
+    assert.gte( 150 , n , "half rate" );
+
+    assert.commandWorked( db.runCommand( { profile : 2 , sampleRate : 0 } ) );
+    t.insert( { i : -1 } );
+    assert.eq( 100 + n , inserts() , "zero rate" );
+
+    var metrics = db.serverStatus().metrics.profiler;
+    assert( metrics.written > 0 , tojson( metrics ) );
+    assert( metrics.skipped > 0 , tojson( metrics ) );
+}
+finally {
+    db.runCommand( { profile : 0 , sampleRate : 1 } );
+    db.system.profile.drop();
+    db = stddb;
+}
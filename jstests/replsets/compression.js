@@ -0,0 +1,41 @@
+// Check that a secondary with replNetworkCompression set gets the oplog compressed, and that
+// what it applies is the same as without compression.
+
+var replTest = new ReplSetTest( {name: "compression", nodes: 2} );
+var nodes = replTest.startSet( {setParameter: "replNetworkCompression=true"} );
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var pdb = primary.getDB( "test" );
+
+// isMaster only answers with a compressor when asked for one it knows
+var res = pdb.runCommand( {isMaster:1} );
+assert.eq( undefined, res.compression );
+res = pdb.runCommand( {isMaster:1, compression:["nosuchcompressor"]} );
+assert.eq( undefined, res.compression );
+res = pdb.runCommand( {isMaster:1, compression:["nosuchcompressor", "zlib"]} );
+assert.eq( "zlib", res.compression );
+
+var before = primary.getDB( "admin" ).serverStatus().network.compression;
+
+// compressible documents, big enough to make getMore replies worth compressing
+var text = new Array( 200 ).join( "compress me " );
+for ( var i = 0; i < 2000; i++ ) {
+    pdb.foo.insert( {_id: i, text: text} );
+}
+assert.eq( null, pdb.getLastError( 2 ) );
+replTest.awaitReplication();
+
+var after = primary.getDB( "admin" ).serverStatus().network.compression;
+printjson( after );
+assert.gt( after.compressed.messages, before.compressed.messages );
+assert.gt( after.compressed.ratio, 1 );
+
+var secondary = replTest.liveNodes.slaves[0];
+secondary.setSlaveOk();
+var sdb = secondary.getDB( "test" );
+assert.eq( 2000, sdb.foo.count() );
+assert.eq( text, sdb.foo.findOne( {_id: 1999} ).text );
+assert.gt( secondary.getDB( "admin" ).serverStatus().network.compression.decompressed.messages, 0 );
+
+replTest.stopSet();
@@ -0,0 +1,73 @@
+// Check that a secondary prefetching what it is about to apply ends up with the same data, and
+// that replIndexPrefetch can be changed while running.
+
+var replTest = new ReplSetTest( {name: "prefetch", nodes: 2} );
+var nodes = replTest.startSet( {replIndexPrefetch: "all"} );
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var pdb = primary.getDB( "test" );
+var secondary = replTest.liveNodes.slaves[0];
+var sadmin = secondary.getDB( "admin" );
+
+assert.eq( "all", sadmin.runCommand( {getParameter: 1, replIndexPrefetch: 1} ).replIndexPrefetch );
+assert.commandFailed( sadmin.runCommand( {setParameter: 1, replIndexPrefetch: "some"} ) );
+assert.eq( "all", sadmin.runCommand( {getParameter: 1, replIndexPrefetch: 1} ).replIndexPrefetch );
+
+var work = function() {
+    pdb.foo.ensureIndex( {a: 1} );
+    pdb.foo.ensureIndex( {b: 1, c: 1} );
+    for ( var i = 0; i < 1000; i++ ) {
+        pdb.foo.insert( {_id: i, a: i, b: [i % 7, i % 11], c: "c" + i} );
+    }
+    for ( var i = 0; i < 1000; i += 3 ) {
+        pdb.foo.update( {_id: i}, {$inc: {a: 1000}} );
+    }
+    for ( var i = 0; i < 1000; i += 5 ) {
+        pdb.foo.update( {_id: i}, {_id: i, a: -i, c: "replaced"} );
+    }
+    for ( var i = 0; i < 1000; i += 7 ) {
+        pdb.foo.remove( {_id: i} );
+    }
+    assert.eq( null, pdb.getLastError( 2 ) );
+    replTest.awaitReplication();
+};
+
+var prefetchStats = function() {
+    var s = sadmin.serverStatus().metrics.repl.prefetch;
+    return s.transactions.num + s.skipped;
+};
+
+var checkData = function() {
+    secondary.setSlaveOk();
+    var sdb = secondary.getDB( "test" );
+    assert.eq( pdb.foo.count(), sdb.foo.count() );
+    assert.eq( pdb.foo.find().sort( {_id: 1} ).toArray(), sdb.foo.find().sort( {_id: 1} ).toArray() );
+    assert.eq( pdb.foo.find( {}, {_id: 0, a: 1} ).hint( {a: 1} ).toArray(),
+               sdb.foo.find( {}, {_id: 0, a: 1} ).hint( {a: 1} ).toArray() );
+    assert.eq( pdb.foo.find( {}, {_id: 0, b: 1, c: 1} ).hint( {b: 1, c: 1} ).toArray(),
+               sdb.foo.find( {}, {_id: 0, b: 1, c: 1} ).hint( {b: 1, c: 1} ).toArray() );
+};
+
+var before = prefetchStats();
+work();
+checkData();
+assert.gt( prefetchStats(), before );
+
+// with prefetching off the prefetch threads stay idle
+assert.commandWorked( sadmin.runCommand( {setParameter: 1, replIndexPrefetch: "none"} ) );
+pdb.foo.drop();
+assert.eq( null, pdb.getLastError( 2 ) );
+replTest.awaitReplication();
+before = prefetchStats();
+work();
+checkData();
+assert.eq( before, prefetchStats() );
+
+assert.commandWorked( sadmin.runCommand( {setParameter: 1, replIndexPrefetch: "_id_only"} ) );
+pdb.foo.drop();
+work();
+checkData();
+assert.gt( prefetchStats(), before );
+
+replTest.stopSet();
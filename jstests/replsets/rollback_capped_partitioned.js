@@ -0,0 +1,65 @@
+// Check that a member rolls back inserts into a partitioned capped collection, by deleting them
+// from their partition.
+
+var name = "rollback_capped_partitioned";
+var host = getHostName();
+var replTest = new ReplSetTest( {name: name, nodes: 3} );
+var conns = replTest.startSet();
+var port = replTest.ports;
+replTest.initiate( {_id: name, members: [
+    {_id: 0, host: host + ":" + port[0], priority: 10},
+    {_id: 1, host: host + ":" + port[1]},
+    {_id: 2, host: host + ":" + port[2], arbiterOnly: true}
+]} );
+replTest.awaitReplication();
+assert.soon( function() { return conns[0].getDB( "admin" ).isMaster().ismaster; } );
+
+var a = conns[0].getDB( "test" );
+var b = conns[1].getDB( "test" );
+
+assert.commandWorked( a.runCommand( {create: "kap", capped: true, partitioned: true,
+                                     max: 100, size: 10000000, cappedPartitions: 4} ) );
+for ( var i = 0; i < 10; i++ ) {
+    a.kap.insert( {_id: i} );
+}
+assert.eq( null, a.getLastError() );
+replTest.awaitReplication();
+
+// these inserts only reach member 1, and are rolled back
+replTest.stop( 0 );
+assert.soon( function() { return conns[1].getDB( "admin" ).isMaster().ismaster; } );
+for ( var i = 100; i < 110; i++ ) {
+    b.kap.insert( {_id: i} );
+}
+assert.eq( null, b.getLastError() );
+assert.eq( 20, b.kap.count() );
+replTest.stop( 1 );
+
+replTest.restart( 0 );
+assert.soon( function() { return conns[0].getDB( "admin" ).isMaster().ismaster; } );
+a = conns[0].getDB( "test" );
+for ( var i = 10; i < 15; i++ ) {
+    a.kap.insert( {_id: i} );
+}
+assert.eq( null, a.getLastError() );
+
+replTest.restart( 1 );
+replTest.awaitReplication();
+b = conns[1].getDB( "test" );
+b.setSlaveOk();
+
+assert.eq( 15, b.kap.count() );
+assert.eq( 0, b.kap.find( {_id: {$gte: 100}} ).itcount() );
+assert.eq( a.kap.find().sort( {$natural: 1} ).toArray(), b.kap.find().sort( {$natural: 1} ).toArray() );
+
+// the rolled back member keeps counting towards its next rotation correctly
+for ( var i = 15; i < 100; i++ ) {
+    a.kap.insert( {_id: i} );
+}
+assert.eq( null, a.getLastError() );
+replTest.awaitReplication();
+assert.soon( function() {
+    return b.runCommand( {getPartitionInfo: "kap"} ).numPartitions == 4;
+}, "member 1 never rotated its partitions" );
+
+replTest.stopSet( 15 );
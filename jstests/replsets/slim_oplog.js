@@ -0,0 +1,86 @@
+// Check that updates and deletes logged without their pre-image with oplogPreImages are
+// applied correctly by a secondary, including to its secondary indexes.
+
+var replTest = new ReplSetTest( {name: "slim_oplog", nodes: 2} );
+var nodes = replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var pdb = primary.getDB( "test" );
+var plocal = primary.getDB( "local" );
+var secondary = replTest.liveNodes.slaves[0];
+secondary.setSlaveOk();
+var sdb = secondary.getDB( "test" );
+
+assert.eq( "full", pdb.adminCommand( {getParameter: 1, oplogPreImages: 1} ).oplogPreImages );
+assert.commandFailed( pdb.adminCommand( {setParameter: 1, oplogPreImages: "some"} ) );
+
+var lastOp = function() {
+    return plocal.oplog.rs.find().sort( {$natural: -1} ).next().ops[0];
+};
+
+var checkData = function() {
+    replTest.awaitReplication();
+    assert.eq( pdb.foo.find().sort( {_id: 1} ).toArray(), sdb.foo.find().sort( {_id: 1} ).toArray() );
+    assert.eq( pdb.foo.find( {}, {_id: 0, a: 1} ).hint( {a: 1} ).toArray(),
+               sdb.foo.find( {}, {_id: 0, a: 1} ).hint( {a: 1} ).toArray() );
+};
+
+var big = new Array( 1000 ).join( "x" );
+var run = function( mode ) {
+    assert.commandWorked( pdb.adminCommand( {setParameter: 1, oplogPreImages: mode} ) );
+    pdb.foo.drop();
+    pdb.foo.ensureIndex( {a: 1} );
+    for ( var i = 0; i < 100; i++ ) {
+        pdb.foo.insert( {_id: i, a: i, b: 0, big: big} );
+    }
+    assert.eq( null, pdb.getLastError() );
+
+    // unindexed mods, applied with an update message on the secondary
+    pdb.foo.update( {_id: 1}, {$inc: {b: 1}, $set: {"sub.c": 5}} );
+    var op = lastOp();
+    printjson( op );
+    if ( mode == "full" ) {
+        assert.eq( "ur", op.op );
+    }
+    else {
+        assert.eq( "up", op.op );
+        assert.eq( undefined, op.o );
+        assert.lt( Object.bsonsize( op ), big.length );
+        if ( mode == "modifiedFields" ) {
+            assert.eq( {$set: {b: 0}, $unset: {sub: 1}}, op.rm );
+        }
+        else {
+            assert.eq( undefined, op.rm );
+        }
+    }
+    checkData();
+
+    // indexed mods, the secondary has to read the document to maintain the index
+    pdb.foo.update( {_id: 2}, {$set: {a: 1000}} );
+    assert.eq( mode == "full" ? "ur" : "up", lastOp().op );
+    checkData();
+
+    // replace-style updates keep the post-image
+    pdb.foo.update( {_id: 3}, {a: -3, c: 1} );
+    op = lastOp();
+    assert.eq( "u", op.op );
+    if ( mode == "none" ) {
+        assert.eq( undefined, op.o );
+    }
+    else {
+        assert.eq( {_id: 3, a: 3, b: 0, big: big}, op.o );
+    }
+    checkData();
+
+    pdb.foo.remove( {_id: 4} );
+    assert.eq( mode == "none" ? "dp" : "d", lastOp().op );
+    checkData();
+    assert.eq( 0, sdb.foo.find( {a: 4} ).hint( {a: 1} ).itcount() );
+};
+
+run( "full" );
+run( "modifiedFields" );
+run( "none" );
+
+replTest.stopSet();
@@ -0,0 +1,75 @@
+// Test that mongos merges sorted results from several shards correctly, across many getMores.
+
+s = new ShardingTest( "sort_merge" , 3 , 0 , 1 )
+s.stopBalancer();
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+db = s.getDB( "test" );
+
+N = 3000
+
+for ( i=0; i<N; i++ ){
+    var doc = { _id : i , a : i % 7 , b : { c : ( i * 13 ) % 101 } };
+    if ( i % 10 == 0 ) {
+        // missing sort fields sort like null
+        delete doc.a;
+    }
+    db.data.insert( doc );
+}
+db.getLastError();
+
+s.adminCommand( { split : "test.data" , middle : { _id : 1000 } } )
+s.adminCommand( { split : "test.data" , middle : { _id : 2000 } } )
+var shards = s.config.shards.find().toArray();
+s.adminCommand( { movechunk : "test.data" , find : { _id : 1000 } , to : shards[1]._id , waitForDelete : true } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : 2000 } , to : shards[2]._id , waitForDelete : true } );
+assert.eq( 3 , s.config.chunks.find( { ns : "test.data" } ).count() , "chunks" );
+
+// Checks a sorted query through mongos against the same query on one shard's full copy.
+function check( sort , batchSize , limit ) {
+    var q = db.data.find().sort( sort ).batchSize( batchSize );
+    if ( limit ) q = q.limit( limit );
+    var got = q.toArray();
+
+    var all = db.data.find().toArray();
+    all.sort( function( l , r ) {
+        for ( var f in sort ) {
+            var lv = f.split( "." ).reduce( function( o , k ) { return o === undefined ? undefined : o[k]; } , l );
+            var rv = f.split( "." ).reduce( function( o , k ) { return o === undefined ? undefined : o[k]; } , r );
+            lv = ( lv === undefined ) ? -1 : lv;
+            rv = ( rv === undefined ) ? -1 : rv;
+            if ( lv != rv ) return ( lv < rv ? -1 : 1 ) * sort[f];
+        }
+        return 0;
+    } );
+    var expected = limit ? all.slice( 0 , limit ) : all;
+
+    assert.eq( expected.length , got.length , "count " + tojson( sort ) );
+    for ( var i = 0; i < got.length; i++ ) {
+        for ( var f in sort ) {
+            var g = f.split( "." ).reduce( function( o , k ) { return o === undefined ? undefined : o[k]; } , got[i] );
+            var e = f.split( "." ).reduce( function( o , k ) { return o === undefined ? undefined : o[k]; } , expected[i] );
+            assert.eq( e , g , "position " + i + " of " + tojson( sort ) + " batchSize " + batchSize );
+        }
+    }
+}
+
+[ 2 , 17 , 1000 ].forEach( function( batchSize ) {
+    check( { _id : 1 } , batchSize );
+    check( { _id : -1 } , batchSize );
+    check( { a : 1 , _id : -1 } , batchSize );
+    check( { a : -1 , 'b.c' : 1 , _id : 1 } , batchSize );
+    check( { 'b.c' : -1 , _id : 1 } , batchSize , 250 );
+} );
+
+// Stop partway through a cursor, leaving getMores in flight; the connections must stay usable.
+for ( i = 0; i < 20; i++ ) {
+    var c = db.data.find().sort( { 'b.c' : 1 , _id : 1 } ).batchSize( 10 );
+    for ( var j = 0; j < 15 + i; j++ ) c.next();
+    c.close();
+}
+assert.eq( N , db.data.find().sort( { _id : 1 } ).itcount() , "after abandoned cursors" );
+
+s.stop();
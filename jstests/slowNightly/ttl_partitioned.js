@@ -0,0 +1,43 @@
+/**
+ * Test that a TTL index on a partitioned collection whose primary key starts with the TTL field
+ * expires data by dropping partitions.  Create four partitions holding docs from 40, 30, 20 and
+ * 0 hours ago, then create a TTL index expiring docs older than ~5.5 hours (20000 seconds).  The
+ * first three partitions should be dropped and the last one left intact.
+ */
+
+var t = db.ttl_partitioned;
+t.drop();
+
+assert.commandWorked(db.createCollection(t.getName(), {partitioned: 1, primaryKey: {x: 1, _id: 1}}));
+
+var now = (new Date()).getTime();
+var hour = 3600 * 1000;
+
+var offsets = [40, 30, 20];
+for (var p = 0; p < offsets.length; p++) {
+    for (i = 0; i < 5; i++) {
+        t.insert({x: new Date(now - (offsets[p] * hour) - i)});
+    }
+    assert.commandWorked(db.runCommand({addPartition: t.getName()}));
+}
+for (i = 0; i < 5; i++) {
+    t.insert({x: new Date(now - i)});
+}
+db.getLastError();
+
+assert.eq(20, t.count());
+assert.eq(4, db.runCommand({getPartitionInfo: t.getName()}).numPartitions);
+
+t.ensureIndex({x: 1}, {expireAfterSeconds: 20000});
+
+assert.soon(
+    function() {
+        return db.runCommand({getPartitionInfo: t.getName()}).numPartitions == 1;
+    }, "TTL index on x didn't drop partitions", 70 * 1000
+);
+
+assert.eq(5, t.count());
+assert.eq(0, t.find({x: {$lt: new Date(now - 20000000)}}).count());
+assert.lte(3, db.serverStatus().metrics.ttl.droppedPartitions);
+
+t.drop();
@@ -0,0 +1,40 @@
+/**
+ * Test that a TTL index on a partitioned collection whose first partition has a non-Date key
+ * still expires documents, by deleting them instead of dropping partitions.
+ */
+
+var t = db.ttl_partitioned_nondate;
+t.drop();
+
+assert.commandWorked(db.createCollection(t.getName(), {partitioned: 1, primaryKey: {x: 1, _id: 1}}));
+
+var now = (new Date()).getTime();
+var hour = 3600 * 1000;
+
+// numbers sort before dates, so this one lands in partition 0 and is never expired
+t.insert({x: 5});
+for (i = 0; i < 5; i++) {
+    t.insert({x: new Date(now - (40 * hour) - i)});
+}
+assert.commandWorked(db.runCommand({addPartition: t.getName()}));
+for (i = 0; i < 5; i++) {
+    t.insert({x: new Date(now - i)});
+}
+db.getLastError();
+
+assert.eq(11, t.count());
+assert.eq(2, db.runCommand({getPartitionInfo: t.getName()}).numPartitions);
+
+t.ensureIndex({x: 1}, {expireAfterSeconds: 20000});
+
+assert.soon(
+    function() {
+        return t.count() == 6;
+    }, "TTL index on x didn't delete expired documents", 70 * 1000
+);
+
+assert.eq(2, db.runCommand({getPartitionInfo: t.getName()}).numPartitions);
+assert.eq(1, t.find({x: 5}).count());
+assert.eq(0, t.find({x: {$lt: new Date(now - 20000000)}}).count());
+
+t.drop();
@@ -142,9 +142,9 @@ case5();
 
 // -------------------------
 // Case 6: limit number of objects in a chunk
-// This is deprecated.
+// The split points are estimated from the index statistics, so only check that we get roughly
+// one split point per 500 documents.
 
-if (0) {
 f.drop();
 f.ensureIndex( { x: 1 }, {clustering:cl} );
 
@@ -158,13 +158,13 @@ var case6 = function() {
     res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , maxChunkObjects: 500} );
 
     assert.eq( true , res.ok , "6a" );
-    assert.eq( 19 , res.splitKeys.length , "6b" );
+    assert.gt( res.splitKeys.length , 15 , "6b" );
+    assert.lt( res.splitKeys.length , 25 , "6c" );
     for( i=0; i < res.splitKeys.length; i++ ){
         assertFieldNamesMatch( res.splitKeys[i] , {x : 1} );
     }
 }
 case6();
-}
 
 // -------------------------
 // Case 7: enough occurances of min key documents to pass the chunk limit
@@ -288,6 +288,7 @@ if (0) {
 f.drop();
 f.ensureIndex( { x: 1, y: -1 , z : 1 }, {clustering:cl} );
 case5();
+}
 
 f.drop();
 f.ensureIndex( { x: 1, y: 1 }, {clustering:cl} );
@@ -296,7 +297,6 @@ case6();
 f.drop();
 f.ensureIndex( { x: 1, y: -1 , z : 1 }, {clustering:cl} );
 case6();
-}
 
 f.drop();
 f.ensureIndex( { x: 1, y: 1 }, {clustering:cl} );
@@ -0,0 +1,36 @@
+// test that mongod collects diagnostic data under its dbpath, and that mongodiag decodes it
+
+var dbpath = MongoRunner.dataPath + "diagnostic_data";
+resetDbpath( dbpath );
+var conn = MongoRunner.runMongod( { dbpath : dbpath , setParameter : "diagnosticDataCollectionPeriodMillis=100" } );
+var db = conn.getDB( "diagnostic_data" );
+var admin = conn.getDB( "admin" );
+
+// keep the chunks short so they get written while the test runs
+assert.commandWorked( admin.runCommand( { setParameter : 1 , diagnosticDataCollectionPeriodMillis : 50 } ) );
+for ( var i = 0; i < 200; i++ ) {
+    db.foo.insert( { i : i } );
+}
+db.getLastError();
+sleep( 2000 );
+
+// turning collection off writes out the samples gathered so far
+assert.commandWorked( admin.runCommand( { setParameter : 1 , diagnosticDataCollectionEnabled : false } ) );
+sleep( 500 );
+
+var dir = dbpath + "/diagnostic.data";
+var files = listFiles( dir ).filter( function( f ) { return /\/metrics\.[^\/]*$/.test( f.name ); } );
+assert.lt( 0 , files.length , "no diagnostic data files in " + dir );
+
+clearRawMongoProgramOutput();
+assert.eq( 0 , runMongoProgram( "mongodiag" , "--csv" , "-f" , "serverStatus.opcounters.insert" , dir ) );
+var lines = rawMongoProgramOutput().split( "\n" ).filter( function( l ) { return /\d,\d+$/.test( l ); } );
+assert.lt( 10 , lines.length , "too few samples decoded" );
+var last = lines[ lines.length - 1 ].split( "," );
+assert.lte( 200 , parseInt( last[ last.length - 1 ] ) , "inserts not counted: " + lines[ lines.length - 1 ] );
+
+clearRawMongoProgramOutput();
+assert.eq( 0 , runMongoProgram( "mongodiag" , dir ) );
+assert( /"serverStatus"/.test( rawMongoProgramOutput() ) , "json output" );
+
+MongoRunner.stopMongod( conn );
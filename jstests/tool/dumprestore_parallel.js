@@ -0,0 +1,31 @@
+// test that restore and import with --numParallelConnections load everything
+
+t = new ToolTest( "dumprestore_parallel" );
+
+c = t.startDB( "foo" );
+c.ensureIndex( { a : 1 } );
+for ( var i = 0; i < 20000; i++ ) {
+    c.insert( { _id : i , a : i % 100 , s : "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" } );
+}
+assert.eq( 20000 , c.count() , "setup" );
+
+t.runTool( "dump" , "--out" , t.ext );
+
+c.drop();
+assert.eq( 0 , c.count() , "after drop" );
+
+t.runTool( "restore" , "--dir" , t.ext , "--numParallelConnections" , "4" );
+assert.eq( 20000 , c.count() , "after restore" );
+assert.eq( 200 , c.find( { a : 7 } ).hint( { a : 1 } ).itcount() , "index after restore" );
+assert.eq( 2 , c.getIndexes().length , "indexes after restore" );
+
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+
+c.drop();
+assert.eq( 0 , c.count() , "after drop 2" );
+
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParallelConnections" , "4" );
+assert.eq( 20000 , c.count() , "after import" );
+assert.eq( 200 , c.find( { a : 7 } ).itcount() , "after import 2" );
+
+t.stop();
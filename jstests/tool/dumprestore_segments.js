@@ -0,0 +1,40 @@
+// test that dump with --segmentSize splits big collections into several files, and that
+// restore loads them all back
+
+t = new ToolTest( "dumprestore_segments" );
+
+c = t.startDB( "foo" );
+c.ensureIndex( { a : 1 } );
+var s = new Array( 200 ).join( "x" );
+for ( var i = 0; i < 20000; i++ ) {
+    c.insert( { _id : i , a : i % 100 , s : s } );
+}
+// small enough to stay in one piece
+for ( var i = 0; i < 100; i++ ) {
+    t.db.bar.insert( { _id : i } );
+}
+assert.eq( 20000 , c.count() , "setup" );
+
+t.runTool( "dump" , "--out" , t.ext , "--numParallelCollections" , "3" , "--segmentSize" , "1" );
+
+var files = listFiles( t.ext + "/" + t.baseName ).map( function( f ) { return f.name.substring( f.name.lastIndexOf( "/" ) + 1 ); } );
+assert.contains( "foo.bson" , files , "first segment" );
+assert.contains( "foo.bson.1" , files , "segments: " + tojson( files ) );
+assert.contains( "bar.bson" , files );
+assert.eq( -1 , files.indexOf( "bar.bson.1" ) , "small collection was split" );
+
+c.drop();
+t.db.bar.drop();
+assert.eq( 0 , c.count() , "after drop" );
+
+t.runTool( "restore" , "--dir" , t.ext );
+assert.eq( 20000 , c.count() , "after restore" );
+assert.eq( 20000 , c.distinct( "_id" ).length , "duplicates after restore" );
+assert.eq( 200 , c.find( { a : 7 } ).hint( { a : 1 } ).itcount() , "index after restore" );
+assert.eq( 100 , t.db.bar.count() , "small collection after restore" );
+
+c.drop();
+t.runTool( "restore" , "--dir" , t.ext , "--numParallelConnections" , "3" );
+assert.eq( 20000 , c.count() , "after parallel restore" );
+
+t.stop();
@@ -0,0 +1,57 @@
+// import_parallel.js
+// mongoimport with several parsing threads, with and without --maintainInsertionOrder
+
+t = new ToolTest( "import_parallel" );
+
+c = t.startDB( "foo" );
+
+// enough data for the input to be cut into several chunks
+var N = 50000;
+for ( var i = 0; i < N; i++ ) {
+    c.insert( { i : i , s : "some text to make the line longer, line " + i } );
+}
+assert.eq( N , c.count() , "setup" );
+
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--csv" , "-f" , "i,s" );
+
+function checkImported( ordered ) {
+    assert.eq( N , c.count() , "count, ordered: " + ordered );
+    var seen = 0;
+    var last = -1;
+    // the server generates the _ids in the order the documents arrive
+    c.find().sort( { _id : 1 } ).forEach( function( doc ) {
+        if ( ordered ) {
+            assert.eq( last + 1 , doc.i , "out of order" );
+        }
+        assert.eq( "some text to make the line longer, line " + doc.i , doc.s );
+        last = doc.i;
+        seen++;
+    } );
+    assert.eq( N , seen );
+    assert.eq( N , c.distinct( "i" ).length , "duplicates, ordered: " + ordered );
+}
+
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--type" , "csv" , "--headerline" ,
+           "--numParsingThreads" , "4" , "--maintainInsertionOrder" );
+checkImported( true );
+
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--type" , "csv" , "--headerline" ,
+           "--numParsingThreads" , "4" );
+checkImported( false );
+
+// through the parallel inserter
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--type" , "csv" , "--headerline" ,
+           "--numParsingThreads" , "3" , "--numParallelConnections" , "2" );
+assert.eq( N , c.count() , "parallel connections" );
+
+// json
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParsingThreads" , "4" );
+assert.eq( N , c.count() , "json" );
+assert.eq( N , c.distinct( "i" ).length , "json duplicates" );
+
+t.stop();
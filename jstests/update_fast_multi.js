@@ -0,0 +1,84 @@
+// test that multi updates which touch no indexed field give the same results
+// when they are sent as update messages with fastupdates
+
+fastcoll = db.updatefastmulti;
+nonfastcoll = db.updatefastmulti2;
+
+function setFastupdates(on) {
+    assert.commandWorked(db.getSisterDB('admin').runCommand({ setParameter: 1, fastupdates: on }));
+}
+
+function metrics() {
+    return db.serverStatus().metrics.fastupdates;
+}
+
+function initialDocs() {
+    var docs = [];
+    for (var i = 0; i < 200; i++) {
+        docs.push({ _id: i, a: i % 10, c: i, arr: [ i ], sub: { x: i } });
+    }
+    return docs;
+}
+
+// @param expectFast one of 'broadcasts', 'ranges', or null if the update should take the slow path
+function checkUpdate(query, updateobj, expectFast) {
+    var before = metrics();
+
+    fastcoll.remove({});
+    fastcoll.insert(initialDocs());
+    setFastupdates(true);
+    fastcoll.update(query, updateobj, { multi: true });
+    var fastErr = db.getLastErrorObj();
+    setFastupdates(false);
+
+    nonfastcoll.remove({});
+    nonfastcoll.insert(initialDocs());
+    nonfastcoll.update(query, updateobj, { multi: true });
+    var nonFastErr = db.getLastErrorObj();
+
+    print('checking query: ' + tojson(query) + ' update: ' + tojson(updateobj));
+    var after = metrics();
+    [ 'broadcasts', 'ranges' ].forEach(function(m) {
+        assert.eq(before[m] + (m == expectFast ? 1 : 0), after[m], m + ' metric');
+    });
+    // a broadcast reports an estimated count, which may be off
+    if (expectFast != 'broadcasts') {
+        assert.eq(nonFastErr.n, fastErr.n, "number updated differs");
+    }
+    assert.eq(nonfastcoll.find().sort({ _id: 1 }).toArray(), fastcoll.find().sort({ _id: 1 }).toArray(), "update result differ");
+}
+
+fastcoll.drop();
+nonfastcoll.drop();
+fastcoll.ensureIndex({ a: 1 });
+nonfastcoll.ensureIndex({ a: 1 });
+
+// whole collection
+checkUpdate({ }, { $inc: { c: 1 } }, 'broadcasts');
+checkUpdate({ }, { $set: { 'sub.y': 'new' }, $push: { arr: -1 } }, 'broadcasts');
+checkUpdate({ }, { $unset: { c: 1 } }, 'broadcasts');
+
+// primary key ranges
+checkUpdate({ _id: { $gte: 50, $lt: 150 } }, { $inc: { c: 1 } }, 'ranges');
+checkUpdate({ _id: { $gt: 190 } }, { $set: { z: 1 } }, 'ranges');
+checkUpdate({ _id: 7 }, { $set: { z: 1 } }, 'ranges');
+checkUpdate({ _id: { $gt: 500 } }, { $set: { z: 1 } }, 'ranges');
+
+// indexed fields, positional updates, and queries that are not one pk range use the slow path
+checkUpdate({ }, { $inc: { a: 1 } }, null);
+checkUpdate({ arr: 3 }, { $set: { 'arr.$': 0 } }, null);
+checkUpdate({ _id: { $in: [ 1, 5 ] } }, { $inc: { c: 1 } }, null);
+checkUpdate({ _id: { $gte: 50 }, c: { $lt: 100 } }, { $inc: { c: 1 } }, null);
+checkUpdate({ _id: { $ne: 4 } }, { $inc: { c: 1 } }, null);
+checkUpdate({ a: 3 }, { $inc: { c: 1 } }, null);
+
+// a broadcast that is rolled back leaves every document alone
+fastcoll.remove({});
+fastcoll.insert(initialDocs());
+setFastupdates(true);
+db.beginTransaction();
+fastcoll.update({ }, { $inc: { c: 1000 } }, { multi: true });
+assert.eq(0, fastcoll.count({ c: { $lt: 1000 } }));
+db.rollbackTransaction();
+setFastupdates(false);
+assert.eq(200, fastcoll.count({ c: { $lt: 1000 } }));
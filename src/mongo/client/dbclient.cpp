@@ -31,6 +31,7 @@
 #include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
 #include "mongo/util/assert_util.h"
 #include "mongo/util/md5.hpp"
+#include "mongo/util/net/message_compressor.h"
 
 #ifdef MONGO_SSL
 // TODO: Remove references to cmdline from the client.
@@ -894,9 +895,48 @@ namespace mongo {
         }
 #endif
 
+        _compressionNegotiated = false;
+        if ( _compression ) {
+            _negotiateCompression();
+        }
+
         return true;
     }
 
+    bool DBClientConnection::enableCompression() {
+        _compression = true;
+        if ( !p ) {
+            // negotiated once connected
+            return false;
+        }
+        if ( _compressionNegotiated ) {
+            return port().compressor() != MessageCompressor::none;
+        }
+        return _negotiateCompression();
+    }
+
+    bool DBClientConnection::_negotiateCompression() {
+        _compressionNegotiated = true;
+        BSONObj info;
+        try {
+            BSONObj cmd = BSON( "isMaster" << 1 <<
+                                "compression" << BSON_ARRAY( MessageCompressor::name( MessageCompressor::zlib ) ) );
+            if ( !runCommand( "admin", cmd, info ) ) {
+                return false;
+            }
+        }
+        catch ( DBException& e ) {
+            LOG(_logLevel) << "couldn't negotiate compression with " << _serverString
+                           << causedBy( e ) << endl;
+            return false;
+        }
+        // servers that don't compress leave the field out
+        const MessageCompressor::Id id = MessageCompressor::fromName( info["compression"].str() );
+        port().setCompressor( id );
+        LOG(1) << "compression with " << _serverString << ": " << MessageCompressor::name( id ) << endl;
+        return id != MessageCompressor::none;
+    }
+
 
     inline bool DBClientConnection::runCommand(const string &dbname,
                                                const BSONObj& cmd,
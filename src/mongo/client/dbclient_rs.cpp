@@ -1438,7 +1438,7 @@ namespace mongo {
     const size_t DBClientReplicaSet::MAX_RETRY = 3;
 
     DBClientReplicaSet::DBClientReplicaSet( const string& name , const vector<HostAndPort>& servers, double so_timeout )
-        : _setName( name ), _so_timeout( so_timeout ) {
+        : _setName( name ), _so_timeout( so_timeout ), _compression( false ) {
         ReplicaSetMonitor::createIfNeeded( name, servers );
     }
 
@@ -1551,11 +1551,26 @@ namespace mongo {
 
         _master.reset(newConn);
         _master->setReplSetClientCallback(this);
+        if ( _compression ) {
+            _master->enableCompression();
+        }
 
         _auth( _master.get() );
         return _master.get();
     }
 
+    bool DBClientReplicaSet::enableCompression() {
+        _compression = true;
+        bool ok = true;
+        if ( _master ) {
+            ok = _master->enableCompression() && ok;
+        }
+        if ( _lastSlaveOkConn && _lastSlaveOkConn != _master ) {
+            ok = _lastSlaveOkConn->enableCompression() && ok;
+        }
+        return ok;
+    }
+
     bool DBClientReplicaSet::checkLastHost(const ReadPreferenceSetting* readPref) {
         if (_lastSlaveOkHost.empty()) {
             return false;
@@ -1973,6 +1988,9 @@ namespace mongo {
 
         _lastSlaveOkConn.reset(newConn);
         _lastSlaveOkConn->setReplSetClientCallback(this);
+        if ( _compression ) {
+            _lastSlaveOkConn->enableCompression();
+        }
 
         _auth(_lastSlaveOkConn.get());
 
@@ -514,6 +514,9 @@ namespace mongo {
         virtual ConnectionString::ConnectionType type() const { return ConnectionString::SET; }
         virtual bool lazySupported() const { return true; }
 
+        /** Applies to the connections made to members later on, too. */
+        virtual bool enableCompression();
+
         // ---- low level ------
 
         virtual bool call( Message &toSend, Message &response, bool assertOk=true , string * actualServer = 0 );
@@ -649,6 +652,9 @@ namespace mongo {
         
         double _so_timeout;
 
+        // whether connections to members should be compressed
+        bool _compression;
+
         // we need to store so that when we connect to a new node on failure
         // we can re-auth
         // this could be a security issue, as the password is stored in memory
@@ -117,9 +117,10 @@ namespace mongo {
         return ok;
     }
 
-    void DBClientCursor::requestMore() {
-        verify( cursorId && batch.pos == batch.nReturned );
-
+    // Builds the getMore for the batch after the current one. Leaves nToReturn alone, since
+    // more() still checks the current batch against it; requestMore() reduces it.
+    void DBClientCursor::_assembleGetMore( Message &toSend ) {
+        const int savedNToReturn = nToReturn;
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
@@ -129,11 +130,66 @@ namespace mongo {
         b.appendStr(ns);
         b.appendNum(nextBatchSize());
         b.appendNum(cursorId);
+        nToReturn = savedNToReturn;
 
-        Message toSend;
         toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
+    void DBClientCursor::prefetchNextBatch() {
+        if ( _prefetchConn || ! cursorId || _scopedHost.empty() || ( opts & QueryOption_Exhaust ) )
+            return;
+        if ( batch.nReturned - batch.pos > batch.nReturned / 2 )
+            return;
+        if ( haveLimit && nToReturn <= batch.nReturned )
+            return;
+
+        ScopedDbConnection *conn = ScopedDbConnection::getScopedDbConnection( _scopedHost );
+        if ( ! conn->get()->lazySupported() ) {
+            conn->done();
+            delete conn;
+            return;
+        }
+
+        Message toSend;
+        _assembleGetMore( toSend );
+        try {
+            conn->get()->say( toSend );
+        }
+        catch ( DBException& ) {
+            // don't return a connection in an unknown state to the pool
+            delete conn;
+            throw;
+        }
+        _prefetchConn = conn;
+    }
+
+    void DBClientCursor::requestMore() {
+        verify( cursorId && batch.pos == batch.nReturned );
+
+        Message toSend;
+        if ( ! _prefetchConn ) {
+            _assembleGetMore( toSend );
+        }
+        if (haveLimit) {
+            nToReturn -= batch.nReturned;
+            verify(nToReturn > 0);
+        }
         auto_ptr<Message> response(new Message());
 
+        if ( _prefetchConn ) {
+            // prefetchNextBatch() already sent the getMore
+            scoped_ptr<ScopedDbConnection> conn( _prefetchConn );
+            _prefetchConn = NULL;
+            uassert( 17379, "recv failed while receiving prefetched batch",
+                     conn->get()->recv( *response ) );
+            _client = conn->get();
+            this->batch.m = response;
+            dataReceived();
+            _client = 0;
+            conn->done();
+            return;
+        }
+
         if ( _client ) {
             _client->call( toSend, *response );
             this->batch.m = response;
@@ -321,6 +377,15 @@ namespace mongo {
 
         DESTRUCTOR_GUARD (
 
+        if ( _prefetchConn ) {
+            // Read the reply to the outstanding getMore so the connection can go back to the pool.
+            scoped_ptr<ScopedDbConnection> conn( _prefetchConn );
+            _prefetchConn = NULL;
+            Message m;
+            if ( conn->get()->recv( m ) )
+                conn->done();
+        }
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
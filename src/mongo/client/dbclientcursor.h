@@ -29,6 +29,7 @@
 namespace mongo {
 
     class AScopedConnection;
+    class ScopedDbConnection;
 
     /** for mock purposes only -- do not create variants of DBClientCursor, nor hang code here 
         @see DBClientMockCursor
@@ -57,6 +58,15 @@ namespace mongo {
         int objsLeftInBatch() const { _assertIfNull(); return _putBack.size() + batch.nReturned - batch.pos; }
         bool moreInCurrentBatch() { return objsLeftInBatch() > 0; }
 
+        /** Once half of the current batch has been consumed, sends the getMore for the next
+            batch without waiting for the reply, so the server produces it while the rest of
+            this batch is consumed.  The more() that runs out of the batch then only has to
+            receive it.  Call as often as convenient; does nothing if a getMore is already
+            outstanding, or unless the cursor is attached to a pooled connection (see attach()),
+            since nothing else may use the connection until the reply has been read.
+        */
+        void prefetchNextBatch();
+
         /** next
            @return next object in the result cursor.
            on an error at the remote server, you will get back:
@@ -147,7 +157,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _prefetchConn( NULL ) {
             _finishConsInit();
         }
 
@@ -163,7 +174,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _prefetchConn(NULL) {
             _finishConsInit();
         }
 
@@ -262,10 +274,13 @@ namespace mongo {
         string _scopedHost;
         string _lazyHost;
         bool wasError;
+        // holds the pooled connection a prefetched getMore was sent on until its reply is read
+        ScopedDbConnection *_prefetchConn;
 
         void dataReceived() { bool retry; string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, string& lazyHost );
         void requestMore();
+        void _assembleGetMore( Message &toSend );
         void exhaustReceiveMore(); // for exhaust
 
         // Don't call from a virtual function
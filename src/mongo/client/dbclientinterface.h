@@ -1130,6 +1130,13 @@ namespace mongo {
             return INVALID_SOCK_CREATION_TIME;
         }
 
+        /**
+         * Asks the server to compress what is sent either way on this connection, if it can.
+         * Meant for internal connections over slow links; see MessageCompressor.
+         * @return true if the connection is now compressed.
+         */
+        virtual bool enableCompression() { return false; }
+
     }; // DBClientBase
 
     class DBClientReplicaSet;
@@ -1154,7 +1161,7 @@ namespace mongo {
            Connect timeout is fixed, but short, at 5 seconds.
          */
         DBClientConnection(bool _autoReconnect=false, DBClientReplicaSet* cp=0, double so_timeout=0) :
-            clientSet(cp), _failed(false), autoReconnect(_autoReconnect), lastReconnectTry(0), _so_timeout(so_timeout) {
+            clientSet(cp), _failed(false), autoReconnect(_autoReconnect), lastReconnectTry(0), _so_timeout(so_timeout), _compression(false), _compressionNegotiated(false) {
             _numConnections++;
         }
 
@@ -1274,6 +1281,9 @@ namespace mongo {
 
         uint64_t getSockCreationMicroSec() const;
 
+        /** Also renegotiated after reconnecting. */
+        virtual bool enableCompression();
+
     protected:
         friend class SyncClusterConnection;
         virtual void _auth(const BSONObj& params);
@@ -1296,6 +1306,12 @@ namespace mongo {
         double _so_timeout;
         bool _connect( string& errmsg );
 
+        bool _compression;
+        // set once compression was asked for on the current port, whatever the answer, so a
+        // server that doesn't compress isn't asked again each time enableCompression() is called
+        bool _compressionNegotiated;
+        bool _negotiateCompression();
+
         static AtomicUInt _numConnections;
         static bool _lazyKillCursor; // lazy means we piggy back kill cursors on next op
 
@@ -478,6 +478,7 @@ namespace mongo {
         _numServers = _servers.size();
         _lastFrom = 0;
         _cursors = 0;
+        _mergeInitialized = false;
 
         if( ! _qSpec.isEmpty() ){
 
@@ -1599,6 +1600,11 @@ namespace mongo {
             _needToSkip = n;
         }
 
+        if ( ! _sortKey.isEmpty() ) {
+            _initMerge();
+            return ! _heap.empty();
+        }
+
         for ( int i=0; i<_numServers; i++ ) {
             if ( _cursors[i].more() )
                 return true;
@@ -1606,7 +1612,87 @@ namespace mongo {
         return false;
     }
 
+    void ParallelSortClusteredCursor::_initMerge() {
+        if ( _mergeInitialized )
+            return;
+        _mergeInitialized = true;
+
+        BSONObjIterator it( _sortKey );
+        while ( it.more() ) {
+            _sortDirections.push_back( it.next().number() < 0 ? -1 : 1 );
+        }
+
+        _heads.resize( _numServers );
+        _heap.reserve( _numServers );
+        for ( int i = 0; i < _numServers; i++ ) {
+            _pushHead( i );
+        }
+    }
+
+    // Puts cursor i back in the heap if it has more, keyed by its next result.
+    void ParallelSortClusteredCursor::_pushHead( int i ) {
+        if ( ! _cursors[i].more() ) {
+            if( _cursors[i].rawMData() )
+                _cursors[i].rawMData()->pcState->done = true;
+            return;
+        }
+
+        // Same semantics as woSortOrder: dotted field names, missing fields sort as null.
+        BSONObj head = _cursors[i].peek();
+        BSONObjBuilder b;
+        BSONObjIterator it( _sortKey );
+        while ( it.more() ) {
+            BSONElement e = head.getFieldDotted( it.next().fieldName() );
+            if ( e.eoo() )
+                b.appendNull( "" );
+            else
+                b.appendAs( e, "" );
+        }
+        _heads[i] = b.obj();
+
+        _heap.push_back( i );
+        HeadGreater greater = { this };
+        push_heap( _heap.begin(), _heap.end(), greater );
+    }
+
+    int ParallelSortClusteredCursor::_compareHeads( int l, int r ) const {
+        BSONObjIterator li( _heads[l] );
+        BSONObjIterator ri( _heads[r] );
+        for ( vector<int>::const_iterator d = _sortDirections.begin(); d != _sortDirections.end(); ++d ) {
+            int x = li.next().woCompare( ri.next(), false ) * *d;
+            if ( x != 0 )
+                return x;
+        }
+        // break ties by shard so the merge order is deterministic
+        return l - r;
+    }
+
     BSONObj ParallelSortClusteredCursor::next() {
+        if ( ! _sortKey.isEmpty() ) {
+            _initMerge();
+            uassert( 10019 ,  "no more elements" , ! _heap.empty() );
+
+            HeadGreater greater = { this };
+            pop_heap( _heap.begin(), _heap.end(), greater );
+            const int i = _heap.back();
+            _heap.pop_back();
+
+            // If this was the last result in its batch, next() hands back an owned copy,
+            // so fetching the following batch below doesn't invalidate it.
+            BSONObj best = _cursors[i].next();
+            if( _cursors[i].rawMData() )
+                _cursors[i].rawMData()->pcState->count++;
+            _lastFrom = i;
+
+            // Overlap the shard producing its next batch with merging this one.
+            if ( _cursors[i].raw() )
+                _cursors[i].raw()->prefetchNextBatch();
+
+            _pushHead( i );
+            return best;
+        }
+
+        // Unsorted, so take from the servers in turn.
         BSONObj best = BSONObj();
         int bestFrom = -1;
 
@@ -1623,21 +1709,9 @@ namespace mongo {
                 continue;
             }
 
-            BSONObj me = _cursors[i].peek();
-
-            if ( best.isEmpty() ) {
-                best = me;
-                bestFrom = i;
-                if( _sortKey.isEmpty() ) break;
-                continue;
-            }
-
-            int comp = best.woSortOrder( me , _sortKey , true );
-            if ( comp < 0 )
-                continue;
-
-            best = me;
+            best = _cursors[i].peek();
             bestFrom = i;
+            break;
         }
 
         _lastFrom = bestFrom;
@@ -1648,6 +1722,9 @@ namespace mongo {
         if( _cursors[bestFrom].rawMData() )
             _cursors[bestFrom].rawMData()->pcState->count++;
 
+        if ( _cursors[bestFrom].raw() )
+            _cursors[bestFrom].raw()->prefetchNextBatch();
+
         return best;
     }
 
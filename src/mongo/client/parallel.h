@@ -392,6 +392,22 @@ namespace mongo {
         FilteringClientCursor * _cursors;
         int _needToSkip;
 
+        // Sorted merge. _heap is a binary heap of the indexes of cursors that have more
+        // results, ordered by _heads, the sort key of each cursor's next result (extracted
+        // once, with field names dropped), so next() is O(log n) in the number of shards.
+        void _initMerge();
+        void _pushHead( int i );
+        int _compareHeads( int l, int r ) const;
+        struct HeadGreater {
+            const ParallelSortClusteredCursor *c;
+            bool operator()( int l, int r ) const { return c->_compareHeads( l, r ) > 0; }
+        };
+
+        bool _mergeInitialized;
+        vector<int> _heap;
+        vector<BSONObj> _heads;
+        vector<int> _sortDirections;
+
     private:
         /**
          * Setups the shard version of the connection. When using a replica
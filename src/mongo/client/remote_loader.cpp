@@ -32,15 +32,16 @@ namespace mongo {
     }
 
     RemoteLoader::RemoteLoader(DBClientWithCommands &conn, const string &db,
-                 const string &ns, const vector<BSONObj> &indexes, const BSONObj &options)
+                 const string &ns, const vector<BSONObj> &indexes, const BSONObj &options,
+                 bool shared)
             : _conn(&conn), _db(db), _rtxn(conn, "serializable"), _usingLoader(false), _commandObj() {
         BSONObjBuilder b;
-        beginLoadCmd(ns, indexes, options, b);
+        beginLoadCmd(ns, indexes, options, shared, b);
         begin(b.done());
     }
 
     void RemoteLoader::beginLoadCmd(const string &ns, const vector<BSONObj> &indexes, const BSONObj &options,
-                                    BSONObjBuilder &b) {
+                                    bool shared, BSONObjBuilder &b) {
         b.append("beginLoad", 1);
         b.append("ns", ns);
         {
@@ -51,6 +52,9 @@ namespace mongo {
             ab.doneFast();
         }
         b.append("options", options);
+        if (shared) {
+            b.append("shared", true);
+        }
     }
 
     void RemoteLoader::begin(const BSONObj &obj) {
@@ -60,10 +64,22 @@ namespace mongo {
         bool ok = false;
         if (_rtxn.isLive()) {
             ok = _conn->runCommand(_db, obj, res);
+            if (!ok && obj["shared"].trueValue()) {
+                // The server rejects shared loads when it can't support them (e.g. it is
+                // replicating), before it does anything else, so try a plain load.
+                LOG(0) << "RemoteLoader failed to begin shared load: " << res
+                       << ". Trying an unshared load." << endl;
+                _commandObj = obj.removeField("shared");
+                ok = _conn->runCommand(_db, _commandObj, res);
+            }
         }
 
         if (ok) {
             _usingLoader = true;
+            BSONElement tokenElt = res["loadToken"];
+            if (tokenElt.type() == jstOID) {
+                _loadToken = tokenElt.OID();
+            }
         } else {
             LOG(0) << "RemoteLoader failed to beginLoad: " << res
                    << ". Falling back to normal inserts." << endl;
@@ -133,6 +149,16 @@ namespace mongo {
         return ok;
     }
 
+    bool RemoteLoader::join(DBClientWithCommands &conn, const string &db, const string &ns,
+                            const OID &token, BSONObj *res) {
+        BSONObj cmd = BSON("joinLoad" << 1 << "ns" << ns << "token" << token);
+        BSONObj tmp;
+        if (res == NULL) {
+            res = &tmp;
+        }
+        return conn.runCommand(db, cmd, *res);
+    }
+
     bool RemoteLoader::abort(BSONObj *res) {
         bool ok = true;
         if (_usingLoader) {
@@ -54,8 +54,9 @@ namespace mongo {
         RemoteTransaction _rtxn;
         bool _usingLoader;
         BSONObj _commandObj;
+        OID _loadToken;
         static void beginLoadCmd(const string &ns, const vector<BSONObj> &indexes, const BSONObj &options,
-                                 BSONObjBuilder &b);
+                                 bool shared, BSONObjBuilder &b);
         void begin(const BSONObj &obj);
       public:
         /** Creates a bulk loader using a connection.
@@ -70,9 +71,12 @@ namespace mongo {
             @param ns -- The name of the collection to load.
             @param indexes -- A list of indexes to create, given as index spec objects.
             @param options -- Additional createCollection options.
+            @param shared -- Ask for a load other connections can join (see join()).  If the
+                             server can't share it, the load is still begun unshared.
          */
         RemoteLoader(DBClientWithCommands &conn, const string &db,
-                     const string &ns, const vector<BSONObj> &indexes, const BSONObj &options);
+                     const string &ns, const vector<BSONObj> &indexes, const BSONObj &options,
+                     bool shared = false);
         /** Aborts the load if necessary. */
         ~RemoteLoader();
         /** Commits the load.
@@ -85,6 +89,24 @@ namespace mongo {
             @return true -- iff the abort was successful
          */
         bool abort(BSONObj *res = NULL);
+        /** @return true if the bulk loader is in use (as opposed to normal inserts). */
+        bool usingLoader() const { return _usingLoader; }
+        /** @return true if other connections may insert into the collection in parallel,
+                    either because they can join the load or because there is no load. */
+        bool allowsParallelInserts() const { return !_usingLoader || _loadToken.isSet(); }
+        /** @return the token other connections pass to join(), unset if the load is not shared. */
+        const OID &loadToken() const { return _loadToken; }
+        /** Lets another connection insert into a shared load.  The owning RemoteLoader must not
+            commit until every joined connection has finished inserting (and checked getLastError).
+            @param conn -- The connection to join with.
+            @param db -- The db of the collection being loaded.
+            @param ns -- The name of the collection being loaded.
+            @param token -- The loadToken() of the owning RemoteLoader.
+            @param res -- pointer to object to return the result of the join
+            @return true -- iff the join was successful
+         */
+        static bool join(DBClientWithCommands &conn, const string &db, const string &ns,
+                         const OID &token, BSONObj *res = NULL);
     };
 
 } // namespace mongo
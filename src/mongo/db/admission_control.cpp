@@ -0,0 +1,191 @@
+// admission_control.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/admission_control.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        const int DEFAULT_TICKETS = 128;
+
+        struct TicketPool : boost::noncopyable {
+            TicketHolder tickets;
+            Counter64 totalQueued;
+            Counter64 queuedMicros;
+
+            TicketPool() : tickets(DEFAULT_TICKETS) {}
+
+            void report(BSONObjBuilder &b) const {
+                b.append("out", tickets.used());
+                b.append("available", tickets.available());
+                b.append("totalTickets", tickets.outof());
+                b.append("queued", tickets.waiters());
+                b.append("totalQueued", totalQueued.get());
+                b.append("queuedMicros", queuedMicros.get());
+            }
+        };
+
+        TicketPool &readPool = *new TicketPool();
+        TicketPool &writePool = *new TicketPool();
+
+        class TicketPoolParameter : public ServerParameter {
+        public:
+            TicketPoolParameter(const string &name, TicketPool &pool)
+                : ServerParameter(ServerParameterSet::getGlobal(), name), _pool(pool) {}
+
+            virtual void append(BSONObjBuilder &b, const string &name) {
+                b.append(name, _pool.tickets.outof());
+            }
+
+            virtual Status set(const BSONElement &newValueElement) {
+                if (!newValueElement.isNumber()) {
+                    return Status(ErrorCodes::BadValue, str::stream() << name() << " must be a number");
+                }
+                return set(newValueElement.numberInt());
+            }
+
+            virtual Status setFromString(const string &str) {
+                return set(atoi(str.c_str()));
+            }
+
+        private:
+            Status set(int n) {
+                if (n < 1) {
+                    return Status(ErrorCodes::BadValue, str::stream() << name() << " must be at least 1");
+                }
+                _pool.tickets.resize(n);
+                return Status::OK();
+            }
+
+            TicketPool &_pool;
+        };
+
+        TicketPoolParameter readTicketsParameter("readTickets", readPool);
+        TicketPoolParameter writeTicketsParameter("writeTickets", writePool);
+
+        class AdmissionControlServerStatusSection : public ServerStatusSection {
+        public:
+            AdmissionControlServerStatusSection() : ServerStatusSection("admissionControl") {}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement &configElement) const {
+                BSONObjBuilder b;
+                {
+                    BSONObjBuilder r(b.subobjStart("read"));
+                    readPool.report(r);
+                    r.doneFast();
+                }
+                {
+                    BSONObjBuilder w(b.subobjStart("write"));
+                    writePool.report(w);
+                    w.doneFast();
+                }
+                return b.obj();
+            }
+        } admissionControlServerStatusSection;
+
+        void acquire(TicketPool &pool) {
+            if (!pool.tickets.tryAcquire()) {
+                Timer t;
+                pool.tickets.waitForTicket();
+                pool.totalQueued.increment();
+                pool.queuedMicros.increment(t.micros());
+            }
+        }
+
+        bool isExempt(const Command &command) {
+            const string &name = command.name;
+            return (name == "isMaster" || name == "getLastError" || name == "serverStatus" ||
+                    str::startsWith(name, "replSet"));
+        }
+
+        TicketPool *poolFor(const Command &command) {
+            if (isExempt(command)) {
+                return NULL;
+            }
+            switch (command.locktype()) {
+                case Command::WRITE:
+                    return &writePool;
+                case Command::READ:
+                    return &readPool;
+                default:
+                    // Takes its own locks, classify it by whether it could run on a secondary.
+                    return command.slaveOk() ? &readPool : &writePool;
+            }
+        }
+
+        TicketPool *poolFor(int op, bool isCommand, const Command *command) {
+            if (isCommand) {
+                // An unknown command only gets as far as its error message.
+                return command != NULL ? poolFor(*command) : NULL;
+            }
+            switch (op) {
+                case dbQuery:
+                case dbGetMore:
+                    return &readPool;
+                case dbInsert:
+                case dbUpdate:
+                case dbDelete:
+                    return &writePool;
+                default:
+                    return NULL;
+            }
+        }
+
+    } // namespace
+
+    AdmissionTicket::AdmissionTicket(int op, bool isCommand, const Command *command, bool nested)
+        : _holder(NULL) {
+        TicketPool *pool = nested ? NULL : poolFor(op, isCommand, command);
+        if (pool == NULL) {
+            return;
+        }
+        acquire(*pool);
+        _holder = &pool->tickets;
+    }
+
+    AdmissionTicket::~AdmissionTicket() {
+        if (_holder != NULL) {
+            _holder->release();
+        }
+    }
+
+    AdmissionTicket::Released::Released(AdmissionTicket &ticket) : _ticket(ticket) {
+        if (_ticket._holder != NULL) {
+            _ticket._holder->release();
+        }
+    }
+
+    AdmissionTicket::Released::~Released() {
+        if (_ticket._holder != NULL) {
+            acquire(_ticket._holder == &readPool.tickets ? readPool : writePool);
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,66 @@
+// admission_control.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+namespace mongo {
+
+    class Command;
+    class TicketHolder;
+
+    /**
+     * Admission control: caps how many reads and how many writes are in the storage engine at
+     * once, so that a burst of operations queues up (first come, first served) instead of all of
+     * them fighting over the cache and the locktree.  The pool sizes are the readTickets and
+     * writeTickets server parameters, which can be changed at runtime.
+     *
+     * Held around the dispatch of one client operation in assembleResponse().  Queries and
+     * getMores need a read ticket; inserts, updates and deletes need a write ticket.  Commands
+     * are classified by their locktype() and slaveOk(): write locked commands and the ones that
+     * can't run on a secondary need a write ticket, the others (count, aggregate, ...) a read
+     * ticket.  isMaster, getLastError, serverStatus and the replSet commands don't need one, so
+     * that monitoring and replication can't get stuck behind a full pool.  Nested operations
+     * (e.g. through DBDirectClient) run on their parent's ticket.
+     */
+    class AdmissionTicket : boost::noncopyable {
+    public:
+        /** @param command the command run by a query on $cmd, NULL if there isn't one. */
+        AdmissionTicket(int op, bool isCommand, const Command *command, bool nested);
+        ~AdmissionTicket();
+
+        /**
+         * Gives the ticket back for a wait that doesn't use the storage engine, like a getMore
+         * with QueryOption_AwaitData waiting for data, and waits for one again at the end of
+         * the scope.  Must not be used with locks held: a thread waiting for its ticket while
+         * holding a lock could block the ticket holders waiting for that lock.
+         */
+        class Released : boost::noncopyable {
+        public:
+            explicit Released(AdmissionTicket &ticket);
+            ~Released();
+        private:
+            AdmissionTicket &_ticket;
+        };
+
+    private:
+        TicketHolder *_holder;
+    };
+
+} // namespace mongo
@@ -0,0 +1,92 @@
+// capped_partitions.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/capped_partitions.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/client.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/util/background.h"
+#include "mongo/util/queue.h"
+
+namespace mongo {
+
+    Counter64 cappedPartitionRotations;
+
+    ServerStatusMetricField<Counter64> cappedPartitionRotationsDisplay("cappedPartitions.rotations", &cappedPartitionRotations);
+
+    class CappedPartitionMonitor : public BackgroundJob {
+    public:
+        CappedPartitionMonitor() {}
+        virtual ~CappedPartitionMonitor() {}
+
+        virtual string name() const { return "CappedPartitionMonitor"; }
+
+        void request(const StringData &ns) {
+            _requests.push(ns.toString());
+        }
+
+    private:
+        void rotate(const string &ns) {
+            LOCK_REASON(lockReason, "capped: rotating partitions");
+            Client::WriteContext ctx(ns, lockReason);
+            Collection *cl = getCollection(ns);
+            if (cl == NULL || !cl->isCapped() || !cl->isPartitioned()) {
+                // dropped or renamed since the request was made
+                return;
+            }
+            Client::Transaction txn(DB_SERIALIZABLE);
+            cl->as<PartitionedCappedCollection>()->rotatePartitions();
+            txn.commit();
+            cappedPartitionRotations.increment();
+        }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+
+            while (!inShutdown()) {
+                string ns;
+                if (!_requests.blockingPop(ns, 1)) {
+                    continue;
+                }
+                try {
+                    rotate(ns);
+                }
+                catch (DBException &e) {
+                    error() << "error rotating partitions of capped collection " << ns << ": " << e << endl;
+                }
+            }
+        }
+
+        BlockingQueue<string> _requests;
+    };
+
+    static CappedPartitionMonitor cappedPartitionMonitor;
+
+    void startCappedPartitionMonitor() {
+        cappedPartitionMonitor.go();
+    }
+
+    void requestCappedPartitionRotation(const StringData &ns) {
+        cappedPartitionMonitor.request(ns);
+    }
+
+}
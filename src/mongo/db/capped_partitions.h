@@ -0,0 +1,33 @@
+// capped_partitions.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+    // Starts the thread that adds and drops partitions of partitioned capped collections.
+    void startCappedPartitionMonitor();
+
+    // Ask the monitor thread to rotate the partitions of the partitioned capped
+    // collection ns. Called by inserts, which are only read locked, when the
+    // last partition fills up.
+    void requestCappedPartitionRotation(const StringData &ns);
+
+}
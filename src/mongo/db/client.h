@@ -385,6 +385,13 @@ namespace mongo {
         /** Abort the client load. uasserts if none is in progress. */
         void abortClientLoad();
 
+        /** Let other connections join the client load. uasserts if none is in progress.
+            @return the token other connections pass to joinClientLoad */
+        OID shareClientLoad();
+
+        /** Join a shared load begun by another client, so this client may insert into ns. */
+        void joinClientLoad(const StringData &ns, const OID &token);
+
         /** @return true if a load is in progress. */
         bool loadInProgress() const;
 
@@ -73,6 +73,25 @@ namespace mongo {
         abortBulkLoad(ns);
     }
 
+    OID Client::shareClientLoad() {
+        uassert( 17372, "Cannot share client load, none in progress.",
+                        loadInProgress() );
+
+        const string &ns = _loadInfo->bulkLoadNS();
+        LOCK_REASON(lockReason, "loader: sharing load");
+        Client::WriteContext ctx(ns, lockReason);
+        return shareBulkLoad(ns);
+    }
+
+    void Client::joinClientLoad(const StringData &ns, const OID &token) {
+        uassert( 17373, "Cannot join a load while one is in progress on this connection",
+                        !loadInProgress() );
+
+        LOCK_REASON(lockReason, "loader: joining load");
+        Client::WriteContext ctx(ns, lockReason);
+        joinBulkLoad(ns, token);
+    }
+
     bool Client::loadInProgress() const {
         return _loadInfo;
     }
@@ -228,7 +228,7 @@ namespace mongo {
                                 }
                             }
                             BSONObj row = rowBuilder.obj();
-                            CappedCollection *cappedCl = cl->as<CappedCollection>();
+                            CappedCollectionInterface *cappedCl = cl->as<CappedCollectionInterface>();
                             bool indexBitChanged = false;
                             cappedCl->insertObjectWithPK(pk, row, Collection::NO_LOCKTREE, &indexBitChanged);
                             // Hack copied from Collection::insertObject. TODO: find a better way to do this                        
@@ -19,11 +19,13 @@
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/base/init.h"
+#include "mongo/db/capped_partitions.h"
 #include "mongo/db/collection.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/database.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/index.h"
+#include "mongo/db/index_stats.h"
 #include "mongo/db/index_set.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/db/relock.h"
@@ -215,8 +217,9 @@ namespace mongo {
             // We enforce the restriction because it's easier to implement. See SERVER-6937.
             uassert( 16852, "System profile must be a capped collection.", options["capped"].trueValue() );
             _cd.reset(new ProfileCollection(ns, options));
+        } else if (options["partitioned"].trueValue() && options["capped"].trueValue()) {
+            _cd = PartitionedCappedCollection::make(ns, options);
         } else if (options["partitioned"].trueValue()) {
-            uassert(17266, "Partitioned Collection cannot be capped", !options["capped"].trueValue());
             _cd = PartitionedCollection::make(ns, options);
         } else if (options["capped"].trueValue()) {
             _cd.reset(new CappedCollection(ns, options));
@@ -289,7 +292,11 @@ namespace mongo {
             _cd.reset(new ProfileCollection(serialized));
         } else if (serialized["options"]["partitioned"].trueValue()) {
             massert( 17247, "bug: Should not bulk load partitioned collections", !bulkLoad );
-            _cd = PartitionedCollection::make(serialized);
+            if (serialized["options"]["capped"].trueValue()) {
+                _cd = PartitionedCappedCollection::make(serialized);
+            } else {
+                _cd = PartitionedCollection::make(serialized);
+            }
         } else if (serialized["options"]["capped"].trueValue()) {
             massert( 16871, "bug: Should not bulk load capped collections", !bulkLoad );
             _cd.reset(new CappedCollection(serialized));
@@ -675,6 +682,61 @@ namespace mongo {
     // Can manually disable all primary key unique checks, if the user knows that it is safe to do so.
     MONGO_EXPORT_SERVER_PARAMETER(pkUniqueChecks, bool, true);
 
+    // Secondary keys for one write, generated by the single key fast path (see
+    // IndexDetailsBase::getSingleKeyFromObject()) instead of through a BSONObjSet.
+    //
+    // Every key is appended to one stack buffer, and the DBT_ARRAYs are pointed at the
+    // keys in finish(), once the buffer can no longer move, so that in the common case
+    // of documents with no arrays in their indexed fields no key is ever copied to the
+    // heap.
+    class SingleKeyBuffer : boost::noncopyable {
+    public:
+        SingleKeyBuffer() : _nPending(0) { }
+
+        // @return false if obj may generate several keys for idx, in which case nothing
+        //         was done and getKeysFromObject() must be used. Otherwise obj's key, if
+        //         it has one, belongs to array after finish().
+        bool generate(const IndexDetailsBase &idx, const BSONObj &obj, const BSONObj &pk,
+                      DBT_ARRAY *array) {
+            const int offset = _b.len();
+            bool generated;
+            if (!idx.getSingleKeyFromObject(obj, pk, _b, &generated)) {
+                return false;
+            }
+            if (generated) {
+                verify(_nPending < MaxPending);
+                Pending &p = _pending[_nPending++];
+                p.array = array;
+                p.offset = offset;
+                p.size = _b.len() - offset;
+            }
+            return true;
+        }
+
+        void finish() {
+            for (int i = 0; i < _nPending; i++) {
+                const Pending &p = _pending[i];
+                _dbts[i] = storage::dbt_make(_b.buf() + p.offset, p.size);
+                storage::dbt_array_borrow_single(p.array, &_dbts[i]);
+            }
+        }
+
+    private:
+        // Updates generate old and new keys for every index.
+        static const int MaxPending = 2 * Collection::NIndexesMax;
+
+        struct Pending {
+            DBT_ARRAY *array;
+            int offset;
+            int size;
+        };
+
+        StackBufBuilder _b;
+        Pending _pending[MaxPending];
+        DBT _dbts[MaxPending];
+        int _nPending;
+    };
+
     void CollectionBase::insertIntoIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
         *indexBitChanged = false; // just for initialization
         dassert(!pk.isEmpty());
@@ -684,6 +746,7 @@ namespace mongo {
         DB *dbs[n];
         storage::DBTArrays keyArrays(n);
         storage::DBTArrays valArrays(n);
+        SingleKeyBuffer singleKeys;
         uint32_t put_flags[n];
 
         storage::Key sPK(pk, NULL);
@@ -711,9 +774,15 @@ namespace mongo {
             }
 
             if (!isPK) {
+                // Unique checks are done on the BSONObj form of each key.
+                const bool uniqueCheck = idx.unique() && doUniqueChecks;
+                if (!uniqueCheck && singleKeys.generate(idx, obj, pk, &keyArrays[i])) {
+                    continue;
+                }
+
                 BSONObjSet idxKeys;
                 idx.getKeysFromObject(obj, idxKeys);
-                if (idx.unique() && doUniqueChecks) {
+                if (uniqueCheck) {
                     for (BSONObjSet::const_iterator o = idxKeys.begin(); o != idxKeys.end(); ++o) {
                         idx.uniqueCheck(*o, pk);
                     }
@@ -732,6 +801,8 @@ namespace mongo {
             }
         }
 
+        singleKeys.finish();
+
         DB_ENV *env = storage::env;
         const int r = env->put_multiple(env, dbs[0], cc().txn().db_txn(),
                                         &src_key, &src_val,
@@ -764,6 +835,7 @@ namespace mongo {
         const int n = nIndexesBeingBuilt();
         DB *dbs[n];
         storage::DBTArrays keyArrays(n);
+        SingleKeyBuffer singleKeys;
         uint32_t del_flags[n];
 
         storage::Key sPK(pk, NULL);
@@ -784,6 +856,10 @@ namespace mongo {
                 del_flags[i] &= ~DB_DELETE_ANY;
             }
             if (!isPK) {
+                if (singleKeys.generate(idx, obj, pk, &keyArrays[i])) {
+                    continue;
+                }
+
                 BSONObjSet idxKeys;
                 idx.getKeysFromObject(obj, idxKeys);
 
@@ -802,6 +878,8 @@ namespace mongo {
             }
         }
 
+        singleKeys.finish();
+
         DB_ENV *env = storage::env;
         const int r = env->del_multiple(env, dbs[0], cc().txn().db_txn(),
                                         &src_key, &src_val,
@@ -856,6 +934,7 @@ namespace mongo {
         DB *dbs[n];
         storage::DBTArrays keyArrays(n * 2);
         storage::DBTArrays valArrays(n);
+        SingleKeyBuffer singleKeys;
         uint32_t update_flags[n];
 
         storage::Key sPK(pk, NULL);
@@ -888,11 +967,24 @@ namespace mongo {
             //   we need to update the clustering document.
             const bool keysMayHaveChanged = !(flags & Collection::KEYS_UNAFFECTED_HINT);
             if (!isPK && (keysMayHaveChanged || idx.clustering())) {
+                // Unique checks need both sets of keys in BSONObj form. Otherwise the old
+                // and new keys can each take the single key fast path on their own.
+                const bool uniqueCheck = idx.unique() && doUniqueChecks && keysMayHaveChanged;
+                const bool newKeysDone = !uniqueCheck && singleKeys.generate(idx, newObj, pk, &keyArrays[i]);
+                const bool oldKeysDone = !uniqueCheck && singleKeys.generate(idx, oldObj, pk, &keyArrays[i + n]);
+                if (newKeysDone && oldKeysDone) {
+                    continue;
+                }
+
                 BSONObjSet oldIdxKeys;
                 BSONObjSet newIdxKeys;
-                idx.getKeysFromObject(oldObj, oldIdxKeys);
-                idx.getKeysFromObject(newObj, newIdxKeys);
-                if (idx.unique() && doUniqueChecks && keysMayHaveChanged) {
+                if (!oldKeysDone) {
+                    idx.getKeysFromObject(oldObj, oldIdxKeys);
+                }
+                if (!newKeysDone) {
+                    idx.getKeysFromObject(newObj, newIdxKeys);
+                }
+                if (uniqueCheck) {
                     // Only perform the unique check for those keys that actually changed.
                     for (BSONObjSet::iterator o = newIdxKeys.begin(); o != newIdxKeys.end(); ++o) {
                         const BSONObj &k = *o;
@@ -907,21 +999,27 @@ namespace mongo {
 
                 // Store the keys we just generated, so we won't do it twice in
                 // the generate keys callback. See storage::generate_keys()
-                DBT_ARRAY *array = &keyArrays[i];
-                storage::dbt_array_clear_and_resize(array, newIdxKeys.size());
-                for (BSONObjSet::const_iterator it = newIdxKeys.begin(); it != newIdxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
-                    storage::dbt_array_push(array, sKey.buf(), sKey.size());
+                if (!newKeysDone) {
+                    DBT_ARRAY *array = &keyArrays[i];
+                    storage::dbt_array_clear_and_resize(array, newIdxKeys.size());
+                    for (BSONObjSet::const_iterator it = newIdxKeys.begin(); it != newIdxKeys.end(); it++) {
+                        const storage::Key sKey(*it, &pk);
+                        storage::dbt_array_push(array, sKey.buf(), sKey.size());
+                    }
                 }
-                array = &keyArrays[i + n];
-                storage::dbt_array_clear_and_resize(array, oldIdxKeys.size());
-                for (BSONObjSet::const_iterator it = oldIdxKeys.begin(); it != oldIdxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
-                    storage::dbt_array_push(array, sKey.buf(), sKey.size());
+                if (!oldKeysDone) {
+                    DBT_ARRAY *array = &keyArrays[i + n];
+                    storage::dbt_array_clear_and_resize(array, oldIdxKeys.size());
+                    for (BSONObjSet::const_iterator it = oldIdxKeys.begin(); it != oldIdxKeys.end(); it++) {
+                        const storage::Key sKey(*it, &pk);
+                        storage::dbt_array_push(array, sKey.buf(), sKey.size());
+                    }
                 }
             }
         }
 
+        singleKeys.finish();
+
         // The pk doesn't change, so old_src_key == new_src_key.
         DB_ENV *env = storage::env;
         const int r = env->update_multiple(env, dbs[0], cc().txn().db_txn(),
@@ -951,6 +1049,16 @@ namespace mongo {
         pkIdx.updatePair(pk, NULL, b.done(), flags);
     }
 
+    void CollectionBase::updateAllObjectsMods(const BSONObj &updateObj, uint64_t flags) {
+        verify(!updateObj.isEmpty());
+        BSONObjBuilder b;
+        b.append("t", "b");
+        b.append("o", updateObj);
+
+        IndexDetailsBase &pkIdx = getPKIndexBase();
+        pkIdx.updateBroadcast(b.done(), flags);
+    }
+
     bool CollectionBase::_allowSetMultiKeyInMSTForTests = false;
 
     // only set indexBitsChanged if true, NEVER set to false
@@ -1087,6 +1195,8 @@ namespace mongo {
 
         IndexDetails &idx = _cd->idx(idxNum);
 
+        dropIndexStats(_ns, idx.indexNamespace());
+
         // Remove this index from the system catalogs
         removeFromNamespacesCatalog(idx.indexNamespace());
         if (nsToCollectionSubstring(_ns) != "system.indexes") {
@@ -1755,6 +1865,26 @@ namespace mongo {
         verify(closed);
     }
 
+    OID shareBulkLoad(const StringData &ns) {
+        Collection *cl = getCollection(ns);
+        verify(cl != NULL && cl->bulkLoading());
+        return cl->as<BulkLoadedCollection>()->share();
+    }
+
+    void joinBulkLoad(const StringData &ns, const OID &token) {
+        // Inserts from joined connections are logged in their own transactions,
+        // which would reach the oplog ahead of the beginLoad that creates the
+        // collection on secondaries.
+        uassert( 17370, "Cannot join a bulk load while logging operations for replication",
+                        !logTxnOpsForReplication() );
+        // getCollection() would reject us for not owning the load, so look
+        // the ns up directly. A collection under-going bulk load is always open.
+        Collection *cl = collectionMap(ns)->find_ns(ns);
+        uassert( 17371, str::stream() << "No bulk load in progress for " << ns,
+                        cl != NULL && cl->bulkLoading() );
+        cl->as<BulkLoadedCollection>()->join(cc().getConnectionId(), token);
+    }
+
     bool legalClientSystemNS( const StringData& ns , bool write ) {
         if( ns == "local.system.replset" ) return true;
 
@@ -2175,6 +2305,11 @@ namespace mongo {
                            " should have been enforced higher in the stack" );
     }
 
+    void SystemUsersCollection::updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags) {
+        msgasserted(17380, "bug: cannot (fast) update on the system users collection, "
+                           " should have been enforced higher in the stack" );
+    }
+
     // ------------------------------------------------------------------------
 
     // Capped collections have natural order insert semantics but borrow (ie: copy)
@@ -2327,6 +2462,11 @@ namespace mongo {
                            " should have been enforced higher in the stack" );
     }
 
+    void CappedCollection::updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags) {
+        msgasserted(17381, "bug: cannot (fast) update a capped collection, "
+                           " should have been enforced higher in the stack" );
+    }
+
     void CappedCollection::_insertObject(const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
         uassert( 16328 , str::stream() << "document is larger than capped size "
                  << obj.objsize() << " > " << _maxSize, obj.objsize() <= _maxSize );
@@ -2347,7 +2487,8 @@ namespace mongo {
     //
     // The given deltas are signed values that represent changes to the collection.
     // We need to roll back those changes. Therefore, we subtract from the current value.
-    void CappedCollection::noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta) {
+    void CappedCollection::noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta,
+                                     const CappedPartitionDeltas &partitionDeltas) {
         noteComplete(minPK);
         _currentObjects.fetchAndSubtract(nDelta);
         _currentSize.fetchAndSubtract(sizeDelta);
@@ -2535,7 +2676,11 @@ namespace mongo {
 
     BulkLoadedCollection::BulkLoadedCollection(const BSONObj &serialized) :
         IndexedCollection(serialized),
-        _bulkLoadConnectionId(cc().getConnectionId()) {
+        _bulkLoadConnectionId(cc().getConnectionId()),
+        _joinMutex("bulkLoadJoinMutex"),
+        _shared(false),
+        _intakeMutex("bulkLoadIntakeMutex"),
+        _loaderMutex("bulkLoadLoaderMutex") {
         // By noting this ns in the collection map rollback, we will automatically
         // abort the load if the calling transaction aborts, because close()
         // will be called with aborting = true. See BulkLoadedCollection::close()
@@ -2570,6 +2715,11 @@ namespace mongo {
         } finallyClose(*this, abortingLoad);
 
         if (!abortingLoad) {
+            // We have the write lock, so nobody else is adding to the intake batch.
+            if (_intake) {
+                SimpleMutex::scoped_lock lk(_loaderMutex);
+                drainIntake(*_intake);
+            }
             const int r = _loader->close();
             if (r != 0) {
                 storage::handle_ydb_error(r);
@@ -2589,23 +2739,89 @@ namespace mongo {
     }
 
     void BulkLoadedCollection::validateConnectionId(const ConnectionId &id) {
+        if (_bulkLoadConnectionId == id) {
+            return;
+        }
+        SimpleMutex::scoped_lock lk(_joinMutex);
         uassert( 16878, str::stream() << "This connection cannot use ns " << _ns <<
                         ", it is currently under-going bulk load by connection id "
                         << _bulkLoadConnectionId,
-                        _bulkLoadConnectionId == id );
+                        _joinedConnectionIds.count(id) > 0 );
+    }
+
+    OID BulkLoadedCollection::share() {
+        // Only called by the connection that owns the load, with the write lock held.
+        if (!_shared) {
+            _loadToken.init();
+            _intake.reset(new BufBuilder(IntakeBatchBytes));
+            _shared = true;
+        }
+        return _loadToken;
+    }
+
+    void BulkLoadedCollection::join(const ConnectionId &id, const OID &token) {
+        uassert( 17367, str::stream() << "Bulk load of " << _ns << " is not shared",
+                        _shared );
+        uassert( 17368, str::stream() << "Invalid load token for bulk load of " << _ns,
+                        token == _loadToken );
+        SimpleMutex::scoped_lock lk(_joinMutex);
+        _joinedConnectionIds.insert(id);
     }
 
     void BulkLoadedCollection::insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
         const BSONObj pk = getValidatedPKFromObject(obj);
+        put(pk, obj);
+        // multiKey stuff taken care of during close(), so indexBitChanged is not set
+    }
 
+    void BulkLoadedCollection::put(const BSONObj &pk, const BSONObj &obj) {
         storage::Key sPK(pk, NULL);
-        DBT key = storage::dbt_make(sPK.buf(), sPK.size());
-        DBT val = storage::dbt_make(obj.objdata(), obj.objsize());
-        const int r = _loader->put(&key, &val);
-        if (r != 0) {
-            storage::handle_ydb_error(r);
+        if (!_shared) {
+            DBT key = storage::dbt_make(sPK.buf(), sPK.size());
+            DBT val = storage::dbt_make(obj.objdata(), obj.objsize());
+            const int r = _loader->put(&key, &val);
+            if (r != 0) {
+                storage::handle_ydb_error(r);
+            }
+            return;
         }
-        // multiKey stuff taken care of during close(), so indexBitChanged is not set
+
+        // Each intake entry is the key size, the key, then the object (which
+        // knows its own size).
+        scoped_ptr<BufBuilder> full;
+        {
+            SimpleMutex::scoped_lock lk(_intakeMutex);
+            _intake->appendNum(sPK.size());
+            _intake->appendBuf(sPK.buf(), sPK.size());
+            _intake->appendBuf(obj.objdata(), obj.objsize());
+            if (_intake->len() >= IntakeBatchBytes) {
+                full.swap(_intake);
+                _intake.reset(new BufBuilder(IntakeBatchBytes));
+            }
+        }
+        if (full) {
+            SimpleMutex::scoped_lock lk(_loaderMutex);
+            drainIntake(*full);
+        }
+    }
+
+    void BulkLoadedCollection::drainIntake(BufBuilder &batch) {
+        const char *p = batch.buf();
+        const char *end = p + batch.len();
+        while (p < end) {
+            const int keySize = *reinterpret_cast<const int *>(p);
+            p += sizeof(int);
+            DBT key = storage::dbt_make(p, keySize);
+            p += keySize;
+            const BSONObj obj(p);
+            DBT val = storage::dbt_make(obj.objdata(), obj.objsize());
+            p += obj.objsize();
+            const int r = _loader->put(&key, &val);
+            if (r != 0) {
+                storage::handle_ydb_error(r);
+            }
+        }
+        batch.reset();
     }
 
     void BulkLoadedCollection::deleteObject(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
@@ -2624,6 +2840,10 @@ namespace mongo {
         uasserted( 17218, "Cannot update a collection under-going bulk load." );
     }
 
+    void BulkLoadedCollection::updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags) {
+        uasserted( 17382, "Cannot update a collection under-going bulk load." );
+    }
+
     bool BulkLoadedCollection::rebuildIndex(int i, const BSONObj &options, BSONObjBuilder &wasBuilder) {
         uasserted( 16895, "Cannot optimize a collection under-going bulk load." );
     }
@@ -2698,6 +2918,15 @@ namespace mongo {
         // We can't call initialize here because it depends on virtual functions
     }
 
+    PartitionedCollection::PartitionedCollection(const StringData &ns, const BSONObj &pkPattern, const BSONObj &options) :
+        CollectionData(ns, pkPattern),
+        _options(options.getOwned()),
+        _ordering(Ordering::make(BSONObj())), // dummy for now, we create it properly below
+        _shardKeyPattern(_pk)
+    {
+        // MUST CALL initialize directly after this.
+    }
+
     void PartitionedCollection::initialize(const StringData &ns, const BSONObj &options) {
         // create the meta collection
         // note that we create it with empty options
@@ -3560,4 +3789,333 @@ namespace mongo {
         return c.obj();
     }
 
+    // ------------------------------------------------------------------------
+
+    CappedPartition::CappedPartition(const StringData &ns, const BSONObj &options,
+                                     PartitionedCappedCollection *pcc) :
+        CollectionBase(ns, BSON("$_" << 1), options),
+        _pcc(pcc) {
+        // Create an _id index if "autoIndexId" is missing or it exists as true.
+        // It cannot be unique, since uniqueness can't be checked across partitions.
+        const BSONElement e = options["autoIndexId"];
+        if (!e.ok() || e.trueValue()) {
+            BSONObj info = indexInfo(_ns, BSON("_id" << 1), false, false, options);
+            createIndex(info);
+        }
+    }
+
+    CappedPartition::CappedPartition(const BSONObj &serialized, PartitionedCappedCollection *pcc) :
+        CollectionBase(serialized),
+        _pcc(pcc) {
+    }
+
+    BSONObj CappedPartition::minUnsafeKey() {
+        return _pcc->minUnsafeKey();
+    }
+
+    bool CappedPartition::getMaxPKForPartitionCap(BSONObj &result) const {
+        BSONObj lastPK;
+        if (!CollectionBase::getMaxPKForPartitionCap(lastPK)) {
+            return false;
+        }
+        // Every key handed out so far must stay in this partition, including
+        // those whose inserts haven't reached it yet.
+        result = _pcc->lastGeneratedPK();
+        dassert(result.woCompare(lastPK) >= 0);
+        return true;
+    }
+
+    void CappedPartition::insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        msgasserted(17363, "bug: capped partitions must be inserted into with a primary key");
+    }
+
+    void CappedPartition::insertObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        insertIntoIndexes(pk, obj, flags, indexBitChanged);
+    }
+
+    void CappedPartition::updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj,
+                                       const bool fromMigrate,
+                                       uint64_t flags, bool* indexBitChanged) {
+        newObj = inheritIdField(oldObj, newObj);
+        long long diff = newObj.objsize() - oldObj.objsize();
+        uassert( 17364, "failing update: objects in a capped ns cannot grow", diff <= 0 );
+
+        CollectionBase::updateObject(pk, oldObj, newObj, fromMigrate, flags, indexBitChanged);
+    }
+
+    // ------------------------------------------------------------------------
+
+    shared_ptr<PartitionedCappedCollection> PartitionedCappedCollection::make(
+        const StringData &ns,
+        const BSONObj &options
+        )
+    {
+        shared_ptr<PartitionedCappedCollection> ret;
+        BSONObj stripped = cloneBSONWithFieldStripped(options, "partitioned");
+        ret.reset(new PartitionedCappedCollection(ns, stripped));
+        ret->initialize(ns, stripped);
+        ret->noteLastPartition();
+        return ret;
+    }
+
+    shared_ptr<PartitionedCappedCollection> PartitionedCappedCollection::make(const BSONObj &serialized) {
+        shared_ptr<PartitionedCappedCollection> ret;
+        BSONObj stripped = cloneBSONWithFieldChanged(
+            serialized, "options",
+            cloneBSONWithFieldStripped(serialized.getObjectField("options"), "partitioned"),
+            false);
+        ret.reset(new PartitionedCappedCollection(stripped));
+        ret->initialize(stripped);
+        ret->initializeCappedState();
+        return ret;
+    }
+
+    static int cappedPartitionsFromOptions(const BSONObj &options) {
+        const BSONElement e = options["cappedPartitions"];
+        const int n = e.ok() ? e.numberInt() : 8;
+        uassert(17359, "cappedPartitions must be between 2 and 1000", n >= 2 && n <= 1000);
+        return n;
+    }
+
+    PartitionedCappedCollection::PartitionedCappedCollection(const StringData &ns, const BSONObj &options) :
+        PartitionedCollection(ns, BSON("$_" << 1), options),
+        _maxSize(BytesQuantity<long long>(options["size"])),
+        _maxObjects(BytesQuantity<long long>(options["max"])),
+        _nPartitions(cappedPartitionsFromOptions(options)),
+        _nextPK(0),
+        _lastPartitionObjects(0),
+        _lastPartitionSize(0),
+        _lastPartitionId(0),
+        _rotationRequested(0),
+        _mutex("partitionedCappedMutex") {
+        uassert(17360, "cannot define a primary key for a capped collection",
+                       !options["primaryKey"].ok());
+        uassert(17361, "partitioned capped collections must specify a size or max",
+                       _maxSize > 0 || _maxObjects > 0);
+    }
+
+    PartitionedCappedCollection::PartitionedCappedCollection(const BSONObj &serialized) :
+        PartitionedCollection(serialized),
+        _maxSize(BytesQuantity<long long>(serialized["options"]["size"])),
+        _maxObjects(BytesQuantity<long long>(serialized["options"]["max"])),
+        _nPartitions(cappedPartitionsFromOptions(serialized["options"].Obj())),
+        _nextPK(0),
+        _lastPartitionObjects(0),
+        _lastPartitionSize(0),
+        _lastPartitionId(0),
+        _rotationRequested(0),
+        _mutex("partitionedCappedMutex") {
+    }
+
+    shared_ptr<CollectionData> PartitionedCappedCollection::makeNewPartition(
+        const StringData &ns,
+        const BSONObj &options
+        )
+    {
+        shared_ptr<CappedPartition> ret;
+        ret.reset(new CappedPartition(ns, options, this));
+        return ret;
+    }
+
+    // called in constructor
+    shared_ptr<CollectionData> PartitionedCappedCollection::openExistingPartition(
+        const BSONObj &serialized
+        )
+    {
+        shared_ptr<CappedPartition> ret;
+        ret.reset(new CappedPartition(serialized, this));
+        return ret;
+    }
+
+    void PartitionedCappedCollection::initializeCappedState() {
+        Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+        // The next PK is one past the last one in the collection. If the
+        // last partition is empty, its predecessor's pivot bounds every key.
+        const uint64_t n = numPartitions();
+        shared_ptr<CollectionData> last = getPartition(n - 1);
+        BSONObj lastPK;
+        if (last->as<CollectionBase>()->CollectionBase::getMaxPKForPartitionCap(lastPK)) {
+            _nextPK.store(lastPK.firstElement().Long() + 1);
+        } else if (n > 1) {
+            BSONObj pivot = getPartitionMetadata(n - 2)["max"].Obj();
+            _nextPK.store(pivot.firstElement().Long() + 1);
+        }
+
+        // The stats are estimates, which is good enough to decide when to
+        // add the next partition.
+        CollectionData::Stats stats;
+        last->fillCollectionStats(stats, NULL, 1);
+        _lastPartitionObjects.store(stats.count);
+        _lastPartitionSize.store(stats.size);
+        noteLastPartition();
+        txn.commit();
+    }
+
+    void PartitionedCappedCollection::fillSpecificStats(BSONObjBuilder &result, int scale) const {
+        PartitionedCollection::fillSpecificStats(result, scale);
+        result.appendBool("capped", true);
+        if (_maxObjects) {
+            result.appendNumber("max", _maxObjects);
+        }
+        result.appendNumber("cappedSizeMax", _maxSize);
+        result.appendNumber("cappedPartitions", _nPartitions);
+    }
+
+    // @return the maximum safe key to read for a tailable cursor.
+    BSONObj PartitionedCappedCollection::minUnsafeKey() {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        const long long minUncommitted = _uncommittedMinPKs.size() > 0 ?
+                                         _uncommittedMinPKs.begin()->firstElement().Long() :
+                                         _nextPK.load();
+        TOKULOG(2) << "minUnsafeKey: minUncommitted " << minUncommitted << endl;
+        BSONObjBuilder b;
+        b.append("", minUncommitted);
+        return b.obj();
+    }
+
+    BSONObj PartitionedCappedCollection::lastGeneratedPK() const {
+        const long long nextPK = _nextPK.load();
+        if (nextPK == 0) {
+            return BSONObj();
+        }
+        BSONObjBuilder b(32);
+        b.append("", nextPK - 1);
+        return b.obj();
+    }
+
+    void PartitionedCappedCollection::insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        const BSONObj pk = getNextPK();
+        insertIntoPartition(pk, obj, flags | Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE, indexBitChanged);
+    }
+
+    void PartitionedCappedCollection::deleteObject(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
+        msgasserted(17362, "bug: cannot remove from a capped collection, "
+                           " should have been enforced higher in the stack" );
+    }
+
+    void PartitionedCappedCollection::updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj,
+                                                   const bool fromMigrate,
+                                                   uint64_t flags, bool* indexBitChanged) {
+        getPartition(partitionWithPK(pk))->updateObject(pk, oldObj, newObj, fromMigrate, flags, indexBitChanged);
+    }
+
+    void PartitionedCappedCollection::insertObjectAndLogOps(const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        const BSONObj objWithId = addIdField(obj);
+        const BSONObj pk = getNextPK();
+        insertIntoPartition(pk, objWithId, flags | Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE, indexBitChanged);
+        OplogHelpers::logInsertForCapped(_ns.c_str(), pk, objWithId);
+    }
+
+    // run an insertion where the PK is specified
+    // Can come from the applier thread on a slave or a cloner 
+    void PartitionedCappedCollection::insertObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            long long pkVal = pk[""].Long();
+            if (pkVal >= _nextPK.load()) {
+                _nextPK.store(pkVal + 1);
+            }
+            noteUncommittedPK(pk);
+        }
+        insertIntoPartition(pk, obj, flags, indexBitChanged);
+    }
+
+    void PartitionedCappedCollection::noteCommit(const BSONObj &minPK, long long nDelta, long long sizeDelta) {
+        noteComplete(minPK);
+    }
+
+    void PartitionedCappedCollection::noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta,
+                                                const CappedPartitionDeltas &partitionDeltas) {
+        noteComplete(minPK);
+        // Called under a read lock, so the last partition can't change meanwhile. What went
+        // into partitions that were last before a rotation isn't counted anywhere anymore.
+        CappedPartitionDeltas::const_iterator it = partitionDeltas.find(_lastPartitionId);
+        if (it != partitionDeltas.end()) {
+            _lastPartitionObjects.fetchAndSubtract(it->second.first);
+            _lastPartitionSize.fetchAndSubtract(it->second.second);
+        }
+    }
+
+    // run a deletion where the PK is specified
+    // Can come from the rollback of an insert on a slave
+    void PartitionedCappedCollection::deleteObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
+        const uint64_t whichPartition = partitionWithPK(pk);
+        getPartition(whichPartition)->deleteObject(pk, obj, flags);
+        if (whichPartition == numPartitions() - 1) {
+            CappedCollectionRollback &rollback = cc().txn().cappedRollback();
+            rollback.notePartitionChange(_ns, _lastPartitionId, -obj.objsize());
+            _lastPartitionObjects.fetchAndSubtract(1);
+            _lastPartitionSize.fetchAndSubtract(obj.objsize());
+        }
+    }
+
+    // requires: _mutex is held
+    void PartitionedCappedCollection::noteUncommittedPK(const BSONObj &pk) {
+        CappedCollectionRollback &rollback = cc().txn().cappedRollback();
+        if (!rollback.hasNotedInsert(_ns)) {
+            _uncommittedMinPKs.insert(pk.getOwned());
+        }
+    }
+
+    BSONObj PartitionedCappedCollection::getNextPK() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        BSONObjBuilder b(32);
+        b.append("", _nextPK.fetchAndAdd(1));
+        BSONObj pk = b.obj();
+        noteUncommittedPK(pk);
+        return pk;
+    }
+
+    void PartitionedCappedCollection::noteComplete(const BSONObj &minPK) {
+        if (!minPK.isEmpty()) {
+            SimpleMutex::scoped_lock lk(_mutex);
+            const int n = _uncommittedMinPKs.erase(minPK);
+            verify(n == 1);
+        }
+    }
+
+    void PartitionedCappedCollection::insertIntoPartition(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
+        uassert( 17365, str::stream() << "document is larger than capped size "
+                 << obj.objsize() << " > " << _maxSize, _maxSize == 0 || obj.objsize() <= _maxSize );
+
+        CappedCollectionRollback &rollback = cc().txn().cappedRollback();
+        rollback.noteInsert(_ns, pk, obj.objsize());
+
+        const uint64_t whichPartition = partitionWithPK(pk);
+        getPartition(whichPartition)->as<CappedPartition>()->insertObjectWithPK(pk, obj, flags, indexBitChanged);
+
+        if (whichPartition == numPartitions() - 1) {
+            rollback.notePartitionChange(_ns, _lastPartitionId, obj.objsize());
+            const long long n = _lastPartitionObjects.addAndFetch(1);
+            const long long size = _lastPartitionSize.addAndFetch(obj.objsize());
+            if (isLastPartitionFull(n, size) && _rotationRequested.compareAndSwap(0, 1) == 0) {
+                requestCappedPartitionRotation(_ns);
+            }
+        }
+    }
+
+    void PartitionedCappedCollection::noteLastPartition() {
+        _lastPartitionId = getPartitionMetadata(numPartitions() - 1)["_id"].numberLong();
+    }
+
+    bool PartitionedCappedCollection::isLastPartitionFull(long long n, long long size) const {
+        return (_maxObjects > 0 && n >= _maxObjects / _nPartitions) ||
+               (_maxSize > 0 && size >= _maxSize / _nPartitions);
+    }
+
+    void PartitionedCappedCollection::rotatePartitions() {
+        Lock::assertWriteLocked(_ns);
+        _rotationRequested.store(0);
+        if (isLastPartitionFull(_lastPartitionObjects.load(), _lastPartitionSize.load())) {
+            addPartition();
+            noteLastPartition();
+            _lastPartitionObjects.store(0);
+            _lastPartitionSize.store(0);
+        }
+        while (numPartitions() > (uint64_t) _nPartitions) {
+            dropPartition(getPartitionMetadata(0)["_id"].numberLong());
+        }
+    }
+
 } // namespace mongo
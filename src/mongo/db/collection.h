@@ -27,6 +27,7 @@
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/querypattern.h"
 #include "mongo/db/storage/builder.h"
+#include "mongo/db/txn_context.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/concurrency/simplerwlock.h"
@@ -81,6 +82,11 @@ namespace mongo {
                        const BSONObj &options);
     void commitBulkLoad(const StringData &ns);
     void abortBulkLoad(const StringData &ns);
+    // Open a load in progress to other connections. Returns the token they
+    // must present to joinBulkLoad.
+    OID shareBulkLoad(const StringData &ns);
+    // Allow the current connection to insert into a shared load.
+    void joinBulkLoad(const StringData &ns, const OID &token);
 
     // Because of #673 we need to detect if we're missing this index and to ignore that error.
     extern BSONObj oldSystemUsersKeyPattern;
@@ -215,6 +221,12 @@ namespace mongo {
                                       const bool fromMigrate,
                                       uint64_t flags) = 0;
 
+        // update every object in the namespace, described by the updateObj's $ operators,
+        // with one message that the storage layer applies lazily.
+        //
+        // does not maintain secondary indexes and does not handle logging
+        virtual void updateAllObjectsMods(const BSONObj &updateObj, uint64_t flags) = 0;
+
         // rebuild the given index, online.
         // - if there are options, change those options in the index and update the system catalog.
         // - otherwise, send an optimize message and run hot optimize.
@@ -583,6 +595,13 @@ namespace mongo {
             _cd->updateObjectMods(pk, updateObj, fromMigrate, flags);
         }
 
+        // update every object in the namespace, described by the updateObj's $ operators
+        //
+        // does not handle logging
+        void updateAllObjectsMods(const BSONObj &updateObj, uint64_t flags = 0) {
+            _cd->updateAllObjectsMods(updateObj, flags);
+        }
+
         // Rebuild indexes. Details are implementation specific. This is typically an online operation.
         //
         // @param name, name of the index to optimize. "*" means all indexes
@@ -847,6 +866,9 @@ namespace mongo {
         virtual void updateObjectMods(const BSONObj &pk, const BSONObj &updateObj, 
                                       const bool fromMigrate,
                                       uint64_t flags);
+
+        // update every object in the namespace, described by the updateObj's $ operators
+        virtual void updateAllObjectsMods(const BSONObj &updateObj, uint64_t flags);
         
         void setIndexIsMultikey(const int idxNum, bool* indexBitChanged);
 
@@ -1135,11 +1157,37 @@ namespace mongo {
         void updateObjectMods(const BSONObj &pk, const BSONObj &updateobj,
                               const bool fromMigrate,
                               uint64_t flags);
+        void updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags);
         bool updateObjectModsOk() {
             return false;
         }
     };
 
+    // The operations callers need from a capped collection that plain collections don't
+    // have: inserting with a generated primary key that is logged along with the object,
+    // replaying such an insert on a secondary or in the cloner, and maintaining the
+    // minimum uncommitted key when a transaction that inserted commits or aborts.
+    //
+    // Implemented by CappedCollection and PartitionedCappedCollection.
+    class CappedCollectionInterface {
+    public:
+        virtual void insertObjectAndLogOps(const BSONObj &obj, uint64_t flags, bool* indexBitChanged) = 0;
+
+        virtual void insertObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged) = 0;
+
+        virtual void noteCommit(const BSONObj &minPK, long long nDelta, long long sizeDelta) = 0;
+
+        // partitionDeltas: what the transaction changed in each partition, for a partitioned
+        //                  capped collection
+        virtual void noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta,
+                               const CappedPartitionDeltas &partitionDeltas) = 0;
+
+        // Deletes a row by its primary key, for the rollback of a capped insert.
+        virtual void deleteObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags) = 0;
+
+        virtual ~CappedCollectionInterface() { }
+    };
+
     // Capped collections have natural order insert semantics but borrow (ie: copy)
     // its document modification strategy from IndexedCollections. The size
     // and count of a capped collection is maintained in memory and kept valid
@@ -1154,7 +1202,8 @@ namespace mongo {
     // In the implementation, NaturalOrderCollection::_nextPK and the set of
     // uncommitted primary keys are protected together by _mutex. Trimming
     // work is done under the _deleteMutex.
-    class CappedCollection : public NaturalOrderCollection, public TailableCollection {
+    class CappedCollection : public NaturalOrderCollection, public TailableCollection,
+                             public CappedCollectionInterface {
     public:
         CappedCollection(const StringData &ns, const BSONObj &options,
                          const bool mayIndexId = true);
@@ -1180,6 +1229,8 @@ namespace mongo {
                               const bool fromMigrate,
                               uint64_t flags);
 
+        void updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags);
+
         bool updateObjectModsOk() {
             return false;
         }
@@ -1203,7 +1254,8 @@ namespace mongo {
         //
         // The given deltas are signed values that represent changes to the collection.
         // We need to roll back those changes. Therefore, we subtract from the current value.
-        void noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta);
+        void noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta,
+                       const CappedPartitionDeltas &partitionDeltas);
         
         bool requiresIDField() const {
             return true;
@@ -1286,6 +1338,12 @@ namespace mongo {
 
         void validateConnectionId(const ConnectionId &id);
 
+        // Allow other connections to join this load. Returns the token
+        // they must present to join().
+        OID share();
+
+        void join(const ConnectionId &id, const OID &token);
+
         void insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged);
 
         void deleteObject(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
@@ -1298,6 +1356,8 @@ namespace mongo {
                               const bool fromMigrate,
                               uint64_t flags);
 
+        void updateAllObjectsMods(const BSONObj &updateobj, uint64_t flags);
+
         void empty();
 
         bool rebuildIndex(int i, const BSONObj &options, BSONObjBuilder &wasBuilder);
@@ -1314,13 +1374,37 @@ namespace mongo {
 
         void createIndex(const BSONObj &info);
 
-        // The connection that started the bulk load is the only one that can
-        // do anything with the namespace until the load is complete and this
-        // namespace has been closed / re-opened.
+        // Hand a (pk, obj) pair to the loader, buffering it in the intake
+        // batch first if the load is shared.
+        void put(const BSONObj &pk, const BSONObj &obj);
+
+        // Feed every pair in the given intake batch to the loader.
+        // requires: _loaderMutex is held
+        void drainIntake(BufBuilder &batch);
+
+        // The connection that started the bulk load, and any connections that
+        // joined it with the load token, are the only ones that can do anything
+        // with the namespace until the load is complete and this namespace has
+        // been closed / re-opened.
         ConnectionId _bulkLoadConnectionId;
+        OID _loadToken;
+        set<ConnectionId> _joinedConnectionIds;
+        SimpleMutex _joinMutex;
+
         scoped_array<DB *> _dbs;
         scoped_array< scoped_ptr<MultiKeyTracker> > _multiKeyTrackers;
         scoped_ptr<storage::Loader> _loader;
+
+        // The ydb loader is single threaded. Once a load is shared, inserting
+        // connections append to the intake batch under _intakeMutex, and
+        // whoever fills it swaps it out and drains it into the loader under
+        // _loaderMutex, so building and copying the next batch is not
+        // serialized behind the loader.
+        static const int IntakeBatchBytes = 1 << 20;
+        bool _shared;
+        scoped_ptr<BufBuilder> _intake;
+        SimpleMutex _intakeMutex;
+        SimpleMutex _loaderMutex;
     };
 
     string getMetaCollectionName(const StringData &ns);
@@ -1450,6 +1534,12 @@ namespace mongo {
             _partitions[whichPartition]->updateObjectMods(pk, updateObj, fromMigrate, flags);
         }
 
+        virtual void updateAllObjectsMods(const BSONObj &updateObj, uint64_t flags) {
+            for (uint64_t i = 0; i < numPartitions(); i++) {
+                _partitions[i]->updateAllObjectsMods(updateObj, flags);
+            }
+        }
+
         virtual bool rebuildIndex(int i, const BSONObj &options, BSONObjBuilder &result);
 
         virtual void dropIndexDetails(int idxNum, bool noteNs) {
@@ -1613,6 +1703,8 @@ namespace mongo {
         // called in constructor
         virtual shared_ptr<CollectionData> openExistingPartition(const BSONObj &serialized);
         PartitionedCollection(const StringData &ns, const BSONObj &options);
+        // for subclasses whose primary key does not come from the "primaryKey" option
+        PartitionedCollection(const StringData &ns, const BSONObj &pkPattern, const BSONObj &options);
         PartitionedCollection(const BSONObj &serialized, CollectionRenamer* renamer);
         PartitionedCollection(const BSONObj &serialized);
         void initialize(const StringData &ns, const BSONObj &options);
@@ -1728,5 +1820,156 @@ namespace mongo {
         virtual shared_ptr<CollectionData> openExistingPartition(const BSONObj &serialized);
     };
 
+    class PartitionedCappedCollection;
+
+    // The individual partitions of a PartitionedCappedCollection. The primary key
+    // is a hidden auto-increment key like a NaturalOrderCollection's, but it is
+    // generated by the parent so that it increases across partitions. Tailable
+    // cursors only ever tail the last partition, and get their minUnsafeKey from
+    // the parent, which tracks the uncommitted inserts.
+    class CappedPartition : public CollectionBase, public TailableCollection {
+    public:
+        CappedPartition(const StringData &ns, const BSONObj &options, PartitionedCappedCollection *pcc);
+        CappedPartition(const BSONObj &serialized, PartitionedCappedCollection *pcc);
+
+        bool isCapped() const { return true; }
+
+        bool isPKHidden() const {
+            return true;
+        }
+
+        bool requiresIDField() const {
+            return true;
+        }
+
+        bool updateObjectModsOk() {
+            return false;
+        }
+
+        // @return the minimum key that is not safe to read for any tailable cursor
+        BSONObj minUnsafeKey();
+
+        // The parent may have handed out primary keys that are not in this
+        // partition yet, so the cap is the last key it generated.
+        bool getMaxPKForPartitionCap(BSONObj &result) const;
+
+        // Primary keys are generated by the parent, which uses insertObjectWithPK()
+        void insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        void insertObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        void updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj,
+                          const bool fromMigrate,
+                          uint64_t flags, bool* indexBitChanged);
+
+    private:
+        PartitionedCappedCollection *_pcc;
+    };
+
+    // A capped collection stored as a partitioned collection of CappedPartitions.
+    // Rather than deleting the oldest documents one at a time as CappedCollection
+    // does, inserts only note how much the last partition holds. Once it reaches
+    // its share of the cap (size / cappedPartitions, and likewise for max), a
+    // background thread adds a new partition and drops the oldest ones beyond
+    // cappedPartitions, so trimming costs a dictionary drop instead of a delete
+    // per document, and the cap is enforced at partition granularity.
+    //
+    // Primary keys and the set of uncommitted primary keys are maintained exactly
+    // as in CappedCollection, and inserts are logged with their primary key, so
+    // secondaries and the cloner insert the same keys. Each member rotates its own
+    // partitions, the same way each member trims its own oplog.
+    //
+    // Adding or dropping a partition invalidates all cursors over the collection,
+    // tailable ones included, so tailing clients must requery from the last
+    // document they saw, as they would after a cursor timeout.
+    class PartitionedCappedCollection : public PartitionedCollection, public CappedCollectionInterface {
+    public:
+        static shared_ptr<PartitionedCappedCollection> make(const StringData &ns, const BSONObj &options);
+        static shared_ptr<PartitionedCappedCollection> make(const BSONObj &serialized);
+
+        bool isCapped() const {
+            return true;
+        }
+
+        bool updateObjectModsOk() {
+            return false;
+        }
+
+        void fillSpecificStats(BSONObjBuilder &result, int scale) const;
+
+        // @return the minimum key that is not safe to read for any tailable cursor
+        BSONObj minUnsafeKey();
+
+        // @return the last primary key handed out, or an empty object if there is none
+        BSONObj lastGeneratedPK() const;
+
+        void insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        void deleteObject(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
+
+        // the hidden primary key never changes, so the object stays in its partition
+        void updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj,
+                          const bool fromMigrate,
+                          uint64_t flags, bool* indexBitChanged);
+
+        void insertObjectAndLogOps(const BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        void insertObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        void noteCommit(const BSONObj &minPK, long long nDelta, long long sizeDelta);
+
+        // Takes back what the transaction counted against the last partition, if it still is
+        // the last one.  After a rotation its counters started over.
+        void noteAbort(const BSONObj &minPK, long long nDelta, long long sizeDelta,
+                       const CappedPartitionDeltas &partitionDeltas);
+
+        // Deletes from the partition holding pk, for the rollback of a capped insert.
+        void deleteObjectWithPK(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
+
+        // Add a partition if the last one is full, then drop the oldest partitions
+        // until at most cappedPartitions remain. Must be write locked.
+        void rotatePartitions();
+
+    protected:
+        PartitionedCappedCollection(const StringData &ns, const BSONObj &options);
+        PartitionedCappedCollection(const BSONObj &serialized);
+        virtual shared_ptr<CollectionData> makeNewPartition(const StringData &ns, const BSONObj &options);
+        virtual shared_ptr<CollectionData> openExistingPartition(const BSONObj &serialized);
+
+    private:
+        // recover the next primary key and the size of the last partition
+        // from the partitions we just opened
+        void initializeCappedState();
+
+        // requires: _mutex is held
+        void noteUncommittedPK(const BSONObj &pk);
+
+        BSONObj getNextPK();
+
+        void noteComplete(const BSONObj &minPK);
+
+        void insertIntoPartition(const BSONObj &pk, const BSONObj &obj, uint64_t flags, bool* indexBitChanged);
+
+        bool isLastPartitionFull(long long n, long long size) const;
+
+        // remember the id of the last partition, after it changes
+        void noteLastPartition();
+
+        const long long _maxSize;
+        const long long _maxObjects;
+        const int _nPartitions;
+        AtomicWord<long long> _nextPK;
+        // Objects and bytes inserted into the last partition, which is the
+        // only one that grows.
+        AtomicWord<long long> _lastPartitionObjects;
+        AtomicWord<long long> _lastPartitionSize;
+        // The id of the last partition, which only changes under a write lock.
+        uint64_t _lastPartitionId;
+        // Nonzero once a rotation was requested and has not run yet, so that
+        // inserts into a full partition only request it once.
+        AtomicWord<unsigned> _rotationRequested;
+        BSONObjSet _uncommittedMinPKs;
+        SimpleMutex _mutex;
+    };
 
 } // namespace mongo
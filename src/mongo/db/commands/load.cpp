@@ -18,6 +18,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/client.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/txn_context.h"
 
 namespace mongo {
 
@@ -49,7 +50,9 @@ namespace mongo {
             help << "begin load" << endl << 
                 "Begin a bulk load into a collection." << endl <<
                 "Must be inside an existing multi-statement transaction." << endl <<
-                "{ beginLoad: 1, ns : collName, indexes: [ { ... }, ... ], options: { ... }  }" << endl;
+                "If shared is true, the result has a loadToken that other connections" << endl <<
+                "can pass to joinLoad to insert into the collection in parallel." << endl <<
+                "{ beginLoad: 1, ns : collName, indexes: [ { ... }, ... ], options: { ... }, shared: false }" << endl;
         }
 
         virtual bool run(const string& db, 
@@ -80,14 +83,56 @@ namespace mongo {
                 BSONObj obj = i->Obj();
                 indexes.push_back(obj.copy());
             }
+            const bool shared = cmdObj["shared"].trueValue();
+            uassert( 17369, "Cannot begin a shared load while logging operations for replication.",
+                            !shared || !logTxnOpsForReplication() );
 
             cc().beginClientLoad(ns, indexes, optionsObj);
+            if (shared) {
+                result.append("loadToken", cc().shareClientLoad());
+            }
             result.append("status", "load began");
             result.append("ok", true);
             return true;
         }
     } beginLoadCmd;
 
+    class JoinLoadCmd : public LoaderCommand {
+    public:
+        JoinLoadCmd() : LoaderCommand("joinLoad") {}
+
+        // Joining only grants this connection access to the collection; the
+        // owning connection's beginLoad is what gets replicated.
+        virtual bool logTheOp() { return false; }
+
+        virtual void help( stringstream& help ) const {
+            help << "join load" << endl <<
+                "Join a shared bulk load begun by another connection, so this" << endl <<
+                "connection may insert into the collection until the load ends." << endl <<
+                "Not supported while logging operations for replication." << endl <<
+                "{ joinLoad: 1, ns : collName, token: loadToken }" << endl;
+        }
+
+        virtual bool run(const string& db, 
+                         BSONObj& cmdObj, 
+                         int options, 
+                         string& errmsg, 
+                         BSONObjBuilder& result, 
+                         bool fromRepl) 
+        {
+            uassert( 17374, "The ns field must be a string.",
+                            cmdObj["ns"].type() == mongo::String );
+            uassert( 17375, "The token field must be the loadToken returned by beginLoad.",
+                            cmdObj["token"].type() == mongo::jstOID );
+
+            const string ns = db + "." + cmdObj["ns"].String();
+            cc().joinClientLoad(ns, cmdObj["token"].OID());
+            result.append("status", "load joined");
+            result.append("ok", true);
+            return true;
+        }
+    } joinLoadCmd;
+
     class CommitLoadCmd : public LoaderCommand {
     public:
         CommitLoadCmd() : LoaderCommand("commitLoad") {}
@@ -25,8 +25,11 @@
 #include "mongo/db/cmdline.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/util/net/listen.h"
+#include "mongo/util/net/message_buffer_pool.h"
+#include "mongo/util/net/message_compressor.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/version.h"
@@ -312,11 +315,22 @@ namespace mongo {
             BSONObj generateSection(const BSONElement& configElement) const {
                 BSONObjBuilder b;
                 networkCounter.append( b );
+                BSONObjBuilder pool( b.subobjStart( "bufferPool" ) );
+                MessageBufferPool::appendStats( pool );
+                pool.done();
+                BSONObjBuilder compression( b.subobjStart( "compression" ) );
+                MessageCompressor::appendStats( compression );
+                compression.done();
                 return b.obj();
             }
                 
         } network;
 
+        ExportedServerParameter<int> messageBufferPoolMaxMBParameter( ServerParameterSet::getGlobal(),
+                                                                      "messageBufferPoolMaxMB",
+                                                                      &MessageBufferPool::maxRetainedMB,
+                                                                      true, true );
+
         class MemBase : public ServerStatusMetric {
         public:
             MemBase() : ServerStatusMetric(".mem.bits") {}
@@ -22,7 +22,6 @@
 #include "../util/concurrency/qlock.h"
 #include "../util/concurrency/threadlocal.h"
 #include "../util/concurrency/rwlock.h"
-#include "../util/concurrency/mapsf.h"
 #include "../util/assert_util.h"
 #include "../util/stacktrace.h"
 #include "client.h"
@@ -32,6 +31,8 @@
 #include "server.h"
 #include "lockstat.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/string_map.h"
 
 // oplog locking
 // no top level read locks
@@ -67,12 +68,52 @@ namespace mongo {
        Note there is no path concept for where the database is; if somehow you had two db's open 
        in different directories with the same name, it will be ok but they are sharing a lock 
        then.
+
+       Lookups take no mutex: the map is copied on write and published through an atomic
+       pointer.  As locks are never deleted, an old copy stays correct for anyone still reading
+       it, so old copies are never freed either.  A copy is only made the first time a database
+       is locked, so that is a handful of small maps.
     */
-    typedef mapsf< StringMap<WrapperForRWLock*> > DBLocksMap;
-    static DBLocksMap dblocks;
+    class DBLocksMap : boost::noncopyable {
+    public:
+        typedef StringMap<WrapperForRWLock*> Map;
+
+        DBLocksMap() : _mutex("DBLocksMap"), _current(reinterpret_cast<uintptr_t>(new Map())) { }
+
+        const Map &snapshot() const {
+            return *reinterpret_cast<const Map *>(_current.load());
+        }
+
+        WrapperForRWLock *get(const StringData &db) {
+            {
+                const Map &m = snapshot();
+                Map::const_iterator it = m.find(db);
+                if (it != m.end()) {
+                    return it->second;
+                }
+            }
+
+            SimpleMutex::scoped_lock lk(_mutex);
+            const Map &m = snapshot();
+            Map::const_iterator it = m.find(db);
+            if (it != m.end()) {
+                return it->second; // someone beat us to it
+            }
+            Map *copy = new Map(m);
+            WrapperForRWLock *lock = new WrapperForRWLock(db);
+            (*copy)[db] = lock;
+            _current.store(reinterpret_cast<uintptr_t>(copy));
+            return lock;
+        }
+
+    private:
+        SimpleMutex _mutex; // serializes writers only
+        AtomicWord<uintptr_t> _current;
+    };
+    static DBLocksMap &dblocks = *new DBLocksMap();
 
-    /* we don't want to touch dblocks too much as a mutex is involved.  thus party for that, 
-       this is here...
+    /* local and admin are locked nested inside other databases, and often, so they are kept
+       out of dblocks entirely.
     */
     WrapperForRWLock *nestableLocks[] = { 
         0, 
@@ -427,11 +468,7 @@ namespace mongo {
 
         if( db != ls.otherName() )
         {
-            DBLocksMap::ref r(dblocks);
-            WrapperForRWLock*& lock = r[db];
-            if( lock == 0 )
-                lock = new WrapperForRWLock(db);
-            ls.lockedOther( db , 1 , lock, context );
+            ls.lockedOther( db , 1 , dblocks.get(db), context );
         }
         else { 
             DEV OCCASIONALLY { dassert( dblocks.get(db) == ls.otherLock() ); }
@@ -614,11 +651,7 @@ namespace mongo {
 
         if( db != ls.otherName() )
         {
-            DBLocksMap::ref r(dblocks);
-            WrapperForRWLock*& lock = r[db];
-            if( lock == 0 )
-                lock = new WrapperForRWLock(db);
-            ls.lockedOther( db , -1 , lock, context );
+            ls.lockedOther( db , -1 , dblocks.get(db), context );
         }
         else { 
             DEV OCCASIONALLY { dassert( dblocks.get(db) == ls.otherLock() ); }
@@ -752,8 +785,8 @@ namespace mongo {
             b.append("admin", nestableLocks[Lock::admin]->stats.report());
             b.append("local", nestableLocks[Lock::local]->stats.report());
             {
-                DBLocksMap::ref r(dblocks);
-                for( DBLocksMap::const_iterator i = r.r.begin(); i != r.r.end(); ++i ) {
+                const DBLocksMap::Map &m = dblocks.snapshot();
+                for( DBLocksMap::Map::const_iterator i = m.begin(); i != m.end(); ++i ) {
                     b.append(i->first, i->second->stats.report());
                 }
             }
@@ -26,6 +26,10 @@
 #include <db.h>
 
 #include "mongo/base/initializer.h"
+#include "mongo/db/capped_partitions.h"
+#include "mongo/db/diagnostic_data.h"
+#include "mongo/db/index_stats.h"
+#include "mongo/db/log_flusher.h"
 #include "mongo/db/collection.h"
 #include "mongo/db/collection_map.h"
 #include "mongo/db/client.h"
@@ -48,6 +52,7 @@
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/repl.h"
+#include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/restapi.h"
 #include "mongo/db/stats/counters.h"
@@ -741,6 +746,11 @@ namespace mongo {
         else {
             startTTLBackgroundJob();
         }
+        startCappedPartitionMonitor();
+        startLogFlusher();
+        startProfileWriter();
+        startDiagnosticDataCollection();
+        startIndexStatsMonitor();
 
 #ifndef _WIN32
         CmdLine::launchOk();
@@ -1207,7 +1217,11 @@ static void processCommandLineOptions(const std::vector<std::string>& argv) {
             cmdLine._replSet = params["replSet"].as<string>().c_str();
         }
         if (params.count("replIndexPrefetch")) {
-            out() << " replIndexPrefetch is a deprecated parameter" << endl;
+            Status status = BackgroundSync::setPrefetchMode(params["replIndexPrefetch"].as<string>());
+            if (!status.isOK()) {
+                out() << status.reason() << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
         }
         if (params.count("only")) {
             cmdLine.only = params["only"].as<string>().c_str();
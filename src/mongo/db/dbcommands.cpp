@@ -51,6 +51,7 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/log_flusher.h"
 #include "mongo/db/collection_map.h"
 #include "mongo/db/collection.h"
 #include "mongo/db/namespacestring.h"
@@ -168,8 +169,9 @@ namespace mongo {
                 if ( cmdObj["j"].trueValue() || cmdObj["fsync"].trueValue()) {
                     // if there's a non-zero log flush period, transactions
                     // do not fsync on commit and so we must do it here.
+                    // Concurrent callers share a single flush.
                     if (cmdLine.logFlushPeriod != 0) {
-                        storage::log_flush();
+                        waitForLogFlush();
                     }
                 }
 
@@ -423,6 +425,7 @@ namespace mongo {
             help << "{ profile : <n> }\n";
             help << "0=off 1=log slow ops 2=log all\n";
             help << "-1 to get current values\n";
+            help << "optional slowms : <ms>, sampleRate : <fraction of qualifying ops recorded, 0 to 1>\n";
             help << "http://dochub.mongodb.org/core/databaseprofiler";
         }
         // Need access to the database to enable profiling on it
@@ -447,10 +450,20 @@ namespace mongo {
             BSONElement e = cmdObj.firstElement();
             result.append("was", cc().database()->profile());
             result.append("slowms", cmdLine.slowMS );
+            result.append("sampleRate", getProfileSampleRate());
 
             int p = (int) e.number();
             bool ok = false;
 
+            BSONElement sampleRate = cmdObj["sampleRate"];
+            if ( sampleRate.isNumber() ) {
+                Status s = setProfileSampleRate(sampleRate.numberDouble());
+                if ( !s.isOK() ) {
+                    errmsg = s.reason();
+                    return false;
+                }
+            }
+
             if ( p == -1 ) {
                 ok = true;
             } else if ( p >= 0 && p <= 2 ) {
@@ -1720,6 +1733,7 @@ namespace mongo {
             Collection *cl = getCollection( ns );
             massert( 13429, "emptycapped no such collection", cl );
             massert( 13424, "collection must be capped", cl->isCapped() );
+            uassert( 17366, "emptycapped is not supported on partitioned capped collections", !cl->isPartitioned() );
             CappedCollection *cappedCl = cl->as<CappedCollection>();
             cappedCl->empty();
             return true;
@@ -130,4 +130,37 @@ namespace mongo {
         }
     }
 
+    bool Descriptor::appendSingleKey(const BSONObj &obj, const BSONObj &pk,
+                                     StackBufBuilder &b, bool *generated) const {
+        const Header &h(*reinterpret_cast<const Header *>(_data));
+        if (h.hashed) {
+            return false;
+        }
+
+        // Ordering limits a key pattern to 31 fields.
+        const int maxFields = 31;
+        const int n = h.numFields;
+        verify(n <= maxFields);
+        const uint32_t *const offsetsBase = reinterpret_cast<const uint32_t *>(_data + sizeof(Header));
+        const char *const fieldsBase = reinterpret_cast<const char *>(offsetsBase + n);
+        const char *fields[maxFields];
+        for (int i = 0; i < n; i++) {
+            fields[i] = fieldsBase + offsetsBase[i];
+        }
+
+        BSONElement elts[maxFields];
+        int numNotFound;
+        if (!KeyGenerator::getSingleKey(obj, fields, n, elts, numNotFound)) {
+            return false;
+        }
+        if (h.sparse && numNotFound == n) {
+            *generated = false;
+            return true;
+        }
+        storage::KeyV1::appendKey(b, elts, n);
+        b.appendBuf(pk.objdata(), pk.objsize());
+        *generated = true;
+        return true;
+    }
+
 } // namespace mongo
@@ -57,6 +57,15 @@ namespace mongo {
 
         void generateKeys(const BSONObj &obj, BSONObjSet &keys) const;
 
+        // Appends the dictionary key (see storage/key.h) for obj's single key and pk to b,
+        // without the intermediate BSONObjs and BSONObjSet that generateKeys() builds.
+        //
+        // @return false, having appended nothing, if obj may generate several keys or the
+        //         index is hashed, in which case generateKeys() must be used. Otherwise,
+        //         *generated is false if a sparse index generates no key for obj.
+        bool appendSingleKey(const BSONObj &obj, const BSONObj &pk,
+                             StackBufBuilder &b, bool *generated) const;
+
         BSONObj fillKeyFieldNames(const BSONObj &key) const;
 
         bool clustering() const {
@@ -0,0 +1,238 @@
+// diagnostic_data.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/diagnostic_data.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/diagnostic_data_codec.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/background.h"
+#include "mongo/util/file.h"
+#include "mongo/util/paths.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    const char *diagnosticDataDirectoryName = "diagnostic.data";
+
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionEnabled, bool, true);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionPeriodMillis, int, 1000);
+    // A chunk holds up to this many samples; the first is stored whole, the rest as deltas.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(diagnosticDataCollectionSamplesPerChunk, int, 300);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionFileSizeMB, int, 10);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionDirectorySizeMB, int, 100);
+
+    namespace {
+
+        const char *filePrefix = "metrics.";
+        const char *interimFileName = "metrics.interim";
+
+        // The chunk being built is saved to the interim file every this many samples, so a
+        // crash loses only the last few seconds.  The next start moves it to a regular file.
+        const int samplesPerInterimWrite = 10;
+
+        class DiagnosticDataCollector : public BackgroundJob {
+        public:
+            DiagnosticDataCollector() : _file(NULL), _fileSize(0) {}
+            virtual ~DiagnosticDataCollector() {}
+
+            virtual string name() const { return "DiagnosticDataCollector"; }
+
+        private:
+            virtual void run() {
+                Client::initThread(name().c_str());
+
+                try {
+                    _dir = boost::filesystem::path(dbpath) / diagnosticDataDirectoryName;
+                    boost::filesystem::create_directories(_dir);
+                    recoverInterim();
+                }
+                catch (std::exception &e) {
+                    error() << "not collecting diagnostic data in " << _dir.string() << ": "
+                            << e.what() << endl;
+                    return;
+                }
+
+                DiagnosticChunkBuilder builder(std::max(diagnosticDataCollectionSamplesPerChunk, 2));
+                DBDirectClient db;
+                time_t lastWarning = 0;
+                while (!inShutdown()) {
+                    sleepmillis(std::max(diagnosticDataCollectionPeriodMillis, 10));
+                    try {
+                        if (!diagnosticDataCollectionEnabled) {
+                            if (!builder.empty()) {
+                                writeChunk(builder);
+                            }
+                            continue;
+                        }
+                        const BSONObj sample = collect(db);
+                        if (!builder.add(sample)) {
+                            writeChunk(builder);
+                            builder.add(sample);
+                        }
+                        if (builder.numSamples() % samplesPerInterimWrite == 0) {
+                            writeInterim(builder.chunk());
+                        }
+                    }
+                    catch (std::exception &e) {
+                        if (time(0) - lastWarning >= 60) {
+                            warning() << "error collecting diagnostic data: " << e.what() << endl;
+                            lastWarning = time(0);
+                        }
+                    }
+                }
+
+                try {
+                    if (!builder.empty()) {
+                        writeChunk(builder);
+                    }
+                }
+                catch (std::exception &e) {
+                    warning() << "error writing diagnostic data at shutdown: " << e.what() << endl;
+                }
+                closeFile();
+            }
+
+            BSONObj collect(DBDirectClient &db) {
+                // commands need no authorization from the server itself
+                Client::GodScope gs;
+                BSONObjBuilder b;
+                b.appendDate("start", jsTime());
+                BSONObj res;
+                db.runCommand("admin", BSON("serverStatus" << 1), res);
+                b.append("serverStatus", res);
+                db.runCommand("admin", BSON("top" << 1), res);
+                b.append("top", res);
+                b.appendDate("end", jsTime());
+                return b.obj();
+            }
+
+            void writeChunk(DiagnosticChunkBuilder &builder) {
+                const BSONObj chunk = builder.chunk();
+                builder.reset();
+                append(chunk);
+                boost::filesystem::remove(_dir / interimFileName);
+            }
+
+            void writeInterim(const BSONObj &chunk) {
+                const boost::filesystem::path tmp = _dir / (string(interimFileName) + ".tmp");
+                {
+                    File f;
+                    f.open(tmp.string().c_str());
+                    uassert(17387, str::stream() << "couldn't open " << tmp.string(), f.is_open());
+                    f.truncate(0);
+                    f.write(0, chunk.objdata(), chunk.objsize());
+                    uassert(17388, str::stream() << "couldn't write " << tmp.string(), !f.bad());
+                }
+                boost::filesystem::rename(tmp, _dir / interimFileName);
+            }
+
+            // A chunk left in the interim file by a crash goes into the first new file.
+            void recoverInterim() {
+                const boost::filesystem::path interim = _dir / interimFileName;
+                if (!boost::filesystem::exists(interim)) {
+                    return;
+                }
+                const boost::uintmax_t size = boost::filesystem::file_size(interim);
+                if (size >= 5 && size <= (boost::uintmax_t) BSONObjMaxInternalSize) {
+                    boost::scoped_array<char> buf(new char[size]);
+                    File f;
+                    f.open(interim.string().c_str(), true);
+                    f.read(0, buf.get(), size);
+                    BSONObj chunk(buf.get());
+                    if (!f.bad() && (boost::uintmax_t) chunk.objsize() == size && chunk.valid()) {
+                        append(chunk);
+                    }
+                }
+                boost::filesystem::remove(interim);
+            }
+
+            void append(const BSONObj &chunk) {
+                if (_file == NULL ||
+                    _fileSize >= (long long) diagnosticDataCollectionFileSizeMB * 1024 * 1024) {
+                    openNewFile();
+                }
+                const size_t n = fwrite(chunk.objdata(), 1, chunk.objsize(), _file);
+                uassert(17389, errnoWithPrefix("couldn't write diagnostic data"),
+                        n == (size_t) chunk.objsize() && fflush(_file) == 0);
+                _fileSize += n;
+            }
+
+            void openNewFile() {
+                closeFile();
+                const string base = _dir.string() + "/" + filePrefix + terseCurrentTime(false);
+                string path = base;
+                for (int i = 1; boost::filesystem::exists(path); i++) {
+                    path = base + "." + BSONObjBuilder::numStr(i);
+                }
+                _file = fopen(path.c_str(), "ab");
+                uassert(17390, errnoWithPrefix((string("couldn't open ") + path).c_str()), _file != NULL);
+                _fileSize = 0;
+                _currentFile = boost::filesystem::path(path);
+                removeOldFiles();
+            }
+
+            void closeFile() {
+                if (_file != NULL) {
+                    fclose(_file);
+                    _file = NULL;
+                }
+            }
+
+            // Deletes the oldest files until the directory fits in
+            // diagnosticDataCollectionDirectorySizeMB, never the one being written.
+            void removeOldFiles() {
+                vector<boost::filesystem::path> files;
+                boost::uintmax_t total = 0;
+                for (boost::filesystem::directory_iterator it(_dir), end; it != end; ++it) {
+                    const string name = it->path().leaf().string();
+                    if (!str::startsWith(name, filePrefix) || str::startsWith(name, interimFileName)) {
+                        continue;
+                    }
+                    files.push_back(it->path());
+                    total += boost::filesystem::file_size(it->path());
+                }
+                // the names sort by creation time
+                sort(files.begin(), files.end());
+                const boost::uintmax_t limit = (boost::uintmax_t) diagnosticDataCollectionDirectorySizeMB * 1024 * 1024;
+                for (vector<boost::filesystem::path>::iterator it = files.begin();
+                     total > limit && it != files.end() && *it != _currentFile; ++it) {
+                    total -= boost::filesystem::file_size(*it);
+                    boost::filesystem::remove(*it);
+                }
+            }
+
+            boost::filesystem::path _dir;
+            boost::filesystem::path _currentFile;
+            FILE *_file;
+            long long _fileSize;
+        };
+
+    } // namespace
+
+    void startDiagnosticDataCollection() {
+        DiagnosticDataCollector *collector = new DiagnosticDataCollector();
+        collector->go();
+    }
+
+} // namespace mongo
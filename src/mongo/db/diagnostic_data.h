@@ -0,0 +1,34 @@
+// diagnostic_data.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace mongo {
+
+    // Name of the directory under the dbpath that diagnostic data is written to.
+    extern const char *diagnosticDataDirectoryName;
+
+    /**
+     * Starts the thread that samples serverStatus (which includes the engine's "ft" section
+     * and lock stats) and top every diagnosticDataCollectionPeriodMillis, and writes the
+     * samples, delta-encoded in chunks (see DiagnosticChunkBuilder), to rotating files in
+     * diagnosticDataDirectoryName.  mongodiag decodes them.
+     */
+    void startDiagnosticDataCollection();
+
+} // namespace mongo
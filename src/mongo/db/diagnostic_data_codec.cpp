@@ -0,0 +1,267 @@
+// diagnostic_data_codec.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/diagnostic_data_codec.h"
+
+#include "mongo/bson/util/builder.h"
+
+namespace mongo {
+
+    namespace {
+
+        bool isMetric(BSONType t) {
+            return t == NumberInt || t == NumberLong || t == NumberDouble || t == Bool || t == Date;
+        }
+
+        long long metricValue(const BSONElement &e) {
+            switch (e.type()) {
+                case NumberInt: return e._numberInt();
+                case NumberLong: return e._numberLong();
+                case NumberDouble: {
+                    // the bit pattern, which round trips exactly
+                    const double d = e._numberDouble();
+                    long long bits;
+                    memcpy(&bits, &d, sizeof bits);
+                    return bits;
+                }
+                case Bool: return e.boolean() ? 1 : 0;
+                case Date: return (long long) e.date().millis;
+                default: verify(false); return 0;
+            }
+        }
+
+        /**
+         * Appends the metrics of obj to metrics, checking that obj has the same structure as
+         * ref and the same values for everything that isn't a metric, which are only stored in
+         * the reference.  Pass obj == ref to get the metrics of the reference itself.
+         */
+        bool extractMetrics(const BSONObj &ref, const BSONObj &obj, vector<long long> *metrics) {
+            BSONObjIterator r(ref);
+            BSONObjIterator o(obj);
+            while (r.more()) {
+                if (!o.more()) {
+                    return false;
+                }
+                BSONElement re = r.next();
+                BSONElement oe = o.next();
+                if (re.type() != oe.type() || strcmp(re.fieldName(), oe.fieldName()) != 0) {
+                    return false;
+                }
+                if (re.isABSONObj()) {
+                    if (!extractMetrics(re.Obj(), oe.Obj(), metrics)) {
+                        return false;
+                    }
+                }
+                else if (isMetric(re.type())) {
+                    metrics->push_back(metricValue(oe));
+                }
+                else if (!re.valuesEqual(oe)) {
+                    return false;
+                }
+            }
+            return !o.more();
+        }
+
+        // Rebuilds a sample from the reference and its metrics, starting at metrics[*pos].
+        void rebuild(const BSONObj &ref, const vector<long long> &metrics, size_t *pos, BSONObjBuilder &b) {
+            BSONForEach(e, ref) {
+                const char *name = e.fieldName();
+                switch (e.type()) {
+                    case Object: {
+                        BSONObjBuilder sub(b.subobjStart(name));
+                        rebuild(e.Obj(), metrics, pos, sub);
+                        sub.doneFast();
+                        break;
+                    }
+                    case Array: {
+                        BSONObjBuilder sub(b.subarrayStart(name));
+                        rebuild(e.Obj(), metrics, pos, sub);
+                        sub.doneFast();
+                        break;
+                    }
+                    case NumberInt: b.append(name, (int) metrics[(*pos)++]); break;
+                    case NumberLong: b.append(name, metrics[(*pos)++]); break;
+                    case NumberDouble: {
+                        const long long bits = metrics[(*pos)++];
+                        double d;
+                        memcpy(&d, &bits, sizeof d);
+                        b.append(name, d);
+                        break;
+                    }
+                    case Bool: b.appendBool(name, metrics[(*pos)++] != 0); break;
+                    case Date: b.appendDate(name, Date_t((unsigned long long) metrics[(*pos)++])); break;
+                    default: b.append(e); break;
+                }
+            }
+        }
+
+        void appendVarint(BufBuilder &b, unsigned long long v) {
+            while (v >= 0x80) {
+                b.appendUChar((unsigned char) (v | 0x80));
+                v >>= 7;
+            }
+            b.appendUChar((unsigned char) v);
+        }
+
+        unsigned long long readVarint(const unsigned char *&p, const unsigned char *end) {
+            unsigned long long v = 0;
+            for (int shift = 0; ; shift += 7) {
+                uassert(17385, "truncated diagnostic data chunk", p < end && shift < 64);
+                const unsigned char c = *p++;
+                v |= (unsigned long long) (c & 0x7f) << shift;
+                if (!(c & 0x80)) {
+                    return v;
+                }
+            }
+        }
+
+        unsigned long long zigzag(long long v) {
+            return ((unsigned long long) v << 1) ^ (unsigned long long) (v >> 63);
+        }
+
+        long long unzigzag(unsigned long long v) {
+            return (long long) (v >> 1) ^ -(long long) (v & 1);
+        }
+
+        // Deltas wrap around instead of overflowing, the bit patterns of doubles can be far apart.
+        long long delta(long long from, long long to) {
+            return (long long) ((unsigned long long) to - (unsigned long long) from);
+        }
+
+        long long applyDelta(long long from, long long d) {
+            return (long long) ((unsigned long long) from + (unsigned long long) d);
+        }
+
+        void appendZeros(BufBuilder &b, unsigned long long *zeros) {
+            if (*zeros > 0) {
+                appendVarint(b, 0);
+                appendVarint(b, *zeros - 1);
+                *zeros = 0;
+            }
+        }
+
+    } // namespace
+
+    DiagnosticChunkBuilder::DiagnosticChunkBuilder(int maxSamples) : _maxSamples(maxSamples) {}
+
+    bool DiagnosticChunkBuilder::add(const BSONObj &sample) {
+        if (empty()) {
+            _start = jsTime();
+            _reference = sample.getOwned();
+            extractMetrics(_reference, _reference, &_referenceMetrics);
+            return true;
+        }
+        if (numSamples() >= _maxSamples) {
+            return false;
+        }
+        vector<long long> metrics;
+        metrics.reserve(_referenceMetrics.size());
+        if (!extractMetrics(_reference, sample, &metrics)) {
+            return false;
+        }
+        _samples.push_back(vector<long long>());
+        _samples.back().swap(metrics);
+        return true;
+    }
+
+    BSONObj DiagnosticChunkBuilder::chunk() const {
+        verify(!empty());
+        const size_t nMetrics = _referenceMetrics.size();
+        BufBuilder data;
+        unsigned long long zeros = 0;
+        for (size_t m = 0; m < nMetrics; m++) {
+            long long prev = _referenceMetrics[m];
+            for (size_t s = 0; s < _samples.size(); s++) {
+                const long long d = delta(prev, _samples[s][m]);
+                prev = _samples[s][m];
+                if (d == 0) {
+                    zeros++;
+                    continue;
+                }
+                appendZeros(data, &zeros);
+                appendVarint(data, zigzag(d));
+            }
+        }
+        appendZeros(data, &zeros);
+
+        BSONObjBuilder b;
+        b.appendDate("start", _start);
+        b.append("reference", _reference);
+        b.append("nMetrics", (long long) nMetrics);
+        b.append("nSamples", (long long) _samples.size());
+        b.appendBinData("data", data.len(), BinDataGeneral, data.buf());
+        return b.obj();
+    }
+
+    void DiagnosticChunkBuilder::reset() {
+        _reference = BSONObj();
+        _referenceMetrics.clear();
+        _samples.clear();
+    }
+
+    void decodeDiagnosticChunk(const BSONObj &chunk, vector<BSONObj> *samples) {
+        const BSONObj reference = chunk["reference"].Obj();
+        const size_t nMetrics = chunk["nMetrics"].numberLong();
+        const size_t nSamples = chunk["nSamples"].numberLong();
+
+        vector<long long> referenceMetrics;
+        extractMetrics(reference, reference, &referenceMetrics);
+        uassert(17386, "diagnostic data chunk has the wrong number of metrics",
+                referenceMetrics.size() == nMetrics);
+        samples->push_back(reference);
+        if (nSamples == 0) {
+            return;
+        }
+
+        int len;
+        const unsigned char *p = (const unsigned char *) chunk["data"].binData(len);
+        const unsigned char *end = p + len;
+
+        // deltas are stored metric by metric
+        vector<vector<long long> > metrics(nSamples, vector<long long>(nMetrics));
+        unsigned long long zeros = 0;
+        for (size_t m = 0; m < nMetrics; m++) {
+            long long value = referenceMetrics[m];
+            for (size_t s = 0; s < nSamples; s++) {
+                if (zeros == 0) {
+                    const unsigned long long v = readVarint(p, end);
+                    if (v == 0) {
+                        zeros = readVarint(p, end) + 1;
+                    }
+                    else {
+                        value = applyDelta(value, unzigzag(v));
+                    }
+                }
+                if (zeros > 0) {
+                    zeros--;
+                }
+                metrics[s][m] = value;
+            }
+        }
+
+        for (size_t s = 0; s < nSamples; s++) {
+            BSONObjBuilder b;
+            size_t pos = 0;
+            rebuild(reference, metrics[s], &pos, b);
+            samples->push_back(b.obj());
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,70 @@
+// diagnostic_data_codec.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Packs a series of samples with the same structure (e.g. serverStatus once a second) into
+     * one BSON document, a chunk.
+     *
+     * The first sample is kept whole, as the reference.  The metrics of the others (every
+     * number, bool and date, in document order) are stored as deltas from the previous sample,
+     * metric by metric, as zigzag varints with runs of zeros collapsed, since most counters
+     * don't move from one second to the next.  Doubles are stored as their bit patterns, so
+     * they decode exactly.  Everything else (strings, etc.) must be the same as in the
+     * reference, and is taken from it when decoding.
+     */
+    class DiagnosticChunkBuilder : boost::noncopyable {
+    public:
+        explicit DiagnosticChunkBuilder(int maxSamples);
+
+        /**
+         * @return false, without adding it, if sample has a different structure (field names
+         *         and types) than the reference, a non-metric value that differs from the
+         *         reference's, or the chunk is full.  The caller should then write the chunk,
+         *         reset() and add it again.
+         */
+        bool add(const BSONObj &sample);
+
+        bool empty() const { return _reference.isEmpty(); }
+        int numSamples() const { return empty() ? 0 : 1 + _samples.size(); }
+
+        /** Encodes the samples added so far. */
+        BSONObj chunk() const;
+
+        void reset();
+
+    private:
+        const int _maxSamples;
+        Date_t _start;
+        BSONObj _reference;
+        std::vector<long long> _referenceMetrics;
+        // the metrics of each sample after the reference
+        std::vector<std::vector<long long> > _samples;
+    };
+
+    /** Appends the samples in a chunk made by DiagnosticChunkBuilder to samples, oldest first. */
+    void decodeDiagnosticChunk(const BSONObj &chunk, std::vector<BSONObj> *samples);
+
+} // namespace mongo
@@ -330,6 +330,11 @@ namespace mongo {
         _descriptor->generateKeys(obj, keys);
     }
 
+    bool IndexDetailsBase::getSingleKeyFromObject(const BSONObj &obj, const BSONObj &pk,
+                                                  StackBufBuilder &b, bool *generated) const {
+        return _descriptor->appendSingleKey(obj, pk, b, generated);
+    }
+
     IndexDetails::Suitability IndexDetails::suitability(const FieldRangeSet &queryConstraints,
                                                         const BSONObj &order) const {
         // This is a quick first pass to determine the suitability of the index.  It produces some
@@ -433,6 +438,18 @@ namespace mongo {
                    << key << ", pk " << (pk ? *pk : BSONObj()) << ", msg " << msg << endl;
     }
 
+    void IndexDetailsBase::updateBroadcast(const BSONObj &msg, uint64_t flags) {
+        DBT vdbt = storage::dbt_make(msg.objdata(), msg.objsize());
+
+        // Without NO_LOCKTREE the ydb write locks the whole key range for this transaction.
+        const int update_flags = (flags & Collection::NO_LOCKTREE) ? DB_PRELOCKED_WRITE : 0;
+        const int r = db()->update_broadcast(db(), cc().txn().db_txn(), &vdbt, update_flags);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+        TOKULOG(3) << "index " << info()["key"].Obj() << ": sent broadcast update, msg " << msg << endl;
+    }
+
     enum toku_compression_method IndexDetailsBase::getCompressionMethod() const {
         enum toku_compression_method ret;
         int r = db()->get_compression_method(db(), &ret);
@@ -282,8 +282,15 @@ namespace mongo {
            keys will be left empty if key not found in the object.
         */
         void getKeysFromObject(const BSONObj &obj, BSONObjSet &keys) const;
+        /* fast path of getKeysFromObject() for objects that generate a single key: appends
+           the dictionary key for it and pk to b. See Descriptor::appendSingleKey().
+        */
+        bool getSingleKeyFromObject(const BSONObj &obj, const BSONObj &pk,
+                                    StackBufBuilder &b, bool *generated) const;
         // Send an update message.
         void updatePair(const BSONObj &key, const BSONObj *pk, const BSONObj &msg, uint64_t flags);
+        // Send an update message to every row.
+        void updateBroadcast(const BSONObj &msg, uint64_t flags);
         
         struct UniqueCheckExtra : public ExceptionSaver {
             const storage::Key &newKey;
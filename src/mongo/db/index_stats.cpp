@@ -0,0 +1,523 @@
+// index_stats.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/index_stats.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/client.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/d_concurrency.h"
+#include "mongo/db/index.h"
+#include "mongo/db/keypattern.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/ops/delete.h"
+#include "mongo/db/ops/insert.h"
+#include "mongo/db/queryutil.h"
+#include "mongo/db/relock.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/key.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    const char *indexStatsCollectionName = "system.indexStats";
+
+    Counter64 indexStatsAnalyzed;
+    ServerStatusMetricField<Counter64> indexStatsAnalyzedDisplay("indexStats.analyzed", &indexStatsAnalyzed);
+
+    MONGO_EXPORT_SERVER_PARAMETER(indexStatsMonitorEnabled, bool, true);
+    // Statistics are recomputed once the index's number of keys has changed by this fraction.
+    MONGO_EXPORT_SERVER_PARAMETER(indexStatsRefreshThreshold, double, 0.2);
+
+    namespace {
+
+        const int defaultBuckets = 100;
+        const int maxBuckets = 1000;
+        // Keys read at each bound to estimate how often the first field changes value.
+        const int distinctSampleRun = 32;
+
+        // The key sorting before (first) or after (!first) every key of an index on keyPattern.
+        BSONObj extremeKey(const BSONObj &keyPattern, bool first) {
+            BSONObjBuilder b;
+            for (BSONObjIterator it(keyPattern); it.more(); ) {
+                const bool ascending = it.next().number() >= 0;
+                if (ascending == first) {
+                    b.appendMinKey("");
+                }
+                else {
+                    b.appendMaxKey("");
+                }
+            }
+            return b.obj();
+        }
+
+        // Collects the keys get_key_after_bytes lands on, in the unnamed-field key format.
+        class BoundCallback {
+            vector<BSONObj> &_bounds;
+            BSONObj _lastPK;
+          public:
+            bool pastEnd;
+            BoundCallback(vector<BSONObj> &bounds) : _bounds(bounds), pastEnd(false) {}
+            void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+                if (endKey == NULL) {
+                    pastEnd = true;
+                    return;
+                }
+                const BSONObj key = endKey->toBson();
+                const BSONObj pk = endPK != NULL ? endPK->getOwned() : BSONObj();
+                // Small steps on a small index can land on the same entry twice.  The same
+                // key with another pk is kept though, that's how frequent values show up.
+                if (!_bounds.empty() && key.binaryEqual(_bounds.back()) && pk.binaryEqual(_lastPK)) {
+                    return;
+                }
+                _bounds.push_back(key);
+                _lastPK = pk;
+            }
+        };
+
+        SimpleMutex histogramsMutex("indexHistograms");
+        // Keyed by index namespace.  An empty pointer means the index has no statistics.
+        map<string, shared_ptr<const IndexHistogram> > histograms;
+
+        void setHistogram(const string &idxNs, const shared_ptr<const IndexHistogram> &h) {
+            SimpleMutex::scoped_lock lk(histogramsMutex);
+            histograms[idxNs] = h;
+        }
+
+        // @return key with its first field replaced by e
+        BSONObj withFirstField(const BSONObj &key, const BSONElement &e) {
+            BSONObjBuilder b;
+            b.appendAs(e, "");
+            BSONObjIterator it(key);
+            it.next();
+            while (it.more()) {
+                b.append(it.next());
+            }
+            return b.obj();
+        }
+
+    } // namespace
+
+    IndexHistogram::IndexHistogram(const BSONObj &stats) :
+        _stats(stats.getOwned()),
+        _keyPattern(_stats["key"].Obj()),
+        _ordering(Ordering::make(_keyPattern)),
+        _numKeys(std::max(_stats["numKeys"].numberLong(), 1LL)),
+        _distinct(std::max(_stats["distinct"].numberDouble(), 1.0)) {
+        for (BSONObjIterator it(_stats["bounds"].Obj()); it.more(); ) {
+            _bounds.push_back(it.next().Obj());
+        }
+    }
+
+    double IndexHistogram::fractionBefore(const BSONObj &key) const {
+        // j = the number of bounds sorting before key, so key is in bucket j-1
+        size_t lo = 0, hi = _bounds.size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (_bounds[mid].woCompare(key, _ordering, false) < 0) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        if (lo == 0) {
+            return 0;
+        }
+        if (lo == _bounds.size()) {
+            return 1;
+        }
+        return (lo - 0.5) / (_bounds.size() - 1);
+    }
+
+    double IndexHistogram::fractionEqual(const BSONElement &e) const {
+        // Buckets that start and end with e hold nothing but e.
+        int full = 0;
+        for (size_t i = 0; i + 1 < _bounds.size(); i++) {
+            if (_bounds[i].firstElement().woCompare(e, false) == 0 &&
+                _bounds[i + 1].firstElement().woCompare(e, false) == 0) {
+                full++;
+            }
+        }
+        return std::max((double) full / (_bounds.size() - 1), 1 / _distinct);
+    }
+
+    double IndexHistogram::fractionBetween(const BSONObj &a, const BSONObj &b) const {
+        // The ends are only known to within a bucket.
+        return fabs(fractionBefore(b) - fractionBefore(a)) + 1.0 / (_bounds.size() - 1);
+    }
+
+    double IndexHistogram::estimateKeysScanned(const FieldRangeVector &frv, bool *upperBound) const {
+        if (upperBound != NULL) {
+            *upperBound = false;
+        }
+        if (_bounds.size() < 2) {
+            return _numKeys;
+        }
+        double fraction;
+        const FieldRange &first = frv.ranges()[0];
+        if (first.isPointIntervalSet()) {
+            // With more fields constrained, each value's keys are narrowed down by the rest of
+            // the start and end keys, e.g. { a:1, b:5 } on { a:1, b:1 } is the span from
+            // { '':1, '':5 } to { '':1, '':5 }, not every key with a == 1.
+            bool compound = false;
+            for (size_t i = 1; i < frv.ranges().size(); i++) {
+                compound = compound || !frv.ranges()[i].universal();
+            }
+            const BSONObj startKey = compound ? frv.startKey() : BSONObj();
+            const BSONObj endKey = compound ? frv.endKey() : BSONObj();
+            fraction = 0;
+            const vector<FieldInterval> &intervals = first.intervals();
+            for (vector<FieldInterval>::const_iterator it = intervals.begin(); it != intervals.end(); ++it) {
+                double f = fractionEqual(it->_lower._bound);
+                if (compound) {
+                    f = std::min(f, fractionBetween(withFirstField(startKey, it->_lower._bound),
+                                                    withFirstField(endKey, it->_lower._bound)));
+                }
+                fraction += f;
+            }
+            // The narrowed down span is still a bucket wide, which may be far more than the
+            // keys actually scanned.
+            if (compound && upperBound != NULL) {
+                *upperBound = true;
+            }
+        }
+        else {
+            fraction = fractionBetween(frv.startKey(), frv.endKey());
+        }
+        return std::min(fraction, 1.0) * _numKeys;
+    }
+
+    BSONObj analyzeIndex(Collection *cl, const IndexDetails &idx, int numBuckets) {
+        // getKeyAfterBytes is templated, so it's not on IndexDetails (see d_split.cpp)
+        const IndexDetailsBase *idxBase = dynamic_cast<const IndexDetailsBase *>(&idx);
+        uassert(17391, "cannot analyze the indexes of a partitioned collection", idxBase != NULL);
+        uassert(17392, str::stream() << "cannot analyze special index " << idx.indexName(),
+                !idx.special());
+
+        Timer t;
+        const BSONObj keyPattern = idx.keyPattern();
+        DB_BTREE_STAT64 st;
+        idx.getStat64(&st);
+        // no more buckets than keys
+        const int n = (int) std::max(std::min((long long) numBuckets, (long long) st.bt_nkeys), 1LL);
+
+        vector<BSONObj> bounds;
+        {
+            shared_ptr<Cursor> c(Cursor::make(cl, idx, 1));
+            if (c->ok()) {
+                bounds.push_back(c->currKey().getOwned());
+            }
+        }
+        if (!bounds.empty()) {
+            // Each probe is one root-to-leaf descent, we never scan the index.
+            const uint64_t step = std::max(st.bt_dsize / n, (uint64_t) 1);
+            const BSONObj start = extremeKey(keyPattern, true);
+            const storage::Key startKey(start, cl->isPKIndex(idx) ? NULL : &minKey);
+            BoundCallback cb(bounds);
+            for (int i = 1; i < n && !cb.pastEnd; i++) {
+                idxBase->getKeyAfterBytes(startKey, i * step, cb);
+            }
+            shared_ptr<Cursor> c(Cursor::make(cl, idx, -1));
+            if (c->ok() && !c->currKey().binaryEqual(bounds.back())) {
+                bounds.push_back(c->currKey().getOwned());
+            }
+        }
+
+        // Estimate how often the first field changes from one key to the next, from short runs
+        // of keys at each bound.  Frequent values are caught by the bounds themselves.
+        long long sampled = 0;
+        long long changes = 0;
+        long long boundValues = bounds.empty() ? 0 : 1;
+        const BSONObj last = extremeKey(keyPattern, false);
+        for (size_t i = 0; i < bounds.size(); i++) {
+            if (i > 0 && bounds[i].firstElement().woCompare(bounds[i - 1].firstElement(), false) != 0) {
+                boundValues++;
+            }
+            shared_ptr<Cursor> c(Cursor::make(cl, idx, bounds[i], last, true, 1, distinctSampleRun));
+            BSONObj prev;
+            for (int k = 0; k < distinctSampleRun && c->ok(); k++, c->advance()) {
+                const BSONObj key = c->currKey();
+                if (k > 0) {
+                    sampled++;
+                    if (key.firstElement().woCompare(prev.firstElement(), false) != 0) {
+                        changes++;
+                    }
+                }
+                prev = key.getOwned();
+            }
+        }
+        const long long numKeys = st.bt_nkeys;
+        double distinct = sampled > 0 ? (double) changes / sampled * numKeys : numKeys;
+        distinct = std::max(distinct, (double) boundValues);
+
+        KeyPattern kp(keyPattern);
+        BSONObjBuilder b;
+        b.append("_id", idx.indexNamespace());
+        b.append("ns", cl->ns());
+        b.append("index", idx.indexName());
+        b.append("key", keyPattern);
+        b.append("buckets", numBuckets);
+        b.appendNumber("numKeys", numKeys);
+        b.appendNumber("dataBytes", (long long) st.bt_dsize);
+        b.append("distinct", distinct);
+        BSONArrayBuilder boundsBuilder(b.subarrayStart("bounds"));
+        for (vector<BSONObj>::const_iterator it = bounds.begin(); it != bounds.end(); ++it) {
+            boundsBuilder.append(kp.prettyKey(*it));
+        }
+        boundsBuilder.done();
+        b.appendDate("analyzed", jsTime());
+        b.append("millis", t.millis());
+        indexStatsAnalyzed.increment();
+        return b.obj();
+    }
+
+    static void lockedSaveIndexStats(const string &statsNs, const BSONObj &stats) {
+        Client::Context ctx(statsNs);
+        Client::Transaction txn(DB_SERIALIZABLE);
+        Collection *cl = getOrCreateCollection(statsNs, false);
+        const BSONObj pk = BSON("" << stats["_id"]);
+        BSONObj old;
+        if (cl->findByPK(pk, old)) {
+            deleteOneObject(cl, pk, old);
+        }
+        BSONObj obj = stats;
+        insertOneObject(cl, obj);
+        txn.commit();
+    }
+
+    void saveIndexStats(const string &db, const BSONObj &stats) {
+        const string statsNs = getSisterNS(db, indexStatsCollectionName);
+        LOCK_REASON(lockReason, "analyze: saving index statistics");
+        try {
+            Lock::DBRead lk(db, lockReason);
+            lockedSaveIndexStats(statsNs, stats);
+        } catch (RetryWithWriteLock &e) {
+            Lock::DBWrite lk(db, lockReason);
+            lockedSaveIndexStats(statsNs, stats);
+        }
+        setHistogram(stats["_id"].String(), shared_ptr<const IndexHistogram>(new IndexHistogram(stats)));
+    }
+
+    void dropIndexStats(const StringData &ns, const string &idxNs) {
+        {
+            SimpleMutex::scoped_lock lk(histogramsMutex);
+            histograms.erase(idxNs);
+        }
+        const string statsNs = getSisterNS(ns, indexStatsCollectionName);
+        if (ns == statsNs) {
+            return;
+        }
+        Collection *statsCl = getCollection(statsNs);
+        const BSONObj pk = BSON("" << idxNs);
+        BSONObj stats;
+        if (statsCl != NULL && statsCl->findByPK(pk, stats)) {
+            deleteOneObject(statsCl, pk, stats);
+        }
+    }
+
+    shared_ptr<const IndexHistogram> getIndexHistogram(Collection *cl, const IndexDetails &idx) {
+        const string idxNs = idx.indexNamespace();
+        shared_ptr<const IndexHistogram> h;
+        {
+            SimpleMutex::scoped_lock lk(histogramsMutex);
+            map<string, shared_ptr<const IndexHistogram> >::const_iterator it = histograms.find(idxNs);
+            if (it != histograms.end()) {
+                h = it->second;
+                // the index may have been dropped and made again on other fields
+                if (h && h->keyPattern().woCompare(idx.keyPattern()) != 0) {
+                    h.reset();
+                }
+                return h;
+            }
+        }
+        try {
+            Collection *statsCl = getCollection(getSisterNS(cl->ns(), indexStatsCollectionName));
+            BSONObj stats;
+            if (statsCl != NULL && statsCl->findByPK(BSON("" << idxNs), stats)) {
+                h.reset(new IndexHistogram(stats));
+            }
+        }
+        catch (DBException &e) {
+            // planning goes on without statistics
+            LOG(1) << "couldn't load statistics for index " << idxNs << ": " << e.what() << endl;
+            return h;
+        }
+        setHistogram(idxNs, h);
+        return h;
+    }
+
+    class IndexStatsMonitor : public BackgroundJob {
+    public:
+        IndexStatsMonitor() {}
+        virtual ~IndexStatsMonitor() {}
+
+        virtual string name() const { return "IndexStatsMonitor"; }
+
+    private:
+        virtual void run() {
+            Client::initThread(name().c_str());
+
+            while (!inShutdown()) {
+                sleepsecs(60);
+                if (!indexStatsMonitorEnabled) {
+                    continue;
+                }
+
+                vector<shared_ptr<const IndexHistogram> > analyzed;
+                {
+                    SimpleMutex::scoped_lock lk(histogramsMutex);
+                    for (map<string, shared_ptr<const IndexHistogram> >::const_iterator it = histograms.begin();
+                         it != histograms.end(); ++it) {
+                        if (it->second) {
+                            analyzed.push_back(it->second);
+                        }
+                    }
+                }
+                for (vector<shared_ptr<const IndexHistogram> >::const_iterator it = analyzed.begin();
+                     it != analyzed.end() && !inShutdown(); ++it) {
+                    try {
+                        refreshIfStale(**it);
+                    }
+                    catch (DBException &e) {
+                        warning() << "error refreshing statistics for index "
+                                  << (*it)->stats()["_id"].String() << ": " << e.what() << endl;
+                    }
+                }
+            }
+        }
+
+        void refreshIfStale(const IndexHistogram &h) {
+            const string idxNs = h.stats()["_id"].String();
+            const string ns = h.stats()["ns"].String();
+            BSONObj stats;
+            {
+                LOCK_REASON(lockReason, "index stats: refreshing statistics");
+                Client::ReadContext ctx(ns, lockReason);
+                Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+                Collection *cl = getCollection(ns);
+                const int i = cl == NULL ? -1 : cl->findIndexByKeyPattern(h.keyPattern());
+                if (i < 0 || cl->idx(i).indexName() != h.stats()["index"].String()) {
+                    // gone, stop checking it
+                    SimpleMutex::scoped_lock lk(histogramsMutex);
+                    histograms.erase(idxNs);
+                    return;
+                }
+                const IndexDetails &idx = cl->idx(i);
+                DB_BTREE_STAT64 st;
+                idx.getStat64(&st);
+                const double drift = fabs((double) st.bt_nkeys - h.numKeys());
+                if (drift <= indexStatsRefreshThreshold * h.numKeys()) {
+                    return;
+                }
+                LOG(1) << "index " << idxNs << " went from " << h.numKeys() << " to "
+                       << st.bt_nkeys << " keys, refreshing its statistics" << endl;
+                stats = analyzeIndex(cl, idx, h.numBuckets());
+                txn.commit();
+            }
+            saveIndexStats(nsToDatabase(ns), stats);
+        }
+    };
+
+    void startIndexStatsMonitor() {
+        IndexStatsMonitor *monitor = new IndexStatsMonitor();
+        monitor->go();
+    }
+
+    class CmdAnalyze : public Command {
+    public:
+        CmdAnalyze() : Command("analyze") {}
+        virtual void help(stringstream &help) const {
+            help << "compute statistics about the keys of a collection's indexes, which the query\n"
+                    "optimizer uses to rule out plans that would scan many more keys than others\n"
+                    "{ analyze : <collection>, index : <optional index name>, buckets : <histogram buckets, default "
+                 << defaultBuckets << "> }\n"
+                    "the statistics are saved in " << indexStatsCollectionName << ", and kept up to date\n"
+                    "as the indexes grow or shrink";
+        }
+        virtual bool slaveOk() const { return true; }
+        virtual bool requiresShardedOperationScope() const { return false; }
+        virtual LockType locktype() const { return NONE; }
+        virtual bool requiresSync() const { return false; }
+        virtual bool needsTxn() const { return false; }
+        virtual int txnFlags() const { return noTxnFlags(); }
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual OpSettings getOpSettings() const { return OpSettings(); }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::indexStats);
+            out->push_back(Privilege(parseNs(dbname, cmdObj), actions));
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            const string ns = parseNs(dbname, cmdObj);
+            const string indexName = cmdObj["index"].str();
+            const int buckets = cmdObj["buckets"].isNumber() ? cmdObj["buckets"].numberInt() : defaultBuckets;
+            if (buckets < 1 || buckets > maxBuckets) {
+                errmsg = str::stream() << "buckets must be between 1 and " << maxBuckets;
+                return false;
+            }
+
+            vector<BSONObj> stats;
+            {
+                LOCK_REASON(lockReason, "analyze: computing index statistics");
+                Client::ReadContext ctx(ns, lockReason);
+                Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+                Collection *cl = getCollection(ns);
+                if (cl == NULL) {
+                    errmsg = "ns not found";
+                    return false;
+                }
+                for (int i = 0; i < cl->nIndexes(); i++) {
+                    const IndexDetails &idx = cl->idx(i);
+                    if (indexName.empty() ? idx.special() : idx.indexName() != indexName) {
+                        continue;
+                    }
+                    stats.push_back(analyzeIndex(cl, idx, buckets));
+                }
+                txn.commit();
+            }
+            if (stats.empty()) {
+                errmsg = indexName.empty() ? "no indexes to analyze" : "index not found";
+                return false;
+            }
+
+            BSONArrayBuilder indexes(result.subarrayStart("indexes"));
+            for (vector<BSONObj>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+                saveIndexStats(dbname, *it);
+                indexes.append(BSON("index" << (*it)["index"] <<
+                                    "numKeys" << (*it)["numKeys"] <<
+                                    "distinct" << (*it)["distinct"] <<
+                                    "buckets" << std::max((*it)["bounds"].Obj().nFields() - 1, 0) <<
+                                    "millis" << (*it)["millis"]));
+            }
+            indexes.done();
+            return true;
+        }
+    } cmdAnalyze;
+
+} // namespace mongo
@@ -0,0 +1,120 @@
+// index_stats.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class Collection;
+    class FieldRangeVector;
+    class IndexDetails;
+
+    // Collection (in each database) the analyze command saves index statistics to, one
+    // document per index, with _id the index namespace (e.g. "test.foo.$a_1").
+    extern const char *indexStatsCollectionName;
+
+    /**
+     * Statistics about the keys of one index, as computed by analyzeIndex():
+     *
+     *   - numKeys and dataBytes, from the fractal tree's stat64
+     *   - bounds: an equi-depth histogram, as the keys splitting the index into buckets that
+     *     each hold about the same number of bytes (so about the same number of keys), found
+     *     with get_key_after_bytes without scanning the index.  bounds[0] is the first key and
+     *     bounds[n] the last, so there are n buckets.
+     *   - distinct: an estimate of the number of distinct values of the index's first field,
+     *     from short runs of keys read at each bound.
+     *
+     * The query optimizer uses them to estimate how many keys a candidate plan scans.
+     */
+    class IndexHistogram : boost::noncopyable {
+    public:
+        // @param stats a document as saved in indexStatsCollectionName
+        explicit IndexHistogram(const BSONObj &stats);
+
+        const BSONObj &stats() const { return _stats; }
+        const BSONObj &keyPattern() const { return _keyPattern; }
+        long long numKeys() const { return _numKeys; }
+        // The number of buckets analyze was asked for.
+        int numBuckets() const { return _stats["buckets"].numberInt(); }
+
+        /**
+         * @return the estimated number of keys a scan over frv (built for this index) reads.
+         * For point intervals on the first field (equality and $in) that's the keys having
+         * those values, narrowed down by the other fields' bounds if any, otherwise the keys
+         * between frv's start and end keys.
+         *
+         * @param upperBound if not NULL, set to true when the estimate may be much more than
+         * what is scanned (the scan is narrower than a bucket), so shouldn't rule the plan out.
+         */
+        double estimateKeysScanned(const FieldRangeVector &frv, bool *upperBound = NULL) const;
+
+    private:
+        // Estimated fraction of the keys that sort before key, in index order.
+        double fractionBefore(const BSONObj &key) const;
+        // Estimated fraction of the keys whose first field is e.
+        double fractionEqual(const BSONElement &e) const;
+        // Estimated fraction of the keys between a and b, in either order.
+        double fractionBetween(const BSONObj &a, const BSONObj &b) const;
+
+        const BSONObj _stats;
+        const BSONObj _keyPattern;
+        const Ordering _ordering;
+        const long long _numKeys;
+        const double _distinct;
+        vector<BSONObj> _bounds;
+    };
+
+    /**
+     * Computes statistics (see IndexHistogram) for index idx of cl, with about numBuckets
+     * buckets.  Must be called in a transaction, with at least a read lock on the database.
+     *
+     * @return the document to save with saveIndexStats()
+     */
+    BSONObj analyzeIndex(Collection *cl, const IndexDetails &idx, int numBuckets);
+
+    /**
+     * Saves stats (from analyzeIndex()) to the database's indexStatsCollectionName, replacing
+     * what was there for the index, and makes the optimizer use them.  Takes its own lock and
+     * transaction.  The statistics aren't replicated, each member computes its own.
+     */
+    void saveIndexStats(const string &db, const BSONObj &stats);
+
+    /**
+     * @return the saved statistics of index idx of cl, or an empty pointer if it hasn't been
+     * analyzed.  They are loaded from the database once and then kept in memory.
+     */
+    shared_ptr<const IndexHistogram> getIndexHistogram(Collection *cl, const IndexDetails &idx);
+
+    /**
+     * Forgets the statistics of index idxNs of collection ns, in memory and in the database, so
+     * an index made again with the same key pattern doesn't get them.  Called when the index is
+     * dropped, in the dropping transaction and under its write lock.
+     */
+    void dropIndexStats(const StringData &ns, const string &idxNs);
+
+    /**
+     * Starts the thread that re-analyzes indexes whose number of keys has drifted by more than
+     * indexStatsRefreshThreshold since their statistics were computed.
+     */
+    void startIndexStatsMonitor();
+
+} // namespace mongo
@@ -36,6 +36,7 @@
 
 #include "mongo/bson/util/atomic_int.h"
 
+#include "mongo/db/admission_control.h"
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/databaseholder.h"
@@ -50,6 +51,7 @@
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/replutil.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/commands.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/index.h"
@@ -84,7 +86,7 @@ namespace mongo {
     void receivedUpdate(Message& m, CurOp& op);
     void receivedDelete(Message& m, CurOp& op);
     void receivedInsert(Message& m, CurOp& op);
-    bool receivedGetMore(DbResponse& dbresponse, Message& m, CurOp& curop );
+    bool receivedGetMore(DbResponse& dbresponse, Message& m, CurOp& curop, AdmissionTicket& ticket );
 
     int nloggedsome = 0;
 #define LOGWITHRATELIMIT if( ++nloggedsome < 1000 || nloggedsome % 100 == 0 )
@@ -306,15 +308,34 @@ namespace mongo {
         ::abort();
     }
 
-    // Profile the current op in an alternate transaction
-    void lockedDoProfile(const Client& c, int op, CurOp& currentOp) {
-        if ( dbHolder().__isLoaded( nsToDatabase( currentOp.getNS() ) , dbpath ) ) {
-            Client::Context ctx(currentOp.getNS(), dbpath);
-            Client::AlternateTransactionStack altStack;
-            Client::Transaction txn(DB_SERIALIZABLE);
-            profile(c, op, currentOp);
-            txn.commit();
+    // The command object of a query on $cmd, empty if the message can't be parsed.
+    static BSONObj commandObject( Message &m ) {
+        BSONObj cmd;
+        try {
+            DbMessage d(m);
+            QueryMessage q(d);
+            cmd = q.query;
+        }
+        catch ( const DBException& ) {
+            // receivedQuery() reports it
+            return BSONObj();
+        }
+        BSONElement wrapped = cmd.firstElement();
+        if ( wrapped.isABSONObj() &&
+             ( str::equals( wrapped.fieldName(), "query" ) || str::equals( wrapped.fieldName(), "$query" ) ) ) {
+            cmd = wrapped.Obj();
         }
+        return cmd;
+    }
+
+    // Whether m reads a system.profile collection, directly or with a command such as count.
+    static bool readsProfileCollection( Message &m, const BSONObj &cmd ) {
+        const char *ns = m.singleData()->_data + 4;
+        if ( str::endsWith( ns, ".system.profile" ) ) {
+            return true;
+        }
+        BSONElement target = cmd.firstElement();
+        return target.type() == String && str::equals( target.valuestr(), "system.profile" );
     }
 
     // Returns false when request includes 'end'
@@ -368,7 +389,8 @@ namespace mongo {
         
         auto_ptr<CurOp> nestedOp;
         CurOp* currentOpP = c.curop();
-        if ( currentOpP->active() ) {
+        const bool nested = currentOpP->active();
+        if ( nested ) {
             nestedOp.reset( new CurOp( &c , currentOpP ) );
             currentOpP = nestedOp.get();
         }
@@ -382,79 +404,94 @@ namespace mongo {
         long long logThreshold = cmdLine.slowMS;
         bool shouldLog = logLevel >= 1;
 
-        if ( op == dbQuery ) {
-            try {
-                checkPossiblyShardedMessageWithoutLock(m);
-                receivedQuery(c, dbresponse, m);
-            } catch (MustHandleShardedMessage &e) {
-                e.handleShardedMessage(m, &dbresponse);
-                return;
-            }
-        }
-        else if ( op == dbGetMore ) {
-            if ( ! receivedGetMore(dbresponse, m, currentOp) )
-                shouldLog = true;
+        const BSONObj cmd = isCommand ? commandObject( m ) : BSONObj();
+        if ( op == dbQuery && !nested && readsProfileCollection( m, cmd ) ) {
+            // Profile entries are written in the background, make sure this sees the ones
+            // queued so far.
+            flushProfileEntries();
         }
-        else if ( op == dbMsg ) {
-            // deprecated - replaced by commands
-            char *p = m.singleData()->_data;
-            int len = strlen(p);
-            if ( len > 400 )
-                out() << curTimeMillis64() % 10000 <<
-                      " long msg received, len:" << len << endl;
 
-            Message *resp = new Message();
-            if ( strcmp( "end" , p ) == 0 )
-                resp->setData( opReply , "dbMsg end no longer supported" );
-            else
-                resp->setData( opReply , "i am fine - dbMsg deprecated");
+        {
+            // Wait for room in the storage engine before taking any locks, and hold the
+            // ticket only for the operation itself, not for the logging and profiling below.
+            AdmissionTicket ticket(op, isCommand,
+                                   cmd.isEmpty() ? NULL : Command::findCommand( cmd.firstElementFieldName() ),
+                                   nested);
 
-            dbresponse.response = resp;
-            dbresponse.responseTo = m.header()->id;
-        }
-        else {
-            try {
-                // The following operations all require authorization.
-                // dbInsert, dbUpdate and dbDelete can be easily pre-authorized,
-                // here, but dbKillCursors cannot.
-                if ( op == dbKillCursors ) {
-                    currentOp.ensureStarted();
-                    logThreshold = 10;
-                    receivedKillCursors(m);
-                }
-                else if ( !NamespaceString::isValid(ns) ) {
-                    // Only killCursors doesn't care about namespaces
-                    uassert( 16257, str::stream() << "Invalid ns [" << ns << "]", false );
-                }
-                else if ( op == dbInsert ) {
-                    receivedInsert(m, currentOp);
-                }
-                else if ( op == dbUpdate ) {
-                    receivedUpdate(m, currentOp);
-                }
-                else if ( op == dbDelete ) {
-                    receivedDelete(m, currentOp);
+            if ( op == dbQuery ) {
+                try {
+                    checkPossiblyShardedMessageWithoutLock(m);
+                    receivedQuery(c, dbresponse, m);
+                } catch (MustHandleShardedMessage &e) {
+                    e.handleShardedMessage(m, &dbresponse);
+                    return;
                 }
-                else {
-                    mongo::log() << "    operation isn't supported: " << op << endl;
-                    currentOp.done();
+            }
+            else if ( op == dbGetMore ) {
+                if ( ! receivedGetMore(dbresponse, m, currentOp, ticket) )
                     shouldLog = true;
-                }
             }
-            catch ( UserException& ue ) {
-                tlog(3) << " Caught Assertion in " << opToString(op) << ", continuing "
-                        << ue.toString() << endl;
-                debug.exceptionInfo = ue.getInfo();
-                if (ue.getCode() == storage::ASSERT_IDS::LockDeadlock) {
+            else if ( op == dbMsg ) {
+                // deprecated - replaced by commands
+                char *p = m.singleData()->_data;
+                int len = strlen(p);
+                if ( len > 400 )
+                    out() << curTimeMillis64() % 10000 <<
+                          " long msg received, len:" << len << endl;
+
+                Message *resp = new Message();
+                if ( strcmp( "end" , p ) == 0 )
+                    resp->setData( opReply , "dbMsg end no longer supported" );
+                else
+                    resp->setData( opReply , "i am fine - dbMsg deprecated");
+
+                dbresponse.response = resp;
+                dbresponse.responseTo = m.header()->id;
+            }
+            else {
+                try {
+                    // The following operations all require authorization.
+                    // dbInsert, dbUpdate and dbDelete can be easily pre-authorized,
+                    // here, but dbKillCursors cannot.
+                    if ( op == dbKillCursors ) {
+                        currentOp.ensureStarted();
+                        logThreshold = 10;
+                        receivedKillCursors(m);
+                    }
+                    else if ( !NamespaceString::isValid(ns) ) {
+                        // Only killCursors doesn't care about namespaces
+                        uassert( 16257, str::stream() << "Invalid ns [" << ns << "]", false );
+                    }
+                    else if ( op == dbInsert ) {
+                        receivedInsert(m, currentOp);
+                    }
+                    else if ( op == dbUpdate ) {
+                        receivedUpdate(m, currentOp);
+                    }
+                    else if ( op == dbDelete ) {
+                        receivedDelete(m, currentOp);
+                    }
+                    else {
+                        mongo::log() << "    operation isn't supported: " << op << endl;
+                        currentOp.done();
+                        shouldLog = true;
+                    }
+                }
+                catch ( UserException& ue ) {
+                    tlog(3) << " Caught Assertion in " << opToString(op) << ", continuing "
+                            << ue.toString() << endl;
+                    debug.exceptionInfo = ue.getInfo();
+                    if (ue.getCode() == storage::ASSERT_IDS::LockDeadlock) {
+                        shouldLog = true;
+                    }
+                }
+                catch ( AssertionException& e ) {
+                    tlog(3) << " Caught Assertion in " << opToString(op) << ", continuing "
+                            << e.toString() << endl;
+                    debug.exceptionInfo = e.getInfo();
                     shouldLog = true;
                 }
             }
-            catch ( AssertionException& e ) {
-                tlog(3) << " Caught Assertion in " << opToString(op) << ", continuing "
-                        << e.toString() << endl;
-                debug.exceptionInfo = e.getInfo();
-                shouldLog = true;
-            }
         }
         currentOp.ensureStarted();
         currentOp.done();
@@ -468,19 +505,7 @@ namespace mongo {
 
         if ( currentOp.shouldDBProfile( debug.executionTime ) ) {
             // performance profiling is on
-            if ( Lock::isReadLocked() ) {
-                LOG(1) << "note: not profiling because recursive read lock" << endl;
-            }
-            else {
-                LOCK_REASON(lockReason, "writing to system.profile collection");
-                try {
-                    Lock::DBRead lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                } catch (RetryWithWriteLock &e) {
-                    Lock::DBWrite lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                }
-            }
+            profile( c, op, currentOp );
         }
 
         debug.recordStats();
@@ -636,7 +661,7 @@ namespace mongo {
         }
     }
 
-    bool receivedGetMore(DbResponse& dbresponse, Message& m, CurOp& curop ) {
+    bool receivedGetMore(DbResponse& dbresponse, Message& m, CurOp& curop, AdmissionTicket& ticket ) {
         bool ok = true;
 
         DbMessage d(m);
@@ -690,6 +715,7 @@ namespace mongo {
                         last = theReplSet->gtidManager->getMinLiveGTID();
                     }
                     else {
+                        AdmissionTicket::Released released(ticket);
                         theReplSet->gtidManager->waitForDifferentMinLive(
                             last, 
                             2000 // ms, this will be called twice
@@ -740,6 +766,8 @@ namespace mongo {
                             pass = 10000;
                         }
                     }
+                    // nothing to read, let another operation in meanwhile
+                    AdmissionTicket::Released released(ticket);
                     if (debug) {
                         sleepmillis(20);
                     }
@@ -19,9 +19,11 @@
 
 #include "mongo/pch.h"
 
+#include "mongo/base/counter.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/principal_set.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/database.h"
 #include "mongo/db/databaseholder.h"
@@ -29,6 +31,11 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/relock.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/goodies.h"
 
 namespace mongo {
@@ -59,12 +66,181 @@ namespace {
         builder.append("user", bestUser.getUser().empty() ? "" : bestUser.getFullName());
 
     }
-} // namespace
 
-    static void _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder) {
-        Database *db = c.database();
-        DEV verify( db );
+    Counter64 profileEntriesWritten;
+    Counter64 profileEntriesDropped;
+    Counter64 profileEntriesSkipped;
+    Counter64 profileBatches;
+
+    ServerStatusMetricField<Counter64> profileEntriesWrittenDisplay("profiler.written", &profileEntriesWritten);
+    ServerStatusMetricField<Counter64> profileEntriesDroppedDisplay("profiler.dropped", &profileEntriesDropped);
+    ServerStatusMetricField<Counter64> profileEntriesSkippedDisplay("profiler.skipped", &profileEntriesSkipped);
+    ServerStatusMetricField<Counter64> profileBatchesDisplay("profiler.batches", &profileBatches);
+
+    // How many entries may wait for the profile writer. Beyond that, new ones are dropped
+    // rather than making the operations being profiled wait.
+    MONGO_EXPORT_SERVER_PARAMETER(profileQueueSize, int, 10000);
+
+    const int profileWriterPeriodMillis = 100;
+
+    double profileSampleRate = 1.0;
+
+    class ProfileSampleRateParameter : public ExportedServerParameter<double> {
+      public:
+        ProfileSampleRateParameter()
+                : ExportedServerParameter<double>(ServerParameterSet::getGlobal(), "profileSampleRate",
+                                                  &profileSampleRate, true, true) {}
+      protected:
+        virtual Status validate(const double& potentialNewValue) {
+            if (potentialNewValue < 0 || potentialNewValue > 1) {
+                return Status(ErrorCodes::BadValue, "profileSampleRate must be between 0 and 1");
+            }
+            return Status::OK();
+        }
+    } profileSampleRateParameter;
+
+    AtomicUInt64 profileCandidates;
+
+    // Deterministic rather than random: of every 1/rate operations that qualify, one is kept.
+    bool sampled() {
+        const double rate = profileSampleRate;
+        if (rate >= 1) {
+            return true;
+        }
+        const unsigned long long n = profileCandidates.fetchAndAdd(1);
+        return (unsigned long long) ((n + 1) * rate) != (unsigned long long) (n * rate);
+    }
+
+    // Inserts entries into db's system.profile in one transaction.
+    void lockedWriteProfileEntries(const string& db, vector<BSONObj>& entries) {
+        if (!dbHolder().__isLoaded(db, dbpath)) {
+            return;
+        }
+        Client::Context ctx(db, dbpath);
+        // the thread flushing may be in the middle of a multi-statement transaction
+        Client::AlternateTransactionStack altStack;
+        Client::Transaction txn(DB_SERIALIZABLE);
+        Collection *cl = getOrCreateProfileCollection(ctx.db());
+        if (!cl) {
+            return;
+        }
+        for (vector<BSONObj>::iterator it = entries.begin(); it != entries.end(); ++it) {
+            insertOneObject(cl, *it);
+        }
+        txn.commit();
+        profileEntriesWritten.increment(entries.size());
+        profileBatches.increment();
+    }
+
+    void writeProfileEntries(const string& db, vector<BSONObj>& entries) {
+        LOCK_REASON(lockReason, "writing to system.profile collection");
+        try {
+            try {
+                Lock::DBRead lk(db, lockReason);
+                lockedWriteProfileEntries(db, entries);
+            } catch (RetryWithWriteLock &e) {
+                Lock::DBWrite lk(db, lockReason);
+                lockedWriteProfileEntries(db, entries);
+            }
+        }
+        catch (const DBException& e) {
+            warning() << "Caught exception while writing " << entries.size()
+                      << " entries to " << db << ".system.profile: " << e.toString() << endl;
+        }
+    }
+
+    /**
+     * Writes profile entries in the background, so the operations being profiled only pay for
+     * building their entry.
+     *
+     * Request threads push entries onto a lock-free stack.  The writer takes the whole stack at
+     * once every profileWriterPeriodMillis and writes it with one transaction per database.
+     * A request about to read system.profile does the same in its own thread (see
+     * flushProfileEntries()); _writeMutex keeps the batches in order.
+     */
+    class ProfileWriter : public BackgroundJob {
+        struct Entry {
+            const string db;
+            const BSONObj obj;
+            Entry *next;
+            Entry(const string& db, const BSONObj& obj) : db(db), obj(obj.getOwned()), next(NULL) {}
+        };
+
+    public:
+        ProfileWriter() : _writeMutex("ProfileWriter"), _running(false) {}
+        virtual ~ProfileWriter() {}
+
+        virtual string name() const { return "ProfileWriter"; }
+
+        void start() {
+            _running = true;
+            go();
+        }
+
+        bool running() const { return _running; }
+
+        void push(const string& db, const BSONObj& obj) {
+            if (_pending.fetchAndAdd(1) >= (unsigned long long) profileQueueSize) {
+                _pending.fetchAndSubtract(1);
+                profileEntriesDropped.increment();
+                return;
+            }
+            Entry *e = new Entry(db, obj);
+            uintptr_t head = _head.load();
+            while (true) {
+                e->next = reinterpret_cast<Entry *>(head);
+                const uintptr_t prev = _head.compareAndSwap(head, reinterpret_cast<uintptr_t>(e));
+                if (prev == head) {
+                    break;
+                }
+                head = prev;
+            }
+        }
+
+        void writePending() {
+            scoped_lock lk(_writeMutex);
+            // Nobody else takes entries off the stack, so there is no ABA problem.
+            Entry *e = reinterpret_cast<Entry *>(_head.swap(0));
+            if (e == NULL) {
+                return;
+            }
+            // the stack is newest first
+            vector<Entry *> taken;
+            for (; e != NULL; e = e->next) {
+                taken.push_back(e);
+            }
+            _pending.fetchAndSubtract(taken.size());
+
+            map<string, vector<BSONObj> > byDb;
+            for (vector<Entry *>::reverse_iterator it = taken.rbegin(); it != taken.rend(); ++it) {
+                byDb[(*it)->db].push_back((*it)->obj);
+                delete *it;
+            }
+            for (map<string, vector<BSONObj> >::iterator it = byDb.begin(); it != byDb.end(); ++it) {
+                writeProfileEntries(it->first, it->second);
+            }
+        }
+
+    private:
+        virtual void run() {
+            Client::initThread(name().c_str());
+            while (!inShutdown()) {
+                sleepmillis(profileWriterPeriodMillis);
+                writePending();
+            }
+        }
+
+        mongo::mutex _writeMutex;
+        bool _running;
+        AtomicUInt64 _head; // Entry *, the most recently pushed
+        AtomicUInt64 _pending;
+    };
 
+    ProfileWriter profileWriter;
+
+} // namespace
+
+    static BSONObj _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder) {
         // build object
         BSONObjBuilder b(profileBufBuilder);
         b.appendDate("ts", jsTime());
@@ -95,22 +271,31 @@ namespace {
             p = b.done();
         }
 
-        // get or create the profiling collection
-        Collection *cl = getOrCreateProfileCollection(db);
-        if (cl) {
-            insertOneObject(cl, p);
-        }
+        return p;
     }
 
     void profile(const Client& c, int op, CurOp& currentOp) {
-        Lock::assertAtLeastReadLocked(currentOp.getNS());
+        if (!sampled()) {
+            profileEntriesSkipped.increment();
+            return;
+        }
 
         // initialize with 1kb to start, to avoid realloc later
-        // doing this outside the dblock to improve performance
         BufBuilder profileBufBuilder(1024);
 
         try {
-            _profile(c, currentOp, profileBufBuilder);
+            BSONObj p = _profile(c, currentOp, profileBufBuilder);
+            const string db = nsToDatabase(currentOp.getNS());
+            if (profileWriter.running()) {
+                profileWriter.push(db, p);
+            }
+            else if (Lock::isReadLocked()) {
+                LOG(1) << "note: not profiling because recursive read lock" << endl;
+            }
+            else {
+                vector<BSONObj> entries(1, p.getOwned());
+                writeProfileEntries(db, entries);
+            }
         }
         catch (const AssertionException& assertionEx) {
             warning() << "Caught Assertion while trying to profile " << opToString(op)
@@ -119,6 +304,24 @@ namespace {
         }
     }
 
+    void flushProfileEntries() {
+        if (profileWriter.running() && !Lock::isLocked()) {
+            profileWriter.writePending();
+        }
+    }
+
+    void startProfileWriter() {
+        profileWriter.start();
+    }
+
+    double getProfileSampleRate() {
+        return profileSampleRate;
+    }
+
+    Status setProfileSampleRate(double rate) {
+        return profileSampleRateParameter.set(rate);
+    }
+
     Collection *getOrCreateProfileCollection(Database *db, bool force) {
         fassert(16372, db);
         const char *profileName = db->profileName().c_str();
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "mongo/base/status.h"
 #include "mongo/db/client.h"
 #include "mongo/db/collection.h"
 
@@ -32,8 +33,26 @@ namespace mongo {
        do when database->profile is set
     */
 
+    /**
+     * Builds the profile entry for currentOp and queues it for the profile writer, which
+     * batches entries into system.profile in the background.  Only the fraction of operations
+     * set by profileSampleRate (see the profile command) is recorded.
+     */
     void profile(const Client& c, int op, CurOp& currentOp);
 
+    /**
+     * Writes the queued profile entries, so whatever was profiled before this call is visible
+     * in system.profile.  Does nothing if the caller holds any lock.
+     */
+    void flushProfileEntries();
+
+    // Starts the thread that writes queued profile entries. Until it runs, profile() writes
+    // each entry itself.
+    void startProfileWriter();
+
+    double getProfileSampleRate();
+    Status setProfileSampleRate(double rate);
+
     /**
      * Get (or create) the profile collection
      *
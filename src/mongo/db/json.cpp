@@ -35,13 +35,14 @@ namespace mongo {
 #define CONTROL "\a\b\f\n\r\t\v"
 #define JOPTIONS "gims"
 
-    // Size hints given to char vectors
+    // Size hints given to char vectors.  Field names and string values are usually short, and
+    // one of each is allocated per field, so keep those small and let the long ones grow.
     enum {
         ID_RESERVE_SIZE = 64,
         PAT_RESERVE_SIZE = 4096,
         OPT_RESERVE_SIZE = 64,
-        FIELD_RESERVE_SIZE = 4096,
-        STRINGVAL_RESERVE_SIZE = 4096,
+        FIELD_RESERVE_SIZE = 64,
+        STRINGVAL_RESERVE_SIZE = 64,
         BINDATA_RESERVE_SIZE = 4096,
         BINDATATYPE_RESERVE_SIZE = 4096,
         NS_RESERVE_SIZE = 64
@@ -72,6 +73,28 @@ namespace mongo {
 
     Status JParse::value(const StringData& fieldName, BSONObjBuilder& builder) {
         MONGO_JSON_DEBUG("fieldName: " << fieldName);
+        // Strings and numbers are by far the most common values, so look at the first character
+        // for them before trying each of the keywords below in turn.
+        while (_input < _input_end && isspace(*_input)) {
+            ++_input;
+        }
+        if (_input < _input_end) {
+            const char c = *_input;
+            if (c == '"' || c == '\'') {
+                std::string valueString;
+                valueString.reserve(STRINGVAL_RESERVE_SIZE);
+                Status ret = quotedString(&valueString);
+                if (ret != Status::OK()) {
+                    return ret;
+                }
+                builder.append(fieldName, valueString);
+                return Status::OK();
+            }
+            if (isdigit(c) || (c == '-' && _input + 1 < _input_end && isdigit(_input[1]))) {
+                return number(fieldName, builder);
+            }
+        }
+
         if (accept(LBRACE, false)) {
             Status ret = object(fieldName, builder);
             if (ret != Status::OK()) {
@@ -714,6 +737,34 @@ namespace mongo {
     }
 
     Status JParse::number(const StringData& fieldName, BSONObjBuilder& builder) {
+        // Fast path for plain decimal integers that certainly fit in 64 bits.  Anything else
+        // (fractions, exponents, hex, long digit strings) is left to strtod and strtoll below.
+        {
+            const char* p = _input;
+            const bool negative = (p < _input_end && *p == '-');
+            if (negative) {
+                ++p;
+            }
+            const char* const digits = p;
+            long long val = 0;
+            while (p < _input_end && p - digits < 18 && isdigit(*p)) {
+                val = val * 10 + (*p++ - '0');
+            }
+            if (p > digits && p < _input_end && !isdigit(*p) && !match(*p, ".eExXpP")) {
+                if (negative) {
+                    val = -val;
+                }
+                if (val == static_cast<int>(val)) {
+                    builder.append(fieldName, static_cast<int>(val));
+                }
+                else {
+                    builder.append(fieldName, val);
+                }
+                _input = p;
+                return Status::OK();
+            }
+        }
+
         char* endptrll;
         char* endptrd;
         long long retll;
@@ -812,8 +863,23 @@ namespace mongo {
             return parseError("Unexpected end of input");
         }
         const char* q = _input;
+        // With a single terminal character and no allowed set (quoted strings and regex
+        // patterns), copy runs of ordinary characters in one go instead of one at a time.
+        const bool singleTerminal = (allowedSet == NULL && terminalSet[0] != '\0' &&
+                                     terminalSet[1] == '\0');
         while (q < _input_end && !match(*q, terminalSet)) {
             MONGO_JSON_DEBUG("q: " << q);
+            if (singleTerminal) {
+                const char* run = q;
+                while (q < _input_end && *q != terminalSet[0] && *q != '\\' &&
+                       static_cast<unsigned char>(*q) > 0x1F) {
+                    ++q;
+                }
+                result->append(run, q - run);
+                if (q >= _input_end || *q == terminalSet[0]) {
+                    break;
+                }
+            }
             if (allowedSet != NULL) {
                 if (!match(*q, allowedSet)) {
                     _input = q;
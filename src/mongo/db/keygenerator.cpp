@@ -72,6 +72,40 @@ namespace mongo {
         }
     }
         
+    // Like BSONObj::getFieldDottedOrArray(), without building a string for each path component.
+    static BSONElement getFieldDottedOrArray(const BSONObj &obj, const char *name) {
+        BSONObj o = obj;
+        while (true) {
+            const char *p = strchr(name, '.');
+            const BSONElement sub = p != NULL ? o.getField(StringData(name, p - name)) : o.getField(name);
+            if (sub.eoo() || sub.type() == Array || p == NULL) {
+                return sub;
+            }
+            if (sub.type() != Object) {
+                return BSONElement();
+            }
+            o = sub.embeddedObject();
+            name = p + 1;
+        }
+    }
+
+    bool KeyGenerator::getSingleKey(const BSONObj &obj, const char *const *fieldNames, const int n,
+                                    BSONElement *elts, int &numNotFound) {
+        numNotFound = 0;
+        for (int i = 0; i < n; i++) {
+            const BSONElement e = getFieldDottedOrArray(obj, fieldNames[i]);
+            if (e.eoo()) {
+                elts[i] = nullElt;
+                numNotFound++;
+            } else if (e.type() == Array) {
+                return false;
+            } else {
+                elts[i] = e;
+            }
+        }
+        return true;
+    }
+
     /**
      * @param arrayNestedArray - set if the returned element is an array nested directly within arr.
      */
@@ -65,6 +65,16 @@ namespace mongo {
         // One-time key generating function, because the implementation modifies fieldNames.
         static void getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
                             const bool sparse, BSONObjSet &keys);
+
+        // Fast path for the common case where no indexed path in obj reaches an array,
+        // so obj generates exactly one key (or none, if sparse and every field is missing).
+        // Fills elts[0..n) with the key's values, using null for missing fields, without
+        // allocating anything.
+        //
+        // @return false if some indexed path reaches an array, in which case getKeys()
+        //         must be used. Otherwise numNotFound is the number of missing fields.
+        static bool getSingleKey(const BSONObj &obj, const char *const *fieldNames, const int n,
+                                 BSONElement *elts, int &numNotFound);
     private:
 
         /**
@@ -21,6 +21,7 @@
 
 #include "mongo/db/d_concurrency.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/distributed_rwlock.h"
 
 namespace mongo {
 
@@ -121,8 +122,10 @@ namespace mongo {
         friend class AcquiringParallelWriter;
     };
 
+    // Readers of a database far outnumber writers (TokuMX locks documents underneath, so most
+    // writes only need a read lock here), hence the distributed lock.
     class WrapperForRWLock : boost::noncopyable { 
-        SimpleRWLock r;
+        DistributedRWLock r;
         AtomicInt64 _writeLockWaiters;
     public:
         string name() const { return r.name; }
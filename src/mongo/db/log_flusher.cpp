@@ -0,0 +1,168 @@
+// log_flusher.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/log_flusher.h"
+
+#include <boost/thread/condition.hpp>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    static Counter64 logFlushes;
+    static Counter64 logFlushWaiters;
+    static Counter64 logFlushMicros;
+
+    static ServerStatusMetricField<Counter64> logFlushesDisplay("logFlusher.flushes", &logFlushes);
+    static ServerStatusMetricField<Counter64> logFlushWaitersDisplay("logFlusher.waiters", &logFlushWaiters);
+    static ServerStatusMetricField<Counter64> logFlushMicrosDisplay("logFlusher.flushMicros", &logFlushMicros);
+
+    // Flushes are numbered. A waiter needs the first flush that starts after it
+    // arrives, so it waits for flush _started + 1 to complete.
+    class LogFlusher : public BackgroundJob {
+    public:
+        LogFlusher() :
+            _mutex("LogFlusher"),
+            _running(false),
+            _started(0),
+            _completed(0),
+            _succeeded(0),
+            _waiters(0) {
+        }
+        virtual ~LogFlusher() {}
+
+        virtual string name() const { return "LogFlusher"; }
+
+        void start() {
+            {
+                scoped_lock lk(_mutex);
+                _running = true;
+            }
+            go();
+        }
+
+        void waitForFlush() {
+            if (!waitForFlusher()) {
+                // the flusher is not running, or exited in shutdown before our flush
+                storage::log_flush();
+            }
+        }
+
+    private:
+        // @return false if there is no flusher thread to do the flush
+        bool waitForFlusher() {
+            scoped_lock lk(_mutex);
+            if (!_running) {
+                return false;
+            }
+            const unsigned long long target = _started + 1;
+            if (_waiters++ == 0) {
+                _needFlush.notify_one();
+            }
+            while (_completed < target) {
+                if (!_running) {
+                    return false;
+                }
+                _flushed.wait(lk.boost());
+            }
+            uassert(17378, str::stream() << "error flushing the recovery log: " << _lastError,
+                    _succeeded >= target);
+            return true;
+        }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+
+            while (true) {
+                unsigned long long flush;
+                {
+                    scoped_lock lk(_mutex);
+                    while (_waiters == 0) {
+                        // Only exit when nobody is left waiting on us. Later
+                        // callers flush for themselves.
+                        if (inShutdown()) {
+                            _running = false;
+                            _flushed.notify_all();
+                            return;
+                        }
+                        boost::xtime xt;
+                        boost::xtime_get(&xt, MONGO_BOOST_TIME_UTC);
+                        xt.sec += 1;
+                        _needFlush.timed_wait(lk.boost(), xt);
+                    }
+                    flush = ++_started;
+                    logFlushWaiters.increment(_waiters);
+                    _waiters = 0;
+                }
+
+                string err;
+                Timer t;
+                try {
+                    storage::log_flush();
+                }
+                catch (DBException &e) {
+                    err = e.toString();
+                    error() << "LogFlusher: " << err << endl;
+                }
+                logFlushMicros.increment(t.micros());
+                logFlushes.increment();
+
+                {
+                    scoped_lock lk(_mutex);
+                    _completed = flush;
+                    if (err.empty()) {
+                        _succeeded = flush;
+                    } else {
+                        _lastError = err;
+                    }
+                    _flushed.notify_all();
+                }
+            }
+        }
+
+        mongo::mutex _mutex;
+        boost::condition _needFlush;
+        boost::condition _flushed;
+        // protected by _mutex
+        bool _running;
+        unsigned long long _started;
+        unsigned long long _completed;
+        unsigned long long _succeeded;
+        unsigned long long _waiters; // waiting for flush _started + 1
+        string _lastError;
+    };
+
+    static LogFlusher logFlusher;
+
+    void startLogFlusher() {
+        logFlusher.start();
+    }
+
+    void waitForLogFlush() {
+        logFlusher.waitForFlush();
+    }
+
+}
@@ -0,0 +1,32 @@
+// log_flusher.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace mongo {
+
+    // Starts the thread that flushes the recovery log on behalf of waitForLogFlush() callers.
+    void startLogFlusher();
+
+    // Returns once the recovery log has been flushed by a flush that began after this was
+    // called, so everything the caller committed beforehand is durable. Callers that arrive
+    // while a flush is running all share the next one. Flushes directly if the flusher
+    // thread is not running (e.g. in tools using --dbpath).
+    void waitForLogFlush();
+
+}
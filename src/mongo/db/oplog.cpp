@@ -402,6 +402,27 @@ namespace mongo {
         }
     }
     
+    void prefetchTransactionFromOplog(BSONObj entry, bool secondaryIndexes) {
+        // transactions too big to fit in one entry are written to oplog.refs,
+        // those are not worth reading twice
+        if (entry["a"].Bool() || !entry.hasElement("ops")) {
+            return;
+        }
+        Client::Transaction transaction(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+        std::vector<BSONElement> ops = entry["ops"].Array();
+        for (std::vector<BSONElement>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+            try {
+                OplogHelpers::prefetchOperationFromOplog(it->Obj(), secondaryIndexes);
+            }
+            catch (DBException &e) {
+                // the applier will run into whatever the problem is, if it is one at all
+                // (the collection may not have been created yet, for instance)
+                LOG(2) << "could not prefetch op " << it->Obj() << ": " << e.what() << endl;
+            }
+        }
+        transaction.commit();
+    }
+
     // apply all operations in the array
     void rollbackOps(std::vector<BSONElement> ops) {
         const size_t numOps = ops.size();
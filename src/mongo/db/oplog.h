@@ -48,6 +48,9 @@ namespace mongo {
     void writeEntryToOplogRefs(BSONObj entry);
     void replicateFullTransactionToOplog(BSONObj& o, OplogReader& r, bool* bigTxn);
     void applyTransactionFromOplog(BSONObj entry);
+    // reads in the rows (and, if secondaryIndexes, index keys) that applying entry will write,
+    // so they are cached by the time applyTransactionFromOplog gets to it
+    void prefetchTransactionFromOplog(BSONObj entry, bool secondaryIndexes);
     void rollbackTransactionFromOplog(BSONObj entry, bool purgeEntry);
     void purgeEntryFromOplog(BSONObj entry);
 
@@ -16,6 +16,7 @@
 
 #include "mongo/pch.h"
 #include "mongo/db/collection.h"
+#include "mongo/db/cursor.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/db/txn_context.h"
 #include "mongo/db/repl_block.h"
@@ -25,8 +26,10 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/relock.h"
+#include "mongo/platform/atomic_word.h"
 
 // BSON fields for oplog entries
 static const char *KEY_STR_OP_NAME = "op";
@@ -36,15 +39,20 @@ static const char *KEY_STR_OLD_ROW = "o";
 static const char *KEY_STR_NEW_ROW = "o2";
 static const char *KEY_STR_MODS = "m";
 static const char *KEY_STR_PK = "pk";
+static const char *KEY_STR_QUERY = "q";
 static const char *KEY_STR_COMMENT = "o";
 static const char *KEY_STR_MIGRATE = "fromMigrate";
+static const char *KEY_STR_UNDO_MODS = "rm";
 
 // values for types of operations in oplog
 static const char OP_STR_INSERT[] = "i"; // normal insert
 static const char OP_STR_CAPPED_INSERT[] = "ci"; // insert into capped collection
 static const char OP_STR_UPDATE[] = "u"; // normal update with full pre-image and full post-image
 static const char OP_STR_UPDATE_ROW_WITH_MOD[] = "ur"; // update with full pre-image and mods to generate post-image
+static const char OP_STR_UPDATE_OBJECTS_WITH_MODS[] = "um"; // update of every doc in a pk range, mods only
+static const char OP_STR_UPDATE_PK_WITH_MODS[] = "up"; // update by pk with mods, and mods restoring the modified fields, if any
 static const char OP_STR_DELETE[] = "d"; // delete with full pre-image
+static const char OP_STR_DELETE_PK[] = "dp"; // delete by pk, no pre-image
 static const char OP_STR_CAPPED_DELETE[] = "cd"; // delete from capped collection
 static const char OP_STR_COMMENT[] = "n"; // a no-op
 static const char OP_STR_COMMAND[] = "c"; // command
@@ -79,6 +87,108 @@ namespace mongo {
         static inline bool isLocalNs(const char *ns) {
             return (strncmp(ns, "local.", 6) == 0);
         }
+
+        // How much of the documents updates and deletes change is logged for replication:
+        // - full: the whole pre-image, what every operation can be applied and rolled back with.
+        // - modifiedFields: $ operator updates that keep the primary key log only the mods and
+        //   the previous values of the top-level fields they modify. Deletes are logged in full.
+        // - none: updates are logged without pre-image, and deletes with only the primary key.
+        //   Such entries cannot be rolled back.
+        // Secondaries read the documents whenever the logged operation doesn't have what they
+        // need to maintain secondary indexes.
+        // Entries logged for migrations always have the full pre-image.
+        enum PreImageMode {
+            PRE_IMAGES_FULL = 0,
+            PRE_IMAGES_MODIFIED_FIELDS,
+            PRE_IMAGES_NONE
+        };
+
+        static AtomicUInt32 preImageMode(PRE_IMAGES_FULL);
+
+        static PreImageMode getPreImageMode() {
+            return static_cast<PreImageMode>(preImageMode.load());
+        }
+
+        class OplogPreImages : public ServerParameter {
+        public:
+            OplogPreImages()
+                : ServerParameter( ServerParameterSet::getGlobal(), "oplogPreImages" ) {
+            }
+
+            virtual ~OplogPreImages() {
+            }
+
+            virtual void append( BSONObjBuilder& b, const string& name ) {
+                switch (getPreImageMode()) {
+                case PRE_IMAGES_MODIFIED_FIELDS: b.append( name, "modifiedFields" ); break;
+                case PRE_IMAGES_NONE: b.append( name, "none" ); break;
+                default: b.append( name, "full" ); break;
+                }
+            }
+
+            virtual Status set( const BSONElement& newValueElement ) {
+                return setFromString( newValueElement.valuestrsafe() );
+            }
+
+            virtual Status setFromString( const string& mode ) {
+                if (mode == "full") {
+                    preImageMode.store(PRE_IMAGES_FULL);
+                }
+                else if (mode == "modifiedFields") {
+                    preImageMode.store(PRE_IMAGES_MODIFIED_FIELDS);
+                }
+                else if (mode == "none") {
+                    preImageMode.store(PRE_IMAGES_NONE);
+                }
+                else {
+                    return Status( ErrorCodes::BadValue,
+                                   str::stream() << "unrecognized oplogPreImages setting: " << mode
+                                                 << ", expected full, modifiedFields or none" );
+                }
+                return Status::OK();
+            }
+
+        } oplogPreImages;
+
+        // @return the mods that, applied to the document updateobj produced from oldObj,
+        //         give back oldObj: the previous values of the top-level fields updateobj
+        //         modifies are $set, and those it created are $unset. Restored fields may
+        //         end up in a different order.
+        static BSONObj undoMods(const BSONObj &oldObj, const BSONObj &updateobj) {
+            set<string> fields;
+            for (BSONObjIterator ops(updateobj); ops.more(); ) {
+                const BSONElement &op = ops.next();
+                const bool isRename = str::equals(op.fieldName(), "$rename");
+                for (BSONObjIterator i(op.Obj()); i.more(); ) {
+                    const BSONElement &e = i.next();
+                    fields.insert(str::before(e.fieldName(), '.'));
+                    if (isRename) {
+                        fields.insert(str::before(e.valuestrsafe(), '.'));
+                    }
+                }
+            }
+            BSONObjBuilder setBuilder;
+            BSONObjBuilder unsetBuilder;
+            for (set<string>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+                const BSONElement e = oldObj[*it];
+                if (e.eoo()) {
+                    unsetBuilder.append(*it, 1);
+                }
+                else {
+                    setBuilder.append(e);
+                }
+            }
+            BSONObjBuilder b;
+            const BSONObj setObj = setBuilder.done();
+            if (!setObj.isEmpty()) {
+                b.append("$set", setObj);
+            }
+            const BSONObj unsetObj = unsetBuilder.done();
+            if (!unsetObj.isEmpty()) {
+                b.append("$unset", unsetObj);
+            }
+            return b.obj();
+        }
         
         void logComment(const BSONObj &comment) {
             if (logTxnOpsForReplication()) {
@@ -126,28 +236,38 @@ namespace mongo {
             }
         }
 
+        static BSONObj updateOp(const char *ns, const BSONObj &pk,
+                                const BSONObj &oldObj, const BSONObj &newObj,
+                                bool withPreImage, bool fromMigrate) {
+            BSONObjBuilder b;
+            appendOpType(OP_STR_UPDATE, &b);
+            appendNsStr(ns, &b);
+            appendMigrate(fromMigrate, &b);
+            b.append(KEY_STR_PK, pk);
+            if (withPreImage) {
+                b.append(KEY_STR_OLD_ROW, oldObj);
+            }
+            verify(!newObj.isEmpty());
+            b.append(KEY_STR_NEW_ROW, newObj);
+            return b.obj();
+        }
+
         void logUpdate(const char *ns, const BSONObj &pk,
                        const BSONObj &oldObj, const BSONObj &newObj,
                        bool fromMigrate) {
             bool logForSharding = !fromMigrate &&
                 shouldLogTxnUpdateOpForSharding(OP_STR_UPDATE, ns, oldObj);
             if (logTxnOpsForReplication() || logForSharding) {
-                BSONObjBuilder b;
                 if (isLocalNs(ns)) {
                     return;
                 }
 
-                appendOpType(OP_STR_UPDATE, &b);
-                appendNsStr(ns, &b);
-                appendMigrate(fromMigrate, &b);
-                b.append(KEY_STR_PK, pk);
-                b.append(KEY_STR_OLD_ROW, oldObj);
-                // otherwise we just log the full old row and full new row
-                verify(!newObj.isEmpty());
-                b.append(KEY_STR_NEW_ROW, newObj);
-                BSONObj logObj = b.obj();
+                const bool slim = getPreImageMode() == PRE_IMAGES_NONE;
+                BSONObj logObj = updateOp(ns, pk, oldObj, newObj, !slim || logForSharding, fromMigrate);
                 if (logTxnOpsForReplication()) {
-                    cc().txn().logOpForReplication(logObj);
+                    cc().txn().logOpForReplication(slim && logForSharding ?
+                                                   updateOp(ns, pk, oldObj, newObj, false, fromMigrate) :
+                                                   logObj);
                 }
                 if (logForSharding) {
                     cc().txn().logOpForSharding(logObj);
@@ -160,26 +280,48 @@ namespace mongo {
             const BSONObj &pk,
             const BSONObj &oldObj,
             const BSONObj &updateobj,
+            bool samePK,
             bool fromMigrate
             ) 
         {
             bool logForSharding = !fromMigrate &&
                 shouldLogTxnUpdateOpForSharding(OP_STR_UPDATE, ns, oldObj);
             if (logTxnOpsForReplication() || logForSharding) {
-                BSONObjBuilder b;
                 if (isLocalNs(ns)) {
                     return;
                 }
 
-                appendOpType(OP_STR_UPDATE_ROW_WITH_MOD, &b);
-                appendNsStr(ns, &b);
-                appendMigrate(fromMigrate, &b);
-                b.append(KEY_STR_PK, pk);
-                b.append(KEY_STR_OLD_ROW, oldObj);
-                b.append(KEY_STR_MODS, updateobj);
-                BSONObj logObj = b.obj();
+                // an update that moves the document to another primary key is logged in
+                // full, a secondary could not find the document to undo it otherwise
+                const PreImageMode mode = getPreImageMode();
+                const bool slim = samePK && mode != PRE_IMAGES_FULL;
+                BSONObj logObj;
+                if (!slim || logForSharding) {
+                    BSONObjBuilder b;
+                    appendOpType(OP_STR_UPDATE_ROW_WITH_MOD, &b);
+                    appendNsStr(ns, &b);
+                    appendMigrate(fromMigrate, &b);
+                    b.append(KEY_STR_PK, pk);
+                    b.append(KEY_STR_OLD_ROW, oldObj);
+                    b.append(KEY_STR_MODS, updateobj);
+                    logObj = b.obj();
+                }
                 if (logTxnOpsForReplication()) {
-                    cc().txn().logOpForReplication(logObj);
+                    if (slim) {
+                        BSONObjBuilder b;
+                        appendOpType(OP_STR_UPDATE_PK_WITH_MODS, &b);
+                        appendNsStr(ns, &b);
+                        appendMigrate(fromMigrate, &b);
+                        b.append(KEY_STR_PK, pk);
+                        b.append(KEY_STR_MODS, updateobj);
+                        if (mode == PRE_IMAGES_MODIFIED_FIELDS) {
+                            b.append(KEY_STR_UNDO_MODS, undoMods(oldObj, updateobj));
+                        }
+                        cc().txn().logOpForReplication(b.obj());
+                    }
+                    else {
+                        cc().txn().logOpForReplication(logObj);
+                    }
                 }
                 if (logForSharding) {
                     cc().txn().logOpForSharding(logObj);
@@ -187,21 +329,51 @@ namespace mongo {
             }
         }
 
-        void logDelete(const char *ns, const BSONObj &row, bool fromMigrate) {
-            bool logForSharding = !fromMigrate && shouldLogTxnOpForSharding(OP_STR_DELETE, ns, row);
-            if (logTxnOpsForReplication() || logForSharding) {
+        void logUpdateObjectsMods(const char *ns, const BSONObj &query, const BSONObj &updateobj) {
+            // Never logged for sharding, such updates are not done on sharded collections.
+            if (logTxnOpsForReplication()) {
                 BSONObjBuilder b;
                 if (isLocalNs(ns)) {
                     return;
                 }
 
-                appendOpType(OP_STR_DELETE, &b);
+                appendOpType(OP_STR_UPDATE_OBJECTS_WITH_MODS, &b);
                 appendNsStr(ns, &b);
-                appendMigrate(fromMigrate, &b);
-                b.append(KEY_STR_ROW, row);
-                BSONObj logObj = b.obj();
+                b.append(KEY_STR_QUERY, query);
+                b.append(KEY_STR_MODS, updateobj);
+                cc().txn().logOpForReplication(b.obj());
+            }
+        }
+
+        void logDelete(const char *ns, const BSONObj &pk, const BSONObj &row, bool fromMigrate) {
+            bool logForSharding = !fromMigrate && shouldLogTxnOpForSharding(OP_STR_DELETE, ns, row);
+            if (logTxnOpsForReplication() || logForSharding) {
+                if (isLocalNs(ns)) {
+                    return;
+                }
+
+                const bool slim = getPreImageMode() == PRE_IMAGES_NONE;
+                BSONObj logObj;
+                if (!slim || logForSharding) {
+                    BSONObjBuilder b;
+                    appendOpType(OP_STR_DELETE, &b);
+                    appendNsStr(ns, &b);
+                    appendMigrate(fromMigrate, &b);
+                    b.append(KEY_STR_ROW, row);
+                    logObj = b.obj();
+                }
                 if (logTxnOpsForReplication()) {
-                    cc().txn().logOpForReplication(logObj);
+                    if (slim) {
+                        BSONObjBuilder b;
+                        appendOpType(OP_STR_DELETE_PK, &b);
+                        appendNsStr(ns, &b);
+                        appendMigrate(fromMigrate, &b);
+                        b.append(KEY_STR_PK, pk);
+                        cc().txn().logOpForReplication(b.obj());
+                    }
+                    else {
+                        cc().txn().logOpForReplication(logObj);
+                    }
                 }
                 if (logForSharding) {
                     cc().txn().logOpForSharding(logObj);
@@ -224,7 +396,7 @@ namespace mongo {
             }
         }
 
-        void logCommand(const char *ns, const BSONObj &row) {
+        void logCommand(const char *ns, const BSONObj &row, bool fromMigrate) {
             // We do not need to log for sharding because commands are only logged right now if they
             // take a write lock, and we have a read lock the whole time we're logging things for
             // sharding.  TODO: If this changes, we need to start logging commands.
@@ -237,6 +409,7 @@ namespace mongo {
                 appendOpType(OP_STR_COMMAND, &b);
                 appendNsStr(ns, &b);
                 b.append(KEY_STR_ROW, row);
+                appendMigrate(fromMigrate, &b);
                 cc().txn().logOpForReplication(b.obj());
             }
         }
@@ -362,7 +535,7 @@ namespace mongo {
             Collection *cl = getCollection(ns);
 
             verify(cl->isCapped());
-            CappedCollection *cappedCl = cl->as<CappedCollection>();
+            CappedCollectionInterface *cappedCl = cl->as<CappedCollectionInterface>();
             // overwrite set to true because we are running on a secondary
             bool indexBitChanged = false;
             const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
@@ -409,6 +582,26 @@ namespace mongo {
             runDeleteFromOplogWithLock(ns, op);
         }
         
+        static void runDeletePKFromOplog(const char *ns, const BSONObj &op) {
+            LOCK_REASON(lockReason, "repl: applying delete");
+            Client::ReadContext ctx(ns, lockReason);
+            Collection *cl = getCollection(ns);
+
+            // the secondary indexes are maintained from the row, so it has to be read
+            const BSONObj pk = op[KEY_STR_PK].Obj();
+            BSONObj row;
+            if (cl->findByPK(pk, row)) {
+                const uint64_t flags = Collection::NO_LOCKTREE;
+                deleteOneObject(cl, pk, row, flags);
+            }
+        }
+
+        static void rollbackDeletePKFromOplog(const char *ns, const BSONObj &op) {
+            log() << "Cannot rollback delete without pre-image " << op << rsLog;
+            throw RollbackOplogException(str::stream() << "Could not rollback delete of " << op[KEY_STR_PK]
+                                                       << " on ns " << ns);
+        }
+
         static void runCappedDeleteFromOplog(const char *ns, const BSONObj &op) {
             LOCK_REASON(lockReason, "repl: applying capped delete");
             Client::ReadContext ctx(ns, lockReason);
@@ -418,7 +611,7 @@ namespace mongo {
             const BSONObj pk = op[KEY_STR_PK].Obj();
 
             verify(cl->isCapped());
-            CappedCollection *cappedCl = cl->as<CappedCollection>();
+            CappedCollectionInterface *cappedCl = cl->as<CappedCollectionInterface>();
             const uint64_t flags = Collection::NO_LOCKTREE;
             cappedCl->deleteObjectWithPK(pk, row, flags);
             cl->notifyOfWriteOp();
@@ -435,7 +628,20 @@ namespace mongo {
             Collection *cl = getCollection(ns);
 
             uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
-            if (isRollback) {
+            if (oldObj.isEmpty()) {
+                // logged without the pre-image
+                if (isRollback) {
+                    log() << "Cannot rollback update without pre-image of " << pk << " in " << ns << rsLog;
+                    throw RollbackOplogException(str::stream() << "Could not rollback update of " << pk
+                                                               << " on ns " << ns);
+                }
+                BSONObj row;
+                massert(17399, str::stream() << "could not find the document with primary key " << pk
+                                             << " to update in " << ns,
+                        cl->findByPK(pk, row));
+                updateOneObject(cl, pk, row, newObj, BSONObj(), false, flags);
+            }
+            else if (isRollback) {
                 if (cl->isPKHidden()) {
                     // if this is a rollback, then the newObj is what is in the
                     // collections, that we want to replace with oldObj
@@ -466,7 +672,8 @@ namespace mongo {
             BSONElement fields[3];
             op.getFields(3, names, fields);
             const BSONObj pk = fields[0].Obj();     // must exist
-            const BSONObj oldObj = fields[1].Obj(); // must exist
+            // missing if logged with oplogPreImages=none
+            const BSONObj oldObj = fields[1].isABSONObj() ? fields[1].Obj() : BSONObj();
             const BSONObj newObj = fields[2].Obj(); // must exist
             // must be given at least one of the new object or an update obj
             verify(!newObj.isEmpty());
@@ -550,6 +757,75 @@ namespace mongo {
             }
         }
 
+        static void runUpdatePKWithModsFromOplog(const char *ns, const BSONObj &op, bool isRollback) {
+            const char *names[] = {
+                KEY_STR_PK,
+                KEY_STR_MODS,
+                KEY_STR_UNDO_MODS
+                };
+            BSONElement fields[3];
+            op.getFields(3, names, fields);
+            const BSONObj pk = fields[0].Obj();        // must exist
+            const BSONObj updateobj = fields[1].Obj(); // must exist
+            verify(!updateobj.isEmpty());
+            if (isRollback && !fields[2].isABSONObj()) {
+                // logged with oplogPreImages=none
+                log() << "Cannot rollback update without pre-image " << op << rsLog;
+                throw RollbackOplogException(str::stream() << "Could not rollback update of " << pk
+                                                           << " with " << updateobj << " on ns " << ns);
+            }
+            // undoing an update is applying the mods that restore the fields it modified
+            const BSONObj mods = isRollback ? fields[2].Obj() : updateobj;
+
+            const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+            try {
+                LOCK_REASON(lockReason, "repl: applying update");
+                Client::ReadContext ctx(ns, lockReason);
+                updateOneObjectWithMods(getCollection(ns), pk, mods, false, flags);
+            }
+            catch (RetryWithWriteLock &e) {
+                LOCK_REASON(lockReason, "repl: applying update with write lock");
+                Client::WriteContext ctx(ns, lockReason);
+                updateOneObjectWithMods(getCollection(ns), pk, mods, false, flags);
+            }
+        }
+
+        static void runUpdateObjectsModsWithLock(const char *ns, const BSONObj &query, const BSONObj &updateobj) {
+            Collection *cl = getCollection(ns);
+            const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+            updateObjectsWithoutReading(cl, query, updateobj, flags);
+        }
+
+        static void runUpdateObjectsModsFromOplog(const char *ns, const BSONObj &op) {
+            const char *names[] = {
+                KEY_STR_QUERY,
+                KEY_STR_MODS
+                };
+            BSONElement fields[2];
+            op.getFields(2, names, fields);
+            const BSONObj query = fields[0].Obj();     // must exist
+            const BSONObj updateobj = fields[1].Obj(); // must exist
+            verify(!updateobj.isEmpty());
+
+            try {
+                LOCK_REASON(lockReason, "repl: applying update");
+                Client::ReadContext ctx(ns, lockReason);
+                runUpdateObjectsModsWithLock(ns, query, updateobj);
+            }
+            catch (RetryWithWriteLock &e) {
+                LOCK_REASON(lockReason, "repl: applying update with write lock");
+                Client::WriteContext ctx(ns, lockReason);
+                runUpdateObjectsModsWithLock(ns, query, updateobj);
+            }
+        }
+
+        static void rollbackUpdateObjectsModsFromOplog(const char *ns, const BSONObj &op) {
+            // Without the pre-images there is nothing to restore the documents from.
+            log() << "Cannot rollback update without pre-images " << op << rsLog;
+            throw RollbackOplogException(str::stream() << "Could not rollback update of " << op[KEY_STR_QUERY]
+                                                       << " with " << op[KEY_STR_MODS] << " on ns " << ns);
+        }
+
         static void runCommandFromOplog(const char *ns, const BSONObj &op) {
             BufBuilder bb;
             BSONObjBuilder ob;
@@ -589,10 +865,22 @@ namespace mongo {
                 opCounters->gotUpdate();
                 runUpdateModsWithRowFromOplog(ns, op, false);
             }
+            else if (strcmp(opType, OP_STR_UPDATE_OBJECTS_WITH_MODS) == 0) {
+                opCounters->gotUpdate();
+                runUpdateObjectsModsFromOplog(ns, op);
+            }
+            else if (strcmp(opType, OP_STR_UPDATE_PK_WITH_MODS) == 0) {
+                opCounters->gotUpdate();
+                runUpdatePKWithModsFromOplog(ns, op, false);
+            }
             else if (strcmp(opType, OP_STR_DELETE) == 0) {
                 opCounters->gotDelete();
                 runDeleteFromOplog(ns, op);
             }
+            else if (strcmp(opType, OP_STR_DELETE_PK) == 0) {
+                opCounters->gotDelete();
+                runDeletePKFromOplog(ns, op);
+            }
             else if (strcmp(opType, OP_STR_COMMAND) == 0) {
                 opCounters->gotCommand();
                 runCommandFromOplog(ns, op);
@@ -613,6 +901,74 @@ namespace mongo {
             }
         }
 
+        static void prefetchIndexKeys(Collection *cl, const BSONObj &row) {
+            for (int i = 0; i < cl->nIndexes(); i++) {
+                const IndexDetails &idx = cl->idx(i);
+                // key generation is not on IndexDetails, and partitioned
+                // collections aren't worth the trouble
+                const IndexDetailsBase *idxBase = dynamic_cast<const IndexDetailsBase *>(&idx);
+                if (idxBase == NULL || cl->isPKIndex(idx)) {
+                    continue;
+                }
+                BSONObjSet keys;
+                idxBase->getKeysFromObject(row, keys);
+                for (BSONObjSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+                    // positioning the cursor is enough to bring the leaf in
+                    shared_ptr<Cursor> c = Cursor::make(cl, idx, *it, *it, true, 1, 1, true);
+                }
+            }
+        }
+
+        void prefetchOperationFromOplog(const BSONObj& op, bool secondaryIndexes) {
+            const char *names[] = {
+                KEY_STR_NS,
+                KEY_STR_OP_NAME,
+                KEY_STR_PK,
+                KEY_STR_ROW,
+                KEY_STR_NEW_ROW
+                };
+            BSONElement fields[5];
+            op.getFields(5, names, fields);
+            const char *ns = fields[0].valuestrsafe();
+            const char *opType = fields[1].valuestrsafe();
+            // these are logged with the pk
+            const bool hasPK = strcmp(opType, OP_STR_UPDATE) == 0 ||
+                               strcmp(opType, OP_STR_UPDATE_ROW_WITH_MOD) == 0 ||
+                               strcmp(opType, OP_STR_UPDATE_PK_WITH_MODS) == 0 ||
+                               strcmp(opType, OP_STR_DELETE_PK) == 0;
+            if (!hasPK &&
+                strcmp(opType, OP_STR_DELETE) != 0 &&
+                (strcmp(opType, OP_STR_INSERT) != 0 ||
+                 nsToCollectionSubstring(ns) == "system.indexes")) {
+                // capped collections, commands and "um" updates are not worth it,
+                // there is either nothing to read or the applier reads it anyway
+                return;
+            }
+            LOG(6) << "prefetching op: " << op << endl;
+            LOCK_REASON(lockReason, "repl: prefetching op");
+            Client::ReadContext ctx(ns, lockReason);
+            Collection *cl = getCollection(ns);
+            if (cl == NULL || cl->isCapped()) {
+                return;
+            }
+            // inserts are blind, but still write into the same leaf a lookup would read
+            const BSONObj pk = hasPK ? fields[2].Obj() : cl->getValidatedPKFromObject(fields[3].Obj());
+            BSONObj result;
+            const bool found = cl->findByPK(pk, result);
+            if (secondaryIndexes) {
+                // operations logged without the pre-image change the keys of the stored row
+                if (fields[3].isABSONObj()) {
+                    prefetchIndexKeys(cl, fields[3].Obj());
+                }
+                else if (found) {
+                    prefetchIndexKeys(cl, result);
+                }
+                if (fields[4].isABSONObj()) {
+                    prefetchIndexKeys(cl, fields[4].Obj());
+                }
+            }
+        }
+
         static void runRollbackInsertFromOplog(const char *ns, const BSONObj &op) {
             // handle add index case
             if (nsToCollectionSubstring(ns) == "system.indexes") {
@@ -643,10 +999,19 @@ namespace mongo {
             else if (strcmp(opType, OP_STR_UPDATE_ROW_WITH_MOD) == 0) {
                 runUpdateModsWithRowFromOplog(ns, op, true);
             }
+            else if (strcmp(opType, OP_STR_UPDATE_OBJECTS_WITH_MODS) == 0) {
+                rollbackUpdateObjectsModsFromOplog(ns, op);
+            }
+            else if (strcmp(opType, OP_STR_UPDATE_PK_WITH_MODS) == 0) {
+                runUpdatePKWithModsFromOplog(ns, op, true);
+            }
             else if (strcmp(opType, OP_STR_DELETE) == 0) {
                 // the rollback of a delete is to do the insert
                 runInsertFromOplog(ns, op);
             }
+            else if (strcmp(opType, OP_STR_DELETE_PK) == 0) {
+                rollbackDeletePKFromOplog(ns, op);
+            }
             else if (strcmp(opType, OP_STR_COMMAND) == 0) {
                 rollbackCommandFromOplog(ns, op);
             }
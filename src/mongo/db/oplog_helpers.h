@@ -37,19 +37,26 @@ namespace mongo {
 
         void logUpdate(const char *ns, const BSONObj &pk, const BSONObj &oldObj, const BSONObj &newObj, bool fromMigrate);
 
-        void logUpdateModsWithRow(const char *ns, const BSONObj &pk, const BSONObj &oldObj, const BSONObj &updateobj, bool fromMigrate);
+        // samePK: whether the document keeps its primary key, which an update logged
+        //         without the pre-image depends on
+        void logUpdateModsWithRow(const char *ns, const BSONObj &pk, const BSONObj &oldObj, const BSONObj &updateobj, bool samePK, bool fromMigrate);
 
-        void logDelete(const char *ns, const BSONObj &row, bool fromMigrate);
+        void logUpdateObjectsMods(const char *ns, const BSONObj &query, const BSONObj &updateobj);
+
+        void logDelete(const char *ns, const BSONObj &pk, const BSONObj &row, bool fromMigrate);
 
         void logDeleteForCapped(const char *ns, const BSONObj &pk, const BSONObj &row);
 
-        void logCommand(const char *ns, const BSONObj &row);
+        void logCommand(const char *ns, const BSONObj &row, bool fromMigrate = false);
 
         void logUnsupportedOperation(const char *ns);
         // Used by secondaries to process oplog entries
 
         void applyOperationFromOplog(const BSONObj& op);
 
+        // Reads what applyOperationFromOplog will write for op, without changing anything
+        void prefetchOperationFromOplog(const BSONObj& op, bool secondaryIndexes);
+
         void rollbackOperationFromOplog(const BSONObj& op);
 
     }
@@ -20,6 +20,7 @@
 #include "mongo/db/relock.h"
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/ops/update.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
     const BSONObj reverseIDObj = BSON( "_id" << -1 );
@@ -148,6 +149,9 @@ namespace mongo {
         readersCreatedStats.increment();
     }
 
+    // compress the oplog and everything else read from the sync source, see MessageCompressor
+    MONGO_EXPORT_SERVER_PARAMETER(replNetworkCompression, bool, false);
+
     bool OplogReader::commonConnect(const string& hostName, const double default_timeout) {
         if( conn() == 0 ) {
             _conn = shared_ptr<DBClientConnection>(new DBClientConnection(false,
@@ -160,6 +164,9 @@ namespace mongo {
                 log() << "repl: " << errmsg << endl;
                 return false;
             }
+            if (replNetworkCompression) {
+                _conn->enableCompression();
+            }
         }
         return true;
     }
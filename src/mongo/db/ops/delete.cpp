@@ -62,7 +62,7 @@ namespace mongo {
              c->ok(); c->advance()) {
             const BSONObj pk = c->currPK();
             const BSONObj obj = c->current();
-            OplogHelpers::logDelete(ns.c_str(), obj, fromMigrate);
+            OplogHelpers::logDelete(ns.c_str(), pk, obj, fromMigrate);
             deleteOneObject(cl, pk, obj, flags);
             nDeleted++;
         }
@@ -84,7 +84,7 @@ namespace mongo {
         if (!pk.isEmpty()) {
             if (queryByPKHack(cl, pk, pattern, obj)) {
                 if (logop) {
-                    OplogHelpers::logDelete(ns, obj, false);
+                    OplogHelpers::logDelete(ns, pk, obj, false);
                 }
                 deleteOneObject(cl, pk, obj);
                 return 1;
@@ -122,7 +122,7 @@ namespace mongo {
             }
 
             if (logop) {
-                OplogHelpers::logDelete(ns, obj, false);
+                OplogHelpers::logDelete(ns, pk, obj, false);
             }
             deleteOneObject(cl, pk, obj);
             nDeleted++;
@@ -73,7 +73,7 @@ namespace mongo {
                         // special case capped colletions until all oplog writing
                         // for inserts is handled in the collection class, not here.
                         validateInsert(obj);
-                        CappedCollection *cappedCl = cl->as<CappedCollection>();
+                        CappedCollectionInterface *cappedCl = cl->as<CappedCollectionInterface>();
                         bool indexBitChanged = false; // need to initialize this
                         cappedCl->insertObjectAndLogOps(objModified, flags, &indexBitChanged);
                         // Hack copied from Collection::insertObject. TODO: find a better way to do this                        
@@ -24,6 +24,7 @@
 #include "mongo/db/queryutil.h"
 #include "mongo/db/query_optimizer.h"
 #include "mongo/db/collection.h"
+#include "mongo/db/cursor.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/ops/insert.h"
@@ -31,6 +32,7 @@
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_internal.h"
 #include "mongo/db/oplog_helpers.h"
+#include "mongo/s/d_logic.h"
 
 namespace mongo {
 
@@ -62,6 +64,24 @@ namespace mongo {
         cl->notifyOfWriteOp();
     }
 
+    void updateOneObjectWithMods(Collection *cl, const BSONObj &pk, const BSONObj &updateobj,
+                                 const bool fromMigrate, uint64_t flags) {
+        ModSet mods(updateobj, cl->indexKeys());
+        if (mods.isIndexed() <= 0 && !mods.hasDynamicArray() && cl->updateObjectModsOk() &&
+            !cl->indexBuildInProgress() && !hasClusteringSecondaryKey(cl)) {
+            cl->updateObjectMods(pk, updateobj, fromMigrate, flags | Collection::KEYS_UNAFFECTED_HINT);
+        } else {
+            BSONObj oldObj;
+            massert(17398, str::stream() << "could not find the document with primary key " << pk
+                                         << " to update in " << cl->ns(),
+                    cl->findByPK(pk, oldObj));
+            auto_ptr<ModSetState> mss = mods.prepare(oldObj, false /* not an insertion */);
+            BSONObj newObj = mss->createNewFromMods();
+            cl->updateObject(pk, oldObj, newObj, fromMigrate, flags);
+        }
+        cl->notifyOfWriteOp();
+    }
+
     static void checkNoMods(const BSONObj &obj) {
         for (BSONObjIterator i(obj); i.more(); ) {
             const BSONElement &e = i.next();
@@ -117,6 +137,106 @@ namespace mongo {
         Timer _loggingTimer;
     } _storageUpdateCallback; // installed as the ydb update callback in db.cpp via set_update_callback
 
+    static Counter64 fastupdatesBroadcasts;
+    static ServerStatusMetricField<Counter64> fastupdatesBroadcastsDisplay("fastupdates.broadcasts", &fastupdatesBroadcasts);
+    static Counter64 fastupdatesRanges;
+    static ServerStatusMetricField<Counter64> fastupdatesRangesDisplay("fastupdates.ranges", &fastupdatesRanges);
+
+    // @return true if e is a predicate whose matches are exactly the keys
+    //         in one interval of the field's FieldRange (equality or $gt/$gte/$lt/$lte).
+    static bool isSimpleRangePredicate(const BSONElement &e) {
+        switch (e.type()) {
+            case Array:
+            case RegEx:
+                return false;
+            case Object: {
+                const BSONObj o = e.embeddedObject();
+                if (o.isEmpty() || o.firstElementFieldName()[0] != '$') {
+                    // equality with an embedded object
+                    return true;
+                }
+                for (BSONObjIterator i(o); i.more(); ) {
+                    const BSONElement &op = i.next();
+                    switch (op.getGtLtOp(-1)) {
+                        case BSONObj::GT:
+                        case BSONObj::GTE:
+                        case BSONObj::LT:
+                        case BSONObj::LTE:
+                            if (op.type() == Array || op.type() == RegEx) {
+                                return false;
+                            }
+                            break;
+                        default:
+                            return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return true;
+        }
+    }
+
+    // @return true if the operator-style update described by mods can be applied to
+    //         every document matching query with update messages, without reading any of
+    //         them first: the query is empty or a single primary key interval, and the
+    //         collection has nothing besides the primary key that stores modified fields.
+    static bool canUpdateWithoutReading(Collection *cl, const BSONObj &query, const ModSet &mods) {
+        if (mods.isIndexed() > 0 || mods.hasDynamicArray()) {
+            return false;
+        }
+        if (!cl->updateObjectModsOk() || cl->bulkLoading() ||
+            cl->indexBuildInProgress() || hasClusteringSecondaryKey(cl)) {
+            return false;
+        }
+        // Migrations need the pre-image of each document to decide whether its
+        // update belongs to a chunk being moved.
+        if (shardingState.needShardChunkManager(cl->ns())) {
+            return false;
+        }
+        if (query.isEmpty()) {
+            return true;
+        }
+        const BSONObj &pkPattern = cl->getPKIndex().keyPattern();
+        for (BSONObjIterator i(query); i.more(); ) {
+            const BSONElement &e = i.next();
+            if (!pkPattern.hasField(e.fieldName()) || !isSimpleRangePredicate(e)) {
+                return false;
+            }
+        }
+        FieldRangeSet frs(cl->ns().c_str(), query, true, true);
+        if (!frs.matchPossible()) {
+            return false;
+        }
+        return FieldRangeVector(frs, pkPattern, 1).isSingleInterval();
+    }
+
+    long long updateObjectsWithoutReading(Collection *cl, const BSONObj &query,
+                                          const BSONObj &updateobj, uint64_t flags) {
+        long long n = 0;
+        if (query.isEmpty()) {
+            // One message for the whole collection. Counting the documents it touches
+            // would read every leaf of the primary key, which holds the documents, and
+            // apply the message to all of them, so report the estimated count instead.
+            cl->updateAllObjectsMods(updateobj, flags);
+            n = cl->getPKIndex().getStats().count;
+            fastupdatesBroadcasts.increment(1);
+        } else {
+            // There is no ranged update message, so send one message per primary key,
+            // which the cursor reads without having to materialize any document.
+            FieldRangeSet frs(cl->ns().c_str(), query, true, true);
+            shared_ptr<FieldRangeVector> frv(new FieldRangeVector(frs, cl->getPKIndex().keyPattern(), 1));
+            verify(frv->isSingleInterval());
+            for (shared_ptr<Cursor> c = Cursor::make(cl, cl->getPKIndex(), frv, 0, 1); c->ok(); c->advance()) {
+                cl->updateObjectMods(c->currPK(), updateobj, false, flags);
+                n++;
+            }
+            fastupdatesRanges.increment(1);
+        }
+        cl->notifyOfWriteOp();
+        return n;
+    }
+
     static void updateUsingMods(const char *ns, Collection *cl, const BSONObj &pk, const BSONObj &obj,
                                 const BSONObj &updateobj, shared_ptr<ModSet> mods, MatchDetails* details,
                                 const bool fromMigrate) {
@@ -149,7 +269,10 @@ namespace mongo {
             OplogHelpers::logUpdate(ns, pk, obj, newObj, fromMigrate);
         }
         else {
-            OplogHelpers::logUpdateModsWithRow(ns, pk, obj, updateobj, fromMigrate);
+            // mods that touch no index leave the primary key alone
+            const bool samePK = !modsAreIndexed || cl->isPKHidden() ||
+                                cl->getValidatedPKFromObject(newObj).equal(pk);
+            OplogHelpers::logUpdateModsWithRow(ns, pk, obj, updateobj, samePK, fromMigrate);
         }
     }
 
@@ -279,6 +402,20 @@ namespace mongo {
             }
         }
 
+        // Fast-path for multi updates that touch no indexed field over the whole
+        // collection or a primary key range: send update messages instead of rewriting
+        // every document, and log the mods once instead of each document's pre-image.
+        //
+        // Mods that fail on a document are skipped rather than reported, so this is only
+        // done for users who accepted that trade with --fastupdates.
+        if (isOperatorUpdate && multi && !upsert && !fromMigrate && cmdLine.fastupdates &&
+            canUpdateWithoutReading(cl, patternOrig, *mods)) {
+            const long long n = updateObjectsWithoutReading(cl, patternOrig, updateobj, 0);
+            // must happen after updateObjectsWithoutReading
+            OplogHelpers::logUpdateObjectsMods(ns, patternOrig, updateobj);
+            return UpdateResult(n > 0, 1, n, BSONObj());
+        }
+
         int numModded = 0;
         cc().curop()->debug().nscanned = 0;
         for (shared_ptr<Cursor> c = getOptimizedCursor(ns, patternOrig); c->ok(); ) {
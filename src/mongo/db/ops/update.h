@@ -50,6 +50,21 @@ namespace mongo {
                          const bool fromMigrate,
                          uint64_t flags);
 
+    // Apply the $ operators in updateobj to the document with the given primary key, with an
+    // update message when that maintains every index, and otherwise by reading the document.
+    // Does not handle logging.
+    void updateOneObjectWithMods(Collection *cl, const BSONObj &pk, const BSONObj &updateobj,
+                                 const bool fromMigrate, uint64_t flags);
+
+    // Apply the $ operators in updateobj to every document matching query, which must
+    // be empty or a single primary key interval, without reading the documents. Does not
+    // maintain secondary indexes and does not handle logging.
+    //
+    // @return the number of documents updated, an estimate (from the primary key's
+    //         statistics) when the query is empty, so getLastError's n is approximate.
+    long long updateObjectsWithoutReading(Collection *cl, const BSONObj &query,
+                                          const BSONObj &updateobj, uint64_t flags);
+
     UpdateResult updateObjects(const char *ns,
                                const BSONObj &updateobj, const BSONObj &pattern,
                                const bool upsert, const bool multi,
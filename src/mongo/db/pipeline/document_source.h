@@ -444,6 +444,21 @@ namespace mongo {
          */
         void setSort(const shared_ptr<BSONObj> &pBsonObj);
 
+        /*
+          Record the index hint that was used to create the cursor this
+          wraps, if any.  This gets used for explain output.
+
+          @param pBsonObj the key pattern of the hinted index
+         */
+        void setHint(const shared_ptr<BSONObj> &pBsonObj);
+
+        /*
+          Record whether documents are built from index keys alone, without
+          fetching objects.  The cursor is gone by the time explain runs, so
+          it has to be remembered here.
+         */
+        void setIndexOnly(bool indexOnly) { _indexOnly = indexOnly; }
+
         void setProjection(const BSONObj& projection, const ParsedDeps& deps);
     protected:
         // virtuals from DocumentSource
@@ -458,6 +473,7 @@ namespace mongo {
 
         bool unstarted;
         bool hasCurrent;
+        bool _indexOnly;
         Document pCurrent;
 
         string ns; // namespace
@@ -469,6 +485,7 @@ namespace mongo {
          */
         shared_ptr<BSONObj> pQuery;
         shared_ptr<BSONObj> pSort;
+        shared_ptr<BSONObj> pHint;
         shared_ptr<Projection> _projection; // shared with pClientCursor
         ParsedDeps _dependencies;
 
@@ -595,6 +612,30 @@ namespace mongo {
             BSONElement *pBsonElement,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
+        /**
+          Get the sort order the input would need to arrive in for this
+          group to stream.
+
+          Grouping on a plain field path can emit each group as soon as the
+          key changes if documents with equal keys are adjacent in the
+          input, which holds for input sorted on that field.
+
+          @returns {<field>: 1} if the _id is a field path, otherwise an
+            empty object
+         */
+        BSONObj getStreamingSort() const;
+
+        /**
+          Note the order the input documents arrive in.  If it is led by the
+          group key (either direction), this group will emit each group as
+          its key changes, rather than building all of them first.
+
+          @param sortPattern the sort key pattern of the input
+         */
+        void setInputSort(const BSONObj &sortPattern);
+
+        bool isStreaming() const { return streaming; }
+
         // Virtuals for SplittableDocumentSource
         virtual intrusive_ptr<DocumentSource> getShardSource();
         virtual intrusive_ptr<DocumentSource> getRouterSource();
@@ -641,9 +682,31 @@ namespace mongo {
         vector<intrusive_ptr<Expression> > vpExpression;
 
 
-        Document makeDocument(const GroupsType::iterator &rIter);
+        Document makeDocument(const Value &id,
+                              const vector<intrusive_ptr<Accumulator> > &group);
 
         GroupsType::iterator groupsIterator;
+
+        /* add input to the accumulators of group, creating them if need be */
+        void accumulate(vector<intrusive_ptr<Accumulator> > &group, const Document &input);
+
+        /*
+          Streaming state, used instead of groups when the input is sorted
+          on the group key.  Only the group being built is kept, plus the
+          null group: missing and undefined keys compare equal in sort order
+          but group apart, so null keys may not be contiguous and that group
+          is held back until the input runs out.
+         */
+        bool streamNext();
+        bool streaming;
+        bool inputEof;
+        bool haveStreamGroup;
+        Value streamId;
+        vector<intrusive_ptr<Accumulator> > streamGroup;
+        bool haveNullGroup;
+        vector<intrusive_ptr<Accumulator> > nullGroup;
+        bool haveStreamCurrent;
+        Document streamCurrent;
     };
 
 
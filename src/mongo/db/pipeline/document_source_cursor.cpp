@@ -184,11 +184,15 @@ namespace mongo {
                 pBuilder->append("projection", projectionSpec);
             }
 
+            pBuilder->append("indexOnly", _indexOnly);
+
             // construct query for explain
             BSONObjBuilder queryBuilder;
             queryBuilder.append("$query", *pQuery);
             if (pSort.get())
                 queryBuilder.append("$orderby", *pSort);
+            if (pHint.get())
+                queryBuilder.append("$hint", *pHint);
             queryBuilder.append("$explain", 1);
             Query query(queryBuilder.obj());
 
@@ -207,6 +211,7 @@ namespace mongo {
         DocumentSource(pCtx),
         unstarted(true),
         hasCurrent(false),
+        _indexOnly(false),
         _cursorWithContext( cursorWithContext )
     {}
 
@@ -232,6 +237,10 @@ namespace mongo {
         pSort = pBsonObj;
     }
 
+    void DocumentSourceCursor::setHint(const shared_ptr<BSONObj> &pBsonObj) {
+        pHint = pBsonObj;
+    }
+
     void DocumentSourceCursor::setProjection(const BSONObj& projection, const ParsedDeps& deps) {
         verify(!_projection);
         _projection.reset(new Projection);
@@ -25,6 +25,7 @@
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
 #include "db/pipeline/value.h"
+#include "util/mongoutils/str.h"
 
 namespace mongo {
     const char DocumentSourceGroup::groupName[] = "$group";
@@ -40,6 +41,9 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (streaming)
+            return !haveStreamCurrent;
+
         return (groupsIterator == groups.end());
     }
 
@@ -49,6 +53,16 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (streaming) {
+            verify(haveStreamCurrent);
+            haveStreamCurrent = streamNext();
+            if (!haveStreamCurrent) {
+                dispose();
+                return false;
+            }
+            return true;
+        }
+
         verify(groupsIterator != groups.end());
 
         ++groupsIterator;
@@ -64,13 +78,25 @@ namespace mongo {
         if (!populated)
             populate();
 
-        return makeDocument(groupsIterator);
+        if (streaming) {
+            verify(haveStreamCurrent);
+            return streamCurrent;
+        }
+
+        return makeDocument(groupsIterator->first, groupsIterator->second);
     }
 
     void DocumentSourceGroup::dispose() {
         GroupsType().swap(groups);
         groupsIterator = groups.end();
 
+        haveStreamGroup = false;
+        streamGroup.clear();
+        haveNullGroup = false;
+        nullGroup.clear();
+        haveStreamCurrent = false;
+        streamCurrent = Document();
+
         pSource->dispose();
     }
 
@@ -89,6 +115,11 @@ namespace mongo {
             pA->addToBsonObj(&insides, vFieldName[i], true);
         }
 
+        if (explain && streaming) {
+            // not a valid output field name, so this can't be mistaken for one
+            insides.append("$streaming", true);
+        }
+
         pBuilder->append(groupName, insides.done());
     }
 
@@ -122,7 +153,29 @@ namespace mongo {
         groups(),
         vFieldName(),
         vpAccumulatorFactory(),
-        vpExpression() {
+        vpExpression(),
+        streaming(false),
+        inputEof(true),
+        haveStreamGroup(false),
+        haveNullGroup(false),
+        haveStreamCurrent(false) {
+    }
+
+    BSONObj DocumentSourceGroup::getStreamingSort() const {
+        const ExpressionFieldPath *pFieldPath =
+            dynamic_cast<ExpressionFieldPath *>(pIdExpression.get());
+        if (!pFieldPath)
+            return BSONObj();
+
+        return BSON(pFieldPath->getFieldPath(false) << 1);
+    }
+
+    void DocumentSourceGroup::setInputSort(const BSONObj &sortPattern) {
+        verify(!populated);
+        const BSONObj streamingSort = getStreamingSort();
+        streaming = (!streamingSort.isEmpty() && !sortPattern.isEmpty() &&
+                     mongoutils::str::equals(sortPattern.firstElementFieldName(),
+                                 streamingSort.firstElementFieldName()));
     }
 
     void DocumentSourceGroup::addAccumulator(
@@ -287,10 +340,93 @@ namespace mongo {
         return pGroup;
     }
 
-    void DocumentSourceGroup::populate() {
+    void DocumentSourceGroup::accumulate(vector<intrusive_ptr<Accumulator> > &group,
+                                         const Document &input) {
         const size_t numAccumulators = vpAccumulatorFactory.size();
         dassert(numAccumulators == vpExpression.size());
 
+        if (numAccumulators == 0)
+            return; // we are basically building a set
+
+        if (group.empty()) {
+            /* add the accumulators */
+            group.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                intrusive_ptr<Accumulator> accum = (*vpAccumulatorFactory[i])(pExpCtx);
+                accum->addOperand(vpExpression[i]);
+                group.push_back(accum);
+            }
+        }
+
+        /* tickle all the accumulators for the group we found */
+        dassert(numAccumulators == group.size());
+        for (size_t i = 0; i < numAccumulators; i++)
+            group[i]->evaluate(input);
+    }
+
+    bool DocumentSourceGroup::streamNext() {
+        while (!inputEof) {
+            Document input = pSource->getCurrent();
+            inputEof = !pSource->advance();
+
+            /* get the _id value */
+            Value id = pIdExpression->evaluate(input);
+
+            /* treat missing values the same as NULL SERVER-4674 */
+            if (id.missing())
+                id = Value(BSONNULL);
+
+            if (id.getType() == jstNULL) {
+                haveNullGroup = true;
+                accumulate(nullGroup, input);
+                continue;
+            }
+
+            if (haveStreamGroup && id == streamId) {
+                accumulate(streamGroup, input);
+                continue;
+            }
+
+            /* the key changed, so the group we were building is complete */
+            const bool completed = haveStreamGroup;
+            if (completed)
+                streamCurrent = makeDocument(streamId, streamGroup);
+
+            haveStreamGroup = true;
+            streamId = id;
+            streamGroup.clear();
+            accumulate(streamGroup, input);
+
+            if (completed)
+                return true;
+        }
+
+        if (haveStreamGroup) {
+            streamCurrent = makeDocument(streamId, streamGroup);
+            haveStreamGroup = false;
+            streamGroup.clear();
+            return true;
+        }
+
+        if (haveNullGroup) {
+            streamCurrent = makeDocument(Value(BSONNULL), nullGroup);
+            haveNullGroup = false;
+            nullGroup.clear();
+            return true;
+        }
+
+        return false;
+    }
+
+    void DocumentSourceGroup::populate() {
+        if (streaming) {
+            /* nothing is held but the group being built; get the first one */
+            inputEof = pSource->eof();
+            haveStreamCurrent = streamNext();
+            populated = true;
+            return;
+        }
+
         for (bool hasNext = !pSource->eof(); hasNext; hasNext = pSource->advance()) {
             Document input  = pSource->getCurrent();
 
@@ -305,25 +441,7 @@ namespace mongo {
               Look for the _id value in the map; if it's not there, add a
               new entry with a blank accumulator.
             */
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-
-            if (numAccumulators == 0)
-                continue; // we are basically building a set
-
-            if (group.empty()) {
-                /* add the accumulators */
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    intrusive_ptr<Accumulator> accum = (*vpAccumulatorFactory[i])(pExpCtx);
-                    accum->addOperand(vpExpression[i]);
-                    group.push_back(accum);
-                }
-            }
-
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++)
-                group[i]->evaluate(input);
+            accumulate(groups[id], input);
         }
 
         /* start the group iterator */
@@ -332,17 +450,16 @@ namespace mongo {
     }
 
     Document DocumentSourceGroup::makeDocument(
-        const GroupsType::iterator &rIter) {
-        vector<intrusive_ptr<Accumulator> > *pGroup = &rIter->second;
+        const Value &id, const vector<intrusive_ptr<Accumulator> > &group) {
         const size_t n = vFieldName.size();
         MutableDocument out (1 + n);
 
         /* add the _id field */
-        out.addField("_id", rIter->first);
+        out.addField("_id", id);
 
         /* add the rest of the fields */
         for(size_t i = 0; i < n; ++i) {
-            Value pValue((*pGroup)[i]->getValue());
+            Value pValue(group[i]->getValue());
             if (pValue.missing()) {
                 // we return null in this case so return objects are predictable
                 out.addField(vFieldName[i], Value(BSONNULL));
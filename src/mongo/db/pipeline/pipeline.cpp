@@ -293,6 +293,25 @@ namespace mongo {
             (*iter)->optimize();
         }
 
+        /*
+          A $group fed directly by a $sort on its key can emit each group as
+          soon as the key changes, rather than holding every group in memory
+          until the input runs out.  If the sort is later absorbed into an
+          index cursor, PipelineD::prepareCursorSource checks the index
+          order is the same as the $sort's, and turns streaming off if not.
+         */
+        for (size_t srcn = sources.size(), srci = 1; srci < srcn; ++srci) {
+            DocumentSourceGroup *pGroup =
+                dynamic_cast<DocumentSourceGroup *>(sources[srci].get());
+            DocumentSourceSort *pSort =
+                dynamic_cast<DocumentSourceSort *>(sources[srci - 1].get());
+            if (pGroup && pSort) {
+                BSONObjBuilder sortBuilder;
+                pSort->sortKeyToBson(&sortBuilder, false);
+                pGroup->setInputSort(sortBuilder.obj());
+            }
+        }
+
         return pPipeline;
     }
 
@@ -28,11 +28,78 @@
 #include "mongo/db/instance.h"
 #include "mongo/db/parsed_query.h"
 #include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/projection.h"
 #include "mongo/db/query_optimizer.h"
 
 
 namespace mongo {
 
+    namespace {
+
+        /**
+         * Find a secondary index whose keys hold every field in the projection and every field
+         * the query filters on, so the pipeline can be answered from index keys alone.
+         *
+         * Multikey and sparse indexes are skipped: the first can't cover, and hinting the second
+         * would silently drop documents that lack the indexed fields.
+         *
+         * @return the key pattern to hint, or an empty object if no index covers.
+         */
+        BSONObj coveringIndexHint(Collection *cl, const BSONObj &query, const BSONObj &projection) {
+            if (cl == NULL || cl->indexBuildInProgress()) {
+                return BSONObj();
+            }
+            for (BSONObjIterator it(query); it.more(); ) {
+                if (it.next().fieldName()[0] == '$') {
+                    // $or, $and, $where, ... aren't worth reasoning about here
+                    return BSONObj();
+                }
+            }
+
+            Projection proj;
+            proj.init(projection);
+
+            BSONObj best;
+            for (int i = 0; i < cl->nIndexes(); i++) {
+                IndexDetails &idx = cl->idx(i);
+                if (cl->isPKIndex(idx) || idx.special() || idx.sparse() || cl->isMultikey(i)) {
+                    continue;
+                }
+                const BSONObj keyPattern = idx.keyPattern();
+                bool queryCovered = true;
+                for (BSONObjIterator it(query); queryCovered && it.more(); ) {
+                    queryCovered = keyPattern.hasField(it.next().fieldName());
+                }
+                if (!queryCovered) {
+                    continue;
+                }
+                scoped_ptr<Projection::KeyOnly> keyOnly(proj.checkKey(keyPattern, cl->pkPattern()));
+                if (keyOnly && (best.isEmpty() || keyPattern.nFields() < best.nFields())) {
+                    // prefer the narrowest index, it has the fewest bytes to scan
+                    best = keyPattern;
+                }
+            }
+            return best.getOwned();
+        }
+
+        /**
+         * @return true if an index scan in sortPattern's order returns documents ordered by the
+         *         whole value of the pattern's first field, the order $group compares keys in.
+         *         A multikey index orders a document by one of its array elements instead.
+         */
+        bool indexOrderIsValueOrder(Collection *cl, const BSONObj &sortPattern) {
+            const StringData field = sortPattern.firstElementFieldName();
+            for (int i = 0; i < cl->nIndexes(); i++) {
+                if (cl->isMultikey(i) &&
+                    field == cl->idx(i).keyPattern().firstElementFieldName()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
     void PipelineD::prepareCursorSource(
         const intrusive_ptr<Pipeline> &pPipeline,
         const string &dbName,
@@ -176,6 +243,20 @@ namespace mongo {
                 /* success:  remove the sort from the pipeline */
                 sources.pop_front();
 
+                /*
+                  A $group that followed the $sort streams on its order (see
+                  Pipeline::parseCommand).  Cursors asked for an order never
+                  scanAndOrder, but an index scan only keeps that order for
+                  documents without arrays in the sort field; otherwise the
+                  group has to go back to hashing.
+                 */
+                DocumentSourceGroup *pSortedGroup = sources.empty() ? NULL :
+                    dynamic_cast<DocumentSourceGroup *>(sources.front().get());
+                if (pSortedGroup &&
+                    !indexOrderIsValueOrder(getCollection(fullName), *pSortObj)) {
+                    pSortedGroup->setInputSort(BSONObj());
+                }
+
                 if (pSort->getLimitSrc()) {
                     // need to reinsert coalesced $limit after removing $sort
                     sources.push_front(pSort->getLimitSrc());
@@ -186,6 +267,39 @@ namespace mongo {
             }
         }
 
+        /*
+          With no $sort, a leading $group on a field can still stream if the
+          cursor returns documents in that field's order.  Ask for that
+          order, but only keep the cursor if it is covered: an ordered scan
+          of a secondary index that must fetch every document is more
+          expensive than the table scan we'd use otherwise.
+         */
+        intrusive_ptr<DocumentSourceGroup> pGroup;
+        if (!pSort && haveProjection && !sources.empty() && !cursorWithContext->_chunkMgr) {
+            pGroup = dynamic_cast<DocumentSourceGroup *>(sources.front().get());
+        }
+        if (pGroup) {
+            const BSONObj groupSort = pGroup->getStreamingSort();
+            if (!groupSort.isEmpty()) {
+                const BSONObj queryAndSort = BSON("$query" << *pQueryObj << "$orderby" << groupSort);
+                shared_ptr<ParsedQuery> pq (new ParsedQuery(
+                            fullName.c_str(), 0, 0, QueryOption_NoCursorTimeout, queryAndSort, projection));
+
+                shared_ptr<Cursor> pGroupedCursor(
+                    getOptimizedCursor(
+                        fullName.c_str(), *pQueryObj, groupSort,
+                        QueryPlanSelectionPolicy::any(), pq));
+
+                if (pGroupedCursor && pGroupedCursor->ok() && pGroupedCursor->keyFieldsOnly() &&
+                    indexOrderIsValueOrder(getCollection(fullName), groupSort)) {
+                    pCursor = pGroupedCursor;
+                    pSortObj.reset(new BSONObj(groupSort));
+                    pGroup->setInputSort(groupSort);
+                    initSort = true;
+                }
+            }
+        }
+
         if (!pCursor.get()) {
             shared_ptr<ParsedQuery> pq (new ParsedQuery(
                         fullName.c_str(), 0, 0, QueryOption_NoCursorTimeout, *pQueryObj, projection));
@@ -199,6 +313,38 @@ namespace mongo {
             pCursor = pUnsortedCursor;
         }
 
+        /*
+          If everything the pipeline needs lives in a secondary index, but the
+          optimizer didn't pick one (with no query to match, it will always
+          prefer a table scan), hint the covering index so we can build
+          documents from the index keys and never look up the full object.
+          We can't do this when sharded because we need the whole object to
+          filter out orphans, see DocumentSourceCursor::canUseCoveredIndex().
+         */
+        shared_ptr<BSONObj> pHintObj;
+        if (haveProjection && !initSort && pCursor->ok() && !pCursor->keyFieldsOnly() &&
+            !cursorWithContext->_chunkMgr) {
+            const BSONObj hint = coveringIndexHint(getCollection(fullName), *pQueryObj, projection);
+            if (!hint.isEmpty()) {
+                const BSONObj queryAndHint = BSON("$query" << *pQueryObj << "$hint" << hint);
+                shared_ptr<ParsedQuery> pq (new ParsedQuery(
+                            fullName.c_str(), 0, 0, QueryOption_NoCursorTimeout, queryAndHint, projection));
+
+                shared_ptr<Cursor> pCoveredCursor(
+                    getOptimizedCursor(
+                        fullName.c_str(), *pQueryObj, BSONObj(),
+                        QueryPlanSelectionPolicy::any(), pq));
+
+                if (pCoveredCursor && pCoveredCursor->ok() && pCoveredCursor->keyFieldsOnly()) {
+                    pCursor = pCoveredCursor;
+                    pHintObj.reset(new BSONObj(hint));
+                }
+            }
+        }
+        // keyFieldsOnly() can only be asked of a cursor with a current position
+        const bool indexOnly = (pCursor->ok() && pCursor->keyFieldsOnly() &&
+                                !cursorWithContext->_chunkMgr);
+
         // Now add the Cursor to cursorWithContext.
         cursorWithContext->_cursor.reset
                 ( new ClientCursor( QueryOption_NoCursorTimeout, pCursor, fullName ) );
@@ -219,6 +365,9 @@ namespace mongo {
         pSource->setQuery(pQueryObj);
         if (initSort)
             pSource->setSort(pSortObj);
+        if (pHintObj)
+            pSource->setHint(pHintObj);
+        pSource->setIndexOnly(indexOnly);
 
         if (haveProjection) {
             pSource->setProjection(projection, dependencies);
@@ -19,20 +19,34 @@
 
 #include "mongo/db/query_optimizer_internal.h"
 
+#include "mongo/base/counter.h"
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/index_stats.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/collection.h"
 #include "mongo/db/parsed_query.h"
 #include "mongo/db/query_plan_selection_policy.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/server_parameters.h"
 
 //#define DEBUGQO(x) cout << x << endl;
 #define DEBUGQO(x)
 
 namespace mongo {
 
+    // A candidate plan estimated to scan this many times more keys than the best one is not
+    // raced.  0 races every candidate, as if no index had statistics.
+    MONGO_EXPORT_SERVER_PARAMETER( queryOptimizerPruneFactor, double, 10 );
+    // Below this many keys a plan is cheap enough to race anyway.
+    const double pruneMinKeys = 1000;
+
+    Counter64 queryOptimizerPrunedPlans;
+    ServerStatusMetricField<Counter64> queryOptimizerPrunedPlansDisplay( "queryOptimizer.prunedPlans",
+                                                                          &queryOptimizerPrunedPlans );
+
     // returns an IndexDetails* for a hint, 0 if hint is $natural.
     // hint must not be eoo()
     IndexDetails* parseHint( const BSONElement& hint, Collection *cl ) {
@@ -406,16 +420,66 @@ namespace mongo {
             return;
         }
 
+        pruneCostlyPlans( cl, plans );
+
         for( vector<shared_ptr<QueryPlan> >::const_iterator i = plans.begin(); i != plans.end();
             ++i ) {
             _qps.addCandidatePlan( *i );
-        }        
+        }
         
         // Only add a table-scan plan if no helpful indexes were found.
         if (_qps.nPlans() == 0) {
             _qps.addCandidatePlan( newPlan( cl, -1 ) );
         }
     }
+
+    void QueryPlanGenerator::pruneCostlyPlans( Collection *cl,
+                                               vector<shared_ptr<QueryPlan> >& plans ) const {
+        if ( plans.size() < 2 || queryOptimizerPruneFactor <= 0 ) {
+            return;
+        }
+        // A negative estimate means the index has no statistics, those plans are always kept.
+        // So are plans whose estimate is only an upper bound, but it may still be the best.
+        vector<double> estimates;
+        vector<bool> upperBounds;
+        double best = -1;
+        bool bestNeedsSort = true;
+        for( vector<shared_ptr<QueryPlan> >::const_iterator i = plans.begin(); i != plans.end();
+            ++i ) {
+            shared_ptr<const IndexHistogram> h;
+            if ( (*i)->index() && (*i)->frv() ) {
+                h = getIndexHistogram( cl, *(*i)->index() );
+            }
+            bool upperBound = false;
+            estimates.push_back( h ? h->estimateKeysScanned( *(*i)->frv(), &upperBound ) : -1 );
+            upperBounds.push_back( upperBound );
+            const double e = estimates.back();
+            if ( e >= 0 && ( best < 0 || e < best ) ) {
+                best = e;
+                bestNeedsSort = (*i)->scanAndOrderRequired();
+            }
+        }
+        if ( best < 0 ) {
+            return;
+        }
+
+        vector<shared_ptr<QueryPlan> > kept;
+        for( size_t i = 0; i < plans.size(); ++i ) {
+            const double e = estimates[ i ];
+            // A plan that gives the requested order when the best one doesn't may still win,
+            // with a limit, without scanning its whole range.
+            const bool givesOrder = bestNeedsSort && !plans[ i ]->scanAndOrderRequired();
+            if ( e > pruneMinKeys && e > best * queryOptimizerPruneFactor && !givesOrder &&
+                 !upperBounds[ i ] ) {
+                DEBUGQO( "pruning plan on " << plans[ i ]->indexKey() << ", estimated " << e <<
+                         " keys against " << best );
+                queryOptimizerPrunedPlans.increment();
+                continue;
+            }
+            kept.push_back( plans[ i ] );
+        }
+        plans.swap( kept );
+    }
     
     bool QueryPlanGenerator::addShortCircuitPlan( Collection *cl ) {
         return
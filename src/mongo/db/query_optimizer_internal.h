@@ -303,6 +303,12 @@ namespace mongo {
 
         void addStandardPlans( Collection *cl );
 
+        /**
+         * Drops the candidates that the index statistics (see index_stats.h) estimate would scan
+         * many times more keys than the best candidate, so they don't take part in the race.
+         */
+        void pruneCostlyPlans( Collection *cl, vector<shared_ptr<QueryPlan> >& plans ) const;
+
         bool addCachedPlan( Collection *cl );
 
         shared_ptr<QueryPlan> newPlan( Collection *cl,
@@ -57,6 +57,7 @@
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/parsed_query.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/util/net/message_compressor.h"
 #include "mongo/base/counter.h"
 
 namespace mongo {
@@ -168,6 +169,7 @@ namespace mongo {
             result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
             result.appendNumber("maxMessageSizeBytes", MaxMessageSizeBytes);
             result.appendDate("localTime", jsTime());
+            MessageCompressor::negotiate(cmdObj, ClientBasic::getCurrent()->port(), result);
             return true;
         }
     } cmdismaster;
@@ -17,14 +17,19 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/client.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/crash.h"
+#include "mongo/db/oplog.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/base/counter.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
     void incRBID();
@@ -64,6 +69,20 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> displayOpsApplied( "repl.apply.ops",
                                                                 &opsAppliedStats );
 
+    // Number and time of transactions read ahead by the prefetch threads
+    static TimerStats prefetchStats;
+    static ServerStatusMetricField<TimerStats> displayPrefetched( "repl.prefetch.transactions",
+                                                                 &prefetchStats );
+    // Transactions the applier got to before any prefetch thread did
+    static Counter64 prefetchSkippedStats;
+    static ServerStatusMetricField<Counter64> displayPrefetchSkipped( "repl.prefetch.skipped",
+                                                                      &prefetchSkippedStats );
+
+    static AtomicUInt32 prefetchMode(BackgroundSync::PREFETCH_NONE);
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replPrefetchThreads, int, 4);
+    // bytes of oplog entries the prefetch threads may be ahead of the applier
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchMaxBytes, int, 16 * 1024 * 1024);
+
     bool isRollbackRequired(OplogReader& r, uint64_t *lastTS) {
         string hn = r.conn()->getServerAddress();
         if (!r.more()) {
@@ -101,11 +120,44 @@ namespace mongo {
                                             _currentSyncTarget(NULL),
                                             _opSyncShouldExit(false),
                                             _opSyncInProgress(false),
+                                            _prefetchPosition(0),
+                                            _prefetchBytes(0),
                                             _applierShouldExit(false),
-                                            _applierInProgress(false)
+                                            _applierInProgress(false),
+                                            _prefetchersInProgress(0)
     {
     }
 
+    BackgroundSync::PrefetchMode BackgroundSync::getPrefetchMode() {
+        return static_cast<PrefetchMode>(prefetchMode.load());
+    }
+
+    const char* BackgroundSync::getPrefetchModeName() {
+        switch (getPrefetchMode()) {
+        case PREFETCH_ID_ONLY: return "_id_only";
+        case PREFETCH_ALL: return "all";
+        default: return "none";
+        }
+    }
+
+    Status BackgroundSync::setPrefetchMode(const string& mode) {
+        if (mode == "none") {
+            prefetchMode.store(PREFETCH_NONE);
+        }
+        else if (mode == "_id_only") {
+            prefetchMode.store(PREFETCH_ID_ONLY);
+        }
+        else if (mode == "all") {
+            prefetchMode.store(PREFETCH_ALL);
+        }
+        else {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "unrecognized replIndexPrefetch setting: " << mode
+                                        << ", expected none, _id_only or all");
+        }
+        return Status::OK();
+    }
+
     BackgroundSync* BackgroundSync::get() {
         boost::unique_lock<boost::mutex> lock(s_mutex);
         if (s_instance == NULL && !inShutdown()) {
@@ -136,11 +188,12 @@ namespace mongo {
         // at this point, the opSync thread should be done
         _queueCond.notify_all();
         
-        // now get applier thread to exit
+        // now get applier and prefetch threads to exit
         {
             boost::unique_lock<boost::mutex> lock(_mutex);
             _applierShouldExit = true;
             _queueCond.notify_all();
+            _prefetchCond.notify_all();
         }
         // same reasoning as with _opSyncInProgress above
         log() << "waiting for applier thread to end" << rsLog;
@@ -148,6 +201,10 @@ namespace mongo {
             sleepsecs(1);
             log() << "still waiting for applier thread to end..." << rsLog;
         }
+        while (_prefetchersInProgress > 0) {
+            sleepsecs(1);
+            log() << "still waiting for prefetch threads to end..." << rsLog;
+        }
         log() << "shutdown of bgsync complete" << rsLog;
     }
 
@@ -162,6 +219,9 @@ namespace mongo {
         // as it must finish work that it starts
         // done for github issues #770 and #771
         cc().setGloballyUninterruptible(true);
+        for (int i = 0; i < replPrefetchThreads; i++) {
+            boost::thread prefetcher(boost::bind(&BackgroundSync::prefetchThread, this));
+        }
         applyOpsFromOplog();
         cc().shutdown();
         {
@@ -221,6 +281,12 @@ namespace mongo {
                     _deque.pop_front();
                     bufferCountGauge.increment(-1);
                     bufferSizeGauge.increment(-curr.objsize());
+                    if (_prefetchPosition > 0) {
+                        // curr was within the prefetch window, which now has room
+                        _prefetchPosition--;
+                        _prefetchBytes -= curr.objsize();
+                        _prefetchCond.notify_all();
+                    }
                     
                     // this is a flow control mechanism, with bad numbers
                     // hard coded for now just to get something going.
@@ -245,6 +311,66 @@ namespace mongo {
         }
     }
     
+    void BackgroundSync::prefetchThread() {
+        {
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _prefetchersInProgress++;
+        }
+        Client::initThread("replPrefetch");
+        replLocalAuth();
+        prefetchOpsFromOplog();
+        cc().shutdown();
+        {
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _prefetchersInProgress--;
+        }
+    }
+
+    bool BackgroundSync::nextToPrefetch(BSONObj* entry) {
+        if (getPrefetchMode() == PREFETCH_NONE) {
+            return false;
+        }
+        // the applier is already working on the front entry, reading it
+        // in as well would only compete with it
+        if (_prefetchPosition == 0 && _deque.size() > 0) {
+            _prefetchPosition = 1;
+            _prefetchBytes += _deque.front().objsize();
+            prefetchSkippedStats.increment();
+        }
+        if (_prefetchPosition >= _deque.size() || _prefetchBytes >= replPrefetchMaxBytes) {
+            return false;
+        }
+        *entry = _deque[_prefetchPosition++];
+        _prefetchBytes += entry->objsize();
+        return true;
+    }
+
+    void BackgroundSync::prefetchOpsFromOplog() {
+        while (1) {
+            BSONObj curr;
+            bool secondaryIndexes;
+            {
+                boost::unique_lock<boost::mutex> lck(_mutex);
+                while (!_applierShouldExit && !nextToPrefetch(&curr)) {
+                    _prefetchCond.wait(lck);
+                }
+                if (_applierShouldExit) {
+                    return;
+                }
+                secondaryIndexes = getPrefetchMode() == PREFETCH_ALL;
+            }
+            // prefetching is only an optimization, whatever goes wrong
+            // here the applier will run into and handle itself
+            try {
+                TimerHolder timer(&prefetchStats);
+                prefetchTransactionFromOplog(curr, secondaryIndexes);
+            }
+            catch (std::exception& e) {
+                LOG(2) << "exception prefetching transaction from oplog: " << e.what() << rsLog;
+            }
+        }
+    }
+
     void BackgroundSync::producerThread() {
         {
             boost::unique_lock<boost::mutex> lock(_mutex);
@@ -479,6 +605,7 @@ namespace mongo {
                         _deque.push_back(o);
                         bufferCountGauge.increment();
                         bufferSizeGauge.increment(o.objsize());
+                        _prefetchCond.notify_one();
                         // this is a flow control mechanism, with bad numbers
                         // hard coded for now just to get something going.
                         // If the opSync thread notices that we have over 20000
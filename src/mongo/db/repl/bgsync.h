@@ -19,6 +19,7 @@
 
 #include <boost/thread/mutex.hpp>
 
+#include "mongo/base/status.h"
 #include "mongo/util/queue.h"
 #include "mongo/db/oplogreader.h"
 #include "mongo/db/repl/rs.h"
@@ -55,6 +56,10 @@ namespace mongo {
         // signals when the applier has nothing to do
         boost::condition_variable _queueDone;
 
+        // signals the prefetch threads that there may be entries for them
+        // to read ahead, or room in their window to do so
+        boost::condition_variable _prefetchCond;
+
         // boolean that states whether we should actively be 
         // trying to read data from another machine and apply it
         // to our opLog. When we are a secondary, this should be true.
@@ -73,6 +78,16 @@ namespace mongo {
         // to _queueCounter.numElems
         std::deque<BSONObj> _deque;
 
+        // The prefetch threads read in the rows and index keys that queued
+        // transactions will touch, ahead of the applier. Entries
+        // [0, _prefetchPosition) of _deque have been taken by a prefetch
+        // thread, or skipped because the applier already had them, and
+        // _prefetchBytes is their total size. Prefetching stops while that
+        // is over replPrefetchMaxBytes, so that what is read ahead is still
+        // in the cache when the applier gets there.
+        size_t _prefetchPosition;
+        long long _prefetchBytes;
+
         // these variables are relevant to shutdown
 
         // states if opSync should exit, because we are shutting down
@@ -89,6 +104,8 @@ namespace mongo {
         bool _applierShouldExit;
         // variable that states if the applier thread is alive doing anything
         bool _applierInProgress;
+        // number of prefetch threads that are alive
+        int _prefetchersInProgress;
 
         BackgroundSync();
         BackgroundSync(const BackgroundSync& s);
@@ -110,7 +127,27 @@ namespace mongo {
 
         bool hasCursor();
         void verifySettled();
+
+        void prefetchThread();
+        void prefetchOpsFromOplog();
+        // called with _mutex held, takes the next entry to prefetch if the
+        // window allows it
+        bool nextToPrefetch(BSONObj* entry);
     public:
+        // what the prefetch threads read ahead of the applier,
+        // set with replIndexPrefetch
+        enum PrefetchMode {
+            PREFETCH_NONE = 0,
+            // the primary key rows only
+            PREFETCH_ID_ONLY,
+            // the primary key rows and the secondary index keys
+            PREFETCH_ALL
+        };
+        static PrefetchMode getPrefetchMode();
+        static const char* getPrefetchModeName();
+        // @param mode one of "none", "_id_only" or "all"
+        static Status setPrefetchMode(const string& mode);
+
         static BackgroundSync* get();
         void shutdown();
         virtual ~BackgroundSync() {}
@@ -1281,7 +1281,7 @@ namespace mongo {
         const char * _value() {
             if (!theReplSet)
                 return "uninitialized";
-            return "none";
+            return BackgroundSync::getPrefetchModeName();
         }
 
         virtual void append( BSONObjBuilder& b, const string& name ) {
@@ -1298,7 +1298,7 @@ namespace mongo {
         }
 
         virtual Status setFromString( const string& prefetch ) {
-            return Status( ErrorCodes::IllegalOperation, "replIndexPrefetch is a deprecated parameter" );
+            return BackgroundSync::setPrefetchMode( prefetch );
         }
 
     } replIndexPrefetch;
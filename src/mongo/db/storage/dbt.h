@@ -65,6 +65,14 @@ namespace mongo {
             dbt_array->size++;
         }
 
+        // Points an empty dbt_array at a single DBT owned by the caller, which must outlive
+        // every use of the array. DBTArrays never frees an array with no capacity.
+        inline void dbt_array_borrow_single(DBT_ARRAY *dbt_array, DBT *dbt) {
+            verify(dbt_array->capacity == 0 && dbt_array->dbts == NULL);
+            dbt_array->dbts = dbt;
+            dbt_array->size = 1;
+        }
+
         // Manages an array of DBT_ARRAYs and the lifetime of the objects they store.
         //
         // It may be a good idea to cache two of these in the client object so
@@ -87,7 +95,7 @@ namespace mongo {
                             dbt->data = NULL;
                         }
                     }
-                    if (dbt_array->dbts != NULL) {
+                    if (dbt_array->capacity > 0 && dbt_array->dbts != NULL) {
                         free(dbt_array->dbts);
                         dbt_array->dbts = NULL;
                     }
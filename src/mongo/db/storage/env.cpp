@@ -106,8 +106,13 @@ namespace mongo {
                 verify(key != NULL && extra != NULL && extra->data != NULL);
                 const BSONObj msg(static_cast<char *>(extra->data));
                 const char* type = msg[ "t" ].valuestrsafe();
-                // right now, we only support one type of message, an updateMods
-                uassert(17313, str::stream() << "unknown type of update message, type: " << type << " message: " << msg, strcmp(type, "u") == 0);
+                // "u" is an updateMods sent to one row, "b" is an updateMods broadcast to every row
+                const bool broadcast = strcmp(type, "b") == 0;
+                uassert(17313, str::stream() << "unknown type of update message, type: " << type << " message: " << msg, broadcast || strcmp(type, "u") == 0);
+                if (broadcast && (old_val == NULL || old_val->data == NULL)) {
+                    // A broadcast visits rows that are deleted as of this message, leave them deleted.
+                    return 0;
+                }
                 const BSONObj updateObj = msg["o"].Obj();
                 runUpdateMods(db, key, old_val, updateObj, set_val, set_extra);
                 return 0;
@@ -158,7 +163,17 @@ namespace mongo {
                 // because the one and only key is src_key
                 verify(dest_db != src_db);
 
-                // Generate keys for a secondary index.
+                // Generate keys for a secondary index, without a BSONObjSet
+                // when the object has only one key.
+                StackBufBuilder singleKey;
+                bool generated;
+                if (descriptor.appendSingleKey(obj, pk, singleKey, &generated)) {
+                    dbt_array_clear_and_resize(dest_keys, generated ? 1 : 0);
+                    if (generated) {
+                        dbt_array_push(dest_keys, singleKey.buf(), singleKey.len());
+                    }
+                    return 0;
+                }
                 BSONObjSet keys;
                 descriptor.generateKeys(obj, keys);
                 dbt_array_clear_and_resize(dest_keys, keys.size());
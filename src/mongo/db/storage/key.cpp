@@ -93,6 +93,104 @@ namespace mongo {
             dassert( (*_keyData & cNOTUSED) == 0 );
         }
 
+        // Append the compact format of one key element, with the given HASMORE bits.
+        // @return false if the element has no compact format, having appended nothing.
+        template <class Builder>
+        static bool appendCompactElement(Builder &b, const BSONElement &e, unsigned char bits) {
+            switch( e.type() ) { 
+            case MinKey:
+                b.appendUChar(cminkey|bits);
+                break;
+            case jstNULL:
+                b.appendUChar(cnull|bits);
+                break;
+            case MaxKey:
+                b.appendUChar(cmaxkey|bits);
+                break;
+            case Bool:
+                b.appendUChar( (e.boolean()?ctrue:cfalse) | bits );
+                break;
+            case jstOID:
+                b.appendUChar(coid|bits);
+                b.appendBuf(&e.__oid(), sizeof(OID));
+                break;
+            case BinData:
+                {
+                    int t = e.binDataType();
+                    // 0-7 and 0x80 to 0x87 are supported by KeyV1
+                    if( (t & 0x78) == 0 && t != ByteArrayDeprecated ) {
+                        int len;
+                        const char * d = e.binData(len);
+                        if( len <= BinDataLenMax ) {
+                            int code = BinDataLengthToCode[len];
+                            if( code >= 0 ) {
+                                if( t >= 128 )
+                                    t = (t-128) | 0x08;
+                                dassert( (code&t) == 0 );
+                                b.appendUChar( cbindata|bits );
+                                b.appendUChar( code | t );
+                                b.appendBuf(d, len);
+                                break;
+                            }
+                        }
+                    }
+                    return false;
+                }
+            case Date:
+                b.appendUChar(cdate|bits);
+                b.appendStruct(e.date());
+                break;
+            case String:
+                {
+                    // note we do not store the terminating null, to save space.
+                    unsigned x = (unsigned) e.valuestrsize() - 1;
+                    if( x > 255 ) { 
+                        return false;
+                    }
+                    b.appendUChar(cstring|bits);
+                    b.appendUChar(x);
+                    b.appendBuf(e.valuestr(), x);
+                    break;
+                }
+            case NumberInt:
+                b.appendUChar(cint|bits);
+                b.appendNum((double) e._numberInt());
+                break;
+            case NumberLong:
+                {
+                    long long n = e._numberLong();
+                    long long m = 2LL << 52;
+                    DEV {
+                        long long d = m-1;
+                        verify( ((long long) ((double) -d)) == -d );
+                    }
+                    if( n >= m || n <= -m ) {
+                        // can't represent exactly as a double
+                        b.appendUChar(cint64|bits);
+                        b.appendNum(n);
+                    } else {
+                        b.appendUChar(clong|bits);
+                        b.appendNum((double) n);
+                    }
+                    break;
+                }
+            case NumberDouble:
+                {
+                    double d = e._numberDouble();
+                    if( isNaN(d) ) {
+                        return false;
+                    }
+                    b.appendUChar(cdouble|bits);
+                    b.appendNum(d);
+                    break;
+                }
+            default:
+                // if other types involved, store as traditional BSON
+                return false;
+            }
+            return true;
+        }
+
         // fromBSON to KeyV1 format
         KeyV1Owned::KeyV1Owned(const BSONObj& obj) {
             BSONObj::iterator i(obj);
@@ -101,98 +199,7 @@ namespace mongo {
                 BSONElement e = i.next();
                 if( i.more() )
                     bits |= cHASMORE;
-                switch( e.type() ) { 
-                case MinKey:
-                    b.appendUChar(cminkey|bits);
-                    break;
-                case jstNULL:
-                    b.appendUChar(cnull|bits);
-                    break;
-                case MaxKey:
-                    b.appendUChar(cmaxkey|bits);
-                    break;
-                case Bool:
-                    b.appendUChar( (e.boolean()?ctrue:cfalse) | bits );
-                    break;
-                case jstOID:
-                    b.appendUChar(coid|bits);
-                    b.appendBuf(&e.__oid(), sizeof(OID));
-                    break;
-                case BinData:
-                    {
-                        int t = e.binDataType();
-                        // 0-7 and 0x80 to 0x87 are supported by KeyV1
-                        if( (t & 0x78) == 0 && t != ByteArrayDeprecated ) {
-                            int len;
-                            const char * d = e.binData(len);
-                            if( len <= BinDataLenMax ) {
-                                int code = BinDataLengthToCode[len];
-                                if( code >= 0 ) {
-                                    if( t >= 128 )
-                                        t = (t-128) | 0x08;
-                                    dassert( (code&t) == 0 );
-                                    b.appendUChar( cbindata|bits );
-                                    b.appendUChar( code | t );
-                                    b.appendBuf(d, len);
-                                    break;
-                                }
-                            }
-                        }
-                        traditional(obj);
-                        return;
-                    }
-                case Date:
-                    b.appendUChar(cdate|bits);
-                    b.appendStruct(e.date());
-                    break;
-                case String:
-                    {
-                        b.appendUChar(cstring|bits);
-                        // note we do not store the terminating null, to save space.
-                        unsigned x = (unsigned) e.valuestrsize() - 1;
-                        if( x > 255 ) { 
-                            traditional(obj);
-                            return;
-                        }
-                        b.appendUChar(x);
-                        b.appendBuf(e.valuestr(), x);
-                        break;
-                    }
-                case NumberInt:
-                    b.appendUChar(cint|bits);
-                    b.appendNum((double) e._numberInt());
-                    break;
-                case NumberLong:
-                    {
-                        long long n = e._numberLong();
-                        long long m = 2LL << 52;
-                        DEV {
-                            long long d = m-1;
-                            verify( ((long long) ((double) -d)) == -d );
-                        }
-                        if( n >= m || n <= -m ) {
-                            // can't represent exactly as a double
-                            b.appendUChar(cint64|bits);
-                            b.appendNum(n);
-                        } else {
-                            b.appendUChar(clong|bits);
-                            b.appendNum((double) n);
-                        }
-                        break;
-                    }
-                case NumberDouble:
-                    {
-                        double d = e._numberDouble();
-                        if( isNaN(d) ) {
-                            traditional(obj);
-                            return;
-                        }
-                        b.appendUChar(cdouble|bits);
-                        b.appendNum(d);
-                        break;
-                    }
-                default:
-                    // if other types involved, store as traditional BSON
+                if( !appendCompactElement(b, e, bits) ) {
                     traditional(obj);
                     return;
                 }
@@ -205,6 +212,42 @@ namespace mongo {
             dassert( (*_keyData & cNOTUSED) == 0 );
         }
 
+        template <class Builder>
+        void KeyV1::_appendKey(Builder &b, const BSONElement *elts, int n) {
+            dassert( n > 0 );
+            const int start = b.len();
+            for( int i = 0; i < n; i++ ) {
+                if( !appendCompactElement(b, elts[i], i + 1 < n ? cHASMORE : 0) ) {
+                    // Same as traditional(): the sentinel, then { "": elts[0], ... } built by hand
+                    b.setlen(start);
+                    b.appendUChar(IsBSON);
+                    const int objStart = b.len();
+                    b.appendNum((int) 0);
+                    for( int j = 0; j < n; j++ ) {
+                        b.appendNum((char) elts[j].type());
+                        b.appendChar('\0');
+                        b.appendBuf(elts[j].value(), elts[j].valuesize());
+                    }
+                    b.appendNum((char) EOO);
+                    const int objSize = b.len() - objStart;
+                    memcpy(b.buf() + objStart, &objSize, sizeof(int));
+                    break;
+                }
+            }
+            DEV {
+                const KeyV1 k(b.buf() + start);
+                dassert( b.len() - start == k.dataSize() );
+            }
+        }
+
+        void KeyV1::appendKey(BufBuilder &b, const BSONElement *elts, int n) {
+            _appendKey(b, elts, n);
+        }
+
+        void KeyV1::appendKey(StackBufBuilder &b, const BSONElement *elts, int n) {
+            _appendKey(b, elts, n);
+        }
+
         BSONObj KeyV1::toBson(BufBuilder &bb) const { 
             verify( _keyData != 0 );
             if( !isCompactFormat() )
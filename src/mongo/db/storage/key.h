@@ -85,6 +85,12 @@ namespace mongo {
             bool isCompactFormat() const { return *_keyData != IsBSON; }
 
             bool isValid() const { return _keyData > (const unsigned char*)1; }
+
+            /** append to b the key made of the values of elts[0..n), in exactly the format
+                KeyV1Owned would give the BSONObj { "": elts[0], ..., "": elts[n-1] },
+                without building that BSONObj first */
+            static void appendKey(BufBuilder &b, const BSONElement *elts, int n);
+            static void appendKey(StackBufBuilder &b, const BSONElement *elts, int n);
         protected:
             enum { IsBSON = 0xff };
             const unsigned char *_keyData;
@@ -94,6 +100,8 @@ namespace mongo {
             }
         private:
             int compareHybrid(const KeyV1& right, const Ordering& order) const;
+            template <class Builder>
+            static void _appendKey(Builder &b, const BSONElement *elts, int n);
         };
 
         class KeyV1Owned : public KeyV1 {
@@ -23,9 +23,12 @@
 
 #include "mongo/base/counter.h"
 #include "mongo/db/commands/fsync.h"
+#include "mongo/db/collection.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/cursor.h"
 #include "mongo/db/databaseholder.h"
 #include "mongo/db/instance.h"
+#include "mongo/db/oplog_helpers.h"
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/replutil.h"
 #include "mongo/db/server_parameters.h"
@@ -35,11 +38,19 @@ namespace mongo {
 
     Counter64 ttlPasses;
     Counter64 ttlDeletedDocuments;
+    Counter64 ttlDroppedPartitions;
+    Counter64 ttlAddedPartitions;
 
     ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
     ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments", &ttlDeletedDocuments);
+    ServerStatusMetricField<Counter64> ttlDroppedPartitionsDisplay("ttl.droppedPartitions", &ttlDroppedPartitions);
+    ServerStatusMetricField<Counter64> ttlAddedPartitionsDisplay("ttl.addedPartitions", &ttlAddedPartitions);
 
     MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorEnabled, bool, true );
+    // For partitioned collections expired by dropping partitions, how many partitions we add
+    // per expireAfterSeconds period.  More partitions means documents outlive their expiry by
+    // less, at the cost of more dictionaries.
+    MONGO_EXPORT_SERVER_PARAMETER( ttlPartitionsPerExpirePeriod, int, 24 );
     
     class TTLMonitor : public BackgroundJob {
     public:
@@ -95,6 +106,11 @@ namespace mongo {
                 }
                 
                 LOG(1) << "TTL: " << key << " \t " << query << endl;
+
+                // only do deletes if on master
+                if ( isMaster && doTTLForPartitionedCollection( dbName , idx ) ) {
+                    continue;
+                }
                 
                 long long n = 0;
                 {
@@ -124,6 +140,158 @@ namespace mongo {
             }
         }
 
+        /**
+         * TTL only expires dates, and everything else that can be in partition 0 sorts before
+         * them, so partition 0 may only be dropped if its smallest key is a date.
+         */
+        static bool firstPartitionAllDates( PartitionedCollection *pc ) {
+            shared_ptr<Cursor> c(Cursor::make(pc->getPartition(0).get(), 1, false));
+            return !c->ok() || c->currPK().firstElement().type() == Date;
+        }
+
+        /**
+         * Drops the expired partition id, which should be partition 0, after checking again,
+         * under the same write lock that dropping it takes, that it still is partition 0 and
+         * that it has nothing but dates, since an insert may have added something else to it
+         * since it was found expired.  Logged for replication like the dropPartition command.
+         *
+         * @return false if the partition was not dropped.
+         */
+        bool dropExpiredPartition( const string& dbName , const string& ns , long long id ) {
+            LOCK_REASON(lockReason, "ttl: dropping expired partition");
+            Client::WriteContext ctx(ns, lockReason);
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            if (!isMasterNs(ns.c_str())) {
+                return false;
+            }
+            Collection *cl = getCollection(ns);
+            if (!cl || !cl->isPartitioned()) {
+                return false;
+            }
+            PartitionedCollection *pc = cl->as<PartitionedCollection>();
+            if (pc->numPartitions() < 2 || pc->getPartitionMetadata(0)["_id"].numberLong() != id ||
+                !firstPartitionAllDates(pc)) {
+                return false;
+            }
+            pc->dropPartition(id);
+            const string cmdNs = dbName + ".$cmd";
+            OplogHelpers::logCommand(cmdNs.c_str(),
+                                     BSON("dropPartition" << nsToCollectionSubstring(ns) << "id" << id));
+            transaction.commit();
+            return true;
+        }
+
+        /**
+         * Partitioned collections whose primary key starts with the TTL field expire data by
+         * dropping whole partitions, which is just a metadata operation, instead of deleting
+         * documents one at a time.  Partition i holds keys in (pivot[i-1], pivot[i]], so once
+         * pivot[i] is a date older than the cutoff, everything in it has expired.  Documents are
+         * therefore removed at partition granularity, which is why we also add partitions on a
+         * schedule (every expireAfterSeconds / ttlPartitionsPerExpirePeriod), like we do for the
+         * oplog.
+         *
+         * Partitions are added with the addPartition command, so that is locked and replicated
+         * the same way as when a user runs it.  Partitions are dropped by dropExpiredPartition(),
+         * which checks that they can be dropped under the same lock it drops them with.
+         *
+         * @return false if the collection can't be expired this way, or not all of it, and the
+         *         caller should fall back to deleting documents.
+         */
+        bool doTTLForPartitionedCollection( const string& dbName , const BSONObj& idx ) {
+            const string ns = idx["ns"].String();
+            const BSONElement keyElt = idx["key"].Obj().firstElement();
+            const long long expireMillis = 1000 * idx[secondsExpireField].numberLong();
+            const long long cutoff = curTimeMillis64() - expireMillis;
+
+            vector<long long> expiredPartitions;
+            bool shouldAddPartition = false;
+            // whether there may be expired documents that dropping partitions can't (or didn't) get to
+            bool fallBackToDeletes = false;
+            {
+                LOCK_REASON(lockReason, "ttl: checking for expired partitions");
+                Client::ReadContext ctx(ns, lockReason);
+                Client::Transaction transaction(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+                Collection *cl = getCollection(ns);
+                if (!cl || !cl->isPartitioned()) {
+                    return false;
+                }
+                const BSONElement pkElt = cl->getPKIndex().keyPattern().firstElement();
+                if (!keyElt.isNumber() || keyElt.numberInt() != 1 ||
+                    !pkElt.isNumber() || pkElt.numberInt() != 1 ||
+                    strcmp(pkElt.fieldName(), keyElt.fieldName()) != 0) {
+                    // not partitioned by the TTL field
+                    return false;
+                }
+
+                PartitionedCollection *pc = cl->as<PartitionedCollection>();
+                uint64_t numPartitions;
+                BSONArray partitionArray;
+                pc->getPartitionInfo(&numPartitions, &partitionArray);
+                vector<BSONElement> partitions;
+                partitionArray.elems(partitions);
+                verify(partitions.size() == numPartitions && numPartitions > 0);
+
+                // Checked again by dropExpiredPartition(), this saves taking the write lock.
+                if (!firstPartitionAllDates(pc)) {
+                    transaction.commit();
+                    return false;
+                }
+
+                // The last partition is unbounded, it can never be dropped.
+                for (uint64_t i = 0; i + 1 < numPartitions; i++) {
+                    BSONObj meta = partitions[i].Obj();
+                    BSONElement pivot = meta["max"].Obj().firstElement();
+                    if (pivot.type() != Date) {
+                        fallBackToDeletes = true;
+                        break;
+                    }
+                    if ((long long) pivot.date().millis >= cutoff) {
+                        break;
+                    }
+                    expiredPartitions.push_back(meta["_id"].numberLong());
+                }
+
+                const long long period = std::max(expireMillis / std::max(ttlPartitionsPerExpirePeriod, 1), 60 * 1000LL);
+                BSONElement createTime = partitions[numPartitions - 1].Obj()["createTime"];
+                shouldAddPartition = createTime.type() == Date &&
+                                     (long long) createTime.date().millis + period <= (long long) curTimeMillis64();
+                transaction.commit();
+            }
+
+            const string coll = nsToCollectionSubstring(ns).toString();
+            for (vector<long long>::const_iterator it = expiredPartitions.begin(); it != expiredPartitions.end(); ++it) {
+                bool dropped = false;
+                try {
+                    dropped = dropExpiredPartition(dbName, ns, *it);
+                }
+                catch (DBException &e) {
+                    warning() << "TTL: failed to drop expired partition " << *it << " of " << ns << ": " << e.toString() << endl;
+                }
+                if (!dropped) {
+                    // Someone else changed the partitions, or partition 0 got something other
+                    // than a date, so delete what has expired instead and look again next pass.
+                    LOG(1) << "\tTTL did not drop expired partition " << *it << " of " << ns << endl;
+                    fallBackToDeletes = true;
+                    break;
+                }
+                ttlDroppedPartitions.increment();
+                LOG(1) << "\tTTL dropped partition " << *it << " of " << ns << endl;
+            }
+
+            if (shouldAddPartition) {
+                BSONObj res;
+                if (db.runCommand(dbName, BSON("addPartition" << coll), res)) {
+                    ttlAddedPartitions.increment();
+                    LOG(1) << "\tTTL added partition to " << ns << endl;
+                }
+                else {
+                    // Most likely the last partition is still empty, so there's nothing to cap it with.
+                    LOG(1) << "\tTTL could not add partition to " << ns << ": " << res << endl;
+                }
+            }
+            return !fallBackToDeletes;
+        }
+
         virtual void run() {
             Client::initThread( name().c_str() );
 
@@ -30,6 +30,7 @@ namespace mongo {
 
     void TxnCompleteHooksImpl::noteTxnCompletedInserts(const string &ns, const BSONObj &minPK,
                                          long long nDelta, long long sizeDelta,
+                                         const CappedPartitionDeltas &partitionDeltas,
                                          bool committed) {
         LOCK_REASON(lockReason, "txn: noting completed inserts");
         Lock::DBRead lk(ns, lockReason);
@@ -45,11 +46,11 @@ namespace mongo {
             CollectionMap *cm = collectionMap(ns);
             Collection *cl = cm->find_ns(ns);
             if (cl != NULL && cl->isCapped()) {
-                CappedCollection *cappedCl = cl->as<CappedCollection>();
+                CappedCollectionInterface *cappedCl = cl->as<CappedCollectionInterface>();
                 if (committed) {
                     cappedCl->noteCommit(minPK, nDelta, sizeDelta);
                 } else {
-                    cappedCl->noteAbort(minPK, nDelta, sizeDelta);
+                    cappedCl->noteAbort(minPK, nDelta, sizeDelta, partitionDeltas);
                 }
             }
         }
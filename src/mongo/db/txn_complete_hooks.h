@@ -28,6 +28,8 @@ namespace mongo {
         virtual ~TxnCompleteHooks() { }
         virtual void noteTxnCompletedInserts(const string &ns, const BSONObj &minPK,
                                              long long nDelta, long long sizeDelta,
+                                             // a CappedPartitionDeltas, which is in txn_context.h
+                                             const map<uint64_t, pair<long long, long long> > &partitionDeltas,
                                              bool committed) {
             assertNotImplemented();
         }
@@ -51,6 +53,7 @@ namespace mongo {
     public:
         void noteTxnCompletedInserts(const string &ns, const BSONObj &minPK,
                                      long long nDelta, long long sizeDelta,
+                                     const map<uint64_t, pair<long long, long long> > &partitionDeltas,
                                      bool committed);
 
         void noteTxnAbortedFileOps(const set<string> &namespaces, const set<string> &dbs);
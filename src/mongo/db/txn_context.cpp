@@ -312,7 +312,8 @@ namespace mongo {
         for (ContextMap::const_iterator it = _map.begin(); it != _map.end(); it++) {
             const string &ns = it->first;
             const Context &c = it->second;
-            _completeHooks->noteTxnCompletedInserts(ns, c.minPK, c.nDelta, c.sizeDelta, committed);
+            _completeHooks->noteTxnCompletedInserts(ns, c.minPK, c.nDelta, c.sizeDelta,
+                                                    c.partitionDeltas, committed);
         }
     }
 
@@ -336,6 +337,12 @@ namespace mongo {
             }
             parentContext.nDelta += c.nDelta;
             parentContext.sizeDelta += c.sizeDelta;
+            for (CappedPartitionDeltas::const_iterator p = c.partitionDeltas.begin();
+                 p != c.partitionDeltas.end(); ++p) {
+                pair<long long, long long> &parentDeltas = parentContext.partitionDeltas[p->first];
+                parentDeltas.first += p->second.first;
+                parentDeltas.second += p->second.second;
+            }
         }
     }
 
@@ -355,6 +362,12 @@ namespace mongo {
         c.sizeDelta -= size;
     }
 
+    void CappedCollectionRollback::notePartitionChange(const string &ns, uint64_t partitionId, long long size) {
+        pair<long long, long long> &deltas = _map[ns].partitionDeltas[partitionId];
+        deltas.first += size < 0 ? -1 : 1;
+        deltas.second += size;
+    }
+
     bool CappedCollectionRollback::hasNotedInsert(const string &ns) {
         const Context &c = _map[ns];
         return !c.minPK.isEmpty();
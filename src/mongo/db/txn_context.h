@@ -51,6 +51,10 @@ namespace mongo {
     void setTxnGTIDManager(GTIDManager* m);
     void setTxnCompleteHooks(TxnCompleteHooks *hooks);
 
+    // Objects and bytes a transaction inserted (less those it deleted) in each partition, by
+    // partition id, of a partitioned capped collection.
+    typedef map<uint64_t, pair<long long, long long> > CappedPartitionDeltas;
+
     // Class to handle rollback of in-memory stats for capped collections.
     class CappedCollectionRollback : boost::noncopyable {
     public:
@@ -67,6 +71,10 @@ namespace mongo {
 
         void noteDelete(const string &ns, const BSONObj &pk, long long size);
 
+        // For a partitioned capped collection, also note which partition the object went into
+        // or came out of.  A negative size is a delete.
+        void notePartitionChange(const string &ns, uint64_t partitionId, long long size);
+
         bool hasNotedInsert(const string &ns);
 
     private:
@@ -77,6 +85,7 @@ namespace mongo {
             BSONObj minPK;
             long long nDelta;
             long long sizeDelta;
+            CappedPartitionDeltas partitionDeltas;
         };
         typedef map<string, Context> ContextMap;
         ContextMap _map;
@@ -0,0 +1,77 @@
+// benchmark.h : Benchmark registration for the dbbench performance suite.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace mongo {
+    namespace dbbench {
+
+        // context string for the locks macro benchmarks take
+        static const std::string EMPTY_STRING("");
+
+        /**
+         * A benchmark measures the cost of one operation on a hot path.  Subclasses are
+         * registered by constructing a static instance of them.
+         *
+         * For each trial the framework calls setUp(), then calls run() repeatedly until the
+         * trial's time budget is spent, then calls tearDown().  run() does one batch of work and
+         * returns the number of operations it did, so that per-operation times don't include
+         * the framework's own overhead.  Anything run() needs that shouldn't be timed belongs in
+         * setUp().
+         */
+        class Benchmark : boost::noncopyable {
+        public:
+            enum Kind {
+                // exercises one class in memory, no storage
+                MICRO,
+                // goes through the storage layer, transactions and locks
+                MACRO
+            };
+
+            Benchmark(const std::string &name, Kind kind);
+            virtual ~Benchmark() {}
+
+            const std::string &name() const { return _name; }
+            Kind kind() const { return _kind; }
+            static const char *kindName(Kind kind) { return kind == MICRO ? "micro" : "macro"; }
+
+            virtual void setUp() {}
+            virtual long long run() = 0;
+            virtual void tearDown() {}
+
+            /** @return every registered benchmark, sorted by name */
+            static std::vector<Benchmark *> all();
+
+        private:
+            const std::string _name;
+            const Kind _kind;
+        };
+
+        /**
+         * @return a pseudorandom number in [0, max).  The sequence restarts from --seed before
+         *         each trial, so every trial of a benchmark sees the same data.
+         */
+        int nextRandom(int max);
+
+    } // namespace dbbench
+} // namespace mongo
@@ -0,0 +1,30 @@
+// dbbench.cpp : Runs the storage and query layer benchmarks.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include "mongo/base/initializer.h"
+#include "mongo/dbbench/framework.h"
+#include "mongo/util/exception_filter_win32.h"
+
+int main( int argc, char** argv, char** envp ) {
+    static mongo::StaticObserver staticObserver;
+    mongo::setWindowsUnhandledExceptionFilter();
+    mongo::runGlobalInitializersOrDie(argc, argv, envp);
+    _exit(mongo::dbbench::runDbBench( argc, argv, "/tmp/dbbench" ));
+}
@@ -0,0 +1,351 @@
+// framework.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include "mongo/dbbench/framework.h"
+
+#ifndef _WIN32
+#include <sys/file.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/txn_complete_hooks.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/dbbench/benchmark.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/timer.h"
+#include "mongo/util/version.h"
+
+namespace po = boost::program_options;
+
+namespace mongo {
+
+    CmdLine cmdLine;
+    extern storage::UpdateCallback _storageUpdateCallback;
+
+    namespace dbbench {
+
+        namespace {
+
+            std::vector<Benchmark *> *benchmarks = NULL;
+
+            boost::scoped_ptr<PseudoRandom> pseudoRandom;
+
+            bool byName(const Benchmark *a, const Benchmark *b) {
+                return a->name() < b->name();
+            }
+
+            void show_help_text(const char* name, po::options_description options) {
+                cout << "usage: " << name << " [options] [benchmark]..." << endl
+                     << options << "benchmark: run the specified benchmark(s) only" << endl;
+            }
+
+            /**
+             * Runs one trial of b: calls run() once untimed to warm caches, then calls it
+             * until 'micros' have passed.
+             * @return nanoseconds per operation
+             */
+            double runTrial(Benchmark *b, long long seed, unsigned long long micros,
+                            long long &ops) {
+                pseudoRandom.reset(new PseudoRandom(static_cast<int64_t>(seed)));
+                b->setUp();
+                b->run();
+                ops = 0;
+                Timer t;
+                unsigned long long elapsed = 0;
+                do {
+                    ops += b->run();
+                    elapsed = t.micros();
+                } while (elapsed < micros);
+                b->tearDown();
+                massert(17397, str::stream() << "benchmark " << b->name() << " did no work",
+                        ops > 0);
+                return elapsed * 1000.0 / ops;
+            }
+
+            /**
+             * Runs all trials of b and appends its result to 'results'.
+             * @return false if a trial failed
+             */
+            bool runBenchmark(Benchmark *b, long long seed, int trials, double seconds,
+                              BSONArrayBuilder &results) {
+                log() << "running " << b->name() << endl;
+                BSONObjBuilder r(results.subobjStart());
+                r.append("name", b->name());
+                r.append("kind", Benchmark::kindName(b->kind()));
+                std::vector<double> nsPerOp;
+                long long totalOps = 0;
+                try {
+                    for (int i = 0; i < trials; i++) {
+                        long long ops;
+                        nsPerOp.push_back(runTrial(b, seed, seconds * 1000 * 1000, ops));
+                        totalOps += ops;
+                    }
+                }
+                catch (DBException &e) {
+                    error() << b->name() << " failed: " << e.what() << endl;
+                    r.append("errmsg", e.what());
+                    r.done();
+                    return false;
+                }
+                std::sort(nsPerOp.begin(), nsPerOp.end());
+                const double median = nsPerOp[nsPerOp.size() / 2];
+                r.append("trials", trials);
+                r.append("operations", totalOps);
+                {
+                    BSONObjBuilder ns(r.subobjStart("nsPerOp"));
+                    ns.append("median", median);
+                    ns.append("min", nsPerOp.front());
+                    ns.append("max", nsPerOp.back());
+                    ns.done();
+                }
+                r.append("opsPerSec", 1e9 / median);
+                r.done();
+                log() << b->name() << ": " << median << " ns/op" << endl;
+                return true;
+            }
+
+        } // namespace
+
+        Benchmark::Benchmark(const std::string &name, Kind kind) : _name(name), _kind(kind) {
+            if (benchmarks == NULL) {
+                benchmarks = new std::vector<Benchmark *>();
+            }
+            benchmarks->push_back(this);
+        }
+
+        std::vector<Benchmark *> Benchmark::all() {
+            std::vector<Benchmark *> v;
+            if (benchmarks != NULL) {
+                v = *benchmarks;
+            }
+            std::sort(v.begin(), v.end(), byName);
+            return v;
+        }
+
+        int nextRandom(int max) {
+            verify(pseudoRandom);
+            return pseudoRandom->nextInt32(max);
+        }
+
+        int runDbBench( int argc , char** argv , const std::string &default_dbpath ) {
+            long long seed = 1;
+            int trials = 5;
+            double seconds = 1;
+            string dbpathSpec;
+            string outFile;
+
+            po::options_description shell_options("options");
+            po::options_description hidden_options("Hidden options");
+            po::options_description cmdline_options("Command line options");
+            po::positional_options_description positional_options;
+
+            shell_options.add_options()
+            ("help,h", "show this usage information")
+            ("dbpath", po::value<string>(&dbpathSpec)->default_value(default_dbpath),
+             "db data path for this run. NOTE: the contents of this "
+             "directory will be overwritten if it already exists")
+            ("list,l", "list available benchmarks")
+            ("filter,f" , po::value<string>() , "string substring filter on benchmark name" )
+            ("verbose,v", "be more verbose (include multiple times for more verbosity e.g. -vvvvv)")
+            ("seed", po::value<long long>(&seed), "random number seed, fixed so runs are comparable")
+            ("trials", po::value<int>(&trials), "number of times to run each benchmark")
+            ("seconds", po::value<double>(&seconds), "how long each trial runs")
+            ("out,o", po::value<string>(&outFile), "write the JSON results to this file instead of stdout")
+            ;
+
+            hidden_options.add_options()
+            ("benchmarks", po::value< vector<string> >(), "benchmarks to run")
+            ;
+
+            positional_options.add("benchmarks", -1);
+
+            /* support for -vv -vvvv etc. */
+            for (string s = "vv"; s.length() <= 10; s.append("v")) {
+                hidden_options.add_options()(s.c_str(), "verbose");
+            }
+
+            cmdline_options.add(shell_options).add(hidden_options);
+
+            po::variables_map params;
+            int command_line_style = (((po::command_line_style::unix_style ^
+                                        po::command_line_style::allow_guessing) |
+                                       po::command_line_style::allow_long_disguise) ^
+                                      po::command_line_style::allow_sticky);
+
+            try {
+                po::store(po::command_line_parser(argc, argv).options(cmdline_options).
+                          positional(positional_options).
+                          style(command_line_style).run(), params);
+                po::notify(params);
+            }
+            catch (po::error &e) {
+                cout << "ERROR: " << e.what() << endl << endl;
+                show_help_text(argv[0], shell_options);
+                return EXIT_BADOPTIONS;
+            }
+
+            if (params.count("help")) {
+                show_help_text(argv[0], shell_options);
+                return EXIT_CLEAN;
+            }
+
+            if (trials < 1 || seconds <= 0) {
+                cout << "ERROR: --trials and --seconds must be positive" << endl << endl;
+                show_help_text(argv[0], shell_options);
+                return EXIT_BADOPTIONS;
+            }
+
+            if (params.count("verbose")) {
+                logLevel = 1;
+            }
+
+            for (string s = "vv"; s.length() <= 10; s.append("v")) {
+                if (params.count(s)) {
+                    logLevel = s.length();
+                }
+            }
+
+            const std::vector<Benchmark *> all = Benchmark::all();
+
+            if (params.count("list")) {
+                for (std::vector<Benchmark *>::const_iterator i = all.begin(); i != all.end(); ++i) {
+                    std::cout << (*i)->name() << std::endl;
+                }
+                return 0;
+            }
+
+            std::vector<Benchmark *> selected;
+            {
+                std::set<string> names;
+                if (params.count("benchmarks")) {
+                    std::vector<string> v = params["benchmarks"].as< vector<string> >();
+                    names.insert(v.begin(), v.end());
+                }
+                string filter;
+                if (params.count("filter")) {
+                    filter = params["filter"].as<string>();
+                }
+                for (std::vector<Benchmark *>::const_iterator i = all.begin(); i != all.end(); ++i) {
+                    const string &name = (*i)->name();
+                    if ((names.empty() || names.erase(name)) && name.find(filter) != string::npos) {
+                        selected.push_back(*i);
+                    }
+                }
+                if (!names.empty()) {
+                    cout << "ERROR: no benchmark named " << *names.begin() << endl << endl;
+                    show_help_text(argv[0], shell_options);
+                    return EXIT_BADOPTIONS;
+                }
+            }
+
+            boost::filesystem::path p(dbpathSpec);
+
+            /* remove the contents of the benchmark directory if it exists. */
+            if (boost::filesystem::exists(p)) {
+                if (!boost::filesystem::is_directory(p)) {
+                    cout << "ERROR: path \"" << p.string() << "\" is not a directory" << endl << endl;
+                    show_help_text(argv[0], shell_options);
+                    return EXIT_BADOPTIONS;
+                }
+                boost::filesystem::directory_iterator end_iter;
+                for (boost::filesystem::directory_iterator dir_iter(p);
+                        dir_iter != end_iter; ++dir_iter) {
+                    boost::filesystem::remove_all(*dir_iter);
+                }
+            }
+            else {
+                boost::filesystem::create_directory(p);
+            }
+
+            string dbpathString = p.string();
+            dbpath = dbpathString.c_str();
+
+            // stdout is reserved for the results
+            Logstream::setLogFile(stderr);
+
+            Client::initThread("dbbench");
+            acquirePathLock();
+
+            printGitVersion();
+            printSysInfo();
+            DEV log() << "_DEBUG build, timings are not representative" << endl;
+            log() << "random seed: " << seed << endl;
+
+            storage::startup(&_txnCompleteHooks, &_storageUpdateCallback);
+
+            // set tlogLevel to -1 to suppress tlog() output in a benchmark program
+            tlogLevel = -1;
+
+            BSONObjBuilder b;
+            b.append("tokumxVersion", tokumxVersionString);
+            b.append("mongodbVersion", mongodbVersionString);
+            b.append("gitVersion", gitVersion());
+            DEV b.appendBool("debug", true);
+            b.append("seed", seed);
+            b.append("trials", trials);
+            b.append("secondsPerTrial", seconds);
+            b.appendTimeT("date", time(0));
+
+            int ret = EXIT_CLEAN;
+            {
+                BSONArrayBuilder results(b.subarrayStart("benchmarks"));
+                for (std::vector<Benchmark *>::const_iterator i = selected.begin();
+                     i != selected.end(); ++i) {
+                    if (!runBenchmark(*i, seed, trials, seconds, results)) {
+                        ret = EXIT_TEST;
+                    }
+                }
+                results.done();
+            }
+
+            const string json = b.done().jsonString(Strict, 1);
+            if (outFile.empty()) {
+                cout << json << endl;
+            }
+            else {
+                std::ofstream out(outFile.c_str());
+                out << json << endl;
+                if (!out) {
+                    error() << "couldn't write results to " << outFile << endl;
+                    ret = EXIT_TEST;
+                }
+            }
+
+#if !defined(_WIN32) && !defined(__sunos__)
+            flock( lockFile, LOCK_UN );
+#endif
+
+            cc().shutdown();
+            dbexit( (ExitCode)ret ); // so everything shuts down cleanly
+            return ret;
+        }
+
+    }  // namespace dbbench
+}  // namespace mongo
@@ -0,0 +1,31 @@
+// framework.h : Runs the dbbench performance suite.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+namespace mongo {
+    namespace dbbench {
+        /**
+         * Runs the benchmarks selected on the command line and writes their results as one
+         * JSON document to stdout, or to the file named by --out.  Log output goes to stderr.
+         */
+        int runDbBench( int argc, char ** argv, const std::string &default_dbpath );
+    }  // namespace dbbench
+}  // namespace mongo
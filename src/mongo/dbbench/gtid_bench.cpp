@@ -0,0 +1,110 @@
+// gtid_bench.cpp : Benchmarks for the GTIDManager.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/gtid.h"
+#include "mongo/dbbench/benchmark.h"
+
+namespace mongo {
+    namespace dbbench {
+
+        /**
+         * Hands out GTIDs and retires them the way a primary does for each transaction that
+         * writes to the oplog, from one or several threads.
+         */
+        class GTIDManagerPrimaryBench : public Benchmark {
+        public:
+            GTIDManagerPrimaryBench(const string &name, int nThreads) :
+                Benchmark(name, MICRO), _nThreads(nThreads) {
+            }
+            void setUp() {
+                _mgr.reset(new GTIDManager(GTID(1, 1), 0, 0, 0));
+                _mgr->catchUnappliedToLive();
+            }
+            long long run() {
+                if (_nThreads == 1) {
+                    work();
+                }
+                else {
+                    boost::thread_group threads;
+                    for (int i = 0; i < _nThreads; i++) {
+                        threads.create_thread(boost::bind(&GTIDManagerPrimaryBench::work, this));
+                    }
+                    threads.join_all();
+                }
+                return (long long) batchSize * _nThreads;
+            }
+            void tearDown() {
+                _mgr.reset();
+            }
+        private:
+            static const int batchSize = 1000;
+            void work() {
+                uint64_t ts;
+                uint64_t hash;
+                GTID gtid;
+                for (int i = 0; i < batchSize; i++) {
+                    _mgr->getGTIDForPrimary(&gtid, &ts, &hash);
+                    _mgr->noteLiveGTIDDone(gtid);
+                }
+            }
+            const int _nThreads;
+            boost::scoped_ptr<GTIDManager> _mgr;
+        };
+
+        static GTIDManagerPrimaryBench gtidManagerPrimary("gtidManager.primary", 1);
+        static GTIDManagerPrimaryBench gtidManagerPrimary4("gtidManager.primary4threads", 4);
+
+        /** Notes GTIDs added to the oplog and then applied, the way a secondary does. */
+        class GTIDManagerSecondaryBench : public Benchmark {
+        public:
+            GTIDManagerSecondaryBench() : Benchmark("gtidManager.secondary", MICRO) {}
+            void setUp() {
+                _mgr.reset(new GTIDManager(GTID(1, 1), 0, 0, 0));
+                _mgr->catchUnappliedToLive();
+                _next = _mgr->getLiveState();
+                _next.inc();
+            }
+            long long run() {
+                const uint64_t ts = curTimeMillis64();
+                for (int i = 0; i < batchSize; i++) {
+                    _mgr->noteGTIDAdded(_next, ts, i);
+                    _mgr->noteApplyingGTID(_next);
+                    _mgr->noteGTIDApplied(_next);
+                    _next.inc();
+                }
+                return batchSize;
+            }
+            void tearDown() {
+                _mgr.reset();
+            }
+        private:
+            static const int batchSize = 1000;
+            boost::scoped_ptr<GTIDManager> _mgr;
+            GTID _next;
+        };
+
+        static GTIDManagerSecondaryBench gtidManagerSecondary;
+
+    } // namespace dbbench
+} // namespace mongo
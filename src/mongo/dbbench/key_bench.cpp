@@ -0,0 +1,92 @@
+// key_bench.cpp : Benchmarks for index key comparison.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/key.h"
+#include "mongo/dbbench/benchmark.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+    namespace dbbench {
+
+        /**
+         * Compares pairs of KeyV1 keys, the comparison the fractal tree does on every key it
+         * searches or inserts.
+         */
+        class KeyV1CompareBench : public Benchmark {
+        public:
+            enum KeyType {
+                // a single int, in compact format
+                INT,
+                // a string and an int with mixed directions, in compact format
+                COMPOUND,
+                // an embedded object, which can't be compacted and so is compared as BSON
+                BSON_OBJECT
+            };
+            KeyV1CompareBench(const string &name, KeyType type) :
+                Benchmark(name, MICRO), _type(type),
+                _ordering(Ordering::make(type == COMPOUND ? BSON("a" << 1 << "b" << -1) : BSON("a" << 1))) {
+            }
+            void setUp() {
+                _keys.clear();
+                for (int i = 0; i < nKeys; i++) {
+                    KeyV1Owned key(makeKey());
+                    _keys.push_back(string(key.data(), key.dataSize()));
+                }
+            }
+            long long run() {
+                int c = 0;
+                for (int i = 1; i < nKeys; i++) {
+                    const KeyV1 a(_keys[i - 1].data());
+                    const KeyV1 b(_keys[i].data());
+                    c += a.woCompare(b, _ordering);
+                }
+                // keep the comparisons from being optimized away
+                verify(c >= -nKeys);
+                return nKeys - 1;
+            }
+        private:
+            typedef storage::KeyV1 KeyV1;
+            typedef storage::KeyV1Owned KeyV1Owned;
+            static const int nKeys = 1000;
+            BSONObj makeKey() const {
+                switch (_type) {
+                case INT:
+                    return BSON("" << nextRandom(1000 * 1000));
+                case COMPOUND: {
+                    // few distinct strings, so that many comparisons reach the second field
+                    const string s = mongoutils::str::stream() << "user" << nextRandom(10);
+                    return BSON("" << s << "" << nextRandom(1000 * 1000));
+                }
+                default:
+                    return BSON("" << BSON("x" << nextRandom(1000 * 1000)));
+                }
+            }
+            const KeyType _type;
+            const Ordering _ordering;
+            vector<string> _keys;
+        };
+
+        static KeyV1CompareBench keyV1CompareInt("keyV1Compare.int", KeyV1CompareBench::INT);
+        static KeyV1CompareBench keyV1CompareCompound("keyV1Compare.compound", KeyV1CompareBench::COMPOUND);
+        static KeyV1CompareBench keyV1CompareBson("keyV1Compare.bson", KeyV1CompareBench::BSON_OBJECT);
+
+    } // namespace dbbench
+} // namespace mongo
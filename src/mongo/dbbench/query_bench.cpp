@@ -0,0 +1,182 @@
+// query_bench.cpp : Benchmarks for the Matcher, ModSet and aggregation $group.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/collection.h"
+#include "mongo/db/interrupt_status_mongod.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher.h"
+#include "mongo/db/ops/update_internal.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/dbbench/benchmark.h"
+
+namespace mongo {
+    namespace dbbench {
+
+        namespace {
+
+            const string text(50, 'y');
+
+            BSONObj makeDoc(int id) {
+                return BSON("_id" << id <<
+                            "a" << nextRandom(1000 * 1000) <<
+                            "b" << nextRandom(100) <<
+                            "sub" << BSON("x" << nextRandom(1000 * 1000) << "y" << text) <<
+                            "tags" << BSON_ARRAY(nextRandom(20) << nextRandom(20) << nextRandom(20)));
+            }
+
+            void makeDocs(int n, vector<BSONObj> &docs) {
+                docs.clear();
+                for (int i = 0; i < n; i++) {
+                    docs.push_back(makeDoc(i));
+                }
+            }
+
+        } // namespace
+
+        /** Matches a query against a batch of documents. */
+        class MatcherBench : public Benchmark {
+        public:
+            MatcherBench(const string &name, const char *query) :
+                Benchmark(name, MICRO), _query(query) {
+            }
+            void setUp() {
+                _matcher.reset(new Matcher(fromjson(_query)));
+                makeDocs(batchSize, _docs);
+            }
+            long long run() {
+                int matched = 0;
+                for (vector<BSONObj>::const_iterator it = _docs.begin(); it != _docs.end(); ++it) {
+                    if (_matcher->matches(*it)) {
+                        matched++;
+                    }
+                }
+                verify(matched <= batchSize);
+                return batchSize;
+            }
+            void tearDown() {
+                _matcher.reset();
+            }
+        private:
+            static const int batchSize = 1000;
+            const char *const _query;
+            boost::scoped_ptr<Matcher> _matcher;
+            vector<BSONObj> _docs;
+        };
+
+        static MatcherBench matcherEquality("matcher.equality", "{b:5}");
+        static MatcherBench matcherRangeAndIn("matcher.rangeAndIn",
+                                              "{a:{$gt:1000,$lt:500000},b:{$in:[1,3,5,7,11,13,17,19]}}");
+        static MatcherBench matcherDottedAndArray("matcher.dottedAndArray",
+                                                  "{'sub.x':{$gte:500000},tags:7}");
+
+        /** Applies an update's mods to a batch of documents, the way update does for each match. */
+        class ModSetBench : public Benchmark {
+        public:
+            ModSetBench(const string &name, const char *mods) :
+                Benchmark(name, MICRO), _mods(mods) {
+            }
+            void setUp() {
+                // the ModSet points into the update object, so that has to outlive it
+                _modsObj = fromjson(_mods);
+                _modSet.reset(new ModSet(_modsObj));
+                makeDocs(batchSize, _docs);
+            }
+            long long run() {
+                long long bytes = 0;
+                for (vector<BSONObj>::const_iterator it = _docs.begin(); it != _docs.end(); ++it) {
+                    auto_ptr<ModSetState> mss = _modSet->prepare(*it);
+                    bytes += mss->createNewFromMods().objsize();
+                }
+                verify(bytes > 0);
+                return batchSize;
+            }
+            void tearDown() {
+                _modSet.reset();
+            }
+        private:
+            static const int batchSize = 1000;
+            const char *const _mods;
+            BSONObj _modsObj;
+            boost::scoped_ptr<ModSet> _modSet;
+            vector<BSONObj> _docs;
+        };
+
+        static ModSetBench modSetInc("modSet.inc", "{$inc:{a:1}}");
+        static ModSetBench modSetSetNested("modSet.setNested", "{$set:{'sub.z':5,c:'new field'}}");
+        static ModSetBench modSetPush("modSet.push", "{$push:{tags:1}}");
+        static ModSetBench modSetMixed("modSet.mixed", "{$inc:{a:1,'sub.x':-1},$set:{b:0},$push:{tags:1}}");
+
+        /** Runs a $group stage over an in-memory array of documents. */
+        class GroupBench : public Benchmark {
+        public:
+            GroupBench(const string &name, const char *spec) :
+                Benchmark(name, MICRO), _spec(spec) {
+            }
+            void setUp() {
+                _groupSpec = BSON("$group" << fromjson(_spec));
+                vector<BSONObj> docs;
+                makeDocs(nDocs, docs);
+                BSONObjBuilder b;
+                BSONArrayBuilder arr(b.subarrayStart("docs"));
+                for (vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); ++it) {
+                    arr.append(*it);
+                }
+                arr.done();
+                _input = b.obj();
+            }
+            long long run() {
+                intrusive_ptr<ExpressionContext> ctx =
+                        ExpressionContext::create(&InterruptStatusMongod::status);
+                BSONElement inputElement = _input.firstElement();
+                intrusive_ptr<DocumentSource> source =
+                        DocumentSourceBsonArray::create(&inputElement, ctx);
+                BSONElement specElement = _groupSpec.firstElement();
+                intrusive_ptr<DocumentSource> group =
+                        DocumentSourceGroup::createFromBson(&specElement, ctx);
+                group->setSource(source.get());
+                int groups = 0;
+                for (bool more = !group->eof(); more; more = group->advance()) {
+                    group->getCurrent();
+                    groups++;
+                }
+                verify(groups > 0);
+                return nDocs;
+            }
+            void tearDown() {
+                _input = BSONObj();
+            }
+        private:
+            static const int nDocs = 10 * 1000;
+            const char *const _spec;
+            BSONObj _groupSpec;
+            BSONObj _input;
+        };
+
+        static GroupBench groupSum("group.sum", "{_id:'$b',total:{$sum:'$a'},n:{$sum:1}}");
+        static GroupBench groupAccumulators("group.accumulators",
+                                            "{_id:'$b',avg:{$avg:'$sub.x'},max:{$max:'$a'},"
+                                            "first:{$first:'$_id'},tags:{$addToSet:'$tags'}}");
+
+    } // namespace dbbench
+} // namespace mongo
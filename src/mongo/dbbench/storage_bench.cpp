@@ -0,0 +1,195 @@
+// storage_bench.cpp : Benchmarks for collection inserts and index scans.
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include "mongo/db/client.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/key.h"
+#include "mongo/dbbench/benchmark.h"
+
+namespace mongo {
+    namespace dbbench {
+
+        namespace {
+
+            const char *const indexedFields[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+            const int maxIndexes = sizeof(indexedFields) / sizeof(indexedFields[0]);
+            const string padding(100, 'x');
+
+            /**
+             * Every document has all the indexable fields, so that inserts into collections with
+             * different numbers of indexes write the same amount of data.
+             */
+            BSONObj makeDoc(long long id) {
+                BSONObjBuilder b;
+                b.append("_id", id);
+                for (int i = 0; i < maxIndexes; i++) {
+                    b.append(indexedFields[i], nextRandom(1000 * 1000));
+                }
+                b.append("pad", padding);
+                return b.obj();
+            }
+
+            void createCollection(const char *ns, int nIndexes) {
+                DBDirectClient c;
+                c.dropCollection(ns);
+                c.createCollection(ns);
+                for (int i = 0; i < nIndexes; i++) {
+                    c.ensureIndex(ns, BSON(indexedFields[i] << 1));
+                }
+            }
+
+            /** inserts documents with _id in [begin, end) in one transaction */
+            void insertDocs(const char *ns, long long begin, long long end) {
+                Client::WriteContext ctx(ns, EMPTY_STRING);
+                Client::Transaction txn(DB_SERIALIZABLE);
+                Collection *cl = getCollection(ns);
+                verify(cl != NULL);
+                for (long long id = begin; id < end; id++) {
+                    BSONObj doc = makeDoc(id);
+                    cl->insertObject(doc, 0);
+                }
+                txn.commit();
+            }
+
+        } // namespace
+
+        /** Inserts batches of documents into a collection with some secondary indexes. */
+        class InsertBench : public Benchmark {
+        public:
+            InsertBench(const string &name, int nIndexes) :
+                Benchmark(name, MACRO), _nIndexes(nIndexes), _nextId(0) {
+                verify(_nIndexes <= maxIndexes);
+            }
+            void setUp() {
+                createCollection(ns(), _nIndexes);
+                _nextId = 0;
+            }
+            long long run() {
+                insertDocs(ns(), _nextId, _nextId + batchSize);
+                _nextId += batchSize;
+                return batchSize;
+            }
+            void tearDown() {
+                DBDirectClient c;
+                c.dropCollection(ns());
+            }
+        private:
+            static const char *ns() { return "dbbench.insert"; }
+            static const int batchSize = 1000;
+            const int _nIndexes;
+            long long _nextId;
+        };
+
+        static InsertBench insert0("insert.indexes0", 0);
+        static InsertBench insert1("insert.indexes1", 1);
+        static InsertBench insert4("insert.indexes4", 4);
+        static InsertBench insert8("insert.indexes8", 8);
+
+        /**
+         * Scans a whole index with an IndexCursor, which bulk fetches rows into its RowBuffer.
+         * The collection is loaded the first time the benchmark is set up and kept afterwards.
+         */
+        class IndexScanBench : public Benchmark {
+        public:
+            IndexScanBench(const string &name, const BSONObj &keyPattern, bool fetchDocs) :
+                Benchmark(name, MACRO), _keyPattern(keyPattern.getOwned()), _fetchDocs(fetchDocs) {
+            }
+            void setUp() {
+                if (getCollectionFromClient() == NULL) {
+                    createCollection(ns(), 1);
+                    for (long long id = 0; id < nDocs; id += 1000) {
+                        insertDocs(ns(), id, id + 1000);
+                    }
+                }
+            }
+            long long run() {
+                Client::ReadContext ctx(ns(), EMPTY_STRING);
+                Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+                Collection *cl = getCollection(ns());
+                const int idxNo = cl->findIndexByKeyPattern(_keyPattern);
+                verify(idxNo >= 0);
+                long long n = 0;
+                long long bytes = 0;
+                for (shared_ptr<Cursor> c = Cursor::make(cl, cl->idx(idxNo)); c->ok(); c->advance()) {
+                    bytes += _fetchDocs ? c->current().objsize() : c->currKey().objsize();
+                    n++;
+                }
+                verify(bytes > 0);
+                txn.commit();
+                return n;
+            }
+        private:
+            static const char *ns() { return "dbbench.scan"; }
+            static const long long nDocs = 100 * 1000;
+            Collection *getCollectionFromClient() {
+                Client::ReadContext ctx(ns(), EMPTY_STRING);
+                return getCollection(ns());
+            }
+            const BSONObj _keyPattern;
+            const bool _fetchDocs;
+        };
+
+        static IndexScanBench indexScanPK("indexScan.pk", BSON("_id" << 1), true);
+        static IndexScanBench indexScanSecondaryKeys("indexScan.secondaryKeys", BSON("a" << 1), false);
+        static IndexScanBench indexScanSecondaryDocs("indexScan.secondaryDocs", BSON("a" << 1), true);
+
+        /** Fills a RowBuffer with secondary index rows and reads them back. */
+        class RowBufferBench : public Benchmark {
+        public:
+            RowBufferBench() : Benchmark("rowBuffer", MICRO) {}
+            void setUp() {
+                _keys.clear();
+                _pks.clear();
+                for (int i = 0; i < batchSize; i++) {
+                    _keys.push_back(BSON("" << nextRandom(1000 * 1000)));
+                    _pks.push_back(BSON("" << i));
+                }
+            }
+            long long run() {
+                // reused the way an IndexCursor reuses its buffer between bulk fetches
+                _buffer.empty();
+                for (int i = 0; i < batchSize; i++) {
+                    storage::Key sKey(_keys[i], &_pks[i]);
+                    _buffer.append(sKey, BSONObj());
+                }
+                long long n = 0;
+                for (bool ok = _buffer.ok(); ok; ok = _buffer.next()) {
+                    storage::Key sKey;
+                    BSONObj obj;
+                    _buffer.current(sKey, obj);
+                    n++;
+                }
+                verify(n == batchSize);
+                return n;
+            }
+        private:
+            static const int batchSize = 1000;
+            vector<BSONObj> _keys;
+            vector<BSONObj> _pks;
+            RowBuffer _buffer;
+        };
+
+        static RowBufferBench rowBuffer;
+
+    } // namespace dbbench
+} // namespace mongo
@@ -0,0 +1,167 @@
+/*
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pch.h"
+
+#include "dbtests.h"
+
+#include "mongo/db/diagnostic_data_codec.h"
+#include "mongo/db/jsobj.h"
+
+namespace DiagnosticDataTests {
+
+    BSONObj sample(int i) {
+        return BSON("host" << "example" <<
+                    "t" << Date_t(1000000ULL + i * 1000) <<
+                    "opcounters" << BSON("insert" << (long long) i * i << "query" << 7 <<
+                                         "ratio" << 0.5 * i) <<
+                    "flags" << BSON_ARRAY(true << (i % 2 == 0)) <<
+                    "negative" << -5 * i);
+    }
+
+    class RoundTrip {
+    public:
+        void run() {
+            DiagnosticChunkBuilder builder(100);
+            for (int i = 0; i < 50; i++) {
+                ASSERT(builder.add(sample(i)));
+            }
+            ASSERT_EQUALS(50, builder.numSamples());
+
+            vector<BSONObj> samples;
+            decodeDiagnosticChunk(builder.chunk(), &samples);
+            ASSERT_EQUALS(50U, samples.size());
+            ASSERT_EQUALS(sample(0), samples[0]);
+            for (int i = 1; i < 50; i++) {
+                BSONObj expected = sample(i);
+                BSONObj s = samples[i];
+                ASSERT_EQUALS(string("example"), s["host"].String());
+                ASSERT_EQUALS(expected["t"].date(), s["t"].date());
+                ASSERT_EQUALS(expected["opcounters"]["insert"].Long(), s["opcounters"]["insert"].Long());
+                ASSERT_EQUALS(7, s["opcounters"]["query"].Int());
+                ASSERT_EQUALS(expected["opcounters"]["ratio"].Double(), s["opcounters"]["ratio"].Double());
+                ASSERT_EQUALS(expected["flags"], s["flags"]);
+                ASSERT_EQUALS(-5 * i, s["negative"].Int());
+            }
+        }
+    };
+
+    class ConstantSamplesAreSmall {
+    public:
+        void run() {
+            DiagnosticChunkBuilder builder(1000);
+            for (int i = 0; i < 1000; i++) {
+                ASSERT(builder.add(sample(0)));
+            }
+            BSONObj chunk = builder.chunk();
+            int len;
+            chunk["data"].binData(len);
+            // one run of zeros for everything
+            ASSERT_LESS_THAN(len, 4);
+
+            vector<BSONObj> samples;
+            decodeDiagnosticChunk(chunk, &samples);
+            ASSERT_EQUALS(1000U, samples.size());
+            ASSERT_EQUALS(sample(0)["opcounters"]["insert"], samples[999]["opcounters"]["insert"]);
+        }
+    };
+
+    class StructureChangeEndsChunk {
+    public:
+        void run() {
+            DiagnosticChunkBuilder builder(100);
+            ASSERT(builder.add(sample(0)));
+            ASSERT(builder.add(sample(1)));
+            // a new field
+            ASSERT(!builder.add(BSON("host" << "example" << "extra" << 1)));
+            // a type change
+            BSONObj changed = BSON("host" << "example" <<
+                                   "t" << Date_t(1000000ULL) <<
+                                   "opcounters" << BSON("insert" << 1 << "query" << 7 <<
+                                                        "ratio" << 0.5) <<
+                                   "flags" << BSON_ARRAY(true << true) <<
+                                   "negative" << 0);
+            ASSERT(!builder.add(changed));
+            ASSERT_EQUALS(2, builder.numSamples());
+
+            builder.reset();
+            ASSERT(builder.empty());
+            ASSERT(builder.add(changed));
+        }
+    };
+
+    class DoublesRoundTrip {
+    public:
+        void run() {
+            const double values[] = { 0.1, -0.1, 1e300, -1e-300, 0.0, 3.25, 1.0 / 3 };
+            const size_t n = sizeof(values) / sizeof(values[0]);
+            DiagnosticChunkBuilder builder(100);
+            for (size_t i = 0; i < n; i++) {
+                ASSERT(builder.add(BSON("d" << values[i])));
+            }
+            vector<BSONObj> samples;
+            decodeDiagnosticChunk(builder.chunk(), &samples);
+            ASSERT_EQUALS(n, samples.size());
+            for (size_t i = 0; i < n; i++) {
+                ASSERT_EQUALS(values[i], samples[i]["d"].Double());
+            }
+        }
+    };
+
+    class StringChangeEndsChunk {
+    public:
+        void run() {
+            DiagnosticChunkBuilder builder(100);
+            ASSERT(builder.add(BSON("state" << "PRIMARY" << "n" << 1)));
+            ASSERT(builder.add(BSON("state" << "PRIMARY" << "n" << 2)));
+            // the state is only stored in the reference, so it needs a new one
+            ASSERT(!builder.add(BSON("state" << "SECONDARY" << "n" << 3)));
+            ASSERT_EQUALS(2, builder.numSamples());
+
+            builder.reset();
+            ASSERT(builder.add(BSON("state" << "SECONDARY" << "n" << 3)));
+            vector<BSONObj> samples;
+            decodeDiagnosticChunk(builder.chunk(), &samples);
+            ASSERT_EQUALS(1U, samples.size());
+            ASSERT_EQUALS(string("SECONDARY"), samples[0]["state"].String());
+        }
+    };
+
+    class FullChunk {
+    public:
+        void run() {
+            DiagnosticChunkBuilder builder(3);
+            ASSERT(builder.add(sample(0)));
+            ASSERT(builder.add(sample(1)));
+            ASSERT(builder.add(sample(2)));
+            ASSERT(!builder.add(sample(3)));
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("diagnosticdata") {}
+        void setupTests() {
+            add<RoundTrip>();
+            add<ConstantSamplesAreSmall>();
+            add<StructureChangeEndsChunk>();
+            add<DoublesRoundTrip>();
+            add<StringChangeEndsChunk>();
+            add<FullChunk>();
+        }
+    } all;
+
+}
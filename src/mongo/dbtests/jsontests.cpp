@@ -1494,6 +1494,31 @@ namespace JsonTests {
             }
         };
 
+        class NumericTypeBoundaries {
+        public:
+            void run() {
+                BSONObj o = fromjson("{ a: 2147483647, b: -2147483648, c: 2147483648,"
+                                     " d: 123456789012345678, e: 1234567890123456789,"
+                                     " f: 0x10, g: 1e3, h: -0, i: 007 }");
+                ASSERT_EQUALS(NumberInt, o["a"].type());
+                ASSERT_EQUALS(2147483647, o["a"].numberInt());
+                ASSERT_EQUALS(NumberInt, o["b"].type());
+                ASSERT_EQUALS(NumberLong, o["c"].type());
+                ASSERT_EQUALS(2147483648LL, o["c"].numberLong());
+                ASSERT_EQUALS(NumberLong, o["d"].type());
+                ASSERT_EQUALS(123456789012345678LL, o["d"].numberLong());
+                ASSERT_EQUALS(NumberLong, o["e"].type());
+                ASSERT_EQUALS(1234567890123456789LL, o["e"].numberLong());
+                ASSERT_EQUALS(NumberDouble, o["f"].type());
+                ASSERT_EQUALS(16.0, o["f"].numberDouble());
+                ASSERT_EQUALS(NumberDouble, o["g"].type());
+                ASSERT_EQUALS(1000.0, o["g"].numberDouble());
+                ASSERT_EQUALS(NumberInt, o["h"].type());
+                ASSERT_EQUALS(0, o["h"].numberInt());
+                ASSERT_EQUALS(7, o["i"].numberInt());
+            }
+        };
+
         class EmbeddedDatesBase : public Base  {
         public:
 
@@ -1686,6 +1711,7 @@ namespace JsonTests {
             add< FromJsonTests::NumericTypes >();
             add< FromJsonTests::NumericLimits >();
             add< FromJsonTests::NegativeNumericTypes >();
+            add< FromJsonTests::NumericTypeBoundaries >();
             add< FromJsonTests::EmbeddedDatesFormat1 >();
             add< FromJsonTests::EmbeddedDatesFormat2 >();
             add< FromJsonTests::EmbeddedDatesFormat3 >();
@@ -0,0 +1,131 @@
+/*
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pch.h"
+
+#include "dbtests.h"
+
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_buffer_pool.h"
+
+namespace MessageBufferPoolTests {
+
+    class ReusesBuffers {
+    public:
+        void run() {
+            char *a = MessageBufferPool::allocate(100);
+            memset(a, 'a', 1024);
+            MessageBufferPool::release(a);
+            // same size class, same thread
+            char *b = MessageBufferPool::allocate(1000);
+            ASSERT_EQUALS((void *) a, (void *) b);
+            char *c = MessageBufferPool::allocate(1000);
+            ASSERT_NOT_EQUALS((void *) b, (void *) c);
+            MessageBufferPool::release(b);
+            MessageBufferPool::release(c);
+        }
+    };
+
+    class LargeBuffers {
+    public:
+        void run() {
+            // shared between threads
+            char *a = MessageBufferPool::allocate(300 * 1024);
+            a[300 * 1024 - 1] = 'x';
+            MessageBufferPool::release(a);
+            char *b = MessageBufferPool::allocate(300 * 1024 + 1);
+            ASSERT_EQUALS((void *) a, (void *) b);
+            MessageBufferPool::release(b);
+
+            // bigger than the largest class, malloc'd at its size and not kept
+            BSONObjBuilder before;
+            MessageBufferPool::appendStats(before);
+            char *c = MessageBufferPool::allocate(3 * 1024 * 1024 + 1);
+            c[3 * 1024 * 1024] = 'x';
+            MessageBufferPool::release(c);
+            BSONObjBuilder after;
+            MessageBufferPool::appendStats(after);
+            ASSERT_EQUALS(before.obj()["retainedBytes"].numberLong(),
+                          after.obj()["retainedBytes"].numberLong());
+        }
+    };
+
+    class RetainedMemoryIsCapped {
+    public:
+        void run() {
+            const int oldMax = MessageBufferPool::maxRetainedMB;
+            MessageBufferPool::maxRetainedMB = 0;
+            BSONObjBuilder before;
+            MessageBufferPool::appendStats(before);
+
+            char *a = MessageBufferPool::allocate(512 * 1024);
+            MessageBufferPool::release(a);
+            // the thread's own buffers count too
+            char *b = MessageBufferPool::allocate(100);
+            char *c = MessageBufferPool::allocate(100);
+            MessageBufferPool::release(b);
+            MessageBufferPool::release(c);
+
+            BSONObjBuilder after;
+            MessageBufferPool::appendStats(after);
+            const BSONObj beforeObj = before.obj();
+            const BSONObj afterObj = after.obj();
+            ASSERT_EQUALS(beforeObj["discarded"].numberLong() + 3,
+                          afterObj["discarded"].numberLong());
+            ASSERT(afterObj["retainedBytes"].numberLong() <= beforeObj["retainedBytes"].numberLong());
+            MessageBufferPool::maxRetainedMB = oldMax;
+        }
+    };
+
+    class PooledMessages {
+    public:
+        void run() {
+            const string text(5000, 'z');
+            Message m;
+            m.setData(dbQuery, text.c_str(), text.size() + 1);
+            ASSERT_EQUALS(dbQuery, m.operation());
+
+            // ownership moves along with the buffer
+            Message n;
+            n = m;
+            ASSERT(m.empty());
+            ASSERT_EQUALS(string(n.singleData()->_data), text);
+
+            // a malloc'd buffer appended to a pooled one
+            char *extra = (char *) malloc(10);
+            memset(extra, 'y', 10);
+            n.appendData(extra, 10);
+            const int size = n.size();
+            n.concat();
+            ASSERT_EQUALS(size, n.size());
+            ASSERT_EQUALS('y', ((char *) n.singleData())[size - 1]);
+            n.reset();
+            ASSERT(n.empty());
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("messagebufferpool") {}
+        void setupTests() {
+            add<ReusesBuffers>();
+            add<LargeBuffers>();
+            add<RetainedMemoryIsCapped>();
+            add<PooledMessages>();
+        }
+    } all;
+
+}
@@ -21,6 +21,7 @@
 #include "mongo/pch.h"
 #include "mongo/db/json.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/storage/key.h"
 
 #include "mongo/dbtests/dbtests.h"
 
@@ -950,6 +951,68 @@ namespace NamespaceTests {
         protected:
             BSONObj key() const { return BSON( "a" << 1 ); }
         };
+
+        /** The single key fast path stores exactly what the BSONObjSet path would. */
+        class SingleKeyMatchesGetKeys : public Base {
+        public:
+            void run() {
+                create();
+                check( fromjson( "{a:1,b:{c:'x'}}" ), true );
+                check( fromjson( "{a:{d:[1,2]},b:{c:2.5}}" ), true );
+                check( fromjson( "{a:null}" ), true );
+                check( fromjson( "{b:{c:NumberLong(5)}}" ), true );
+                check( fromjson( "{a:'x',b:5}" ), true );
+                check( fromjson( "{}" ), true );
+                // not representable in compact KeyV1 format, so stored as bson
+                check( fromjson( "{a:/re/,b:{c:{z:1}}}" ), true );
+                check( BSON( "a" << string( 300, 'x' ) << "b" << BSON( "c" << 1 ) ), true );
+                // arrays need the general path
+                check( fromjson( "{a:[1,2],b:{c:1}}" ), false );
+                check( fromjson( "{a:1,b:[{c:1}]}" ), false );
+                check( fromjson( "{a:1,b:{c:[]}}" ), false );
+            }
+        private:
+            void check( const BSONObj &obj, bool single ) {
+                const BSONObj pk = BSON( "" << 7 );
+                StackBufBuilder b;
+                bool generated;
+                ASSERT_EQUALS( single, idx().getSingleKeyFromObject( obj, pk, b, &generated ) );
+                if ( !single ) {
+                    ASSERT_EQUALS( 0, b.len() );
+                    return;
+                }
+                BSONObjSet keys;
+                _getKeysFromObject( obj, keys );
+                checkSize( 1, keys );
+                ASSERT( generated );
+                const storage::Key expected( *keys.begin(), &pk );
+                ASSERT_EQUALS( expected.size(), b.len() );
+                ASSERT_EQUALS( 0, memcmp( expected.buf(), b.buf(), b.len() ) );
+            }
+            virtual BSONObj key() const {
+                return BSON( "a" << 1 << "b.c" << -1 );
+            }
+        };
+
+        /** A sparse index generates no key when every indexed field is missing. */
+        class SparseSingleKeyMissing : public Base {
+        public:
+            void run() {
+                create();
+                const BSONObj pk = BSON( "" << 7 );
+                StackBufBuilder b;
+                bool generated = true;
+                ASSERT( idx().getSingleKeyFromObject( fromjson( "{b:1}" ), pk, b, &generated ) );
+                ASSERT( !generated );
+                ASSERT_EQUALS( 0, b.len() );
+                ASSERT( idx().getSingleKeyFromObject( fromjson( "{a:1}" ), pk, b, &generated ) );
+                ASSERT( generated );
+            }
+        private:
+            virtual bool isSparse() const {
+                return true;
+            }
+        };
         
     } // namespace IndexDetailsTests
 
@@ -1135,6 +1198,8 @@ namespace NamespaceTests {
             add< IndexDetailsTests::Suitability >();
             add< IndexDetailsTests::NumericFieldSuitability >();
             add< IndexDetailsTests::IndexMissingField >();
+            add< IndexDetailsTests::SingleKeyMatchesGetKeys >();
+            add< IndexDetailsTests::SparseSingleKeyMissing >();
             add< CollectionTests::SetIndexIsMultikey >();
             add< CollectionTests::ClearQueryCache >();
         }
@@ -30,6 +30,7 @@
 #include "../db/d_concurrency.h"
 #include "../util/concurrency/synchronization.h"
 #include "../util/concurrency/qlock.h"
+#include "../util/concurrency/distributed_rwlock.h"
 #include "dbtests.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/platform/atomic_word.h"
@@ -846,6 +847,106 @@ namespace ThreadedTests {
         }
     };
 
+    // Writers keep two values equal but must change them one at a time, readers check that they
+    // never see them differ.
+    class DistributedRWLockTest : public ThreadedTest<12> {
+    public:
+        DistributedRWLockTest() : m("dtest"), a(0), b(0), reads(0) { }
+    private:
+        enum { N = 20000, Writers = 3 };
+        DistributedRWLock m;
+        long long a;
+        char pad[128];
+        long long b;
+        AtomicUInt64 reads;
+        virtual void validate() {
+            ASSERT_EQUALS( (long long) Writers * N / 100, a );
+            ASSERT_EQUALS( a, b );
+            ASSERT_EQUALS( (unsigned long long) (nthreads - Writers) * N, reads.load() );
+        }
+        virtual void subthread(int x) {
+            for( int i = 0; i < N; i++ ) {
+                if( x <= Writers ) {
+                    if( i % 100 == 0 ) {
+                        m.lock();
+                        a++;
+                        sleepmicros(10);
+                        b++;
+                        m.unlock();
+                    }
+                }
+                else {
+                    m.lock_shared();
+                    ASSERT_EQUALS( a, b );
+                    m.unlock_shared();
+                    reads.fetchAndAdd(1);
+                }
+            }
+        }
+    };
+
+    struct SimpleRWLockReader {
+        SimpleRWLock m;
+        SimpleRWLockReader() : m("bench") { }
+        void lock() { m.lock_shared(); }
+        void unlock() { m.unlock_shared(); }
+        static const char *name() { return "SimpleRWLock shared"; }
+    };
+    struct DistributedRWLockReader {
+        DistributedRWLock m;
+        DistributedRWLockReader() : m("bench") { }
+        void lock() { m.lock_shared(); }
+        void unlock() { m.unlock_shared(); }
+        static const char *name() { return "DistributedRWLock shared"; }
+    };
+    struct QLockReader {
+        QLock m;
+        void lock() { m.lock_r(); }
+        void unlock() { m.unlock_r(); }
+        static const char *name() { return "QLock r"; }
+    };
+
+    /**
+     * Benchmark: how read lock acquisitions scale with the number of threads taking them.  Only
+     * prints, the numbers depend on the machine.  With one cache line shared by all readers,
+     * throughput stays flat or drops as threads are added; with distributed reader counts it
+     * should grow with the number of cores.
+     */
+    template <class Reader>
+    class ReadLockScaling {
+    public:
+        void run() {
+            for( int nthreads = 1; nthreads <= 32; nthreads *= 2 ) {
+                Reader r;
+                AtomicUInt32 done;
+                AtomicUInt64 total;
+                boost::thread_group threads;
+                for( int i = 0; i < nthreads; i++ ) {
+                    threads.create_thread( boost::bind(&ReadLockScaling::worker, &r, &done, &total) );
+                }
+                Timer t;
+                sleepmillis(250);
+                done.store(1);
+                threads.join_all();
+                const long long micros = t.micros();
+                cerr << "ReadLockScaling " << Reader::name() << " threads:" << nthreads
+                     << " locks/s:" << (long long) (total.load() * 1000000.0 / micros) << endl;
+            }
+        }
+    private:
+        static void worker(Reader *r, AtomicUInt32 *done, AtomicUInt64 *total) {
+            unsigned long long n = 0;
+            while( done->loadRelaxed() == 0 ) {
+                for( int i = 0; i < 100; i++ ) {
+                    r->lock();
+                    r->unlock();
+                }
+                n += 100;
+            }
+            total->fetchAndAdd(n);
+        }
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -928,6 +1029,11 @@ namespace ThreadedTests {
             add< WriteLocksAreGreedy >();
             add< QLockTest >();
             add< QLockTest >();
+            add< DistributedRWLockTest >();
+
+            add< ReadLockScaling<SimpleRWLockReader> >();
+            add< ReadLockScaling<DistributedRWLockReader> >();
+            add< ReadLockScaling<QLockReader> >();
 
             // Slack is a test to see how long it takes for another thread to pick up
             // and begin work after another relinquishes the lock.  e.g. a spin lock 
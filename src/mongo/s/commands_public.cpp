@@ -993,6 +993,11 @@ namespace mongo {
             BeginLoadCmd() : NotAllowedOnShardedClusterCmd("beginLoad") {}
         } beginLoadCmd;
 
+        class JoinLoadCmd : public NotAllowedOnShardedClusterCmd  {
+        public:
+            JoinLoadCmd() : NotAllowedOnShardedClusterCmd("joinLoad") {}
+        } joinLoadCmd;
+
         class CommitLoadCmd : public NotAllowedOnShardedClusterCmd  {
         public:
             CommitLoadCmd() : NotAllowedOnShardedClusterCmd("commitLoad") {}
@@ -21,7 +21,10 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/tss.hpp>
+
 #include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/d_chunk_manager.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/util/concurrency/rwlock.h"
@@ -190,7 +193,7 @@ namespace mongo {
         string _shardName;
         string _shardHost;
 
-        // protects state below
+        // protects state below (for _chunks, only writers take it)
         mutable mongo::mutex _mutex;
         // protects accessing the config server
         // Using a ticket holder so we can have multiple redundant tries at any given time
@@ -198,8 +201,32 @@ namespace mongo {
 
         // map from a namespace into the ensemble of chunk ranges that are stored in this mongod
         // a ShardChunkManager carries all state we need for a collection at this shard, including its version information
+        //
+        // A published map is never modified.  Writers (setShardVersion, migrations, splits) copy
+        // it, change the copy and publish that, under _mutex.  Readers, which is every sharded
+        // operation, go through chunks() and take no lock.
         typedef map<string,ShardChunkManagerPtr> ChunkManagersMap;
-        ChunkManagersMap _chunks;
+        typedef shared_ptr<const ChunkManagersMap> ChunkManagersMapPtr;
+        ChunkManagersMapPtr _chunks;
+        // bumped every time _chunks is replaced
+        AtomicUInt64 _chunksGeneration;
+
+        // Each thread keeps the map it last saw, so in the common case a read is just a load
+        // of _chunksGeneration.
+        struct ChunksSnapshot {
+            ChunkManagersMapPtr chunks;
+            unsigned long long generation;
+        };
+        mutable boost::thread_specific_ptr<ChunksSnapshot> _chunksSnapshot;
+
+        /** @return the latest published map, good until this thread calls chunks() again. */
+        const ChunkManagersMap& chunks() const;
+
+        /** Must hold _mutex.  @return a copy of the current map, to change and publish. */
+        shared_ptr<ChunkManagersMap> copyChunks() const;
+
+        /** Must hold _mutex. */
+        void publishChunks( const shared_ptr<ChunkManagersMap>& chunks );
 
         mutable RWLockRecursive _rwlock;
     };
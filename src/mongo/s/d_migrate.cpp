@@ -51,6 +51,7 @@
 #include "mongo/db/repl.h"
 #include "mongo/db/keypattern.h"
 #include "mongo/db/kill_current_op.h"
+#include "mongo/db/log_flusher.h"
 #include "mongo/db/ops/query.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/txn_context.h"
@@ -92,6 +93,10 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(migrateUniqueChecks, bool, true);
     MONGO_EXPORT_SERVER_PARAMETER(migrateStartCloneLockTimeout, uint64_t, 60000);
+    MONGO_EXPORT_SERVER_PARAMETER(migrateBulkLoad, bool, true);
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCloneQueueBytes, int, 64 << 20);
+    // compress what the recipient pulls from the donor, see MessageCompressor
+    MONGO_EXPORT_SERVER_PARAMETER(migrateNetworkCompression, bool, false);
 
     bool findShardKeyIndexPattern_locked( const string& ns,
                                           const BSONObj& shardKeyPattern,
@@ -1464,6 +1469,167 @@ namespace mongo {
        commend to "commit"
     */
 
+    /**
+     * Pulls batches of documents from the donor's clone cursor on its own thread, so that the
+     * round-trips for the next batch overlap with inserting the current one on the migrate
+     * thread.
+     *
+     * Batches are handed over through a queue bounded by migrateCloneQueueBytes.  The cursor's
+     * connection must not be used by anyone else until the fetcher is done or destroyed.
+     */
+    class MigrateCloneFetcher : boost::noncopyable {
+      public:
+        typedef shared_ptr<vector<BSONObj> > Batch;
+
+        MigrateCloneFetcher(DBClientCursor &cursor) :
+            _cursor(cursor),
+            // A single batch is at most a bit more than BSONObjMaxUserSize, make sure one always fits.
+            _queue(std::max(migrateCloneQueueBytes, 2 * BSONObjMaxUserSize + 1), &batchSize),
+            _stopped(false),
+            _thread(boost::bind(&MigrateCloneFetcher::run, this)) {}
+
+        ~MigrateCloneFetcher() {
+            stop();
+        }
+
+        /**
+         * Blocks until the next batch is available.  Returns an empty batch when the cursor is
+         * exhausted, and uasserts if fetching failed.
+         */
+        Batch next() {
+            Batch b = _queue.blockingPop();
+            if (b->empty()) {
+                _thread.join();
+                uassert(17358, mongoutils::str::stream() << "failed fetching documents from donor: " << _errmsg,
+                        _errmsg.empty());
+            }
+            return b;
+        }
+
+      private:
+        static size_t batchSize(const Batch &b) {
+            size_t size = 0;
+            for (vector<BSONObj>::const_iterator it = b->begin(); it != b->end(); ++it) {
+                size += it->objsize();
+            }
+            return std::min(size, (size_t) BSONObjMaxUserSize);
+        }
+
+        void run() {
+            Client::initThread("migrateCloneFetcher");
+            try {
+                while (!_stopped && _cursor.more()) {
+                    Batch b(new vector<BSONObj>());
+                    while (_cursor.moreInCurrentBatch()) {
+                        b->push_back(_cursor.nextSafe().getOwned());
+                    }
+                    _queue.push(b);
+                }
+            }
+            catch (DBException &e) {
+                _errmsg = e.toString();
+            }
+            catch (std::exception &e) {
+                _errmsg = e.what();
+            }
+            // The empty batch marks the end of the stream.
+            _queue.push(Batch(new vector<BSONObj>()));
+            cc().shutdown();
+        }
+
+        void stop() {
+            _stopped = true;
+            // Keep draining so the fetcher can't stay blocked on a full queue.
+            Batch b;
+            while (!_thread.timed_join(boost::posix_time::milliseconds(10))) {
+                while (_queue.tryPop(b)) {}
+            }
+        }
+
+        DBClientCursor &_cursor;
+        BlockingQueue<Batch> _queue;
+        volatile bool _stopped;
+        string _errmsg;
+        boost::thread _thread;
+    };
+
+    /**
+     * When the recipient doesn't have the collection yet, there is nothing in the target range,
+     * so the cloned documents can go through a storage::Loader instead of normal inserts.
+     *
+     * This drives the same machinery as the beginLoad/commitLoad commands, inside a transaction
+     * owned by the migrate thread, and logs those commands around the inserts so secondaries
+     * perform the same load.  Like the inserts, they are tagged fromMigrate, so that oplog
+     * readers can tell them from a user's load.  The load must be committed before any mods are applied, since a
+     * bulk loaded collection only accepts inserts.
+     */
+    class MigrateBulkLoad : boost::noncopyable {
+      public:
+        MigrateBulkLoad(const string &ns) : _ns(ns), _loading(false) {}
+
+        ~MigrateBulkLoad() {
+            if (_loading) {
+                try {
+                    cc().abortClientLoad();
+                }
+                catch (DBException &e) {
+                    warning() << "failed to abort bulk load for migrate of " << _ns << ": " << e.toString() << migrateLog;
+                }
+            }
+        }
+
+        static bool canLoad(const BSONObj &options) {
+            return !options["capped"].trueValue() &&
+                   !options["natural"].trueValue() &&
+                   !options["partitioned"].trueValue();
+        }
+
+        /**
+         * @return false if the collection was created by someone else in the meantime, in which
+         *         case the caller should fall back to creating it normally.
+         */
+        bool begin(const vector<BSONObj> &indexes, const BSONObj &options) {
+            _txn.reset(new Client::Transaction(DB_SERIALIZABLE));
+            try {
+                cc().beginClientLoad(_ns, indexes, options);
+            }
+            catch (UserException &e) {
+                _txn.reset();
+                if (e.getCode() == 16873) {
+                    return false;
+                }
+                throw;
+            }
+            _loading = true;
+            OplogHelpers::logCommand(cmdNs().c_str(),
+                                     BSON("beginLoad" << 1 <<
+                                          "ns" << nsToCollectionSubstring(_ns) <<
+                                          "indexes" << indexes <<
+                                          "options" << options),
+                                     true /* fromMigrate */);
+            return true;
+        }
+
+        void commit() {
+            verify(_loading);
+            cc().commitClientLoad();
+            _loading = false;
+            OplogHelpers::logCommand(cmdNs().c_str(), BSON("commitLoad" << 1), true /* fromMigrate */);
+            RWLockRecursive::Shared lk(operationLock);
+            _txn->commit();
+            _txn.reset();
+        }
+
+      private:
+        string cmdNs() const {
+            return nsToDatabase(_ns) + ".$cmd";
+        }
+
+        const string _ns;
+        scoped_ptr<Client::Transaction> _txn;
+        bool _loading;
+    };
+
     class MigrateStatus {
         long long _lastAppliedMigrateLogID;
 
@@ -1706,12 +1872,12 @@ namespace mongo {
          * We may need to handle RetryWithWriteLock inside this code, so it is factored out of _go
          * below.
          */
-        void lockedMigrateInsertFirstBatch(const BSONObj &firstBatch, uint64_t insertFlags) {
+        void lockedMigrateInsertBatch(const vector<BSONObj> &batch, uint64_t insertFlags) {
             Client::Transaction txn(DB_SERIALIZABLE);
             Collection *cl = getCollection(ns);
             massert(17318, "collection must exist during migration", cl);
-            for (BSONObjIterator it(firstBatch); it.more(); ++it) {
-                BSONObj obj = (*it).Obj();
+            for (vector<BSONObj>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                BSONObj obj = *it;
                 insertOneObject(cl, obj, insertFlags);
                 OplogHelpers::logInsert(ns.c_str(), obj, true);
                 numCloned++;
@@ -1720,18 +1886,22 @@ namespace mongo {
             txn.commit();
         }
 
-        void lockedMigrateInsertBatch(DBClientCursorBatchIterator &iter, uint64_t insertFlags) {
-            Client::Transaction txn(DB_SERIALIZABLE);
-            Collection *cl = getCollection(ns);
-            massert(17319, "collection must exist during migration", cl);
-            while (iter.moreInCurrentBatch()) {
-                BSONObj obj = iter.nextSafe();
-                insertOneObject(cl, obj, insertFlags);
-                OplogHelpers::logInsert(ns.c_str(), obj, true);
-                numCloned++;
-                clonedBytes += obj.objsize();
+        void migrateInsertBatch(const vector<BSONObj> &batch, uint64_t insertFlags) {
+            LOCK_REASON(lockReason, "sharding: cloning documents on recipient for migrate");
+            try {
+                Client::ReadContext ctx(ns, lockReason);
+                CounterResetter<long long> numClonedResetter(numCloned);
+                CounterResetter<long long> clonedBytesResetter(clonedBytes);
+
+                lockedMigrateInsertBatch(batch, insertFlags);
+
+                numClonedResetter.setDone();
+                clonedBytesResetter.setDone();
+            } catch (RetryWithWriteLock) {
+                Client::WriteContext ctx(ns, lockReason);
+
+                lockedMigrateInsertBatch(batch, insertFlags);
             }
-            txn.commit();
         }
 
         bool lockedMigrateHandleLegacyBatch(const BSONObj &arr) {
@@ -1795,6 +1965,13 @@ namespace mongo {
                     ScopedDbConnection::getScopedDbConnection( from ) );
             ScopedDbConnection& conn = *connPtr;
             conn->getLastError(); // just test connection
+            if ( migrateNetworkCompression ) {
+                conn->enableCompression();
+            }
+
+            // Set if the collection is new here and we're cloning it with a loader, until the
+            // load is committed at the end of the initial clone.
+            scoped_ptr<MigrateBulkLoad> bulkLoad;
 
             {
                 // 0. copy system.namespaces entry if collection doesn't already exist
@@ -1829,47 +2006,58 @@ namespace mongo {
                     string system_namespaces = getSisterNS(ns, "system.namespaces");
                     BSONObj entry = conn->findOne(system_namespaces, BSON( "name" << ns ));
 
-                    LOCK_REASON(lockReason, "sharding: creating collection for migrate");
-                    Client::WriteContext ctx(ns, lockReason);
-                    Client::Transaction txn(DB_SERIALIZABLE);
-                    // Now that we have the write lock, check that the collection still doesn't
-                    // exist, otherwise it may be expensive to build the right indexes.
-                    Collection *cl = getCollection(ns);
-                    if (cl == NULL) {
-                        BSONObj opts = entry.getObjectField("options");
-                        if (!opts.isEmpty()) {
-                            string errmsg;
-                            if (!userCreateNS(ns, opts, errmsg, true)) {
-                                warning() << "failed to create collection " << ns << " with options " << opts << ": " << errmsg << migrateLog;
-                            }
-                        }
-                        string system_indexes = getSisterNS(ns, "system.indexes");
-                        for (vector<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                            const BSONObj &idxObj = *it;
-                            insertObject(system_indexes.c_str(), idxObj, 0, true /* flag fromMigrate in oplog */);
+                    BSONObj opts = entry.getObjectField("options");
+                    if (migrateBulkLoad && MigrateBulkLoad::canLoad(opts)) {
+                        bulkLoad.reset(new MigrateBulkLoad(ns));
+                        if (bulkLoad->begin(indexes, opts)) {
+                            LOG(0) << "Collection " << ns << " doesn't exist yet, cloning it with a bulk load." << migrateLog;
+                        } else {
+                            bulkLoad.reset();
                         }
-                    } else {
-                        LOG(0) << "During migrate for collection " << ns << ", it didn't exist but after getting the write lock, it now exists." << migrateLog;
-                        LOG(0) << "This could be a race, shouldn't happen, but is benign as long as the indexes are correct." << migrateLog;
-                        bool anyMissing = false;
-                        for (vector<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                            const BSONObj &idx = *it;
-                            if (cl->findIndexByKeyPattern(idx.getObjectField("key")) < 0) {
-                                anyMissing = true;
-                                warning() << "The index " << idx << " seems to be missing." << migrateLog;
-                                warning() << "We'll proceed with the migration without that index for now, but you should build that index or drop it elsewhere soon." << migrateLog;
+                    }
+
+                    if (!bulkLoad) {
+                        LOCK_REASON(lockReason, "sharding: creating collection for migrate");
+                        Client::WriteContext ctx(ns, lockReason);
+                        Client::Transaction txn(DB_SERIALIZABLE);
+                        // Now that we have the write lock, check that the collection still doesn't
+                        // exist, otherwise it may be expensive to build the right indexes.
+                        Collection *cl = getCollection(ns);
+                        if (cl == NULL) {
+                            if (!opts.isEmpty()) {
+                                string errmsg;
+                                if (!userCreateNS(ns, opts, errmsg, true)) {
+                                    warning() << "failed to create collection " << ns << " with options " << opts << ": " << errmsg << migrateLog;
+                                }
+                            }
+                            string system_indexes = getSisterNS(ns, "system.indexes");
+                            for (vector<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+                                const BSONObj &idxObj = *it;
+                                insertObject(system_indexes.c_str(), idxObj, 0, true /* flag fromMigrate in oplog */);
+                            }
+                        } else {
+                            LOG(0) << "During migrate for collection " << ns << ", it didn't exist but after getting the write lock, it now exists." << migrateLog;
+                            LOG(0) << "This could be a race, shouldn't happen, but is benign as long as the indexes are correct." << migrateLog;
+                            bool anyMissing = false;
+                            for (vector<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+                                const BSONObj &idx = *it;
+                                if (cl->findIndexByKeyPattern(idx.getObjectField("key")) < 0) {
+                                    anyMissing = true;
+                                    warning() << "The index " << idx << " seems to be missing." << migrateLog;
+                                    warning() << "We'll proceed with the migration without that index for now, but you should build that index or drop it elsewhere soon." << migrateLog;
+                                }
+                            }
+                            if (!anyMissing) {
+                                LOG(0) << "All indexes are present." << migrateLog;
                             }
                         }
-                        if (!anyMissing) {
-                            LOG(0) << "All indexes are present." << migrateLog;
-                        }
+                        txn.commit();
                     }
-                    txn.commit();
                 }
                 timing.done(1);
             }
 
-            {
+            if (!bulkLoad) {
                 // 2. delete any data already in range
                 LOCK_REASON(lockReason, "sharding: deleting old documents before migrate");
                 Client::ReadContext ctx(ns, lockReason);
@@ -1892,6 +2080,9 @@ namespace mongo {
                     warning() << "moveChunkCmd deleted data already in chunk # objects: " << num << migrateLog;
 
                 timing.done(2);
+            } else {
+                // The collection didn't exist before, so there's nothing in range to delete.
+                timing.done(2);
             }
 
 
@@ -1933,47 +2124,36 @@ namespace mongo {
                         insertFlags |= Collection::NO_UNIQUE_CHECKS;
                     }
 
-                    LOCK_REASON(lockReason, "sharding: cloning documents on recipient for migrate");
-                    try {
-                        Client::ReadContext ctx(ns, lockReason);
-                        CounterResetter<long long> numClonedResetter(numCloned);
-                        CounterResetter<long long> clonedBytesResetter(clonedBytes);
-
-                        lockedMigrateInsertFirstBatch(cursorObj["firstBatch"].Obj(), insertFlags);
-
-                        numClonedResetter.setDone();
-                        clonedBytesResetter.setDone();
-                    } catch (RetryWithWriteLock) {
-                        Client::WriteContext ctx(ns, lockReason);
-
-                        lockedMigrateInsertFirstBatch(cursorObj["firstBatch"].Obj(), insertFlags);
+                    vector<BSONObj> firstBatch;
+                    for (BSONObjIterator it(cursorObj["firstBatch"].Obj()); it.more(); ++it) {
+                        firstBatch.push_back((*it).Obj());
                     }
+                    migrateInsertBatch(firstBatch, insertFlags);
 
-                    for (DBClientCursor cursor(conn.get(), ns, cursorObj["id"].Long(), 0, 0);
-                         cursor.more(); ) {
-                        try {
-                            Client::ReadContext ctx(ns, lockReason);
-                            CounterResetter<long long> numClonedResetter(numCloned);
-                            CounterResetter<long long> clonedBytesResetter(clonedBytes);
-                            DBClientCursor::BatchResetter br(cursor);
-                            DBClientCursorBatchIterator iter(cursor);
-
-                            lockedMigrateInsertBatch(iter, insertFlags);
-
-                            numClonedResetter.setDone();
-                            clonedBytesResetter.setDone();
-                            br.setDone();
-                        } catch (RetryWithWriteLock) {
-                            Client::WriteContext ctx(ns, lockReason);
-                            DBClientCursorBatchIterator iter(cursor);
-
-                            lockedMigrateInsertBatch(iter, insertFlags);
+                    {
+                        // Fetch the following batches in the background while we insert.
+                        DBClientCursor cursor(conn.get(), ns, cursorObj["id"].Long(), 0, 0);
+                        MigrateCloneFetcher fetcher(cursor);
+                        for (MigrateCloneFetcher::Batch batch = fetcher.next(); !batch->empty(); batch = fetcher.next()) {
+                            migrateInsertBatch(*batch, insertFlags);
                         }
                     }
+
+                    if (bulkLoad) {
+                        bulkLoad->commit();
+                        bulkLoad.reset();
+                    }
                 } else {
                     // The old path, for compatibility with older TokuMX servers.
                     LOG(0) << "moveChunk using old migrate path, please upgrade all shards soon" << migrateLog;
 
+                    if (bulkLoad) {
+                        // The old path upserts, which a bulk loaded collection can't do, so just
+                        // commit the empty load and use normal writes.
+                        bulkLoad->commit();
+                        bulkLoad.reset();
+                    }
+
                     while ( true ) {
                         BSONObj res;
                         if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
@@ -2087,7 +2267,7 @@ namespace mongo {
                     // 2) We've checked at least one more time for un-transmitted mods
                     if ( state == COMMIT_START && transferAfterCommit == true ) {
                         if (opReplicatedEnough(lastGTID)) {
-                            storage::log_flush();
+                            waitForLogFlush();
                             break;
                         }
                     }
@@ -200,8 +200,24 @@ namespace mongo {
         bool _doneFindingPoints;
         long long _justSkipped;
         bool _useCursor;
+        bool _inRange;
         BSONObj _lastSplitKey;
 
+        // True if the index rows contain the full document (clustering or primary key), in which
+        // case byte distances in the index are document bytes.  Otherwise they are only key bytes.
+        bool coversDocuments() const {
+            return _idx->clustering() || _cl->isPKIndex(*_idx);
+        }
+
+        void rangeProbeCallback(const storage::KeyV1 *endKey, BSONObj *endPK __attribute__((unused)), uint64_t skipped) {
+            if (endKey == NULL) {
+                _inRange = false;
+                return;
+            }
+            const storage::KeyV1 max(_chunkMax.buf());
+            _inRange = endKey->woCompare(max, _ordering) < 0;
+        }
+
         void isTooBigCallback(const storage::KeyV1 *endKey, BSONObj *endPK __attribute__((unused)), uint64_t skipped) {
             if (endKey == NULL) {
                 return;
@@ -277,7 +293,10 @@ namespace mongo {
             for (shared_ptr<Cursor> c(Cursor::make(_cl, *_idx, _chunkMin.key(), _chunkMax.key(), false, 1)); c->ok(); c->advance()) {
                 const BSONObj &currKey = c->currKey();
                 const BSONObj &currPK = c->currPK();
-                long long docsize = currKey.objsize() + currPK.objsize() + c->current().objsize();
+                long long docsize = currKey.objsize() + currPK.objsize();
+                if (coversDocuments()) {
+                    docsize += c->current().objsize();
+                }
                 if (skipped + docsize > targetChunkSize) {
                     BSONObj splitKey = _chunkPattern.prettyKey(currKey);
                     int c = splitKey.woCompare(_lastSplitKey, _ordering);
@@ -317,12 +336,21 @@ namespace mongo {
                   _doneFindingPoints(false),
                   _justSkipped(0),
                   _useCursor(false),
+                  _inRange(false),
                   _lastSplitKey()
         {
             massert(16799, "shard key pattern must be a prefix of the index key pattern", chunkPattern.isPrefixOf(_idx->keyPattern()));
         }
 
         // Functors that wrap the above callbacks
+        class RangeProbeCallback {
+            SplitVectorFinder &_finder;
+          public:
+            RangeProbeCallback(SplitVectorFinder &finder) : _finder(finder) {}
+            void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+                _finder.rangeProbeCallback(endKey, endPK, skipped);
+            }
+        };
         class IsTooBigCallback {
             SplitVectorFinder &_finder;
           public:
@@ -340,55 +368,158 @@ namespace mongo {
             }
         };
 
-        // Schedules the calls down into get_key_after_bytes.
-        void find(long long maxChunkSize, long long maxSplitPoints) {
-            //
-            //
-            // HACK!!!!! Need to find a better way to do this
-            // TODO: Zardosht talk to Leif about this
-            // Problem is that getKeyAfterBytes is templated, so we cannot virtualize it
-            //
-            //
+      private:
+        //
+        //
+        // HACK!!!!! Need to find a better way to do this
+        // TODO: Zardosht talk to Leif about this
+        // Problem is that getKeyAfterBytes is templated, so we cannot virtualize it
+        //
+        //
+        const IndexDetailsBase *idxBase() const {
             const IndexDetailsBase* idxBase = dynamic_cast<const IndexDetailsBase *>(_idx);
             massert(17237, "bug: failed to dynamically cast IndexDetails to IndexDetailsBase", idxBase != NULL);
+            return idxBase;
+        }
+
+        // If _chunkMin doesn't actually exist (could be {x: MinKey} for example) we need to get the
+        // actual first key in the chunk so that we make sure we don't try to split on the first key.
+        // Returns false if the chunk is empty.
+        bool initLastSplitKey() {
+            shared_ptr<Cursor> c(Cursor::make(_cl, *_idx, _chunkMin.key(), _chunkMax.key(), false, 1, 1));
+            if (!c->ok()) {
+                return false;
+            }
+            _lastSplitKey = _chunkPattern.prettyKey(c->currKey());
+            return true;
+        }
+
+        void findPoints(long long targetChunkSize, long long maxSplitPoints) {
+            GetPointCallback cb(*this);
+            while (!_doneFindingPoints) {
+                if (maxSplitPoints && _splitPoints.size() >= (size_t) maxSplitPoints) {
+                    break;
+                }
+                if (_useCursor) {
+                    slowFindSplitPoint(targetChunkSize - _justSkipped);
+                    _useCursor = false;
+                }
+                else {
+                    idxBase()->getKeyAfterBytes(_chunkMin, targetChunkSize, cb);
+                }
+            }
+        }
+
+      public:
+        // Estimates the number of bytes the chunk occupies in the index, without scanning it.
+        //
+        // get_key_after_bytes only answers "which key is n bytes past the start", so we binary
+        // search for the smallest n that lands on or past the chunk's max.  Each probe is a single
+        // root-to-leaf descent, so this is O(log(indexSize) * treeHeight).
+        long long estimateChunkBytes() {
+            DB_BTREE_STAT64 st;
+            _idx->getStat64(&st);
+            long long lo = 0;
+            long long hi = std::max((long long) st.bt_dsize, 1LL);
+            RangeProbeCallback cb(*this);
+            idxBase()->getKeyAfterBytes(_chunkMin, hi, cb);
+            if (_inRange) {
+                // The stats are estimates too, the chunk may go past what they report.
+                return hi;
+            }
+            // Stop once we're within ~3% of the answer, that's well inside the error of the
+            // estimates get_key_after_bytes gives us anyway.
+            while (hi - lo > std::max(lo / 32, 1024LL)) {
+                const long long mid = lo + (hi - lo) / 2;
+                idxBase()->getKeyAfterBytes(_chunkMin, mid, cb);
+                if (_inRange) {
+                    lo = mid;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            return hi;
+        }
+
+        // Schedules the calls down into get_key_after_bytes.
+        //
+        // maxChunkSize is the size (in index bytes) past which a chunk is considered too big, and
+        // targetChunkSize is the size (in index bytes) we want each resulting chunk to have.
+        void find(long long maxChunkSize, long long targetChunkSize, long long maxSplitPoints) {
             {
                 IsTooBigCallback cb(*this);
-                idxBase->getKeyAfterBytes(_chunkMin, maxChunkSize, cb);
+                idxBase()->getKeyAfterBytes(_chunkMin, maxChunkSize, cb);
             }
             if (!_chunkTooBig) {
                 return;
             }
-            {
-                // If _chunkMin doesn't actually exist (could be {x: MinKey} for example) we need to
-                // get the actual first key in the chunk so that we make sure we don't try to split
-                // on the first key.
-                shared_ptr<Cursor> c(Cursor::make(_cl, *_idx, _chunkMin.key(), _chunkMax.key(), false, 1, 1));
-                massert(16794, "didn't find anything actually in our chunk, but we thought we should split it", c->ok());
-                _lastSplitKey = _chunkPattern.prettyKey(c->currKey());
-            }
-            {
-                GetPointCallback cb(*this);
-                const long long targetChunkSize = maxChunkSize / 2;
-                while (!_doneFindingPoints) {
-                    if (maxSplitPoints && _splitPoints.size() >= (size_t) maxSplitPoints) {
-                        break;
-                    }
-                    if (_useCursor) {
-                        slowFindSplitPoint(targetChunkSize - _justSkipped);
-                        _useCursor = false;
-                    }
-                    else {
-                        idxBase->getKeyAfterBytes(_chunkMin, targetChunkSize, cb);
-                    }
-                }
+            massert(16794, "didn't find anything actually in our chunk, but we thought we should split it", initLastSplitKey());
+            findPoints(targetChunkSize, maxSplitPoints);
+        }
+
+        // Finds one split point near the middle of the chunk, by bytes.
+        void findMedian() {
+            const long long chunkBytes = estimateChunkBytes();
+            if (!initLastSplitKey()) {
+                return;
             }
+            findPoints(std::max(chunkBytes / 2, 1LL), 1);
         }
     };
 
+    // get_key_after_bytes measures distances in bytes of the index it walks.  Translates the
+    // requested chunk limits (document bytes and/or number of documents) into that unit using the
+    // index's and the collection's statistics, so we can find split points without a scan.
+    //
+    // Following the semantics of the old scanning code, a chunk is too big if it has more than
+    // maxChunkSize bytes or more than maxChunkObjects documents, and we aim for chunks of half of
+    // maxChunkSize bytes, but at most maxChunkObjects documents.
+    static void estimateIndexChunkBytes(Collection *cl, const IndexDetails &idx,
+                                        long long maxChunkSize, long long maxChunkObjects,
+                                        long long &maxIndexBytes, long long &targetIndexBytes) {
+        DB_BTREE_STAT64 st;
+        idx.getStat64(&st);
+
+        long long sizeBytes = maxChunkSize;
+        if (sizeBytes > 0 && !(idx.clustering() || cl->isPKIndex(idx))) {
+            // A non-clustering secondary index only has keys and PKs, so scale the document bytes
+            // by the ratio of its size to the size of the primary key index.
+            DB_BTREE_STAT64 pkSt;
+            cl->getPKIndex().getStat64(&pkSt);
+            if (pkSt.bt_dsize > 0) {
+                sizeBytes = (long long) ((double) maxChunkSize * st.bt_dsize / pkSt.bt_dsize);
+            }
+        }
+
+        long long objBytes = 0;
+        if (maxChunkObjects > 0) {
+            const long long avgRowSize = st.bt_nkeys > 0 ? std::max((long long) (st.bt_dsize / st.bt_nkeys), 1LL) : 1;
+            objBytes = maxChunkObjects * avgRowSize;
+        }
+
+        if (sizeBytes > 0 && (objBytes <= 0 || sizeBytes < objBytes)) {
+            maxIndexBytes = sizeBytes;
+        }
+        else {
+            maxIndexBytes = objBytes;
+        }
+        if (sizeBytes > 0 && (objBytes <= 0 || sizeBytes / 2 < objBytes)) {
+            targetIndexBytes = sizeBytes / 2;
+        }
+        else {
+            targetIndexBytes = objBytes;
+        }
+        maxIndexBytes = std::max(maxIndexBytes, 1LL);
+        targetIndexBytes = std::max(targetIndexBytes, 1LL);
+    }
+
     class SplitVector : public QueryCommand {
     public:
         SplitVector() : QueryCommand("splitVector") {}
         virtual bool slaveOk() const { return false; }
+        // mongodump uses it to split big collections, possibly reading from a secondary
+        virtual bool slaveOverrideOk() const { return true; }
         virtual void help( stringstream &help ) const {
             help <<
                  "Internal command.\n"
@@ -396,6 +527,7 @@ namespace mongo {
                  "  { splitVector : \"blog.post\" , keyPattern:{x:1} , min:{x:10} , max:{x:20}, maxChunkSize:200 }\n"
                  "  maxChunkSize unit in MBs\n"
                  "  May optionally specify 'maxSplitPoints' to avoid traversing the whole chunk\n"
+                 "  May optionally specify 'maxChunkObjects' to also limit the number of documents per chunk\n"
                  "  \n"
                  "  { splitVector : \"blog.post\" , keyPattern:{x:1} , min:{x:10} , max:{x:20}, force: true }\n"
                  "  'force' will produce one split point even if data is small; defaults to false\n"
@@ -476,9 +608,11 @@ namespace mongo {
             // 'force'-ing a split is equivalent to having maxChunkSize be the size of the current chunk, i.e., the
             // logic below will split that chunk in half
             long long maxChunkSize = 0;
+            long long maxChunkObjects = 0;
             bool forceMedianSplit = false;
             {
                 BSONElement maxSizeElem = jsobj[ "maxChunkSize" ];
+                BSONElement maxDocsElem = jsobj[ "maxChunkObjects" ];
                 BSONElement forceElem = jsobj[ "force" ];
 
                 if ( forceElem.trueValue() ) {
@@ -494,17 +628,33 @@ namespace mongo {
                     }
                 }
 
-                if ( !forceMedianSplit && maxChunkSize <= 0 ) {
+                if ( maxDocsElem.isNumber() ) {
+                    maxChunkObjects = maxDocsElem.numberLong();
+                }
+
+                if ( !forceMedianSplit && maxChunkSize <= 0 && maxChunkObjects <= 0 ) {
                     errmsg = "need to specify the desired max chunk size (maxChunkSize or maxChunkSizeBytes)";
                     return false;
                 }
             }
 
-            if (!forceMedianSplit && idx->clustering()) {
+            if (dynamic_cast<const IndexDetailsBase *>(idx) != NULL) {
+                // Estimate split points from the index statistics with get_key_after_bytes, so
+                // that neither autosplit nor the median key lookup has to walk the chunk.
+                Timer timer;
                 SplitVectorFinder finder(cl, idx, keyPattern, min, max, splitKeys);
-                finder.find(maxChunkSize, maxSplitPoints);
+                if (forceMedianSplit) {
+                    finder.findMedian();
+                }
+                else {
+                    long long maxIndexBytes, targetIndexBytes;
+                    estimateIndexChunkBytes(cl, *idx, maxChunkSize, maxChunkObjects, maxIndexBytes, targetIndexBytes);
+                    finder.find(maxIndexBytes, targetIndexBytes, maxSplitPoints);
+                }
+                result.append( "timeMillis", timer.millis() );
             } else {
-                // Haven't implemented a better version using get_key_after_bytes yet, do the slow thing
+                // Partitioned collections' indexes can't do get_key_after_bytes across partitions
+                // yet, do the slow thing
                 CollectionData::Stats stats;
                 cl->fillCollectionStats(stats, NULL, 1);
                 const long long recCount = stats.count;
@@ -518,7 +668,9 @@ namespace mongo {
                 }
 
                 // If there's not enough data for more than one chunk, no point continuing.
-                if ( dataSize < maxChunkSize || recCount == 0 ) {
+                if ( recCount == 0 ||
+                     ( ( maxChunkSize <= 0 || dataSize < maxChunkSize ) &&
+                       ( maxChunkObjects <= 0 || recCount < maxChunkObjects ) ) ) {
                     vector<BSONObj> emptyVector;
                     result.append( "splitKeys" , emptyVector );
                     return true;
@@ -558,7 +710,9 @@ namespace mongo {
                             currCount++;
 
                             // we want ~half-full chunks
-                            if (2 * currSize > maxChunkSize && !forceMedianSplit) {
+                            if (!forceMedianSplit &&
+                                ((maxChunkSize > 0 && 2 * currSize > maxChunkSize) ||
+                                 (maxChunkObjects > 0 && currCount > maxChunkObjects))) {
                                 BSONObj currKey = c->prettyKey(c->currKey()).extractFields(keyPattern);
                                 // Do not use this split key if it is the same used in the previous split point.
                                 if (currKey.woCompare(splitKeys.back()) == 0) {
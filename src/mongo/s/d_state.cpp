@@ -54,9 +54,35 @@ namespace mongo {
     ShardingState::ShardingState()
         : _enabled(false) , _mutex( "ShardingState" ),
           _configServerTickets( 3 /* max number of concurrent config server refresh threads */ ),
+          _chunks( new ChunkManagersMap() ),
           _rwlock("ShardingState") {
     }
 
+    const ShardingState::ChunkManagersMap& ShardingState::chunks() const {
+        ChunksSnapshot* snapshot = _chunksSnapshot.get();
+        if ( ! snapshot ) {
+            snapshot = new ChunksSnapshot();
+            _chunksSnapshot.reset( snapshot );
+        }
+        // publishChunks() replaces _chunks before bumping the generation, so if we see the new
+        // generation we load a map at least that new
+        const unsigned long long generation = _chunksGeneration.load();
+        if ( ! snapshot->chunks || snapshot->generation != generation ) {
+            snapshot->chunks = boost::atomic_load( &_chunks );
+            snapshot->generation = generation;
+        }
+        return *snapshot->chunks;
+    }
+
+    shared_ptr<ShardingState::ChunkManagersMap> ShardingState::copyChunks() const {
+        return shared_ptr<ChunkManagersMap>( new ChunkManagersMap( *_chunks ) );
+    }
+
+    void ShardingState::publishChunks( const shared_ptr<ChunkManagersMap>& chunks ) {
+        boost::atomic_store( &_chunks, ChunkManagersMapPtr( chunks ) );
+        _chunksGeneration.fetchAndAdd( 1 );
+    }
+
     void ShardingState::enable( const string& server ) {
         // Until sharding is enabled, normal clients will not take the ShardingState rwlock
         // (ShardedOperationScope) for speed.  So when we want to transition to sharding being
@@ -130,22 +156,19 @@ namespace mongo {
         _configServer.clear();
         _shardName.clear();
         _shardHost.clear();
-        _chunks.clear();
+        publishChunks( shared_ptr<ChunkManagersMap>( new ChunkManagersMap() ) );
     }
 
     // TODO we shouldn't need three ways for checking the version. Fix this.
     bool ShardingState::hasVersion( const string& ns ) {
-        scoped_lock lk(_mutex);
-
-        ChunkManagersMap::const_iterator it = _chunks.find(ns);
-        return it != _chunks.end();
+        const ChunkManagersMap& chunksMap = chunks();
+        return chunksMap.find( ns ) != chunksMap.end();
     }
 
     bool ShardingState::hasVersion( const string& ns , ConfigVersion& version ) {
-        scoped_lock lk(_mutex);
-
-        ChunkManagersMap::const_iterator it = _chunks.find(ns);
-        if ( it == _chunks.end() )
+        const ChunkManagersMap& chunksMap = chunks();
+        ChunkManagersMap::const_iterator it = chunksMap.find(ns);
+        if ( it == chunksMap.end() )
             return false;
 
         ShardChunkManagerPtr p = it->second;
@@ -154,10 +177,9 @@ namespace mongo {
     }
 
     const ConfigVersion ShardingState::getVersion( const string& ns ) const {
-        scoped_lock lk(_mutex);
-
-        ChunkManagersMap::const_iterator it = _chunks.find( ns );
-        if ( it != _chunks.end() ) {
+        const ChunkManagersMap& chunksMap = chunks();
+        ChunkManagersMap::const_iterator it = chunksMap.find( ns );
+        if ( it != chunksMap.end() ) {
             ShardChunkManagerPtr p = it->second;
             return p->getVersion();
         }
@@ -169,8 +191,9 @@ namespace mongo {
     void ShardingState::donateChunk( const string& ns , const BSONObj& min , const BSONObj& max , ChunkVersion version ) {
         scoped_lock lk( _mutex );
 
-        ChunkManagersMap::const_iterator it = _chunks.find( ns );
-        verify( it != _chunks.end() ) ;
+        shared_ptr<ChunkManagersMap> chunksMap = copyChunks();
+        ChunkManagersMap::const_iterator it = chunksMap->find( ns );
+        verify( it != chunksMap->end() ) ;
         ShardChunkManagerPtr p = it->second;
 
         // empty shards should have version 0
@@ -179,33 +202,40 @@ namespace mongo {
         ShardChunkManagerPtr cloned( p->cloneMinus( min , max , version ) );
         // TODO: a bit dangerous to have two different zero-version states - no-manager and
         // no-version
-        _chunks[ns] = cloned;
+        (*chunksMap)[ns] = cloned;
+        publishChunks( chunksMap );
     }
 
     void ShardingState::undoDonateChunk( const string& ns , const BSONObj& min , const BSONObj& max , ChunkVersion version ) {
         scoped_lock lk( _mutex );
         log() << "ShardingState::undoDonateChunk acquired _mutex" << endl;
 
-        ChunkManagersMap::const_iterator it = _chunks.find( ns );
-        verify( it != _chunks.end() ) ;
+        shared_ptr<ChunkManagersMap> chunksMap = copyChunks();
+        ChunkManagersMap::const_iterator it = chunksMap->find( ns );
+        verify( it != chunksMap->end() ) ;
         ShardChunkManagerPtr p( it->second->clonePlus( min , max , version ) );
-        _chunks[ns] = p;
+        (*chunksMap)[ns] = p;
+        publishChunks( chunksMap );
     }
 
     void ShardingState::splitChunk( const string& ns , const BSONObj& min , const BSONObj& max , const vector<BSONObj>& splitKeys ,
                                     ChunkVersion version ) {
         scoped_lock lk( _mutex );
 
-        ChunkManagersMap::const_iterator it = _chunks.find( ns );
-        verify( it != _chunks.end() ) ;
+        shared_ptr<ChunkManagersMap> chunksMap = copyChunks();
+        ChunkManagersMap::const_iterator it = chunksMap->find( ns );
+        verify( it != chunksMap->end() ) ;
         ShardChunkManagerPtr p( it->second->cloneSplit( min , max , splitKeys , version ) );
-        _chunks[ns] = p;
+        (*chunksMap)[ns] = p;
+        publishChunks( chunksMap );
     }
 
     void ShardingState::resetVersion( const string& ns ) {
         scoped_lock lk( _mutex );
 
-        _chunks.erase( ns );
+        shared_ptr<ChunkManagersMap> chunksMap = copyChunks();
+        chunksMap->erase( ns );
+        publishChunks( chunksMap );
     }
 
     bool ShardingState::trySetVersion( const string& ns , ConfigVersion& version /* IN-OUT */ ) {
@@ -237,9 +267,9 @@ namespace mongo {
         ConfigVersion storedVersion;
         ShardChunkManagerPtr currManager;
         {
-            scoped_lock lk( _mutex );
-            ChunkManagersMap::const_iterator it = _chunks.find( ns );
-            if( it == _chunks.end() ){
+            const ChunkManagersMap& chunksMap = chunks();
+            ChunkManagersMap::const_iterator it = chunksMap.find( ns );
+            if( it == chunksMap.end() ){
 
                 // TODO: We need better semantic distinction between *no manager found* and
                 // *manager of version zero found*
@@ -295,9 +325,11 @@ namespace mongo {
 
             // since we loaded the chunk manager unlocked, other thread may have done the same
             // make sure we keep the freshest config info only
-            ChunkManagersMap::const_iterator it = _chunks.find( ns );
-            if ( it == _chunks.end() || p->getVersion() >= it->second->getVersion() ) {
-                _chunks[ns] = p;
+            ChunkManagersMap::const_iterator it = _chunks->find( ns );
+            if ( it == _chunks->end() || p->getVersion() >= it->second->getVersion() ) {
+                shared_ptr<ChunkManagersMap> chunksMap = copyChunks();
+                (*chunksMap)[ns] = p;
+                publishChunks( chunksMap );
             }
 
             ChunkVersion oldVersion = version;
@@ -318,9 +350,8 @@ namespace mongo {
         {
             BSONObjBuilder bb( b.subobjStart( "versions" ) );
 
-            scoped_lock lk(_mutex);
-
-            for ( ChunkManagersMap::iterator it = _chunks.begin(); it != _chunks.end(); ++it ) {
+            const ChunkManagersMap& chunksMap = chunks();
+            for ( ChunkManagersMap::const_iterator it = chunksMap.begin(); it != chunksMap.end(); ++it ) {
                 ShardChunkManagerPtr p = it->second;
                 bb.appendTimestamp( it->first , p->getVersion().toLong() );
             }
@@ -340,10 +371,9 @@ namespace mongo {
     }
 
     ShardChunkManagerPtr ShardingState::getShardChunkManager( const string& ns ) {
-        scoped_lock lk( _mutex );
-
-        ChunkManagersMap::const_iterator it = _chunks.find( ns );
-        if ( it == _chunks.end() ) {
+        const ChunkManagersMap& chunksMap = chunks();
+        ChunkManagersMap::const_iterator it = chunksMap.find( ns );
+        if ( it == chunksMap.end() ) {
             return ShardChunkManagerPtr();
         }
         else {
@@ -304,6 +304,9 @@ namespace mongo {
         // Controls whether we throw on initially failing to set a version
         static bool ignoreInitialVersionFailure;
 
+        // Whether we ask shards to compress what's sent over our connections to them
+        static bool networkCompression;
+
         /** checks all of my thread local connections for the version of this ns */
         static void checkMyConnectionVersions( const string & ns );
 
@@ -43,6 +43,14 @@ namespace mongo {
                                       true,
                                       true );
 
+    bool ShardConnection::networkCompression( false );
+    ExportedServerParameter<bool>
+        _shardNetworkCompression( ServerParameterSet::getGlobal(),
+                                  "shardNetworkCompression",
+                                  &ShardConnection::networkCompression,
+                                  true,
+                                  true );
+
     DBConnectionPool shardConnectionPool;
 
     class ClientConnections;
@@ -396,6 +404,9 @@ namespace mongo {
     void ShardConnection::_init() {
         verify( _addr.size() );
         _conn = ClientConnections::threadInstance()->get( _addr , _ns );
+        if ( networkCompression ) {
+            _conn->enableCompression();
+        }
         _finishedInit = false;
         usingAShardConnection( _addr );
     }
@@ -26,6 +26,7 @@
 #include <boost/thread/thread.hpp>
 
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/namespacestring.h"
 #include "mongo/scripting/bson_template_evaluator.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/md5.h"
@@ -66,11 +67,62 @@ namespace mongo {
     void BenchRunEventCounter::reset() {
         _numEvents = 0;
         _totalTimeMicros = 0;
+        _maxTimeMicros = 0;
+        std::fill(_buckets, _buckets + numBuckets, 0);
     }
 
     void BenchRunEventCounter::updateFrom(const BenchRunEventCounter &other) {
         _numEvents += other._numEvents;
         _totalTimeMicros += other._totalTimeMicros;
+        _maxTimeMicros = std::max(_maxTimeMicros, other._maxTimeMicros);
+        for (int i = 0; i < numBuckets; ++i)
+            _buckets[i] += other._buckets[i];
+    }
+
+    int BenchRunEventCounter::bucketFor(unsigned long long timeMicros) {
+        if (timeMicros < subBuckets)
+            return timeMicros;
+        int bits = subBucketBits;
+        while (bits < maxBits - 1 && (timeMicros >> (bits + 1)) != 0)
+            ++bits;
+        if ((timeMicros >> (bits + 1)) != 0)
+            return numBuckets - 1;
+        int shift = bits - subBucketBits;
+        int sub = (timeMicros >> shift) & (subBuckets - 1);
+        return subBuckets + shift * subBuckets + sub;
+    }
+
+    unsigned long long BenchRunEventCounter::bucketUpperBound(int bucket) {
+        if (bucket < subBuckets)
+            return bucket;
+        int shift = (bucket - subBuckets) / subBuckets;
+        unsigned long long sub = (bucket - subBuckets) % subBuckets;
+        return ((subBuckets + sub + 1) << shift) - 1;
+    }
+
+    unsigned long long BenchRunEventCounter::getPercentileMicros(double p) const {
+        if (_numEvents == 0)
+            return 0;
+        unsigned long long rank = static_cast<unsigned long long>(ceil(p * _numEvents));
+        if (rank < 1)
+            rank = 1;
+        unsigned long long seen = 0;
+        for (int i = 0; i < numBuckets; ++i) {
+            seen += _buckets[i];
+            if (seen >= rank)
+                return std::min(bucketUpperBound(i), _maxTimeMicros);
+        }
+        return _maxTimeMicros;
+    }
+
+    void BenchRunEventCounter::appendLatencies(BSONObjBuilder &b) const {
+        b.appendNumber("count", static_cast<long long>(_numEvents));
+        b.append("averageMicros", _numEvents ? static_cast<double>(_totalTimeMicros) / _numEvents : 0.0);
+        b.appendNumber("p50Micros", static_cast<long long>(getPercentileMicros(0.50)));
+        b.appendNumber("p95Micros", static_cast<long long>(getPercentileMicros(0.95)));
+        b.appendNumber("p99Micros", static_cast<long long>(getPercentileMicros(0.99)));
+        b.appendNumber("p999Micros", static_cast<long long>(getPercentileMicros(0.999)));
+        b.appendNumber("maxMicros", static_cast<long long>(_maxTimeMicros));
     }
 
     BenchRunStats::BenchRunStats() {
@@ -88,7 +140,12 @@ namespace mongo {
         insertCounter.reset();
         deleteCounter.reset();
         queryCounter.reset();
+        commandCounter.reset();
 
+        transactionCounter.reset();
+        transactionsRolledBack = 0;
+
+        opsPerWindow.clear();
         trappedErrors.clear();
     }
 
@@ -102,6 +159,15 @@ namespace mongo {
         insertCounter.updateFrom(other.insertCounter);
         deleteCounter.updateFrom(other.deleteCounter);
         queryCounter.updateFrom(other.queryCounter);
+        commandCounter.updateFrom(other.commandCounter);
+
+        transactionCounter.updateFrom(other.transactionCounter);
+        transactionsRolledBack += other.transactionsRolledBack;
+
+        if (opsPerWindow.size() < other.opsPerWindow.size())
+            opsPerWindow.resize(other.opsPerWindow.size());
+        for (size_t i = 0; i < other.opsPerWindow.size(); ++i)
+            opsPerWindow[i] += other.opsPerWindow[i];
 
         for (size_t i = 0; i < other.trappedErrors.size(); ++i)
             trappedErrors.push_back(other.trappedErrors[i]);
@@ -132,6 +198,8 @@ namespace mongo {
 
         throwGLE = false;
         breakOnTrap = true;
+
+        throughputWindowSeconds = 0;
     }
 
     BenchRunConfig *BenchRunConfig::createFromBson( const BSONObj &args ) {
@@ -166,6 +234,8 @@ namespace mongo {
             this->throwGLE = args["throwGLE"].trueValue();
         if ( ! args["breakOnTrap"].eoo() )
             this->breakOnTrap = args["breakOnTrap"].trueValue();
+        if ( args["throughputWindowSeconds"].isNumber() )
+            this->throughputWindowSeconds = args["throughputWindowSeconds"].number();
 
         uassert(16164, "loopCommands config not supported", args["loopCommands"].eoo());
 
@@ -297,7 +367,7 @@ namespace mongo {
     }
 
     BenchRunWorker::BenchRunWorker(const BenchRunConfig *config, BenchRunState *brState)
-        : _config(config), _brState(brState) {
+        : _config(config), _brState(brState), _inTransaction(false) {
     }
 
     BenchRunWorker::~BenchRunWorker() {}
@@ -310,6 +380,49 @@ namespace mongo {
         return _brState->shouldWorkerFinish();
     }
 
+    void BenchRunWorker::countInWindow() {
+        if ( _config->throughputWindowSeconds <= 0 )
+            return;
+        size_t window = _brState->elapsedMicros() / ( _config->throughputWindowSeconds * 1000 * 1000 );
+        if ( window >= _stats.opsPerWindow.size() )
+            _stats.opsPerWindow.resize( window + 1 );
+        ++_stats.opsPerWindow[window];
+    }
+
+    void BenchRunWorker::rollbackTransaction( DBClientBase *conn, const string &db ) {
+        if ( !_inTransaction )
+            return;
+        _inTransaction = false;
+        _stats.transactionsRolledBack++;
+        try {
+            BSONObj result;
+            conn->runCommand( db, BSON( "rollbackTransaction" << 1 ), result );
+        }
+        catch ( DBException& ex ) {
+            log() << "Error rolling back transaction in benchRun thread" << causedBy( ex ) << endl;
+        }
+    }
+
+    /**
+     * Waits for the write before it as "writeConcern" asks, or just for it to be done if it's
+     * not an object: { w : <n or tag or "majority">, j : <bool>, fsync : <bool>, wtimeout : <ms> }
+     */
+    static BSONObj awaitWriteConcern( DBClientBase* conn, const string& ns,
+                                      const BSONElement& writeConcern ) {
+        if ( !writeConcern.isABSONObj() )
+            return conn->getLastErrorDetailed();
+        BSONObjBuilder cmd;
+        cmd.append( "getlasterror", 1 );
+        cmd.appendElements( writeConcern.Obj() );
+        BSONObj result;
+        conn->runCommand( nsToDatabase( ns ), cmd.done(), result );
+        return result;
+    }
+
+    static bool isTransactionOp( const string& op ) {
+        return op == "beginTransaction" || op == "commitTransaction" || op == "rollbackTransaction";
+    }
+
     void doNothing(const BSONObj&) { }
 
     void BenchRunWorker::generateLoadOnConnection( DBClientBase* conn ) {
@@ -319,6 +432,9 @@ namespace mongo {
 
         BsonTemplateEvaluator bsonTemplateEvaluator;
 
+        // set after an error inside a transaction, to skip to its end
+        bool skippingTransaction = false;
+
         while ( !shouldStop() ) {
             BSONObjIterator i( _config->ops );
             while ( i.more() ) {
@@ -327,9 +443,18 @@ namespace mongo {
 
                 BSONElement e = i.next();
 
-                string ns = e["ns"].String();
                 string op = e["op"].String();
 
+                if ( skippingTransaction ) {
+                    // the rest of a transaction that failed and was rolled back
+                    if ( op == "commitTransaction" || op == "rollbackTransaction" )
+                        skippingTransaction = false;
+                    continue;
+                }
+
+                // transactions are per connection, so they only need a database
+                string ns = e["ns"].eoo() && isTransactionOp( op ) ? _config->db : e["ns"].String();
+
                 int delay = e["delay"].eoo() ? 0 : e["delay"].Int();
 
                 BSONObj context = e["context"].eoo() ? BSONObj() : e["context"].Obj();
@@ -395,8 +520,11 @@ namespace mongo {
                     else if ( op == "command" ) {
 
                         BSONObj result;
-                        conn->runCommand( ns, fixQuery( e["command"].Obj(), bsonTemplateEvaluator ),
-                                          result, e["options"].numberInt() );
+                        {
+                            BenchRunEventTrace _bret(&_stats.commandCounter);
+                            conn->runCommand( ns, fixQuery( e["command"].Obj(), bsonTemplateEvaluator ),
+                                              result, e["options"].numberInt() );
+                        }
 
                         if( check ){
                             int err = scope->invoke( scopeFunc , 0 , &result,  1000 * 60 , false );
@@ -466,14 +594,14 @@ namespace mongo {
                         BSONObj query = e["query"].eoo() ? BSONObj() : e["query"].Obj();
                         BSONObj update = e["update"].Obj();
                         BSONObj result;
-                        bool safe = e["safe"].trueValue();
+                        bool safe = e["safe"].trueValue() || e["writeConcern"].isABSONObj();
 
                         {
                             BenchRunEventTrace _bret(&_stats.updateCounter);
                             conn->update( ns, fixQuery( query, bsonTemplateEvaluator ), update,
                                           upsert , multi );
                             if (safe)
-                                result = conn->getLastErrorDetailed();
+                                result = awaitWriteConcern( conn, ns, e["writeConcern"] );
                         }
 
                         if( safe ){
@@ -496,7 +624,7 @@ namespace mongo {
                         }
                     }
                     else if( op == "insert" ) {
-                        bool safe = e["safe"].trueValue();
+                        bool safe = e["safe"].trueValue() || e["writeConcern"].isABSONObj();
                         int batchSize = e["batchSize"].numberInt();
                         if (batchSize < 1) {
                             batchSize = 1;
@@ -510,7 +638,7 @@ namespace mongo {
                             }
                             conn->insert( ns, insertBatch );
                             if (safe)
-                                result = conn->getLastErrorDetailed();
+                                result = awaitWriteConcern( conn, ns, e["writeConcern"] );
                         }
 
                         if( safe ){
@@ -536,14 +664,14 @@ namespace mongo {
 
                         bool multi = e["multi"].eoo() ? true : e["multi"].trueValue();
                         BSONObj query = e["query"].eoo() ? BSONObj() : e["query"].Obj();
-                        bool safe = e["safe"].trueValue();
+                        bool safe = e["safe"].trueValue() || e["writeConcern"].isABSONObj();
                         BSONObj result;
 
                         {
                             BenchRunEventTrace _bret(&_stats.deleteCounter);
                             conn->remove( ns, fixQuery( query, bsonTemplateEvaluator ), ! multi );
                             if (safe)
-                                result = conn->getLastErrorDetailed();
+                                result = awaitWriteConcern( conn, ns, e["writeConcern"] );
                         }
 
                         if( safe ){
@@ -571,13 +699,45 @@ namespace mongo {
                     else if ( op == "dropIndex" ) {
                         conn->dropIndex( ns , e["key"].Obj()  );
                     }
+                    else if ( op == "beginTransaction" ) {
+                        BSONObjBuilder cmd;
+                        cmd.append( "beginTransaction", 1 );
+                        if ( e["isolation"].type() == String )
+                            cmd.append( "isolation", e["isolation"].String() );
+                        BSONObj result;
+                        _transactionTimer.reset();
+                        uassert( 17394, str::stream() << "beginTransaction failed: " << result,
+                                 conn->runCommand( nsToDatabase( ns ), cmd.done(), result ) );
+                        _inTransaction = true;
+                    }
+                    else if ( op == "commitTransaction" ) {
+                        BSONObj result;
+                        uassert( 17395, str::stream() << "commitTransaction failed: " << result,
+                                 conn->runCommand( nsToDatabase( ns ), BSON( "commitTransaction" << 1 ), result ) );
+                        _inTransaction = false;
+                        _stats.transactionCounter.countOne( _transactionTimer.micros() );
+                    }
+                    else if ( op == "rollbackTransaction" ) {
+                        BSONObj result;
+                        uassert( 17396, str::stream() << "rollbackTransaction failed: " << result,
+                                 conn->runCommand( nsToDatabase( ns ), BSON( "rollbackTransaction" << 1 ), result ) );
+                        _inTransaction = false;
+                        _stats.transactionsRolledBack++;
+                    }
                     else {
                         log() << "don't understand op: " << op << endl;
                         _stats.error = true;
                         return;
                     }
+
+                    countInWindow();
                 }
                 catch( DBException& ex ){
+                    if ( _inTransaction || op == "beginTransaction" ) {
+                        rollbackTransaction( conn, nsToDatabase( ns ) );
+                        skippingTransaction = op != "commitTransaction" && op != "rollbackTransaction";
+                    }
+
                     if( ! _config->hideErrors || e["showError"].trueValue() ){
 
                         bool yesWatch = ( _config->watchPattern && _config->watchPattern->FullMatch( ex.what() ) );
@@ -605,6 +765,11 @@ namespace mongo {
                     _stats.errCount++;
                 }
                 catch( ... ){
+                    if ( _inTransaction || op == "beginTransaction" ) {
+                        rollbackTransaction( conn, nsToDatabase( ns ) );
+                        skippingTransaction = op != "commitTransaction" && op != "rollbackTransaction";
+                    }
+
                     if( ! _config->hideErrors || e["showError"].trueValue() ) log() << "Error in benchRun thread caused by unknown error for op " << e << endl;
                     if( ! _config->handleErrors && ! e["handleError"].trueValue() ) return;
 
@@ -770,6 +935,16 @@ namespace mongo {
                         static_cast<double>(counter.getTotalTimeMicros()) / counter.getNumEvents());
      }
 
+     static void appendLatenciesIfAvailable(
+             BSONObjBuilder &buf, const std::string &name, const BenchRunEventCounter &counter) {
+
+         if (counter.getNumEvents() > 0) {
+             BSONObjBuilder b(buf.subobjStart(name));
+             counter.appendLatencies(b);
+             b.done();
+         }
+     }
+
      BSONObj BenchRunner::finish( BenchRunner* runner ) {
 
          runner->stop();
@@ -797,6 +972,33 @@ namespace mongo {
          appendAverageMicrosIfAvailable(buf, "updateLatencyAverageMicros", stats.updateCounter);
          appendAverageMicrosIfAvailable(buf, "queryLatencyAverageMicros", stats.queryCounter);
 
+         {
+             BSONObjBuilder latency( buf.subobjStart( "latency" ) );
+             appendLatenciesIfAvailable(latency, "findOne", stats.findOneCounter);
+             appendLatenciesIfAvailable(latency, "insert", stats.insertCounter);
+             appendLatenciesIfAvailable(latency, "delete", stats.deleteCounter);
+             appendLatenciesIfAvailable(latency, "update", stats.updateCounter);
+             appendLatenciesIfAvailable(latency, "query", stats.queryCounter);
+             appendLatenciesIfAvailable(latency, "command", stats.commandCounter);
+             appendLatenciesIfAvailable(latency, "transaction", stats.transactionCounter);
+             latency.done();
+         }
+
+         if ( stats.transactionCounter.getNumEvents() > 0 || stats.transactionsRolledBack > 0 ) {
+             buf.append( "transactions",
+                         stats.transactionCounter.getNumEvents() / runner->_config->seconds );
+             buf.append( "transactionsRolledBack", (long long) stats.transactionsRolledBack );
+         }
+
+         if ( runner->_config->throughputWindowSeconds > 0 ) {
+             // ops per second in each window; the last one may be cut short by the end of the run
+             BSONArrayBuilder series( buf.subarrayStart( "throughput" ) );
+             for ( size_t i = 0; i < stats.opsPerWindow.size(); ++i ) {
+                 series.append( stats.opsPerWindow[i] / runner->_config->throughputWindowSeconds );
+             }
+             series.done();
+         }
+
          {
              BSONObjIterator i( after );
              while ( i.more() ) {
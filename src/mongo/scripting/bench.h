@@ -110,13 +110,20 @@ namespace mongo {
         bool throwGLE;
         bool breakOnTrap;
 
+        /**
+         * If positive, the number of operations completed is also reported for each window of
+         * this many seconds, to show how throughput changes over the run.
+         */
+        double throughputWindowSeconds;
+
     private:
         /// Initialize a config object to its default values.
         void initializeToDefaults();
     };
 
     /**
-     * An event counter for events that have an associated duration.
+     * An event counter for events that have an associated duration.  Keeps a histogram of the
+     * durations, to report percentiles.
      *
      * Not thread safe.  Expected use is one instance per thread during parallel execution.
      */
@@ -142,6 +149,9 @@ namespace mongo {
         void countOne(unsigned long long timeMicros) {
             ++_numEvents;
             _totalTimeMicros += timeMicros;
+            if (timeMicros > _maxTimeMicros)
+                _maxTimeMicros = timeMicros;
+            ++_buckets[bucketFor(timeMicros)];
         }
 
         /**
@@ -154,9 +164,34 @@ namespace mongo {
          */
         unsigned long long getNumEvents() const { return _numEvents; }
 
+        unsigned long long getMaxTimeMicros() const { return _maxTimeMicros; }
+
+        /**
+         * Get the duration, in microseconds, that a fraction "p" of the observed events took at
+         * most.  Accurate to within about 6%.
+         */
+        unsigned long long getPercentileMicros(double p) const;
+
+        /**
+         * Append count, average, 50th, 95th, 99th and 99.9th percentile and maximum durations.
+         */
+        void appendLatencies(BSONObjBuilder &b) const;
+
     private:
+        // Durations under 16 micros get a bucket each; above that, each power of two is split
+        // into 16 buckets.
+        static const int subBucketBits = 4;
+        static const int subBuckets = 1 << subBucketBits;
+        static const int maxBits = 40;
+        static const int numBuckets = subBuckets + (maxBits - subBucketBits) * subBuckets;
+
+        static int bucketFor(unsigned long long timeMicros);
+        static unsigned long long bucketUpperBound(int bucket);
+
         unsigned long long _numEvents;
         unsigned long long _totalTimeMicros;
+        unsigned long long _maxTimeMicros;
+        unsigned long long _buckets[numBuckets];
     };
 
     /**
@@ -226,6 +261,14 @@ namespace mongo {
         BenchRunEventCounter insertCounter;
         BenchRunEventCounter deleteCounter;
         BenchRunEventCounter queryCounter;
+        BenchRunEventCounter commandCounter;
+
+        // whole transactions, from beginTransaction to a successful commitTransaction
+        BenchRunEventCounter transactionCounter;
+        unsigned long long transactionsRolledBack;
+
+        // operations completed in each throughputWindowSeconds window of the run
+        std::vector<unsigned long long> opsPerWindow;
 
         std::map<std::string, long long> opcounters;
         std::vector<BSONObj> trappedErrors;
@@ -285,7 +328,13 @@ namespace mongo {
          */
         void onWorkerFinished();
 
+        /**
+         * Microseconds since the activity was created, to place events in throughput windows.
+         */
+        unsigned long long elapsedMicros() const { return _timer.micros(); }
+
     private:
+        Timer _timer;
         boost::mutex _mutex;
         boost::condition _stateChangeCondition;
         unsigned _numUnstartedWorkers;
@@ -332,9 +381,19 @@ namespace mongo {
         /// Predicate, used to decide whether or not it's time to terminate the worker.
         bool shouldStop() const;
 
+        /// Count a completed operation in the current throughput window.
+        void countInWindow();
+
+        /// Roll back the transaction in progress, if any, after an error.
+        void rollbackTransaction( DBClientBase *conn, const string &db );
+
         const BenchRunConfig *_config;
         BenchRunState *_brState;
         BenchRunStats _stats;
+
+        // set between beginTransaction and commitTransaction/rollbackTransaction
+        bool _inTransaction;
+        Timer _transactionTimer;
     };
 
     /**
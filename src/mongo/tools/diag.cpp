@@ -0,0 +1,162 @@
+// diag.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+
+#include "mongo/base/initializer.h"
+#include "mongo/db/diagnostic_data.h"
+#include "mongo/db/diagnostic_data_codec.h"
+#include "mongo/tools/tool.h"
+#include "mongo/util/time_support.h"
+
+using namespace mongo;
+
+namespace po = boost::program_options;
+
+/**
+ * Decodes the diagnostic data mongod collects in <dbpath>/diagnostic.data, either as JSON,
+ * one sample per line, or as CSV of chosen fields, ready to be plotted with e.g. gnuplot.
+ */
+class Diag : public BSONTool {
+    bool _csv;
+    bool _rate;
+    // for --rate, the previous sample's time and fields
+    Date_t _prevStart;
+    vector<double> _prev;
+
+public:
+    Diag() : BSONTool( "diag", NONE ), _csv(false), _rate(false) {
+        addFieldOptions();
+        add_options()
+        ("csv", "output CSV of the fields given with --fields, with the sample time first" )
+        ("rate", "with --csv, output each numeric field's change per second since the previous sample, for counters" )
+        ;
+        add_hidden_options()
+        ("path", po::value<string>(), "a diagnostic data file, or the diagnostic.data directory" )
+        ;
+        addPositionArg( "path", 1 );
+        _noconnection = true;
+    }
+
+    virtual void printExtraHelp(ostream& out) {
+        out << "Decode the diagnostic data collected by mongod.\n" << endl;
+        out << "usage: " << _name << " [options] <dbpath/" << diagnosticDataDirectoryName << " or a file in it>" << endl;
+        out << "  e.g. " << _name << " --csv --rate -f serverStatus.opcounters.insert,serverStatus.opcounters.query <dir>" << endl;
+    }
+
+    virtual int doRun() {
+        _csv = hasParam( "csv" );
+        _rate = hasParam( "rate" );
+        if ( _csv ) {
+            needFields();
+            cout << "start";
+            for ( vector<string>::const_iterator it = _fields.begin(); it != _fields.end(); ++it ) {
+                cout << "," << *it;
+            }
+            cout << endl;
+        }
+        else if ( _rate ) {
+            cerr << "--rate needs --csv" << endl;
+            return 1;
+        }
+
+        boost::filesystem::path root = getParam( "path" );
+        if ( root == "" ) {
+            printExtraHelp( cout );
+            return 1;
+        }
+
+        if ( !boost::filesystem::is_directory( root ) ) {
+            processFile( root );
+            return 0;
+        }
+
+        // the file names sort by creation time, and the interim file, with the latest
+        // samples, sorts last
+        vector<boost::filesystem::path> files;
+        for ( boost::filesystem::directory_iterator it( root ), end; it != end; ++it ) {
+            const string name = it->path().leaf().string();
+            if ( str::startsWith( name, "metrics." ) && !str::endsWith( name, ".tmp" ) ) {
+                files.push_back( it->path() );
+            }
+        }
+        sort( files.begin(), files.end() );
+        for ( vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it ) {
+            processFile( *it );
+        }
+        return 0;
+    }
+
+    virtual void gotObject( const BSONObj& chunk ) {
+        vector<BSONObj> samples;
+        decodeDiagnosticChunk( chunk, &samples );
+        for ( vector<BSONObj>::const_iterator it = samples.begin(); it != samples.end(); ++it ) {
+            if ( _csv ) {
+                writeCSV( *it );
+            }
+            else {
+                cout << it->jsonString( TenGen ) << endl;
+            }
+        }
+    }
+
+private:
+    void writeCSV( const BSONObj& sample ) {
+        const Date_t start = sample["start"].date();
+        vector<double> values( _fields.size() );
+        stringstream line;
+        // counters are whole numbers, keep them out of scientific notation
+        line.precision(15);
+        line << timeToISOString( (time_t) ( start.millis / 1000 ) );
+        for ( size_t i = 0; i < _fields.size(); i++ ) {
+                BSONElement e = sample.getFieldDotted( _fields[i] );
+            line << ",";
+            if ( !e.isNumber() && e.type() != Date ) {
+                if ( !e.eoo() && !_rate ) {
+                    line << e.toString( false );
+                }
+                continue;
+            }
+            values[i] = e.type() == Date ? (double) e.date().millis : e.numberDouble();
+            if ( !_rate ) {
+                line << values[i];
+            }
+            else if ( !_prev.empty() && start.millis > _prevStart.millis ) {
+                line << ( values[i] - _prev[i] ) * 1000 / ( start.millis - _prevStart.millis );
+            }
+        }
+        if ( _rate ) {
+            const bool first = _prev.empty();
+            _prev.swap( values );
+            _prevStart = start;
+            if ( first ) {
+                return;
+            }
+        }
+        cout << line.str() << endl;
+    }
+};
+
+int main( int argc , char ** argv, char **envp ) {
+    mongo::runGlobalInitializersOrDie(argc, argv, envp);
+    Diag diag;
+    return diag.main( argc , argv );
+}
@@ -29,6 +29,7 @@
 #include "mongo/base/initializer.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/namespacestring.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/tools/tool.h"
 
 using namespace mongo;
@@ -44,14 +45,43 @@ class Dump : public Tool {
     private:
         FILE* _f;
     };
+
+    /* The segments of one collection split because of --segmentSize. */
+    struct SegmentGroup : boost::noncopyable {
+        SegmentGroup() : mx("dumpSegmentGroup"), opened(false) {}
+        mongo::mutex mx;
+        // set once the first of the segments to be dumped has opened the cursors of them all
+        bool opened;
+        // indexes in _jobs
+        vector<size_t> jobs;
+    };
+
+    /**
+     * One output file: a whole collection, or one primary key range of a collection split
+     * because of --segmentSize.
+     */
+    struct DumpJob {
+        string ns;
+        boost::filesystem::path outputFile;
+        Query query;
+        // For a segment, the other segments of its collection.
+        boost::shared_ptr<SegmentGroup> segments;
+        // For a segment, its cursor, opened together with the other segments' cursors when the
+        // first of them is dumped, so that their snapshots are taken back to back.  Only the
+        // first batch has been fetched; dumpSegment() gets the rest over another connection.
+        boost::shared_ptr<DBClientCursor> cursor;
+    };
+
 public:
-    Dump() : Tool( "dump" , ALL , "" , "" , true ) {
+    Dump() : Tool( "dump" , ALL , "" , "" , true ), _numParallelCollections(1), _segmentSize(0) {
         add_options()
         ("out,o", po::value<string>()->default_value("dump"), "output directory or \"-\" for stdout")
         ("query,q", po::value<string>() , "json query" )
         ("oplog", "Use oplog for point-in-time snapshotting" )
         ("repair", "try to recover a crashed database" )
         ("forceTableScan", "deprecated" )
+        ("numParallelCollections", po::value<int>(&_numParallelCollections)->default_value(1), "number of collections (or segments, see --segmentSize) to dump at once, each over its own connection" )
+        ("segmentSize", po::value<int>(&_segmentSize)->default_value(0), "split collections bigger than this many MB into primary key ranges of about this size, dumped to separate files (coll.bson, coll.bson.1, ...) that are dumped and restored in parallel. Each range is read from its own snapshot, so a split collection is not dumped at a single point in time if it is written to meanwhile. 0 means never split" )
         ;
     }
 
@@ -93,15 +123,12 @@ public:
         ProgressMeter* _m;
     };
 
-    void doCollection( const string coll , FILE* out , ProgressMeter *m ) {
-        Query q = _query;
-
+    void doCollection( DBClientBase& connBase , const string coll , const Query& q , FILE* out , ProgressMeter *m ) {
         int queryOptions = QueryOption_SlaveOk | QueryOption_NoCursorTimeout;
         if (startsWith(coll.c_str(), "local.oplog.")) {
             queryOptions |= QueryOption_OplogReplay;
         }
         
-        DBClientBase& connBase = conn(true);
         Writer writer(out, m);
 
         // use low-latency "exhaust" mode if going over the network
@@ -119,21 +146,189 @@ public:
         }
     }
 
-    void writeCollectionFile( const string coll , boost::filesystem::path outputFile ) {
-        log() << "\t" << coll << " to " << outputFile.string() << endl;
+    /**
+     * Dumps what is left of a segment's cursor: the rest of the first batch, which was fetched
+     * on the main connection, and then the remaining batches over c.
+     */
+    void dumpSegment( DBClientBase& c , const DumpJob& job , FILE* out , ProgressMeter *m ) {
+        Writer writer(out, m);
+        DBClientCursor& first = *job.cursor;
+        while ( first.moreInCurrentBatch() ) {
+            writer(first.nextSafe());
+        }
+        const long long cursorId = first.getCursorId();
+        if ( cursorId == 0 ) {
+            return;
+        }
+        first.decouple();
+        DBClientCursor rest( &c , job.ns , cursorId , 0 , QueryOption_SlaveOk | QueryOption_NoCursorTimeout );
+        while ( rest.more() ) {
+            writer(rest.nextSafe());
+        }
+    }
+
+    void writeCollectionFile( DBClientBase& c , const DumpJob& job ) {
+        log() << "\t" << job.ns << " to " << job.outputFile.string() << endl;
 
-        FilePtr f (fopen(outputFile.string().c_str(), "wb"));
+        FilePtr f (fopen(job.outputFile.string().c_str(), "wb"));
         uassert(10262, errnoWithPrefix("couldn't open file"), f);
 
-        ProgressMeter m(conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk));
+        // a segment doesn't know how many objects it has
+        ProgressMeter m(job.segments ? 0 : c.count(job.ns.c_str(), BSONObj(), QueryOption_SlaveOk));
         m.setName("Collection File Writing Progress");
         m.setUnits("objects");
 
-        doCollection(coll, f, &m);
+        if (job.cursor) {
+            dumpSegment(c, job, f, &m);
+        }
+        else {
+            // a segment whose cursor couldn't be opened is read on its own
+            doCollection(c, job.ns, job.query, f, &m);
+        }
 
         log() << "\t\t " << m.done() << " objects" << endl;
     }
 
+    void writeCollectionFile( const string coll , boost::filesystem::path outputFile ) {
+        DumpJob job;
+        job.ns = coll;
+        job.outputFile = outputFile;
+        job.query = _query;
+        writeCollectionFile(conn(true), job);
+    }
+
+    /**
+     * Queues the jobs that dump coll.  With --segmentSize, a big collection is split into
+     * primary key ranges with splitVector.  The cursors for all of them are opened when the
+     * first one is dumped (see openSegmentCursors()), so each range is read from an MVCC
+     * snapshot taken at nearly the same time, without the server holding snapshots for
+     * collections that are still waiting their turn.  They are still separate snapshots: one
+     * transaction can't cover them all, because a cursor of a multi-statement transaction
+     * can't be read from another connection.  Writes that land between two of them can be
+     * seen by some segments and not others, which the user is warned about.
+     */
+    void addCollectionJobs( const string coll , const boost::filesystem::path outputFile ,
+                            const BSONObj& options ) {
+        DumpJob job;
+        job.ns = coll;
+        job.outputFile = outputFile;
+        job.query = _query;
+
+        vector<BSONObj> splitKeys;
+        if ( _segmentSize > 0 && _canSplit && !options["capped"].trueValue() &&
+             !options["partitioned"].trueValue() && !NamespaceString::isSystem(coll) ) {
+            findSplitKeys(coll, pkPattern(options), &splitKeys);
+        }
+        if ( splitKeys.empty() ) {
+            _jobs.push_back(job);
+            return;
+        }
+
+        log() << "\t" << coll << " is split into " << splitKeys.size() + 1 << " segments" << endl;
+        warning() << "the segments of " << coll << " are read from separate snapshots, so the dump "
+                  << "of it is not from a single point in time if it is being written to" << endl;
+        job.segments.reset(new SegmentGroup);
+        for ( size_t i = 0; i <= splitKeys.size(); i++ ) {
+            DumpJob segment = job;
+            Query q = Query(_query).hint(pkPattern(options));
+            if ( i > 0 ) {
+                q.minKey(splitKeys[i - 1]);
+                segment.outputFile = outputFile.string() + "." + BSONObjBuilder::numStr(i);
+            }
+            if ( i < splitKeys.size() ) {
+                q.maxKey(splitKeys[i]);
+            }
+            segment.query = q;
+            job.segments->jobs.push_back(_jobs.size());
+            _jobs.push_back(segment);
+        }
+    }
+
+    /**
+     * Opens the cursors of all segments in job's group over c, unless another segment of the
+     * group already did.  Must be called before dumping any segment.
+     */
+    void openSegmentCursors( DBClientBase& c , const DumpJob& job ) {
+        SegmentGroup& group = *job.segments;
+        scoped_lock lk(group.mx);
+        if ( group.opened ) {
+            return;
+        }
+        group.opened = true;
+        for ( vector<size_t>::const_iterator it = group.jobs.begin(); it != group.jobs.end(); ++it ) {
+            DumpJob& segment = _jobs[*it];
+            segment.cursor.reset(c.query(segment.ns, segment.query, 0, 0, 0,
+                                         QueryOption_SlaveOk | QueryOption_NoCursorTimeout).release());
+            uassert(17383, str::stream() << "couldn't open a cursor for a segment of " << segment.ns,
+                    segment.cursor.get() != NULL);
+        }
+    }
+
+    static BSONObj pkPattern( const BSONObj& options ) {
+        return options["primaryKey"].isABSONObj() ? options["primaryKey"].Obj() : BSON("_id" << 1);
+    }
+
+    void findSplitKeys( const string coll , const BSONObj& pk , vector<BSONObj> *splitKeys ) {
+        // splitVector aims for chunks of half of maxChunkSize
+        const long long maxChunkSizeBytes = 2LL * _segmentSize * 1024 * 1024;
+        BSONObj res;
+        if ( !conn(true).runCommand(nsToDatabase(coll),
+                                    BSON("splitVector" << coll << "keyPattern" << pk <<
+                                         "maxChunkSizeBytes" << maxChunkSizeBytes),
+                                    res, QueryOption_SlaveOk) ) {
+            warning() << "couldn't split " << coll << ", dumping it in one piece: " << res << endl;
+            return;
+        }
+        BSONForEach(e, res["splitKeys"].Obj()) {
+            splitKeys->push_back(e.Obj().getOwned());
+        }
+    }
+
+    /**
+     * Dumps the queued jobs, --numParallelCollections at a time, each thread with its own
+     * connection.
+     * @return the number of jobs that failed
+     */
+    int runJobs() {
+        vector<boost::shared_ptr<DBClientBase> > conns;
+        for ( int i = 1; i < _numParallelCollections && i < (int) _jobs.size(); i++ ) {
+            DBClientBase *c = newConnection();
+            if ( c == NULL ) {
+                warning() << "--numParallelCollections is ignored with --dbpath" << endl;
+                break;
+            }
+            conns.push_back(boost::shared_ptr<DBClientBase>(c));
+        }
+
+        _nextJob.store(0);
+        _failedJobs.store(0);
+        boost::thread_group threads;
+        for ( vector<boost::shared_ptr<DBClientBase> >::iterator it = conns.begin(); it != conns.end(); ++it ) {
+            threads.create_thread(boost::bind(&Dump::dumpJobs, this, it->get()));
+        }
+        dumpJobs(&conn(true));
+        threads.join_all();
+
+        _jobs.clear();
+        return _failedJobs.load();
+    }
+
+    void dumpJobs( DBClientBase *c ) {
+        for ( unsigned i = _nextJob.fetchAndAdd(1); i < _jobs.size(); i = _nextJob.fetchAndAdd(1) ) {
+            try {
+                if ( _jobs[i].segments ) {
+                    openSegmentCursors(*c, _jobs[i]);
+                }
+                writeCollectionFile(*c, _jobs[i]);
+            }
+            catch ( DBException& e ) {
+                error() << "couldn't dump " << _jobs[i].ns << " to "
+                        << _jobs[i].outputFile.string() << ": " << e.toString() << endl;
+                _failedJobs.fetchAndAdd(1);
+            }
+        }
+    }
+
     void writeMetadataFile( const string coll, boost::filesystem::path outputFile, 
                             map<string, BSONObj> options, multimap<string, BSONObj> indexes, map<string, BSONObj> partitionInfo) {
         log() << "\tMetadata for " << coll << " to " << outputFile.string() << endl;
@@ -173,7 +368,7 @@ public:
 
 
     void writeCollectionStdout( const string coll ) {
-        doCollection(coll, stdout, NULL);
+        doCollection(conn(true), coll, _query, stdout, NULL);
     }
 
     void go( const string db , const boost::filesystem::path outdir ) {
@@ -247,7 +442,7 @@ public:
         for (vector<string>::iterator it = collections.begin(); it != collections.end(); ++it) {
             string name = *it;
             const string filename = name.substr( db.size() + 1 );
-            writeCollectionFile( name , outdir / ( filename + ".bson" ) );
+            addCollectionJobs( name , outdir / ( filename + ".bson" ) , collectionOptions[name] );
             writeMetadataFile( name, outdir / (filename + ".metadata.json"), collectionOptions, indexes, partitionInfo);
         }
 
@@ -333,6 +528,12 @@ public:
         }
 
         _usingMongos = isMongos();
+        // Segments are read by handing their cursors over to other connections, which needs
+        // getMores to reach the server the cursor was opened on.
+        _canSplit = !_usingMongos && typeid(conn(true)) == typeid(DBClientConnection);
+        if ( _segmentSize > 0 && !_canSplit ) {
+            warning() << "--segmentSize only works when connected directly to a mongod" << endl;
+        }
 
         boost::filesystem::path root( out );
         string db = _db;
@@ -374,6 +575,11 @@ public:
             go( db , root / db );
         }
 
+        if ( runJobs() > 0 ) {
+            error() << "some collections could not be dumped" << endl;
+            return -1;
+        }
+
         if (!opLogName.empty()) {
             BSONObjBuilder b;
             b.appendDate("$gt", opLogStart);
@@ -387,7 +593,13 @@ public:
     }
 
     bool _usingMongos;
+    bool _canSplit;
     BSONObj _query;
+    int _numParallelCollections;
+    int _segmentSize;
+    vector<DumpJob> _jobs;
+    AtomicUInt32 _nextJob;
+    AtomicUInt32 _failedJobs;
 };
 
 int main( int argc , char ** argv, char ** envp ) {
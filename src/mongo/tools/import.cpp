@@ -21,15 +21,20 @@
 #include "mongo/db/json.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/tools/tool.h"
+#include "mongo/util/queue.h"
 #include "mongo/util/text.h"
+#include "mongo/util/timer.h"
 #include "mongo/base/initializer.h"
 #include "mongo/client/remote_loader.h"
+#include "mongo/platform/atomic_word.h"
 
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace mongo;
 using std::string;
@@ -49,8 +54,56 @@ class Import : public Tool {
     bool _doimport;
     bool _jsonArray;
     bool _doBulkLoad;
+    bool _stopOnError;
+    bool _maintainInsertionOrder;
+    int _numParallelConnections;
+    int _numParsingThreads;
     vector<string> _upsertFields;
     static const int BUF_SIZE;
+    // the reader hands input to the parsers in chunks of about this many bytes
+    static const int CHUNK_SIZE;
+
+    /*
+     * Whole records cut from the input by the reader.  Each record ends with a newline, which
+     * the parser overwrites to terminate it.
+     */
+    struct InputChunk {
+        long long seq;
+        string data;
+        vector<pair<size_t, size_t> > records; // [begin, end) in data
+    };
+
+    /* The documents parsed from one InputChunk, in input order. */
+    struct ParsedChunk {
+        long long seq;
+        long long bytes;
+        vector<BSONObj> objs;
+        bool stop; // a record failed to parse and --stopOnError was given
+    };
+
+    BlockingQueue<boost::shared_ptr<InputChunk> > _toParse;
+    BlockingQueue<boost::shared_ptr<ParsedChunk> > _parsed;
+    // With _maintainInsertionOrder, a parser holds on to a chunk until its seq is less than
+    // _nextToSend + MAX_WAITING_CHUNKS, so one slow chunk can't have the rest of the file pile
+    // up in the sender's memory.  The chunk the sender waits for is always let through.
+    static const int MAX_WAITING_CHUNKS;
+    mongo::mutex _sendWindowMutex;
+    boost::condition _sendWindowMoved;
+    long long _nextToSend;
+    // set when the import should stop at the next chance, after --stopOnError
+    AtomicUInt32 _stop;
+    AtomicInt64 _parseErrors;
+
+    // state of the sending side, only touched by the thread in run()
+    string _ns;
+    scoped_ptr<ParallelInserter> _inserter;
+    vector<BSONObj> _batch;
+    int _batchBytes;
+    bool _checkedFirstInsert;
+    long long _num;
+    long long _numBytes;
+    int _sendErrors;
+    bool _stopped;
 
     void csvTokenizeRow(const string& row, vector<string>& tokens) {
         bool inQuotes = false;
@@ -109,28 +162,14 @@ class Import : public Tool {
     }
 
     /*
-     * Reads one line from in into buf.
+     * Reads a whole JSON array from in into buf.
      * Returns the number of bytes that should be skipped - the caller should
      * increment buf by this amount.
      */
-    int getLine(istream* in, char* buf) {
-        if (_jsonArray) {
-            in->read(buf, BUF_SIZE);
-            uassert(13295, "JSONArray file too large", (in->rdstate() & ios_base::eofbit));
-            buf[ in->gcount() ] = '\0';
-        }
-        else {
-            in->getline( buf , BUF_SIZE );
-            if ((in->rdstate() & ios_base::eofbit) && (in->rdstate() & ios_base::failbit)) {
-                // this is the last line, and it's empty (not even a newline)
-                buf[0] = '\0';
-                return 0;
-            }
-
-            uassert(16329, str::stream() << "read error, or input line too long (max length: "
-                    << BUF_SIZE << ")", !(in->rdstate() & ios_base::failbit));
-            LOG(1) << "got line:" << buf << endl;
-        }
+    int getJSONArray(istream* in, char* buf) {
+        in->read(buf, BUF_SIZE);
+        uassert(13295, "JSONArray file too large", (in->rdstate() & ios_base::eofbit));
+        buf[ in->gcount() ] = '\0';
         uassert( 10263 ,  "unknown error reading file" ,
                  (!(in->rdstate() & ios_base::badbit)) &&
                  (!(in->rdstate() & ios_base::failbit) || (in->rdstate() & ios_base::eofbit)) );
@@ -170,25 +209,27 @@ class Import : public Tool {
     }
 
     /*
-     * Parses one object from the input file.  This usually corresponds to one line in the input
-     * file, unless the file is a CSV and contains a newline within a quoted string entry.
-     * Returns a true if a BSONObj was successfully created and false if not.
+     * Parses one record of the input into o.  A record is usually one line of the input file,
+     * but a CSV record spans lines when a quoted field contains a newline.  line is null
+     * terminated, len bytes long, and may be modified.
+     * Returns true if a BSONObj was created and false if the record was blank.
      */
-    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
-
-        numBytesRead = getLine(in, line);
-        line += numBytesRead;
-
+    bool parseRecord(char* line, size_t len, BSONObj& o) {
+        uassert(16329, str::stream() << "input line too long (max length: " << BUF_SIZE << ")",
+                len <= (size_t) BUF_SIZE);
+        if (strncmp("\xEF\xBB\xBF", line, 3) == 0) { // UTF-8 BOM (notepad is stupid)
+            line += 3;
+            len -= 3;
+        }
         if (line[0] == '\0') {
             return false;
         }
-        numBytesRead += strlen( line );
+        uassert(13289, "Invalid UTF8 character detected", isValidUTF8(line));
+        LOG(1) << "got line:" << line << endl;
 
         if (_type == JSON) {
             // Strip out trailing whitespace
-            char * end = ( line + strlen( line ) ) - 1;
+            char * end = ( line + len ) - 1;
             while ( end >= line && isspace(*end) ) {
                 *end = 0;
                 end--;
@@ -203,35 +244,8 @@ class Import : public Tool {
 
         vector<string> tokens;
         if (_type == CSV) {
-            string row;
-            bool inside_quotes = false;
-            size_t last_quote = 0;
-            while (true) {
-                string lineStr(line);
-                // Deal with line breaks in quoted strings
-                last_quote = lineStr.find_first_of('"');
-                while (last_quote != string::npos) {
-                    inside_quotes = !inside_quotes;
-                    last_quote = lineStr.find_first_of('"', last_quote+1);
-                }
-
-                row.append(lineStr);
-
-                if (inside_quotes) {
-                    row.append("\n");
-                    int num = getLine(in, line);
-                    line += num;
-                    numBytesRead += num;
-
-                    uassert (15854, "CSV file ends while inside quoted field", line[0] != '\0');
-                    numBytesRead += strlen( line );
-                } else {
-                    break;
-                }
-            }
-            // now 'row' is string corresponding to one row of the CSV file
-            // (which may span multiple lines) and represents one BSONObj
-            csvTokenizeRow(row, tokens);
+            // the reader already joined the lines of a row with line breaks in quoted strings
+            csvTokenizeRow(line, tokens);
         }
         else {  // _type == TSV
             while (line[0] != '\t' && isspace(line[0])) { // Strip leading whitespace, but not tabs
@@ -268,8 +282,245 @@ class Import : public Tool {
         return true;
     }
 
+    /*
+     * Returns the offset in data of the newline that ends the record being scanned, looking
+     * from offset from, or string::npos if it isn't in data yet.  For CSV, *inQuotes says
+     * whether the scan is inside a quoted field, and is kept up to date across calls.
+     */
+    size_t findRecordEnd(const string& data, size_t from, bool* inQuotes) const {
+        if (_type != CSV) {
+            return data.find('\n', from);
+        }
+        for (size_t i = from; i < data.size(); i++) {
+            if (data[i] == '"') {
+                *inQuotes = !*inQuotes;
+            }
+            else if (data[i] == '\n' && !*inQuotes) {
+                return i;
+            }
+        }
+        return string::npos;
+    }
+
+    /*
+     * The reader thread: reads the input in blocks, cuts it into records and hands them to the
+     * parsers in chunks.  Parses the header line itself, so that _fields is set before any
+     * parser needs it.
+     */
+    void readInput(istream* in) {
+        try {
+            _readInput(in);
+        }
+        catch ( std::exception& e ) {
+            log() << "exception:" << e.what() << endl;
+            _parseErrors.fetchAndAdd(1);
+            if (_stopOnError) {
+                _stop.store(1);
+            }
+        }
+        for (int i = 0; i < _numParsingThreads; i++) {
+            // tells a parser there is no more input
+            _toParse.push(boost::shared_ptr<InputChunk>());
+        }
+    }
+
+    void _readInput(istream* in) {
+        long long seq = 0;
+        bool inQuotes = false;
+        size_t recordStart = 0;
+        size_t scanned = 0;
+        boost::shared_ptr<InputChunk> chunk(new InputChunk);
+        while (!_stop.load()) {
+            string& data = chunk->data;
+            const size_t oldSize = data.size();
+            data.resize(oldSize + CHUNK_SIZE);
+            in->read(&data[oldSize], CHUNK_SIZE);
+            data.resize(oldSize + in->gcount());
+            uassert( 10263 ,  "unknown error reading file" , !in->bad() );
+            const bool eof = !in->good();
+
+            size_t end;
+            while ((end = findRecordEnd(data, scanned, &inQuotes)) != string::npos) {
+                chunk->records.push_back(make_pair(recordStart, end));
+                recordStart = scanned = end + 1;
+            }
+            scanned = data.size();
+
+            if (eof && recordStart < data.size()) {
+                // the last line has no newline
+                uassert (15854, "CSV file ends while inside quoted field", !inQuotes);
+                data.push_back('\n');
+                chunk->records.push_back(make_pair(recordStart, data.size() - 1));
+                recordStart = scanned = data.size();
+            }
+
+            if (!chunk->records.empty()) {
+                // Hand over the whole records, and start the next chunk with what is left.
+                boost::shared_ptr<InputChunk> next(new InputChunk);
+                next->data.assign(data, recordStart, string::npos);
+                data.resize(recordStart);
+                scanned -= recordStart;
+                recordStart = 0;
+
+                while (_headerLine && !chunk->records.empty()) {
+                    pair<size_t, size_t> header = chunk->records.front();
+                    chunk->records.erase(chunk->records.begin());
+                    data[header.second] = '\0';
+                    BSONObj o;
+                    if (parseRecord(&data[header.first], header.second - header.first, o)) {
+                        _headerLine = false;
+                    }
+                }
+
+                chunk->seq = seq++;
+                _toParse.push(chunk);
+                chunk = next;
+            }
+            if (eof) {
+                break;
+            }
+        }
+    }
+
+    /* A parser thread: parses chunks until the reader runs out of input. */
+    void parseChunks() {
+        while (true) {
+            boost::shared_ptr<InputChunk> chunk = _toParse.blockingPop();
+            if (!chunk) {
+                break;
+            }
+            boost::shared_ptr<ParsedChunk> parsed(new ParsedChunk);
+            parsed->seq = chunk->seq;
+            parsed->bytes = chunk->data.size();
+            parsed->stop = false;
+            parsed->objs.reserve(chunk->records.size());
+            for (vector<pair<size_t, size_t> >::const_iterator it = chunk->records.begin();
+                 it != chunk->records.end() && !_stop.load(); ++it) {
+                char* line = &chunk->data[it->first];
+                chunk->data[it->second] = '\0';
+                try {
+                    BSONObj o;
+                    if (parseRecord(line, it->second - it->first, o)) {
+                        parsed->objs.push_back(o);
+                    }
+                }
+                catch ( std::exception& e ) {
+                    log() << "exception:" << e.what() << endl;
+                    log() << line << endl;
+                    _parseErrors.fetchAndAdd(1);
+                    if (_stopOnError) {
+                        parsed->stop = true;
+                        _stop.store(1);
+                    }
+                }
+            }
+            if (_maintainInsertionOrder) {
+                scoped_lock lk(_sendWindowMutex);
+                while (parsed->seq >= _nextToSend + MAX_WAITING_CHUNKS) {
+                    _sendWindowMoved.wait(lk.boost());
+                }
+            }
+            _parsed.push(parsed);
+        }
+        // tells the sender this parser is done
+        _parsed.push(boost::shared_ptr<ParsedChunk>());
+    }
+
+    /* Sends the documents of a parsed chunk and reports progress. */
+    void sendChunk(const ParsedChunk& chunk, ProgressMeter& pm, const Timer& t) {
+        if (_stopped) {
+            return;
+        }
+        for (vector<BSONObj>::const_iterator it = chunk.objs.begin(); it != chunk.objs.end(); ++it) {
+            try {
+                insertObj(*it);
+                _num++;
+            }
+            catch ( std::exception& e ) {
+                log() << "exception:" << e.what() << endl;
+                log() << it->toString() << endl;
+                _sendErrors++;
+                if (_stopOnError) {
+                    _stop.store(1);
+                    _stopped = true;
+                    return;
+                }
+            }
+        }
+        _numBytes += chunk.bytes;
+        if (chunk.stop) {
+            _stopped = true;
+        }
+
+        if ( pm.hit( chunk.bytes ) ) {
+            const long long micros = std::max(t.micros(), 1ULL);
+            const long long tenthsMBps = _numBytes * 10 * 1000 * 1000 / (1024 * 1024) / micros;
+            log() << "\t\t\t" << _num << "\t" << ( _num * 1000 * 1000 / micros ) << "/second\t"
+                  << tenthsMBps / 10 << "." << tenthsMBps % 10 << " MB/second" << endl;
+        }
+    }
+
+    /* Upserts or inserts one document, batching inserts where it can. */
+    void insertObj(const BSONObj& o) {
+        if (!_doimport) {
+            return;
+        }
+        bool doUpsert = _upsert;
+        BSONObjBuilder b;
+        if (_upsert) {
+            for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
+                BSONElement e = o.getFieldDotted(it->c_str());
+                if (e.eoo()) {
+                    doUpsert = false;
+                    break;
+                }
+                b.appendAs(e, *it);
+            }
+        }
+
+        if (doUpsert) {
+            // keep the batched inserts ahead of this update, in input order
+            flushBatch();
+            conn().update(_ns, Query(b.obj()), o, true);
+            if (!_checkedFirstInsert) {
+                _checkedFirstInsert = true;
+                checkLastError();
+            }
+        }
+        else if (_inserter) {
+            _inserter->insert(o);
+        }
+        else {
+            _batch.push_back(o);
+            _batchBytes += o.objsize();
+            if (_batch.size() >= 1000 || _batchBytes >= 1024 * 1024) {
+                flushBatch();
+            }
+        }
+    }
+
+    void flushBatch() {
+        if (_batch.empty()) {
+            return;
+        }
+        vector<BSONObj> batch;
+        batch.swap(_batch);
+        _batchBytes = 0;
+        // Like one-at-a-time inserts, keep going past errors such as duplicate keys.
+        conn().insert(_ns, batch, InsertOption_ContinueOnError);
+        if (!_checkedFirstInsert) {
+            // we absolutely want to check the first batch, to catch things like bad
+            // permissions early; the last one is checked at the end
+            _checkedFirstInsert = true;
+            checkLastError();
+        }
+    }
+
 public:
-    Import() : Tool( "import" ) {
+    Import() : Tool( "import" ),
+               // bounds how far the reader and parsers get ahead of the inserts
+               _toParse( 64 ), _parsed( 64 ),
+               _sendWindowMutex( "importSendWindow" ) {
         addFieldOptions();
         add_options()
         ("ignoreBlanks","if given, empty fields in csv and tsv will be ignored")
@@ -281,6 +532,9 @@ public:
         ("upsertFields", po::value<string>(), "comma-separated fields for the query part of the upsert. You should make sure this is indexed" )
         ("stopOnError", "stop importing at first error rather than continuing" )
         ("jsonArray", "load a json array, not one item per line. Currently limited to 16MB." )
+        ("numParallelConnections", po::value<int>(&_numParallelConnections)->default_value(1), "number of connections used to insert. Connections beyond the first join the bulk load, which the server only allows when it is not replicating. Ignored with --upsert." )
+        ("numParsingThreads", po::value<int>(&_numParsingThreads)->default_value(defaultParsingThreads()), "number of threads that parse the input. Ignored with --jsonArray." )
+        ("maintainInsertionOrder", "insert documents in the order of the input file, even with more than one parsing thread. Implied by --upsert" )
         ;
         add_hidden_options()
         ("noimport", "don't actually import. useful for benchmarking parser" )
@@ -292,8 +546,23 @@ public:
         _upsert = false;
         _doimport = true;
         _jsonArray = false;
+        _stopOnError = false;
+        _maintainInsertionOrder = false;
+        _nextToSend = 0;
+        _numParallelConnections = 1;
+        _numParsingThreads = defaultParsingThreads();
+        _batchBytes = 0;
+        _checkedFirstInsert = false;
+        _num = 0;
+        _numBytes = 0;
+        _sendErrors = 0;
+        _stopped = false;
     }
     ;
+    static int defaultParsingThreads() {
+        return std::max(1U, boost::thread::hardware_concurrency());
+    }
+
     virtual void printExtraHelp( ostream & out ) {
         out << "Import CSV, TSV or JSON data into MongoDB.\n" << endl;
         out << "When importing JSON documents, each document must be a separate line of the input file.\n";
@@ -305,7 +574,11 @@ public:
 
     /** @return true if ok */
     bool checkLastError() { 
-        string s = conn().getLastError();
+        return checkError(conn().getLastError());
+    }
+
+    /** @return true if s, a lastError string, is ok */
+    bool checkError(const string &s) {
         if( !s.empty() ) { 
             if( str::contains(s,"uplicate") ) {
                 // we don't want to return an error from the mongoimport process for
@@ -324,7 +597,6 @@ public:
     int run() {
         string filename = getParam( "file" );
         long long fileSize = 0;
-        int headerRows = 0;
 
         istream * in = &cin;
 
@@ -353,6 +625,7 @@ public:
             printHelp(cerr);
             return -1;
         }
+        _ns = ns;
 
         LOG(1) << "ns: " << ns << endl;
 
@@ -386,6 +659,14 @@ public:
             _doimport = false;
         }
 
+        _stopOnError = hasParam( "stopOnError" );
+        // an upsert of a document has to come after its insert
+        _maintainInsertionOrder = hasParam( "maintainInsertionOrder" ) || _upsert;
+        if ( _numParsingThreads < 1 ) {
+            error() << "--numParsingThreads must be at least 1" << endl;
+            return -1;
+        }
+
         if ( hasParam( "type" ) ) {
             string type = getParam( "type" );
             if ( type == "json" )
@@ -406,10 +687,7 @@ public:
 
         if ( _type == CSV || _type == TSV ) {
             _headerLine = hasParam( "headerline" );
-            if ( _headerLine ) {
-                headerRows = 1;
-            }
-            else {
+            if ( ! _headerLine ) {
                 needFields();
             }
         }
@@ -418,111 +696,92 @@ public:
             _jsonArray = true;
         }
 
-        time_t start = time(0);
         LOG(1) << "filesize: " << fileSize << endl;
-        ProgressMeter pm( fileSize );
-        int num = 0;
-        int lastNumChecked = num;
-        int errors = 0;
+        ProgressMeter pm( fileSize , 3 , 1 );
+        Timer t;
         lastErrorFailures = 0;
-        int len = 0;
-        // buffer and line are only used when parsing a jsonArray
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
 
+        // Extra connections for --numParallelConnections. conn() inserts too, so while the
+        // inserter is running only its threads may use conn().
+        vector<boost::shared_ptr<DBClientBase> > parallelConns;
+        if (_doimport && !_upsert) {
+            for (int i = 1; i < _numParallelConnections; i++) {
+                DBClientBase *c = newConnection();
+                if (c == NULL) {
+                    warning() << "--numParallelConnections is ignored with --dbpath" << endl;
+                    break;
+                }
+                parallelConns.push_back(boost::shared_ptr<DBClientBase>(c));
+            }
+        }
+
+        NamespaceString n(ns);
         scoped_ptr<RemoteLoader> loader;
         if (_doBulkLoad) {
             // Pass no indexes or collection options, since this tool has no
             // way of specifying either.
-            NamespaceString n(ns);
-            loader.reset(new RemoteLoader(conn(), n.db, n.coll, vector<BSONObj>(), BSONObj()));
+            loader.reset(new RemoteLoader(conn(), n.db, n.coll, vector<BSONObj>(), BSONObj(),
+                                          !parallelConns.empty()));
         }
-        while ( _jsonArray || in->rdstate() == 0 ) {
-            try {
-                BSONObj o;
-                if (_jsonArray) {
-                    int bytesProcessed = 0;
-                    if (line == buffer.get()) { // Only read on first pass - the whole array must be on one line.
-                        bytesProcessed = getLine(in, line);
-                        line += bytesProcessed;
-                        len += bytesProcessed;
-                    }
-                    if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
-                        len += bytesProcessed;
-                        break;
-                    }
-                    len += bytesProcessed;
-                    line += bytesProcessed;
-                }
-                else {
-                    if (!parseRow(in, o, len)) {
-                        continue;
-                    }
-                }
-
-                if ( _headerLine ) {
-                    _headerLine = false;
-                }
-                else if (_doimport) {
-                    bool doUpsert = _upsert;
-                    BSONObjBuilder b;
-                    if (_upsert) {
-                        for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
-                            BSONElement e = o.getFieldDotted(it->c_str());
-                            if (e.eoo()) {
-                                doUpsert = false;
-                                break;
-                            }
-                            b.appendAs(e, *it);
-                        }
-                    }
 
-                    if (doUpsert) {
-                        conn().update(ns, Query(b.obj()), o, true);
-                    }
-                    else {
-                        conn().insert( ns.c_str() , o );
-                    }
-
-                    if( num < 10 ) { 
-                        // we absolutely want to check the first and last op of the batch. we do 
-                        // a few more as that won't be too time expensive.
-                        checkLastError();
-                        lastNumChecked = num;
+        if (!parallelConns.empty() && (!loader || loader->allowsParallelInserts())) {
+            vector<DBClientBase *> conns;
+            conns.push_back(&conn());
+            for (vector<boost::shared_ptr<DBClientBase> >::iterator it = parallelConns.begin();
+                 it != parallelConns.end(); ++it) {
+                if (loader && loader->loadToken().isSet()) {
+                    BSONObj res;
+                    if (!RemoteLoader::join(**it, n.db, n.coll, loader->loadToken(), &res)) {
+                        warning() << "couldn't join the load of " << ns << ": " << res
+                                  << ", using one connection" << endl;
+                        conns.clear();
+                        break;
                     }
                 }
-
-                num++;
+                conns.push_back(it->get());
             }
-            catch ( std::exception& e ) {
-                log() << "exception:" << e.what() << endl;
-                log() << line << endl;
-                errors++;
-
-                if (hasParam("stopOnError") || _jsonArray)
-                    break;
+            if (!conns.empty()) {
+                _inserter.reset(new ParallelInserter(conns, ns));
             }
+        }
 
-            if ( pm.hit( len + 1 ) ) {
-                log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
-            }
+        if (_jsonArray) {
+            importJSONArray(in, pm, t);
         }
-        if (loader) {
-            loader->commit();
+        else {
+            importPipelined(in, pm, t);
         }
 
-        // this is for two reasons: to wait for all operations to reach the server and be processed, and this will wait until all data reaches the server,
-        // and secondly to check if there were an error (on the last op)
-        if( lastNumChecked+1 != num ) { // avoid redundant log message if already reported above
-            log() << "check " << lastNumChecked << " " << num << endl;
+        try {
+            flushBatch();
+        }
+        catch ( std::exception& e ) {
+            log() << "exception:" << e.what() << endl;
+            _sendErrors++;
+        }
+        if (_inserter) {
+            vector<string> insertErrors;
+            _inserter->finish(&insertErrors);
+            _inserter.reset();
+            for (vector<string>::const_iterator it = insertErrors.begin(); it != insertErrors.end(); ++it) {
+                checkError(*it);
+            }
+        }
+        else if (_doimport && _num > 0) {
+            // this is for two reasons: to wait for all operations to reach the server and be
+            // processed, and to check if there was an error (on the last op)
             checkLastError();
         }
+        if (loader) {
+            loader->commit();
+        }
 
+        const long long errors = _parseErrors.load() + _sendErrors;
         bool hadErrors = lastErrorFailures || errors;
 
         // the message is vague on lastErrorFailures as we don't call it on every single operation. 
         // so if we have a lastErrorFailure there might be more than just what has been counted.
-        log() << (lastErrorFailures ? "tried to import " : "imported ") << ( num - headerRows ) << " objects" << endl;
+        log() << (lastErrorFailures ? "tried to import " : "imported ") << _num << " objects" << endl;
 
         if ( !hadErrors )
             return 0;
@@ -530,6 +789,88 @@ public:
         error() << "encountered " << (lastErrorFailures?"at least ":"") << lastErrorFailures+errors <<  " error(s)" << ( lastErrorFailures+errors == 1 ? "" : "s" ) << endl;
         return -1;
     }
+
+    /*
+     * Imports a file holding one JSON array, which has to fit in memory, on this thread.
+     */
+    void importJSONArray(istream* in, ProgressMeter& pm, const Timer& t) {
+        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
+        char* line = buffer.get();
+        bool first = true;
+        while (true) {
+            ParsedChunk chunk;
+            chunk.seq = 0;
+            chunk.bytes = 0;
+            chunk.stop = false;
+            try {
+                if (first) {
+                    first = false;
+                    const int skipped = getJSONArray(in, line);
+                    line += skipped;
+                    chunk.bytes += skipped;
+                }
+                BSONObj o;
+                const int bytesProcessed = parseJSONArray(line, o);
+                if (bytesProcessed < 0) {
+                    break;
+                }
+                line += bytesProcessed;
+                chunk.bytes += bytesProcessed;
+                chunk.objs.push_back(o);
+            }
+            catch ( std::exception& e ) {
+                log() << "exception:" << e.what() << endl;
+                log() << line << endl;
+                _parseErrors.fetchAndAdd(1);
+                break;
+            }
+            sendChunk(chunk, pm, t);
+            if (_stopped) {
+                break;
+            }
+        }
+    }
+
+    /*
+     * Imports line oriented input (JSON, CSV or TSV) in a pipeline: a reader thread cuts the
+     * input into chunks of records, --numParsingThreads threads parse them, and this thread
+     * sends the documents.  Unless --maintainInsertionOrder or --upsert is given, chunks are
+     * sent in the order they finish parsing rather than the order of the file.
+     */
+    void importPipelined(istream* in, ProgressMeter& pm, const Timer& t) {
+        boost::thread_group threads;
+        threads.create_thread(boost::bind(&Import::readInput, this, in));
+        for (int i = 0; i < _numParsingThreads; i++) {
+            threads.create_thread(boost::bind(&Import::parseChunks, this));
+        }
+
+        // chunks that finished parsing ahead of their turn, with _maintainInsertionOrder, at
+        // most MAX_WAITING_CHUNKS of them
+        map<long long, boost::shared_ptr<ParsedChunk> > waiting;
+        long long nextSeq = 0;
+        for (int parsersLeft = _numParsingThreads; parsersLeft > 0; ) {
+            boost::shared_ptr<ParsedChunk> chunk = _parsed.blockingPop();
+            if (!chunk) {
+                parsersLeft--;
+                continue;
+            }
+            if (!_maintainInsertionOrder) {
+                sendChunk(*chunk, pm, t);
+                continue;
+            }
+            waiting[chunk->seq] = chunk;
+            map<long long, boost::shared_ptr<ParsedChunk> >::iterator it;
+            while ((it = waiting.find(nextSeq)) != waiting.end()) {
+                sendChunk(*it->second, pm, t);
+                waiting.erase(it);
+                nextSeq++;
+                scoped_lock lk(_sendWindowMutex);
+                _nextToSend = nextSeq;
+                _sendWindowMoved.notify_all();
+            }
+        }
+        threads.join_all();
+    }
 };
 
 int main( int argc , char ** argv, char** envp ) {
@@ -539,3 +880,5 @@ int main( int argc , char ** argv, char** envp ) {
 }
 
 const int Import::BUF_SIZE(1024 * 1024 * 16);
+const int Import::CHUNK_SIZE(1024 * 1024);
+const int Import::MAX_WAITING_CHUNKS(64);
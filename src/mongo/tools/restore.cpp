@@ -48,18 +48,29 @@ public:
     bool _restoreIndexes;
     int _w;
     bool _doBulkLoad;
+    int _numParallelConnections;
     string _curns;
     string _curdb;
     string _curcoll;
     set<string> _users; // For restoring users with --drop
 
+    // Extra connections used with --numParallelConnections, and the inserter feeding them
+    // while a collection is being restored.
+    vector<boost::shared_ptr<DBClientBase> > _parallelConns;
+    // Whether to ask for bulk loads the parallel connections can join, cleared once the server
+    // refuses one (it does while it logs operations for replication).
+    bool _sharedLoads;
+    scoped_ptr<ParallelInserter> _inserter;
+    // Files of the current collection that couldn't be read, see processFiles.
+    AtomicUInt32 _failedFiles;
+
     std::string _defaultCompression;
     BytesQuantity<int> _defaultPageSize;
     BytesQuantity<int> _defaultReadPageSize;
 
     Restore() : BSONTool( "restore" ),
         _drop(false), _restoreOptions(false), _restoreIndexes(false),
-        _w(0), _doBulkLoad(false) {
+        _w(0), _doBulkLoad(false), _numParallelConnections(1), _sharedLoads(true) {
         // Default values set here will show up in help text, but will supercede any default value
         // used when calling getParam below.
         add_options()
@@ -71,6 +82,7 @@ public:
         ("noIndexRestore" , "don't restore indexes")
         ("w" , po::value<int>()->default_value(0) , "minimum number of replicas per write. WARNING, setting w > 1 prevents the bulk load optimization." )
         ("noLoader", "don't use bulk loader")
+        ("numParallelConnections", po::value<int>(&_numParallelConnections)->default_value(1), "number of connections used to insert into each collection. Connections beyond the first join its bulk load, which the server only allows when it is not replicating.")
         ("defaultCompression", po::value(&_defaultCompression)->default_value(""), "default compression method to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultPageSize", po::value(&_defaultPageSize)->default_value(0), "default pageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultReadPageSize", po::value(&_defaultReadPageSize)->default_value(0), "default readPageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
@@ -113,6 +125,16 @@ public:
         if (hasParam( "noLoader" )) {
             _doBulkLoad = false;
         }
+        if (_numParallelConnections > 1) {
+            for (int i = 1; i < _numParallelConnections; i++) {
+                DBClientBase *c = newConnection();
+                if (c == NULL) {
+                    log() << "warning: --numParallelConnections is ignored with --dbpath" << endl;
+                    break;
+                }
+                _parallelConns.push_back(boost::shared_ptr<DBClientBase>(c));
+            }
+        }
         if (hasParam( "keepIndexVersion" )) {
             log() << "warning: --keepIndexVersion is deprecated in TokuMX" << endl;
         }
@@ -177,6 +199,10 @@ public:
                 if (top_level && !use_db && p.leaf() == "oplog.bson")
                     continue;
 
+                // Segments are restored along with the collection's first file.
+                if (isSegmentFile(p))
+                    continue;
+
                 // Only restore indexes from a corresponding .metadata.json file.
                 if ( p.leaf() != "system.indexes.bson" ) {
                     drillDown(p, use_db, use_coll);
@@ -288,9 +314,27 @@ public:
                                               ? metadataObject["options"].Obj()
                                               : BSONObj());
 
+        // A collection mongodump split with --segmentSize also has coll.bson.1, coll.bson.2, ...
+        // which are read in parallel, so their documents must go through an inserter.
+        const vector<boost::filesystem::path> files = segmentFiles(root);
+        const bool segmented = files.size() > 1;
+
+        // system.users needs to be restored one document at a time, see gotObject
+        const bool parallel = !_parallelConns.empty() && !NamespaceString::isSystem(ns);
         if (_doBulkLoad && !options["partitioned"].trueValue()) {
-            RemoteLoader loader(conn(), _curdb, _curcoll, indexes, options);
-            processFile( root );
+            RemoteLoader loader(conn(), _curdb, _curcoll, indexes, options, parallel && _sharedLoads);
+            if (parallel && _sharedLoads && loader.usingLoader() && !loader.loadToken().isSet()) {
+                log() << "warning: the server can't share bulk loads while it replicates (e.g. as a "
+                      << "replica set member), so each collection will be loaded over one connection. "
+                      << "Use --noLoader to insert over all " << _numParallelConnections
+                      << " connections instead." << endl;
+                _sharedLoads = false;
+            }
+            if (segmented || (parallel && loader.allowsParallelInserts())) {
+                startParallelInserts(loader.loadToken(), parallel && loader.allowsParallelInserts());
+            }
+            processFiles( files );
+            finishParallelInserts();
             BSONObj res;
             bool ok = loader.commit(&res);
             if (!ok) {
@@ -302,7 +346,11 @@ public:
                 createCollectionWithOptions(options, metadataObject);
             }
             // Build indexes last - it's a little faster.
-            processFile( root );
+            if (parallel || segmented) {
+                startParallelInserts(OID(), parallel);
+            }
+            processFiles( files );
+            finishParallelInserts();
             for (vector<BSONObj>::iterator it = indexes.begin(); it != indexes.end(); ++it) {
                 createIndex(*it);
             }
@@ -328,6 +376,8 @@ public:
             BSONObj userMatch = BSON("user" << obj["user"].String());
             conn().update(_curns, Query(userMatch), obj);
             _users.erase(obj["user"].String());
+        } else if (_inserter) {
+            _inserter->insert(obj);
         } else {
             conn().insert( _curns , obj );
 
@@ -343,6 +393,90 @@ public:
 
 private:
 
+    static bool isSegmentFile(const boost::filesystem::path &p) {
+        const string name = p.leaf().string();
+        const size_t dot = name.find_last_of('.');
+        if (dot == string::npos || dot + 1 == name.size() || !endsWith(name.substr(0, dot).c_str(), ".bson")) {
+            return false;
+        }
+        return name.find_first_not_of("0123456789", dot + 1) == string::npos;
+    }
+
+    // The file for a collection, followed by its segments if mongodump split it.
+    static vector<boost::filesystem::path> segmentFiles(const boost::filesystem::path &root) {
+        vector<boost::filesystem::path> files;
+        files.push_back(root);
+        if (!endsWith(root.string().c_str(), ".bson")) {
+            return files;
+        }
+        for (int i = 1; ; i++) {
+            boost::filesystem::path segment(root.string() + "." + BSONObjBuilder::numStr(i));
+            if (!boost::filesystem::exists(segment)) {
+                break;
+            }
+            files.push_back(segment);
+        }
+        return files;
+    }
+
+    // Reads the files of one collection, each but the first on its own thread.
+    void processFiles(const vector<boost::filesystem::path> &files) {
+        _failedFiles.store(0);
+        boost::thread_group threads;
+        for (size_t i = 1; i < files.size(); i++) {
+            threads.create_thread(boost::bind(&Restore::processSegment, this, files[i]));
+        }
+        processSegment(files[0]);
+        threads.join_all();
+        uassert(17384, str::stream() << "couldn't read all the files for " << _curns,
+                _failedFiles.load() == 0);
+    }
+
+    void processSegment(const boost::filesystem::path &file) {
+        try {
+            processFile(file);
+        }
+        catch (DBException &e) {
+            error() << "couldn't restore " << file.string() << ": " << e.toString() << endl;
+            _failedFiles.fetchAndAdd(1);
+        }
+    }
+
+    // Spread the inserts for _curns over an inserter, using the parallel connections too if
+    // useParallelConns, joining them to the collection's bulk load first if it has one (a set
+    // loadToken).  A connection that can't join is left out; the ones that did join all insert,
+    // since the server counts them as part of the load.
+    // conn() inserts too; the main thread only reads the file until finishParallelInserts().
+    void startParallelInserts(const OID &loadToken, bool useParallelConns) {
+        vector<DBClientBase *> conns;
+        conns.push_back(&conn());
+        for (vector<boost::shared_ptr<DBClientBase> >::iterator it = _parallelConns.begin();
+             useParallelConns && it != _parallelConns.end(); ++it) {
+            if (loadToken.isSet()) {
+                BSONObj res;
+                if (!RemoteLoader::join(**it, _curdb, _curcoll, loadToken, &res)) {
+                    warning() << "couldn't join a connection to the load of " << _curns << ": "
+                              << res << ", inserting without it" << endl;
+                    continue;
+                }
+            }
+            conns.push_back(it->get());
+        }
+        _inserter.reset(new ParallelInserter(conns, _curns, _w));
+    }
+
+    void finishParallelInserts() {
+        if (!_inserter) {
+            return;
+        }
+        vector<string> errors;
+        _inserter->finish(&errors);
+        _inserter.reset();
+        for (vector<string>::const_iterator it = errors.begin(); it != errors.end(); ++it) {
+            error() << *it << endl;
+        }
+    }
+
     BSONObj updateOptions(const BSONObj &originalOptions) {
         BSONObjBuilder newOptsBuilder;
         bool compressionSpecified = false;
@@ -432,10 +432,38 @@ namespace mongo {
             return;
         }
 
-        _conn->auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
-                           saslCommandPrincipalFieldName << _username <<
-                           saslCommandPasswordFieldName << _password  <<
-                           saslCommandMechanismFieldName << _authenticationMechanism ) );
+        authConnection( *_conn );
+    }
+
+    void Tool::authConnection( DBClientBase &c ) {
+        c.auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
+                      saslCommandPrincipalFieldName << _username <<
+                      saslCommandPasswordFieldName << _password  <<
+                      saslCommandMechanismFieldName << _authenticationMechanism ) );
+    }
+
+    DBClientBase *Tool::newConnection() {
+        if ( hasParam( "dbpath" ) ) {
+            return NULL;
+        }
+
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse( _host , errmsg );
+        uassert( 17376 , str::stream() << "invalid hostname [" << _host << "] " << errmsg ,
+                 cs.isValid() );
+        DBClientBase *c = cs.connect( errmsg );
+        uassert( 17377 , str::stream() << "couldn't connect to [" << _host << "] " << errmsg ,
+                 c != NULL );
+        if ( ! _username.empty() ) {
+            try {
+                authConnection( *c );
+            }
+            catch ( DBException& ) {
+                delete c;
+                throw;
+            }
+        }
+        return c;
     }
 
     BSONTool::BSONTool( const char * name, DBAccess access , bool objcheck )
@@ -456,25 +484,26 @@ namespace mongo {
             _objcheck = false;
 
         if ( hasParam( "filter" ) )
-            _matcher.reset( new Matcher( fromjson( getParam( "filter" ) ) ) );
+            _filter = fromjson( getParam( "filter" ) ).getOwned();
 
         return doRun();
     }
 
     long long BSONTool::processFile( const boost::filesystem::path& root ) {
-        _fileName = root.string();
+        // a local, so that a tool may read several files at once
+        const string fileName = root.string();
 
         unsigned long long fileLength = file_size( root );
 
         if ( fileLength == 0 ) {
-            out() << "file " << _fileName << " empty, skipping" << endl;
+            out() << "file " << fileName << " empty, skipping" << endl;
             return 0;
         }
 
 
-        FILE* file = fopen( _fileName.c_str() , "rb" );
+        FILE* file = fopen( fileName.c_str() , "rb" );
         if ( ! file ) {
-            log() << "error opening file: " << _fileName << " " << errnoWithDescription() << endl;
+            log() << "error opening file: " << fileName << " " << errnoWithDescription() << endl;
             return 0;
         }
 
@@ -484,6 +513,8 @@ namespace mongo {
 
         LOG(1) << "\t file size: " << fileLength << endl;
 
+        scoped_ptr<Matcher> matcher( _filter.isEmpty() ? NULL : new Matcher( _filter ) );
+
         unsigned long long read = 0;
         unsigned long long num = 0;
         unsigned long long processed = 0;
@@ -523,7 +554,7 @@ namespace mongo {
                 }
             }
 
-            if ( _matcher.get() == 0 || _matcher->matches( o ) ) {
+            if ( !matcher || matcher->matches( o ) ) {
                 gotObject( o );
                 processed++;
             }
@@ -538,9 +569,110 @@ namespace mongo {
 
         uassert( 10265 ,  "counts don't match" , m.done() == fileLength );
         (_usesstdout ? cout : cerr ) << m.hits() << " objects found" << endl;
-        if ( _matcher.get() )
+        if ( matcher )
             (_usesstdout ? cout : cerr ) << processed << " objects processed" << endl;
         return processed;
     }
 
+    ParallelInserter::ParallelInserter( const vector<DBClientBase *> &conns , const string &ns , int w )
+        : _ns( ns ), _db( nsToDatabase( ns ) ), _w( w ),
+          // big enough to hold a maximum size document
+          _queue( 2 * BSONObjMaxInternalSize , &ParallelInserter::itemSize ),
+          _nThreads( conns.size() ), _finished( false ),
+          _errorsMutex( "ParallelInserter" ) {
+        for ( vector<DBClientBase *>::const_iterator it = conns.begin(); it != conns.end(); ++it ) {
+            _threads.create_thread( boost::bind( &ParallelInserter::run , this , *it ) );
+        }
+    }
+
+    ParallelInserter::~ParallelInserter() {
+        if ( ! _finished ) {
+            finish();
+        }
+    }
+
+    void ParallelInserter::insert( const BSONObj &obj ) {
+        Item item = { obj.getOwned() , false };
+        _queue.push( item );
+    }
+
+    bool ParallelInserter::finish( vector<string> *errors ) {
+        _finished = true;
+        for ( int i = 0; i < _nThreads; i++ ) {
+            Item item = { BSONObj() , true };
+            _queue.push( item );
+        }
+        _threads.join_all();
+
+        scoped_lock lk( _errorsMutex );
+        if ( errors != NULL ) {
+            errors->insert( errors->end() , _errors.begin() , _errors.end() );
+        }
+        return _errors.empty();
+    }
+
+    void ParallelInserter::run( DBClientBase *conn ) {
+        const int maxBatchObjs = 1000;
+        const int maxBatchBytes = 1024 * 1024;
+        // After an error, keep draining the queue so insert() never blocks forever.
+        bool failed = false;
+        bool last = false;
+        while ( ! last ) {
+            vector<BSONObj> batch;
+            int batchBytes = 0;
+            Item item = _queue.blockingPop();
+            while ( true ) {
+                if ( item.last ) {
+                    last = true;
+                    break;
+                }
+                batch.push_back( item.obj );
+                batchBytes += item.obj.objsize();
+                if ( (int) batch.size() >= maxBatchObjs || batchBytes >= maxBatchBytes
+                        || ! _queue.tryPop( item ) ) {
+                    break;
+                }
+            }
+            if ( failed || batch.empty() ) {
+                continue;
+            }
+            try {
+                insertBatch( conn , batch );
+            }
+            catch ( DBException &e ) {
+                failed = true;
+                scoped_lock lk( _errorsMutex );
+                _errors.push_back( e.toString() );
+            }
+        }
+
+        if ( ! failed ) {
+            try {
+                string err = conn->getLastError( _db );
+                if ( ! err.empty() ) {
+                    scoped_lock lk( _errorsMutex );
+                    _errors.push_back( err );
+                }
+            }
+            catch ( DBException &e ) {
+                scoped_lock lk( _errorsMutex );
+                _errors.push_back( e.toString() );
+            }
+        }
+    }
+
+    void ParallelInserter::insertBatch( DBClientBase *conn , const vector<BSONObj> &batch ) {
+        // Like one-at-a-time inserts, keep going past errors such as duplicate keys.
+        conn->insert( _ns , batch , InsertOption_ContinueOnError );
+
+        // wait for inserts to propagate to "w" nodes (doesn't warn if w used without replset)
+        if ( _w > 0 ) {
+            string err = conn->getLastError( _db , false , false , _w );
+            if ( ! err.empty() ) {
+                scoped_lock lk( _errorsMutex );
+                _errors.push_back( err );
+            }
+        }
+    }
+
 }
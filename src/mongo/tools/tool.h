@@ -21,6 +21,7 @@
 #include <string>
 
 #include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
 
 #if defined(_WIN32)
 #include <io.h>
@@ -28,6 +29,7 @@
 
 #include "db/instance.h"
 #include "db/matcher.h"
+#include "util/queue.h"
 #include "client/remote_transaction.h"
 
 using std::string;
@@ -106,11 +108,14 @@ namespace mongo {
 
         mongo::DBClientBase &conn( bool slaveIfPaired = false );
 
+        /** Opens and authenticates another connection to the server conn() talks to.
+            @return NULL if the tool is using direct data file access (--dbpath) */
+        mongo::DBClientBase *newConnection();
+
         string _name;
 
         string _db;
         string _coll;
-        string _fileName;
 
         string _username;
         string _password;
@@ -144,11 +149,14 @@ namespace mongo {
 
     private:
         void auth();
+        void authConnection( mongo::DBClientBase &c );
     };
 
     class BSONTool : public Tool {
         bool _objcheck;
-        auto_ptr<Matcher> _matcher;
+        // --filter, empty if not given.  processFile() matches against it with a Matcher of its
+        // own, since a $where has a JS scope that threads can't share.
+        BSONObj _filter;
 
     public:
         BSONTool( const char * name , DBAccess access=ALL, bool objcheck = true );
@@ -162,4 +170,50 @@ namespace mongo {
 
     };
 
+    /**
+     * Spreads inserts into one collection over several connections.  Each connection gets a
+     * thread that takes documents off a shared, bounded queue and inserts them in batches.
+     * Used by tools given --numParallelConnections; to insert into a bulk load, each
+     * connection must have joined it first (see RemoteLoader::join).
+     */
+    class ParallelInserter : boost::noncopyable {
+    public:
+        /** @param conns -- The connections to insert on. Not owned; they must outlive this.
+            @param ns -- The collection to insert into.
+            @param w -- If > 0, wait for each batch to reach this many replicas.
+         */
+        ParallelInserter( const vector<DBClientBase *> &conns , const string &ns , int w = 0 );
+        ~ParallelInserter();
+
+        /** Queues a copy of obj, blocking while the queue is full. */
+        void insert( const BSONObj &obj );
+
+        /** Waits for every queued document to be inserted and checks getLastError on each
+            connection. Must be called before the load the connections joined is committed.
+            @param errors -- If not NULL, any errors are appended here.
+            @return true -- iff no connection reported an error
+         */
+        bool finish( vector<string> *errors = NULL );
+
+    private:
+        struct Item {
+            BSONObj obj;
+            bool last; // tells a thread there is nothing more to insert
+        };
+        static size_t itemSize( const Item &item ) { return item.obj.objsize(); }
+
+        void run( DBClientBase *conn );
+        void insertBatch( DBClientBase *conn , const vector<BSONObj> &batch );
+
+        const string _ns;
+        const string _db;
+        const int _w;
+        BlockingQueue<Item> _queue;
+        boost::thread_group _threads;
+        int _nThreads;
+        bool _finished;
+        mongo::mutex _errorsMutex;
+        vector<string> _errors;
+    };
+
 }
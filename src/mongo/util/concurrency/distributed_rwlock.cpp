@@ -0,0 +1,43 @@
+// @file distributed_rwlock.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/util/concurrency/distributed_rwlock.h"
+
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+    static AtomicUInt32 nextReaderSlot;
+
+    // Handed out round robin so that the threads that exist at any time tend to spread evenly
+    // over the slots.
+    struct ReaderSlot {
+        const int slot;
+        ReaderSlot() : slot(nextReaderSlot.fetchAndAdd(1) % DistributedReaderCount::NumSlots) {}
+    };
+
+    TSP_DECLARE(ReaderSlot, readerSlot);
+    TSP_DEFINE(ReaderSlot, readerSlot);
+
+    int DistributedReaderCount::mySlot() {
+        return readerSlot.getMake()->slot;
+    }
+
+} // namespace mongo
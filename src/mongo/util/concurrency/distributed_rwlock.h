@@ -0,0 +1,132 @@
+// @file distributed_rwlock.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/string_data.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * A count of readers, spread over one counter per cache line so that readers arriving and
+     * departing on different cores don't bounce a shared line between them.
+     *
+     * Each thread is handed a slot the first time it asks.  Only the sum of the slots means
+     * anything, so threads sharing a slot (when there are more threads than slots) is fine.
+     */
+    class DistributedReaderCount : boost::noncopyable {
+    public:
+        enum { NumSlots = 64 };
+
+        DistributedReaderCount() {}
+
+        /** @return the slot for the calling thread, always the same one. */
+        static int mySlot();
+
+        /** arrive() and depart() are full memory barriers. */
+        void arrive(int slot) { _slots[slot].fetchAndAdd(1); }
+        void depart(int slot) { _slots[slot].fetchAndSubtract(1); }
+
+        /**
+         * Not a snapshot: only meaningful once new readers are kept out, which the caller must
+         * have announced with a full barrier (e.g. AtomicWord::store()) before calling this.
+         */
+        long long sum() const {
+            long long n = 0;
+            for (int i = 0; i < NumSlots; i++) {
+                n += _slots[i].loadRelaxed();
+            }
+            return n;
+        }
+
+    private:
+        AtomicWordOnCacheLine _slots[NumSlots];
+    };
+
+    /**
+     * A reader/writer lock that is cheap to share: lock_shared() and unlock_shared() only touch
+     * the calling thread's reader slot and a flag that writers change, so readers on different
+     * cores don't contend with each other.  The cost moves to writers, which have to wait for
+     * every slot to drain, so use this where writes are rare.
+     *
+     * Writers are greedy: once one is waiting, new readers queue behind it.  Not recursive.
+     */
+    class DistributedRWLock : boost::noncopyable {
+    public:
+        DistributedRWLock(const StringData &name) : name(name.toString()), _writer(0) {}
+
+        const std::string name;
+
+        void lock_shared() {
+            const int slot = DistributedReaderCount::mySlot();
+            while (true) {
+                _readers.arrive(slot);
+                if (_writer.load() == 0) {
+                    return;
+                }
+                // A writer holds the lock or is waiting for readers to leave.  Back out, and
+                // tell it we left in case it already counted us.
+                _readers.depart(slot);
+                boost::mutex::scoped_lock lk(_m);
+                _c.notify_all();
+                while (_writer.loadRelaxed() != 0) {
+                    _c.wait(lk);
+                }
+            }
+        }
+
+        void unlock_shared() {
+            _readers.depart(DistributedReaderCount::mySlot());
+            if (_writer.load() != 0) {
+                boost::mutex::scoped_lock lk(_m);
+                _c.notify_all();
+            }
+        }
+
+        void lock() {
+            boost::mutex::scoped_lock lk(_m);
+            while (_writer.loadRelaxed() != 0) {
+                _c.wait(lk);
+            }
+            _writer.store(1);
+            while (_readers.sum() != 0) {
+                _c.wait(lk);
+            }
+        }
+
+        void unlock() {
+            boost::mutex::scoped_lock lk(_m);
+            _writer.store(0);
+            _c.notify_all();
+        }
+
+    private:
+        DistributedReaderCount _readers;
+        // nonzero while a writer holds the lock or waits for readers to drain
+        AtomicInt32 _writer;
+        boost::mutex _m;
+        boost::condition _c;
+    };
+
+} // namespace mongo
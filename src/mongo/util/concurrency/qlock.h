@@ -23,6 +23,7 @@
 #include <boost/thread/condition.hpp>
 #include "../assert_util.h"
 #include "../time_support.h"
+#include "distributed_rwlock.h"
 
 namespace mongo { 
 
@@ -60,6 +61,11 @@ namespace mongo {
         transition, all threads in the "w" state must be blocked in w_to_X().  When all threads in
         the "w" state are blocked in w_to_X(), one thread will be released in the X state.  The
         other threads remain blocked in w_to_X() until the thread in the X state calls X_to_w().
+
+        "r" is by far the most common state, and only W and X exclude it, so r holders are counted
+        in a DistributedReaderCount rather than under the mutex.  While nothing is in or waiting
+        for W or X (or an R_to_W upgrade), lock_r() and unlock_r() never touch the mutex.  Once
+        something is, readersMustWait is set and readers go through the mutex like everyone else.
     */
     class QLock : boost::noncopyable {
         struct Z { 
@@ -68,17 +74,26 @@ namespace mongo {
             int n;
         };
         boost::mutex m;
-        Z r,w,R,W,U,X;
+        Z r,w,R,W,U,X; // r.n is unused, see readers
+        DistributedReaderCount readers;
+        AtomicInt32 readersMustWait; // r_legal() is false, only changed under m
         int numPendingGlobalWrites;  // >0 if someone wants to acquire a write lock
         long long generationX;
         long long generationXExit;
         void _lock_W();
         void _unlock_R();
+        // call under m after changing W.n, X.n or numPendingGlobalWrites, before waiting
+        void noteReadersMustWait() {
+            readersMustWait.store( W.n + X.n + numPendingGlobalWrites > 0 ? 1 : 0 );
+        }
+        void readerLeft();
         bool _areQueueJumpingGlobalWritesPending() const {
             return numPendingGlobalWrites > 0;
         }
 
-        bool W_legal() const { return r.n + w.n + R.n + W.n + X.n == 0; }
+        long long rCount() const { return readers.sum(); }
+
+        bool W_legal() const { return rCount() + w.n + R.n + W.n + X.n == 0; }
         bool R_legal_ignore_greed() const { return w.n + W.n + X.n == 0; }
         bool r_legal_ignore_greed() const { return W.n + X.n == 0; }
         bool w_legal_ignore_greed() const { return R.n + W.n + X.n == 0; }
@@ -95,12 +110,13 @@ namespace mongo {
             return !_areQueueJumpingGlobalWritesPending() && r_legal_ignore_greed();
         }
 
-        bool X_legal() const { return w.n + r.n + R.n + W.n == 0; }
+        bool X_legal() const { return w.n + rCount() + R.n + W.n == 0; }
 
         void notifyWeUnlocked(char me);
         static bool i_block(char me, char them);
     public:
         QLock() :
+            readersMustWait(0),
             numPendingGlobalWrites(0),
             generationX(0),
             generationXExit(0) {
@@ -141,7 +157,7 @@ namespace mongo {
         }
         if( U.n ) {
             // U is highest priority
-            if( (r.n + w.n + W.n + X.n == 0) && (R.n == 1) ) {
+            if( (rCount() + w.n + W.n + X.n == 0) && (R.n == 1) ) {
                 U.c.notify_one();
                 return;
             }
@@ -165,14 +181,31 @@ namespace mongo {
         }
     }
 
+    // a reader dropped out of readers while readersMustWait was set: whoever set it may be
+    // waiting for the count to reach zero.  call under m.
+    inline void QLock::readerLeft() {
+        if( W.n == 0 ) {
+            notifyWeUnlocked('r');
+        }
+    }
+
     // "i will be reading. i promise to coordinate my activities with w's as i go with more 
     //  granular locks."
     inline void QLock::lock_r() {
+        const int slot = DistributedReaderCount::mySlot();
+        readers.arrive(slot);
+        if( readersMustWait.load() == 0 ) {
+            return;
+        }
+        readers.depart(slot);
+
         boost::mutex::scoped_lock lk(m);
+        readerLeft();
         while( !r_legal() ) {
             r.c.wait(m);
         }
-        r.n++;
+        // readersMustWait only changes under m, so nobody can be counting readers right now
+        readers.arrive(slot);
     }
 
     // "i will be writing. i promise to coordinate my activities with w's and r's as i go with more 
@@ -213,6 +246,7 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
 
         ++numPendingGlobalWrites;
+        noteReadersMustWait();
         while (!W_legal() && curTimeMillis64() < end) {
             W.c.timed_wait(m, boost::posix_time::milliseconds(millis));
         }
@@ -221,9 +255,15 @@ namespace mongo {
         if (W_legal()) {
             W.n++;
             fassert( 16202, W.n == 1 );
+            noteReadersMustWait();
             return true;
         }
 
+        noteReadersMustWait();
+        if ( r_legal() ) {
+            // readers that queued behind us while we waited
+            r.c.notify_all();
+        }
         return false;
     }
 
@@ -236,6 +276,7 @@ namespace mongo {
         fassert(16205, U.n == 0);
         W.n = 0;
         R.n = 1;
+        noteReadersMustWait();
         notifyWeUnlocked('W');
     }
 
@@ -258,8 +299,9 @@ namespace mongo {
         U.n = 1;
 
         ++numPendingGlobalWrites;
+        noteReadersMustWait();
 
-        while( W.n + R.n + w.n + r.n > 1 ) {
+        while( W.n + R.n + w.n + rCount() > 1 ) {
             U.c.wait(m);
         }
         --numPendingGlobalWrites;
@@ -271,6 +313,7 @@ namespace mongo {
         R.n = 0;
         W.n = 1;
         U.n = 0;
+        noteReadersMustWait();
     }
 
     inline bool QLock::w_to_X() {
@@ -280,6 +323,7 @@ namespace mongo {
 
         ++X.n;
         --w.n;
+        noteReadersMustWait();
 
         long long myGeneration = generationX;
 
@@ -312,6 +356,7 @@ namespace mongo {
 
         w.n = X.n;
         X.n = 0;
+        noteReadersMustWait();
         ++generationXExit;
         notifyWeUnlocked('X');
     }
@@ -319,11 +364,13 @@ namespace mongo {
     // "i will be writing. i will coordinate with no one. you better stop them all"
     inline void QLock::_lock_W() {
         ++numPendingGlobalWrites;
+        noteReadersMustWait();
         while( !W_legal() ) {
             W.c.wait(m);
         }
         --numPendingGlobalWrites;
         W.n++;
+        noteReadersMustWait();
     }
     inline void QLock::lock_W() {
         boost::mutex::scoped_lock lk(m);
@@ -331,10 +378,13 @@ namespace mongo {
     }
 
     inline void QLock::unlock_r() {
+        readers.depart(DistributedReaderCount::mySlot());
+        if( readersMustWait.load() == 0 ) {
+            // nobody but r and w around, and neither waits for us
+            return;
+        }
         boost::mutex::scoped_lock lk(m);
-        fassert(16137, r.n > 0);
-        --r.n;
-        notifyWeUnlocked('r');
+        readerLeft();
     }
     inline void QLock::unlock_w() {
         boost::mutex::scoped_lock lk(m);
@@ -358,6 +408,7 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
         fassert(16140, W.n == 1);
         --W.n;
+        noteReadersMustWait();
         notifyWeUnlocked('W');
     }
 
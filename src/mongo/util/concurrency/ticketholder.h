@@ -14,12 +14,17 @@
  */
 #pragma once
 
+#include <list>
 #include <boost/thread/condition_variable.hpp>
 
 #include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
+    /**
+     * A pool of tickets.  Threads that have to wait for one are served in the order they arrived,
+     * and tryAcquire() never takes a ticket ahead of them.
+     */
     class TicketHolder {
     public:
         TicketHolder( int num ) : _mutex("TicketHolder") {
@@ -29,47 +34,53 @@ namespace mongo {
 
         bool tryAcquire() {
             scoped_lock lk( _mutex );
-            return _tryAcquire();
+            return _waiters.empty() && _tryAcquire();
         }
 
         void waitForTicket() {
             scoped_lock lk( _mutex );
+            if ( _waiters.empty() && _tryAcquire() ) {
+                return;
+            }
 
-            while( ! _tryAcquire() ) {
-                _newTicket.wait( lk.boost() );
+            boost::condition_variable_any myTurn;
+            _waiters.push_back( &myTurn );
+            while( _waiters.front() != &myTurn || ! _tryAcquire() ) {
+                myTurn.wait( lk.boost() );
             }
+            _waiters.pop_front();
+            _notifyNext();
         }
 
         void release() {
-            {
-                scoped_lock lk( _mutex );
-                _num++;
-            }
-            _newTicket.notify_one();
+            scoped_lock lk( _mutex );
+            _num++;
+            _notifyNext();
         }
 
+        /**
+         * Shrinking below the number of tickets in use is allowed: no new tickets are handed out
+         * until enough have been released.
+         */
         void resize( int newSize ) {
-            {
-                scoped_lock lk( _mutex );
-
-                int used = _outof - _num;
-                if ( used > newSize ) {
-                    cout << "ERROR: can't resize since we're using (" << used << ") more than newSize(" << newSize << ")" << endl;
-                    return;
-                }
-
-                _outof = newSize;
-                _num = _outof - used;
-            }
+            scoped_lock lk( _mutex );
 
-            // Potentially wasteful, but easier to see is correct
-            _newTicket.notify_all();
+            int used = _outof - _num;
+            _outof = newSize;
+            _num = _outof - used;
+            _notifyNext();
         }
 
         int available() const {
             return _num;
         }
 
+        /** @return the number of threads in waitForTicket() */
+        int waiters() const {
+            scoped_lock lk( _mutex );
+            return _waiters.size();
+        }
+
         int used() const {
             return _outof - _num;
         }
@@ -80,19 +91,24 @@ namespace mongo {
 
         bool _tryAcquire(){
             if ( _num <= 0 ) {
-                if ( _num < 0 ) {
-                    cerr << "DISASTER! in TicketHolder" << endl;
-                }
+                // negative after shrinking below the number in use
                 return false;
             }
             _num--;
             return true;
         }
 
+        void _notifyNext() {
+            if ( !_waiters.empty() && _num > 0 ) {
+                _waiters.front()->notify_one();
+            }
+        }
+
         int _outof;
         int _num;
-        mongo::mutex _mutex;
-        boost::condition_variable_any _newTicket;
+        mutable mongo::mutex _mutex;
+        // the front one is the next to get a ticket
+        std::list<boost::condition_variable_any *> _waiters;
     };
 
     class TicketHolderReleaser {
@@ -20,6 +20,7 @@
 #include "sock.h"
 #include "../../bson/util/atomic_int.h"
 #include "hostandport.h"
+#include "message_buffer_pool.h"
 
 namespace mongo {
 
@@ -43,7 +44,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* another message, compressed.  see message_compressor.h */
     };
 
     bool doesOpGetAResponse( int op );
@@ -59,6 +61,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default:
             massert( 16141, str::stream() << "cannot translate opcode " << op, !op );
             return "";
@@ -150,12 +153,12 @@ namespace mongo {
     class Message {
     public:
         // we assume here that a vector with initial size 0 does no allocation (0 is the default, but wanted to make it explicit).
-        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ) {}
+        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {}
         Message( void * data , bool freeIt ) :
-            _buf( 0 ), _data( 0 ), _freeIt( false ) {
+            _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {
             _setData( reinterpret_cast< MsgData* >( data ), freeIt );
         };
-        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ) {
+        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {
             *this = r;
         }
         ~Message() {
@@ -192,6 +195,12 @@ namespace mongo {
 
         int dataSize() const { return size() - sizeof(MSGHEADER); }
 
+        // the buffers the message is sent from, in order; the first starts with the header
+        int numBuffers() const { return _buf ? 1 : _data.size(); }
+        pair< char*, int > buffer( int i ) const {
+            return _buf ? make_pair( (char*)_buf, _buf->len ) : _data[ i ];
+        }
+
         // concat multiple buffers - noop if <2 buffers already, otherwise can be expensive copy
         // can get rid of this if we make response handling smarter
         void concat() {
@@ -204,14 +213,14 @@ namespace mongo {
             for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
                 totalSize += i->second;
             }
-            char *buf = (char*)malloc( totalSize );
+            char *buf = MessageBufferPool::allocate( totalSize );
             char *p = buf;
             for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
                 memcpy( p, i->first, i->second );
                 p += i->second;
             }
             reset();
-            _setData( (MsgData*)buf, true );
+            _setData( (MsgData*)buf, true, true );
         }
 
         // vector swap() so this is fast
@@ -225,21 +234,24 @@ namespace mongo {
             }
             r._freeIt = false;
             _freeIt = true;
+            _pooled = r._pooled;
+            r._pooled = false;
             return *this;
         }
 
         void reset() {
             if ( _freeIt ) {
                 if ( _buf ) {
-                    free( _buf );
+                    _free( (char*)_buf, _pooled );
                 }
                 for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
-                    free(i->first);
+                    _free( i->first, _pooled && i == _data.begin() );
                 }
             }
             _buf = 0;
             _data.clear();
             _freeIt = false;
+            _pooled = false;
         }
 
         // use to add a buffer
@@ -268,17 +280,22 @@ namespace mongo {
             verify( empty() );
             _setData( d, freeIt );
         }
+        // same, for a buffer from MessageBufferPool::allocate(), which the message gives back
+        void setPooledData(MsgData *d) {
+            verify( empty() );
+            _setData( d, true, true );
+        }
         void setData(int operation, const char *msgtxt) {
             setData(operation, msgtxt, strlen(msgtxt)+1);
         }
         void setData(int operation, const char *msgdata, size_t len) {
             verify( empty() );
             size_t dataLen = len + sizeof(MsgData) - 4;
-            MsgData *d = (MsgData *) malloc(dataLen);
+            MsgData *d = (MsgData *) MessageBufferPool::allocate(dataLen);
             memcpy(d->_data, msgdata, len);
             d->len = fixEndian(dataLen);
             d->setOperation(operation);
-            _setData( d, true );
+            _setData( d, true, true );
         }
 
         bool doIFreeIt() {
@@ -290,16 +307,28 @@ namespace mongo {
         string toString() const;
 
     private:
-        void _setData( MsgData *d, bool freeIt ) {
+        void _setData( MsgData *d, bool freeIt, bool pooled = false ) {
             _freeIt = freeIt;
+            _pooled = pooled;
             _buf = d;
         }
+        static void _free( char *buf, bool pooled ) {
+            if ( pooled ) {
+                MessageBufferPool::release( buf );
+            }
+            else {
+                free( buf );
+            }
+        }
         // if just one buffer, keep it in _buf, otherwise keep a sequence of buffers in _data
         MsgData * _buf;
         // byte buffer(s) - the first must contain at least a full MsgData unless using _buf for storage instead
         typedef vector< pair< char*, int > > MsgVec;
         MsgVec _data;
         bool _freeIt;
+        // whether the first buffer (the one with the header) is from MessageBufferPool; any
+        // appended after it come from malloc
+        bool _pooled;
     };
 
 
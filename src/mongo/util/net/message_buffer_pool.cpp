@@ -0,0 +1,242 @@
+// message_buffer_pool.cpp
+
+/*    Copyright 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_buffer_pool.h"
+
+#include <boost/thread/tss.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    int MessageBufferPool::maxRetainedMB = 64;
+
+    namespace {
+
+        // size classes are 1 << minClassBits ... 1 << maxClassBits bytes.  Bigger buffers are
+        // malloc'd at their exact size, rounding them up would waste too much.
+        const int minClassBits = 10;
+        const int maxClassBits = 20;
+        const int numClasses = maxClassBits - minClassBits + 1;
+
+        // what each thread may keep for itself
+        const int threadCacheClasses = 16 - minClassBits + 1;  // up to 64KB
+        const size_t threadCacheBuffersPerClass = 4;
+        const size_t threadCacheMaxBytes = 128 * 1024;
+
+        // Precedes each buffer.  16 bytes, so the buffer is aligned like malloc's.
+        struct BufferHeader {
+            int sizeClass;  // -1 for buffers too big for any class
+            unsigned magic;
+            char pad[8];
+        };
+        const unsigned headerMagic = 0x4d425546;
+
+        size_t classSize(int sizeClass) {
+            return size_t(1) << (sizeClass + minClassBits);
+        }
+
+        int sizeClassFor(size_t size) {
+            for (int c = 0; c < numClasses; c++) {
+                if (size <= classSize(c)) {
+                    return c;
+                }
+            }
+            return -1;
+        }
+
+        BufferHeader* headerOf(char* buf) {
+            BufferHeader* h = reinterpret_cast<BufferHeader*>(buf) - 1;
+            verify(h->magic == headerMagic);
+            return h;
+        }
+
+        char* newBuffer(int sizeClass, size_t size) {
+            BufferHeader* h = static_cast<BufferHeader*>(malloc(sizeof(BufferHeader) + size));
+            verify(h);
+            h->sizeClass = sizeClass;
+            h->magic = headerMagic;
+            return reinterpret_cast<char*>(h + 1);
+        }
+
+        void freeBuffer(char* buf) {
+            free(headerOf(buf));
+        }
+
+        AtomicUInt64 totalAllocations;
+        AtomicUInt64 totalThreadCacheHits;
+        AtomicUInt64 sharedHits;
+        AtomicUInt64 discarded;
+        // in the thread caches and the shared buffers together, limited by maxRetainedMB
+        AtomicInt64 retainedBytes;
+        AtomicInt64 threadCachedBytes;
+
+        long long maxRetainedBytes() {
+            return (long long) std::max(MessageBufferPool::maxRetainedMB, 0) * 1024 * 1024;
+        }
+
+        // Counts a buffer of size bytes as retained if there's room for it under maxRetainedMB.
+        // Threads may go over the limit together by a few buffers.
+        bool retain(size_t size) {
+            if (retainedBytes.load() + (long long) size > maxRetainedBytes()) {
+                return false;
+            }
+            retainedBytes.fetchAndAdd(size);
+            return true;
+        }
+
+        void unretain(size_t size) {
+            retainedBytes.fetchAndSubtract(size);
+        }
+
+        struct ThreadCache {
+            vector<char*> buffers[threadCacheClasses];
+            size_t bytes;
+            // counted here and added to the totals now and then, to keep the common path off
+            // shared cache lines
+            unsigned long long allocations;
+            unsigned long long hits;
+
+            ThreadCache() : bytes(0), allocations(0), hits(0) {}
+            ~ThreadCache() {
+                for (int c = 0; c < threadCacheClasses; c++) {
+                    for (vector<char*>::iterator it = buffers[c].begin(); it != buffers[c].end(); ++it) {
+                        freeBuffer(*it);
+                    }
+                }
+                unretain(bytes);
+                threadCachedBytes.fetchAndSubtract(bytes);
+                flushCounts();
+            }
+            void flushCounts() {
+                totalAllocations.fetchAndAdd(allocations);
+                totalThreadCacheHits.fetchAndAdd(hits);
+                allocations = hits = 0;
+            }
+        };
+
+        // Neither is ever deleted: threads may still release buffers while statics are torn down.
+        ThreadCache* threadCache() {
+            static boost::thread_specific_ptr<ThreadCache>* caches = new boost::thread_specific_ptr<ThreadCache>();
+            ThreadCache* tc = caches->get();
+            if (!tc) {
+                tc = new ThreadCache();
+                caches->reset(tc);
+            }
+            return tc;
+        }
+
+        struct SharedBuffers {
+            SimpleMutex mutex;
+            vector<char*> buffers[numClasses];
+            SharedBuffers() : mutex("messageBufferPool") {}
+        };
+
+        SharedBuffers& sharedBuffers() {
+            static SharedBuffers* shared = new SharedBuffers();
+            return *shared;
+        }
+
+    } // namespace
+
+    char* MessageBufferPool::allocate(size_t size) {
+        const int c = sizeClassFor(size);
+        if (c < 0) {
+            totalAllocations.fetchAndAdd(1);
+            return newBuffer(-1, size);
+        }
+
+        if (c < threadCacheClasses) {
+            ThreadCache* tc = threadCache();
+            if (++tc->allocations >= 1024) {
+                tc->flushCounts();
+            }
+            if (!tc->buffers[c].empty()) {
+                char* buf = tc->buffers[c].back();
+                tc->buffers[c].pop_back();
+                tc->bytes -= classSize(c);
+                unretain(classSize(c));
+                threadCachedBytes.fetchAndSubtract(classSize(c));
+                tc->hits++;
+                return buf;
+            }
+        }
+        else {
+            totalAllocations.fetchAndAdd(1);
+        }
+
+        SharedBuffers& shared = sharedBuffers();
+        {
+            SimpleMutex::scoped_lock lk(shared.mutex);
+            if (!shared.buffers[c].empty()) {
+                char* buf = shared.buffers[c].back();
+                shared.buffers[c].pop_back();
+                unretain(classSize(c));
+                sharedHits.fetchAndAdd(1);
+                return buf;
+            }
+        }
+        return newBuffer(c, classSize(c));
+    }
+
+    void MessageBufferPool::release(char* buf) {
+        const int c = headerOf(buf)->sizeClass;
+        if (c < 0) {
+            freeBuffer(buf);
+            return;
+        }
+
+        const size_t size = classSize(c);
+        if (c < threadCacheClasses) {
+            ThreadCache* tc = threadCache();
+            if (tc->buffers[c].size() < threadCacheBuffersPerClass &&
+                tc->bytes + size <= threadCacheMaxBytes && retain(size)) {
+                tc->buffers[c].push_back(buf);
+                tc->bytes += size;
+                threadCachedBytes.fetchAndAdd(size);
+                return;
+            }
+        }
+
+        SharedBuffers& shared = sharedBuffers();
+        {
+            SimpleMutex::scoped_lock lk(shared.mutex);
+            if (retain(size)) {
+                shared.buffers[c].push_back(buf);
+                return;
+            }
+        }
+        discarded.fetchAndAdd(1);
+        freeBuffer(buf);
+    }
+
+    void MessageBufferPool::appendStats(BSONObjBuilder& b) {
+        // each thread adds its allocations and hits every 1024 allocations
+        b.appendNumber("allocations", (long long) totalAllocations.load());
+        b.appendNumber("threadCacheHits", (long long) totalThreadCacheHits.load());
+        b.appendNumber("sharedHits", (long long) sharedHits.load());
+        b.appendNumber("discarded", (long long) discarded.load());
+        b.appendNumber("retainedBytes", (long long) retainedBytes.load());
+        b.appendNumber("threadCacheBytes", (long long) threadCachedBytes.load());
+        b.appendNumber("maxRetainedBytes", maxRetainedBytes());
+    }
+
+} // namespace mongo
@@ -0,0 +1,54 @@
+// message_buffer_pool.h
+
+/*    Copyright 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Recycles the buffers that Messages are received into (and that some are sent from), so a
+     * busy server doesn't malloc and free one per operation.
+     *
+     * Buffers come in power of two size classes from 1KB to 1MB; bigger ones are malloc'd at
+     * their exact size and not kept.  Each thread keeps a few small ones (up to 64KB) for
+     * itself, which is where small request/response traffic is served from without any locking.
+     * Bigger ones are shared between threads.  At most maxRetainedMB are kept in all, counting
+     * the threads' own.
+     *
+     * Buffers must be given back with release(), not free(); Message tracks which of its
+     * buffers came from here.
+     */
+    class MessageBufferPool {
+    public:
+        /** @return a buffer of at least size bytes. */
+        static char* allocate( size_t size );
+
+        /** Takes back a buffer allocate() returned. */
+        static void release( char* buf );
+
+        /** Appends reuse statistics. */
+        static void appendStats( BSONObjBuilder& b );
+
+        /** Limit on the memory held in the pool, thread caches included, in megabytes. */
+        static int maxRetainedMB;
+    };
+
+} // namespace mongo
@@ -0,0 +1,228 @@
+// message_compressor.cpp
+
+/*    Copyright 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_compressor.h"
+
+#include <zlib.h>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_buffer_pool.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+#pragma pack(1)
+        struct CompressedHeader {
+            int originalOpCode;
+            int uncompressedSize;
+            char compressorId;
+        };
+#pragma pack()
+
+        const int compressedPrefixSize = sizeof(MSGHEADER) + sizeof(CompressedHeader);
+
+        AtomicUInt64 messagesCompressed;
+        AtomicUInt64 bytesBeforeCompression;
+        AtomicUInt64 bytesAfterCompression;
+        AtomicUInt64 compressMicros;
+        AtomicUInt64 incompressible;
+
+        AtomicUInt64 messagesDecompressed;
+        AtomicUInt64 bytesBeforeDecompression;
+        AtomicUInt64 bytesAfterDecompression;
+        AtomicUInt64 decompressMicros;
+
+    } // namespace
+
+    const char* MessageCompressor::name( Id id ) {
+        switch ( id ) {
+        case zlib: return "zlib";
+        default: return "none";
+        }
+    }
+
+    MessageCompressor::Id MessageCompressor::fromName( const string& name ) {
+        if ( name == "zlib" ) {
+            return zlib;
+        }
+        return none;
+    }
+
+    bool MessageCompressor::compress( Id id, const Message& toSend, Message& out ) {
+        verify( id == zlib );
+        verify( out.empty() );
+        const int bodySize = toSend.dataSize();
+        if ( toSend.size() < minMessageBytes ) {
+            return false;
+        }
+
+        Timer t;
+        z_stream zs;
+        memset( &zs, 0, sizeof zs );
+        int rc = deflateInit( &zs, Z_BEST_SPEED );
+        massert( 17393, str::stream() << "zlib deflateInit failed: " << rc, rc == Z_OK );
+        ON_BLOCK_EXIT( deflateEnd, &zs );
+
+        const uLong bound = deflateBound( &zs, bodySize );
+        char *buf = MessageBufferPool::allocate( compressedPrefixSize + bound );
+        ScopeGuard guard = MakeGuard( MessageBufferPool::release, buf );
+
+        zs.next_out = reinterpret_cast<Bytef*>( buf + compressedPrefixSize );
+        zs.avail_out = bound;
+        const int n = toSend.numBuffers();
+        for ( int i = 0; i < n; i++ ) {
+            pair< char*, int > b = toSend.buffer( i );
+            if ( i == 0 ) {
+                b.first += sizeof(MSGHEADER);
+                b.second -= sizeof(MSGHEADER);
+            }
+            zs.next_in = reinterpret_cast<Bytef*>( b.first );
+            zs.avail_in = b.second;
+            rc = deflate( &zs, i == n - 1 ? Z_FINISH : Z_NO_FLUSH );
+            if ( rc == Z_STREAM_ERROR || zs.avail_in != 0 ) {
+                break;
+            }
+        }
+
+        const int compressedSize = bound - zs.avail_out;
+        if ( rc != Z_STREAM_END || compressedSize + int(sizeof(CompressedHeader)) >= bodySize ) {
+            incompressible.fetchAndAdd( 1 );
+            return false;
+        }
+
+        MsgData *md = reinterpret_cast<MsgData*>( buf );
+        md->len = compressedPrefixSize + compressedSize;
+        md->id = toSend.header()->id;
+        md->responseTo = toSend.header()->responseTo;
+        md->setOperation( dbCompressed );
+        CompressedHeader *ch = reinterpret_cast<CompressedHeader*>( md->_data );
+        ch->originalOpCode = toSend.operation();
+        ch->uncompressedSize = bodySize;
+        ch->compressorId = id;
+
+        guard.Dismiss();
+        out.setPooledData( md );
+
+        messagesCompressed.fetchAndAdd( 1 );
+        bytesBeforeCompression.fetchAndAdd( toSend.size() );
+        bytesAfterCompression.fetchAndAdd( md->len );
+        compressMicros.fetchAndAdd( t.micros() );
+        return true;
+    }
+
+    bool MessageCompressor::decompress( const Message& compressed, Message& out, string& errmsg ) {
+        verify( out.empty() );
+        const MsgData *md = compressed.singleData();
+        if ( md->len < compressedPrefixSize ) {
+            errmsg = "compressed message too short";
+            return false;
+        }
+        const CompressedHeader *ch = reinterpret_cast<const CompressedHeader*>( md->_data );
+        if ( ch->compressorId != zlib ) {
+            errmsg = str::stream() << "unknown compressor " << int(ch->compressorId);
+            return false;
+        }
+        if ( ch->originalOpCode == dbCompressed ) {
+            errmsg = "compressed message inside a compressed message";
+            return false;
+        }
+        if ( ch->uncompressedSize < 0 ||
+             ch->uncompressedSize > MaxMessageSizeBytes - int(sizeof(MSGHEADER)) ) {
+            errmsg = str::stream() << "uncompressed size " << ch->uncompressedSize
+                                   << " is out of range";
+            return false;
+        }
+
+        Timer t;
+        const int len = sizeof(MSGHEADER) + ch->uncompressedSize;
+        char *buf = MessageBufferPool::allocate( len );
+        ScopeGuard guard = MakeGuard( MessageBufferPool::release, buf );
+
+        uLongf destLen = ch->uncompressedSize;
+        const int rc = uncompress( reinterpret_cast<Bytef*>( buf + sizeof(MSGHEADER) ), &destLen,
+                                   reinterpret_cast<const Bytef*>( ch + 1 ),
+                                   md->len - compressedPrefixSize );
+        if ( rc != Z_OK || destLen != uLongf( ch->uncompressedSize ) ) {
+            errmsg = str::stream() << "zlib uncompress failed: " << rc;
+            return false;
+        }
+
+        MsgData *original = reinterpret_cast<MsgData*>( buf );
+        original->len = len;
+        original->id = md->id;
+        original->responseTo = md->responseTo;
+        original->setOperation( ch->originalOpCode );
+
+        guard.Dismiss();
+        out.setPooledData( original );
+
+        messagesDecompressed.fetchAndAdd( 1 );
+        bytesBeforeDecompression.fetchAndAdd( md->len );
+        bytesAfterDecompression.fetchAndAdd( len );
+        decompressMicros.fetchAndAdd( t.micros() );
+        return true;
+    }
+
+    void MessageCompressor::negotiate( const BSONObj& cmdObj, AbstractMessagingPort* port,
+                                       BSONObjBuilder& result ) {
+        BSONElement e = cmdObj["compression"];
+        MessagingPort *mp = dynamic_cast<MessagingPort*>( port );
+        if ( e.type() != Array || !mp ) {
+            return;
+        }
+        BSONForEach( c, e.Obj() ) {
+            Id id = c.type() == String ? fromName( c.String() ) : none;
+            if ( id != none ) {
+                mp->setCompressor( id );
+                result.append( "compression", name( id ) );
+                return;
+            }
+        }
+    }
+
+    void MessageCompressor::appendStats( BSONObjBuilder& b ) {
+        const unsigned long long before = bytesBeforeCompression.load();
+        const unsigned long long after = bytesAfterCompression.load();
+        {
+            BSONObjBuilder c( b.subobjStart( "compressed" ) );
+            c.appendNumber( "messages", (long long) messagesCompressed.load() );
+            c.appendNumber( "bytesIn", (long long) before );
+            c.appendNumber( "bytesOut", (long long) after );
+            c.append( "ratio", after ? double( before ) / after : 1.0 );
+            c.appendNumber( "micros", (long long) compressMicros.load() );
+            c.appendNumber( "incompressible", (long long) incompressible.load() );
+            c.done();
+        }
+        {
+            BSONObjBuilder d( b.subobjStart( "decompressed" ) );
+            d.appendNumber( "messages", (long long) messagesDecompressed.load() );
+            d.appendNumber( "bytesIn", (long long) bytesBeforeDecompression.load() );
+            d.appendNumber( "bytesOut", (long long) bytesAfterDecompression.load() );
+            d.appendNumber( "micros", (long long) decompressMicros.load() );
+            d.done();
+        }
+    }
+
+} // namespace mongo
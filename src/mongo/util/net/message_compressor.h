@@ -0,0 +1,87 @@
+// message_compressor.h
+
+/*    Copyright 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace mongo {
+
+    class AbstractMessagingPort;
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Compression of the messages sent over a connection, for links where bandwidth is scarcer
+     * than cpu (replication and migrations between data centers, mongos to remote shards).
+     *
+     * Nothing is compressed unless the client asks for it, by sending
+     *   { isMaster : 1, compression : [ "zlib", ... ] }
+     * A server that supports one of the listed compressors answers with the one it picked
+     * (compression : "zlib") and from then on compresses its replies on that connection; the
+     * client does the same for what it sends once it sees the answer.  Older servers ignore the
+     * field, so the connection stays uncompressed.  See DBClientConnection::enableCompression().
+     *
+     * A compressed message has a header of its own, with the id and responseTo of the original
+     * and opCode dbCompressed, followed by
+     *   int32  opCode of the original
+     *   int32  size of the original body (everything after its header)
+     *   int8   compressor id
+     *   ...    the compressed body
+     */
+    class MessageCompressor {
+    public:
+        enum Id {
+            none = 0,
+            zlib = 1
+        };
+
+        /** @return the name of id, as used in isMaster. */
+        static const char* name( Id id );
+
+        /** @return the compressor called name, or none if there isn't one. */
+        static Id fromName( const std::string& name );
+
+        /**
+         * Compresses toSend, which must have its id and responseTo set already, into out.
+         * @return false, leaving out empty, if toSend is too small to bother with or doesn't
+         *         get any smaller.
+         */
+        static bool compress( Id id, const Message& toSend, Message& out );
+
+        /**
+         * Restores the original of a dbCompressed message into out.
+         * @return false if compressed is malformed; errmsg says why.
+         */
+        static bool decompress( const Message& compressed, Message& out, std::string& errmsg );
+
+        /**
+         * Handles the compression field of an isMaster command: switches port to the first
+         * listed compressor this server supports, and reports it in result.
+         */
+        static void negotiate( const BSONObj& cmdObj, AbstractMessagingPort* port,
+                               BSONObjBuilder& result );
+
+        /** Appends byte counts and the time spent compressing and decompressing. */
+        static void appendStats( BSONObjBuilder& b );
+
+        /** Messages smaller than this are always sent as they are. */
+        static const int minMessageBytes = 1024;
+    };
+
+} // namespace mongo
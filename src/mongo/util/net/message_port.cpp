@@ -126,18 +126,19 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0),
+          _compressor( MessageCompressor::none ) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, int ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ), _compressor( MessageCompressor::none ) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressor( MessageCompressor::none ) {
         ports.insert(this);
     }
 
@@ -189,11 +190,9 @@ again:
                 return false;
             }
 
-            int z = (len+1023)&0xfffffc00;
-            verify(z>=len);
-            MsgData *md = (MsgData *) malloc(z);
-            ScopeGuard guard = MakeGuard(free, md);
-            verify(md);
+            char *buf = MessageBufferPool::allocate(len);
+            ScopeGuard guard = MakeGuard(MessageBufferPool::release, buf);
+            MsgData *md = (MsgData *) buf;
             md->len = len;
 
             char *p = (char *) &md->id;
@@ -202,7 +201,18 @@ again:
             psock->recv( p, left );
 
             guard.Dismiss();
-            m.setData(md, true);
+            m.setPooledData(md);
+
+            if ( md->operation() == dbCompressed ) {
+                Message compressed;
+                compressed = m;
+                string errmsg;
+                if ( !MessageCompressor::decompress( compressed, m, errmsg ) ) {
+                    LOG(0) << "recv(): bad compressed message from " << remote() << ": "
+                           << errmsg << endl;
+                    return false;
+                }
+            }
             return true;
 
         }
@@ -270,6 +280,14 @@ again:
             }
         }
 
+        if ( _compressor != MessageCompressor::none ) {
+            Message compressed;
+            if ( MessageCompressor::compress( _compressor, toSend, compressed ) ) {
+                compressed.send( *this, "say" );
+                return;
+            }
+        }
+
         toSend.send( *this, "say" );
     }
 
@@ -19,6 +19,7 @@
 
 #include "sock.h"
 #include "message.h"
+#include "message_compressor.h"
 
 namespace mongo {
 
@@ -90,6 +91,13 @@ namespace mongo {
 
         void piggyBack( Message& toSend , int responseTo = -1 );
 
+        /**
+         * Compresses what say() sends from now on with id, once both ends agreed to it (see
+         * MessageCompressor).  Compressed messages are decompressed by recv() regardless.
+         */
+        void setCompressor( MessageCompressor::Id id ) { _compressor = id; }
+        MessageCompressor::Id compressor() const { return _compressor; }
+
         unsigned remotePort() const { return psock->remotePort(); }
         virtual HostAndPort remote() const;
 
@@ -127,6 +135,8 @@ namespace mongo {
         // mutable because its initialized only on call to remote()
         mutable HostAndPort _remoteParsed; 
 
+        MessageCompressor::Id _compressor;
+
     public:
         static void closeAllSockets(unsigned tagMask = 0xffffffff);
 